@@ -5,6 +5,9 @@
 #include <logging.hpp>
 #include <thread>
 #include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include "FecCodec.hpp"
 #include <ValidationConfig.hpp>
 #include <ThreadSafeQueue.hpp>
 
@@ -19,21 +22,41 @@ public:
     ThreadSafeQueue<Frame>& getOutgoingFrames();
     void receiveFrameWithCrc(const Frame& frameWithCrc);
 
+    // Groups frames sent on `connId` and adds parity frames so the receiver
+    // rebuilds lost frames without a retransmit. FecScheme::NONE turns it off
+    // (a partial group is closed first). Throws invalid_argument on a bad config.
+    void setForwardErrorCorrection(ConnectionId connId, const FecConfig& config);
+    // Worst-case growth of a frame while any connection uses FEC, else 0
+    size_t frameOverheadBytes() const;
+    size_t recoveredFrames() const;
+
 private:
     uint32_t crc32(const vector<uint8_t>& data);
     void initializeConstraints();
     void ensureFrameEncodable(const Frame& frame) const;
     void ensureFrameDecodable(const Frame& frameWithCrc) const;
+    // The frame keeps the connection and peer it is sent for, which
+    // multi-peer links route by, and whether it waits for the pacer
+    void pushWithCrc(vector<uint8_t>&& data, uint32_t crcMask, ConnectionId connId, LinkAddress peer, bool paced);
+    void flushFecGroups();
     ThreadSafeQueue<Frame>& inputFrames_;
     ThreadSafeQueue<Frame> outgoingFrames_;
     TransportLayer& transportLayer_;
     const ValidationConfig& validationConfig_;
     size_t headerBytesWithoutPayload_{};
+    size_t minFrameBytes_{};
     size_t maxPayloadBytes_{};
     size_t maxFrameBytesWithoutCrc_{};
     size_t maxFrameBytesWithCrc_{};
     uint8_t payloadLengthBytes_{};
     static constexpr size_t CRC_BYTES = 4;
+    // FEC frames carry CRC32 xor this value, so plain frames need no marker
+    static constexpr uint32_t FEC_CRC_MASK = 0x46454331;
+    mutable mutex fecMutex_;
+    unordered_map<ConnectionId, FecEncoder> fecEncoders_;
+    uint32_t nextFecGroupId_{};
+    mutable mutex fecDecoderMutex_;
+    FecDecoder fecDecoder_;
     thread worker_;
     atomic<bool> stopWorker_{false};
 };
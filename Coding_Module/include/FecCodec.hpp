@@ -0,0 +1,114 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+enum class FecScheme : uint8_t {
+    NONE = 0,
+    // One parity frame per group: the XOR of its data frames
+    XOR = 1,
+    // parityFrames parity frames per group; any parityFrames losses are repaired
+    REED_SOLOMON = 2
+};
+
+struct FecConfig {
+    FecScheme scheme = FecScheme::NONE;
+    uint8_t dataFrames = 8;    // K — data frames per group
+    uint8_t parityFrames = 1;  // M — parity frames per group (always 1 for XOR)
+    // A group that is not full after this long is closed with the frames it
+    // has, so a quiet link does not hold back repair
+    chrono::milliseconds flushInterval{10};
+};
+
+/**
+ * Systematic erasure code over groups of frames.
+ *
+ * Data frames go out unchanged behind a 5-byte group header, so receivers
+ * deliver them without waiting; parity frames follow once a group is
+ * complete. Parity row p of a K-frame group is a Cauchy row
+ * 1 / ((K + p) xor j) over GF(2^8) (all ones for XOR), which keeps every
+ * square submatrix invertible: any M lost frames of a group can be rebuilt
+ * from any M parity frames that arrived.
+ *
+ * Wire format (the CodingModule CRC is appended after this):
+ *   data:   [groupId:4][index:1][frame]
+ *   parity: [groupId:4][0x80 | parityIndex:1][scheme:1][K:1][M:1][symbol]
+ * A symbol is [frameLength:2][frame] zero-padded to the longest frame of
+ * the group plus 2. Integers are big-endian.
+ */
+namespace fec {
+
+constexpr size_t DATA_HEADER_BYTES = 5;
+constexpr size_t PARITY_HEADER_BYTES = 8;
+constexpr size_t SYMBOL_LENGTH_BYTES = 2;
+// Largest growth of a frame: parity header + symbol length prefix
+constexpr size_t MAX_OVERHEAD_BYTES = PARITY_HEADER_BYTES + SYMBOL_LENGTH_BYTES;
+constexpr uint8_t MAX_DATA_FRAMES = 127;
+constexpr uint8_t MAX_PARITY_FRAMES = 127;
+constexpr size_t MAX_GROUP_FRAMES = 255;
+
+// Throws invalid_argument when the config cannot be encoded
+void validateConfig(const FecConfig& config);
+
+}  // namespace fec
+
+class FecEncoder {
+public:
+    explicit FecEncoder(const FecConfig& config);
+
+    // Appends the wrapped frame, and the group's parity frames once the group is full
+    void encode(const vector<uint8_t>& frame, uint32_t& nextGroupId,
+                chrono::steady_clock::time_point now, vector<vector<uint8_t>>& out);
+    // Closes a partial group older than flushInterval (any partial group if force)
+    void flush(chrono::steady_clock::time_point now, vector<vector<uint8_t>>& out, bool force = false);
+
+    const FecConfig& config() const { return config_; }
+
+private:
+    void emitParity(vector<vector<uint8_t>>& out);
+
+    FecConfig config_;
+    uint32_t groupId_ = 0;
+    vector<vector<uint8_t>> group_;
+    chrono::steady_clock::time_point groupStart_{};
+};
+
+class FecDecoder {
+public:
+    static constexpr chrono::milliseconds GROUP_LIFETIME{500};
+    static constexpr size_t MAX_GROUPS = 256;
+
+    // Passes every frame carried by `fecFrame` that was not delivered before to
+    // `deliver`: the data frame itself, or frames rebuilt with its parity.
+    // Throws runtime_error on malformed input.
+    void receive(const uint8_t* fecFrame, size_t size, chrono::steady_clock::time_point now,
+                 const function<void(vector<uint8_t>&&)>& deliver);
+
+    size_t recoveredFrames() const { return recoveredFrames_; }
+
+private:
+    struct Group {
+        chrono::steady_clock::time_point firstSeen;
+        map<uint8_t, vector<uint8_t>> data;      // index -> frame, received or rebuilt
+        map<uint8_t, vector<uint8_t>> parity;    // parity index -> symbol
+        FecScheme scheme = FecScheme::NONE;
+        uint8_t dataFrames = 0;                  // 0 until a parity frame arrived
+        uint8_t parityFrames = 0;
+        bool complete = false;
+    };
+
+    void evict(chrono::steady_clock::time_point now);
+    void tryRecover(Group& group, const function<void(vector<uint8_t>&&)>& deliver);
+
+    unordered_map<uint32_t, Group> groups_;
+    deque<pair<chrono::steady_clock::time_point, uint32_t>> arrivalOrder_;
+    size_t recoveredFrames_ = 0;
+};
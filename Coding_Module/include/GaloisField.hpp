@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+// ============================================================
+// GaloisField — GF(2^8) arithmetic for the Reed-Solomon FEC stage.
+//
+// Field polynomial x^8 + x^4 + x^3 + x^2 + 1 (0x11D). Scalar products use
+// log/exp tables; region products split every byte into nibbles and look
+// both halves up in 16-entry tables, which maps onto one byte shuffle per
+// 16 bytes (SSSE3 pshufb, NEON tbl). The kernel is picked once at run time:
+// SSSE3 on x86 CPUs that have it, NEON on AArch64, portable code elsewhere.
+// ============================================================
+class GaloisField {
+public:
+    static uint8_t mul(uint8_t a, uint8_t b);
+    // a must be non-zero
+    static uint8_t inv(uint8_t a);
+
+    // dst[i] ^= c * src[i]
+    static void mulAddRegion(uint8_t* dst, const uint8_t* src, uint8_t c, size_t size);
+    // dst[i] ^= src[i]
+    static void xorRegion(uint8_t* dst, const uint8_t* src, size_t size);
+
+    // Portable kernel, for comparison in benchmarks and tests
+    static void mulAddRegionScalar(uint8_t* dst, const uint8_t* src, uint8_t c, size_t size);
+
+    // "ssse3", "neon" or "scalar"
+    static const char* kernelName();
+};
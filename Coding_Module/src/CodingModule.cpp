@@ -2,6 +2,7 @@
 #include "TransportLayer.hpp"
 #include <chrono>
 #include <limits>
+#include <random>
 #include <sstream>
 #include <stdexcept>
 #include <thread>
@@ -16,28 +17,32 @@ CodingModule::CodingModule(ThreadSafeQueue<Frame>& inputFrames, TransportLayer&
 	  transportLayer_(transportLayer),
 	  validationConfig_(validationConfig) {
 	initializeConstraints();
+	// Random start keeps group ids of different senders apart at a receiver
+	nextFecGroupId_ = random_device{}();
 	worker_ = thread([this]() {
 		try {
 			while (!stopWorker_) {
 				Frame frame;
 				while (inputFrames_.tryPop(frame)) {
 					ensureFrameEncodable(frame);
-					uint32_t crc = crc32(frame.data);
-					Frame frameWithCrc = frame;
-					if (frameWithCrc.data.size() > maxFrameBytesWithoutCrc_) {
+					if (frame.data.size() > maxFrameBytesWithoutCrc_) {
 						throw runtime_error("Frame size exceeded after validation");
 					}
-					for (int i = 0; i < 4; ++i) {
-						frameWithCrc.data.push_back((crc >> (8 * (3 - i))) & 0xFF);
+					{
+						lock_guard<mutex> lock(fecMutex_);
+						auto it = fecEncoders_.find(frame.connId);
+						if (it != fecEncoders_.end()) {
+							vector<vector<uint8_t>> fecFrames;
+							it->second.encode(frame.data, nextFecGroupId_, steady_clock::now(), fecFrames);
+							for (auto& fecFrame : fecFrames) {
+								pushWithCrc(move(fecFrame), FEC_CRC_MASK, frame.connId, frame.peer, frame.paced);
+							}
+							continue;
+						}
 					}
-					if (frameWithCrc.data.size() > maxFrameBytesWithCrc_) {
-						throw runtime_error("Frame with CRC exceeds allowed length");
-					}
-					outgoingFrames_.push(frameWithCrc);
-					ostringstream oss;
-					oss << "Frame encoded (CRC32) size=" << frameWithCrc.data.size();
-					log(LogLevel::DEBUG, oss.str());
+					pushWithCrc(move(frame.data), 0, frame.connId, frame.peer, frame.paced);
 				}
+				flushFecGroups();
 				this_thread::sleep_for(10ms);
 			}
 		} catch (const exception& ex) {
@@ -74,15 +79,107 @@ void CodingModule::receiveFrameWithCrc(const Frame& frameWithCrc) {
 		receivedCrc = (receivedCrc << 8) | frameWithCrc.data[n - 4 + i];
 	}
 	uint32_t computedCrc = crc32(data);
-	if (receivedCrc != computedCrc) {
+	if (receivedCrc == computedCrc) {
+		Frame decodedFrame;
+		decodedFrame.data = move(data);
+		decodedFrame.peer = frameWithCrc.peer;
+		ensureFrameEncodable(decodedFrame);
+		transportLayer_.receiveFrame(decodedFrame);
+		log(LogLevel::DEBUG, "Frame decoded and forwarded to TransportLayer");
+		return;
+	}
+	if (receivedCrc != (computedCrc ^ FEC_CRC_MASK)) {
 		log(LogLevel::ERROR, "CRC32 mismatch detected");
 		throw runtime_error("CRC32 mismatch: transmission error detected");
 	}
-	Frame decodedFrame;
-	decodedFrame.data = move(data);
-	ensureFrameEncodable(decodedFrame);
-	transportLayer_.receiveFrame(decodedFrame);
-	log(LogLevel::DEBUG, "Frame decoded and forwarded to TransportLayer");
+
+	vector<Frame> decodedFrames;
+	{
+		lock_guard<mutex> lock(fecDecoderMutex_);
+		fecDecoder_.receive(data.data(), data.size(), steady_clock::now(), [&](vector<uint8_t>&& frameData) {
+			Frame decodedFrame;
+			decodedFrame.data = move(frameData);
+			decodedFrame.peer = frameWithCrc.peer;
+			ensureFrameEncodable(decodedFrame);
+			decodedFrames.push_back(move(decodedFrame));
+		});
+	}
+	for (const auto& decodedFrame : decodedFrames) {
+		transportLayer_.receiveFrame(decodedFrame);
+	}
+	if (!decodedFrames.empty()) {
+		log(LogLevel::DEBUG, "FEC frame decoded, forwarded " + to_string(decodedFrames.size()) + " frame(s)");
+	}
+}
+
+void CodingModule::setForwardErrorCorrection(ConnectionId connId, const FecConfig& config) {
+	fec::validateConfig(config);
+	lock_guard<mutex> lock(fecMutex_);
+	auto it = fecEncoders_.find(connId);
+	if (it == fecEncoders_.end() && config.scheme == FecScheme::NONE) {
+		return;
+	}
+	if (it != fecEncoders_.end()) {
+		vector<vector<uint8_t>> fecFrames;
+		it->second.flush(steady_clock::now(), fecFrames, true);
+		for (auto& fecFrame : fecFrames) {
+			pushWithCrc(move(fecFrame), FEC_CRC_MASK, connId, 0, false);
+		}
+		fecEncoders_.erase(it);
+	}
+	if (config.scheme != FecScheme::NONE) {
+		fecEncoders_.emplace(connId, FecEncoder(config));
+	}
+	ostringstream oss;
+	oss << "FEC for connection " << connId << " set to scheme=" << static_cast<int>(config.scheme)
+	    << " K=" << static_cast<int>(config.dataFrames) << " M=" << static_cast<int>(config.parityFrames);
+	log(LogLevel::INFO, oss.str());
+}
+
+size_t CodingModule::frameOverheadBytes() const {
+	lock_guard<mutex> lock(fecMutex_);
+	return fecEncoders_.empty() ? 0 : fec::MAX_OVERHEAD_BYTES;
+}
+
+size_t CodingModule::recoveredFrames() const {
+	lock_guard<mutex> lock(fecDecoderMutex_);
+	return fecDecoder_.recoveredFrames();
+}
+
+void CodingModule::pushWithCrc(vector<uint8_t>&& data, uint32_t crcMask, ConnectionId connId, LinkAddress peer, bool paced) {
+	uint32_t crc = crc32(data) ^ crcMask;
+	for (int i = 0; i < 4; ++i) {
+		data.push_back((crc >> (8 * (3 - i))) & 0xFF);
+	}
+	if (data.size() > maxFrameBytesWithCrc_) {
+		throw runtime_error("Frame with CRC exceeds allowed length");
+	}
+	Frame frameWithCrc;
+	frameWithCrc.data = move(data);
+	frameWithCrc.connId = connId;
+	frameWithCrc.peer = peer;
+	frameWithCrc.paced = paced;
+	size_t size = frameWithCrc.data.size();
+	outgoingFrames_.push(move(frameWithCrc));
+	ostringstream oss;
+	oss << "Frame encoded (CRC32" << (crcMask != 0 ? ", FEC" : "") << ") size=" << size;
+	log(LogLevel::DEBUG, oss.str());
+}
+
+void CodingModule::flushFecGroups() {
+	lock_guard<mutex> lock(fecMutex_);
+	if (fecEncoders_.empty()) {
+		return;
+	}
+	auto now = steady_clock::now();
+	vector<vector<uint8_t>> fecFrames;
+	for (auto& [connId, encoder] : fecEncoders_) {
+		encoder.flush(now, fecFrames);
+		for (auto& fecFrame : fecFrames) {
+			pushWithCrc(move(fecFrame), FEC_CRC_MASK, connId, 0, false);
+		}
+		fecFrames.clear();
+	}
 }
 
 uint32_t CodingModule::crc32(const vector<uint8_t>& data) {
@@ -126,9 +223,13 @@ void CodingModule::initializeConstraints() {
 		throw runtime_error("CodingModule header bytes calculation failed");
 	}
 
+	// Header-compressed frames may be shorter than the full header
+	minFrameBytes_ = validationConfig_.minTransportHeaderBytes();
+
 	maxPayloadBytes_ = (1ULL << (payloadLengthBytes_ * 8)) - 1ULL;
 	maxFrameBytesWithoutCrc_ = headerBytesWithoutPayload_ + maxPayloadBytes_;
-	maxFrameBytesWithCrc_ = maxFrameBytesWithoutCrc_ + CRC_BYTES;
+	// FEC wraps frames in a group header (parity frames also in a length prefix)
+	maxFrameBytesWithCrc_ = maxFrameBytesWithoutCrc_ + fec::MAX_OVERHEAD_BYTES + CRC_BYTES;
 	if (maxFrameBytesWithoutCrc_ < headerBytesWithoutPayload_ ||
 		maxFrameBytesWithCrc_ < maxFrameBytesWithoutCrc_) {
 		throw runtime_error("CodingModule frame constraints overflow");
@@ -136,7 +237,7 @@ void CodingModule::initializeConstraints() {
 }
 
 void CodingModule::ensureFrameEncodable(const Frame& frame) const {
-	if (frame.data.size() < headerBytesWithoutPayload_) {
+	if (frame.data.size() < minFrameBytes_) {
 		throw runtime_error("Frame shorter than transport header");
 	}
 	if (frame.data.size() > maxFrameBytesWithoutCrc_) {
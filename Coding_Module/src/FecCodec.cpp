@@ -0,0 +1,309 @@
+#include "FecCodec.hpp"
+#include "GaloisField.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+using namespace chrono;
+
+// ============================================================
+// Helpers
+// ============================================================
+
+static uint8_t coefficient(FecScheme scheme, size_t dataFrames, size_t parityIndex, size_t dataIndex) {
+    if (scheme == FecScheme::XOR) {
+        return 1;
+    }
+    return GaloisField::inv(static_cast<uint8_t>((dataFrames + parityIndex) ^ dataIndex));
+}
+
+static void writeU32(vector<uint8_t>& out, uint32_t value) {
+    for (int i = 3; i >= 0; --i) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+static uint32_t readU32(const uint8_t* in) {
+    return (static_cast<uint32_t>(in[0]) << 24) | (static_cast<uint32_t>(in[1]) << 16) |
+           (static_cast<uint32_t>(in[2]) << 8) | static_cast<uint32_t>(in[3]);
+}
+
+// symbol ^= c * ([frame.size():2][frame])
+static void mulAddSymbol(uint8_t* symbol, const vector<uint8_t>& frame, uint8_t c) {
+    uint8_t length[fec::SYMBOL_LENGTH_BYTES] = {static_cast<uint8_t>(frame.size() >> 8),
+                                                static_cast<uint8_t>(frame.size())};
+    GaloisField::mulAddRegion(symbol, length, c, fec::SYMBOL_LENGTH_BYTES);
+    GaloisField::mulAddRegion(symbol + fec::SYMBOL_LENGTH_BYTES, frame.data(), c, frame.size());
+}
+
+void fec::validateConfig(const FecConfig& config) {
+    if (config.scheme == FecScheme::NONE) {
+        return;
+    }
+    if (config.scheme != FecScheme::XOR && config.scheme != FecScheme::REED_SOLOMON) {
+        throw invalid_argument("Unknown FEC scheme");
+    }
+    if (config.dataFrames < 1 || config.dataFrames > MAX_DATA_FRAMES) {
+        throw invalid_argument("FEC data frames must be in [1, " + to_string(MAX_DATA_FRAMES) + "]");
+    }
+    if (config.parityFrames < 1 || config.parityFrames > MAX_PARITY_FRAMES) {
+        throw invalid_argument("FEC parity frames must be in [1, " + to_string(MAX_PARITY_FRAMES) + "]");
+    }
+    if (config.scheme == FecScheme::XOR && config.parityFrames != 1) {
+        throw invalid_argument("XOR FEC produces exactly one parity frame per group");
+    }
+    if (config.flushInterval.count() <= 0) {
+        throw invalid_argument("FEC flush interval must be positive");
+    }
+}
+
+// ============================================================
+// Encoder
+// ============================================================
+
+FecEncoder::FecEncoder(const FecConfig& config) : config_(config) {
+    fec::validateConfig(config_);
+    if (config_.scheme == FecScheme::NONE) {
+        throw invalid_argument("FecEncoder requires an FEC scheme");
+    }
+    group_.reserve(config_.dataFrames);
+}
+
+void FecEncoder::encode(const vector<uint8_t>& frame, uint32_t& nextGroupId,
+                        steady_clock::time_point now, vector<vector<uint8_t>>& out) {
+    if (frame.size() > 0xFFFF) {
+        throw runtime_error("Frame too large for FEC symbol");
+    }
+    if (group_.empty()) {
+        groupId_ = nextGroupId++;
+        groupStart_ = now;
+    }
+
+    vector<uint8_t> wrapped;
+    wrapped.reserve(fec::DATA_HEADER_BYTES + frame.size());
+    writeU32(wrapped, groupId_);
+    wrapped.push_back(static_cast<uint8_t>(group_.size()));
+    wrapped.insert(wrapped.end(), frame.begin(), frame.end());
+    out.push_back(move(wrapped));
+
+    group_.push_back(frame);
+    if (group_.size() >= config_.dataFrames) {
+        emitParity(out);
+    }
+}
+
+void FecEncoder::flush(steady_clock::time_point now, vector<vector<uint8_t>>& out, bool force) {
+    if (!group_.empty() && (force || now - groupStart_ >= config_.flushInterval)) {
+        emitParity(out);
+    }
+}
+
+void FecEncoder::emitParity(vector<vector<uint8_t>>& out) {
+    size_t dataFrames = group_.size();
+    size_t parityFrames = config_.scheme == FecScheme::XOR ? 1 : config_.parityFrames;
+    size_t longest = 0;
+    for (const auto& frame : group_) {
+        longest = max(longest, frame.size());
+    }
+    size_t symbolBytes = fec::SYMBOL_LENGTH_BYTES + longest;
+
+    for (size_t p = 0; p < parityFrames; ++p) {
+        vector<uint8_t> parity;
+        parity.reserve(fec::PARITY_HEADER_BYTES + symbolBytes);
+        writeU32(parity, groupId_);
+        parity.push_back(static_cast<uint8_t>(0x80 | p));
+        parity.push_back(static_cast<uint8_t>(config_.scheme));
+        parity.push_back(static_cast<uint8_t>(dataFrames));
+        parity.push_back(static_cast<uint8_t>(parityFrames));
+        parity.resize(fec::PARITY_HEADER_BYTES + symbolBytes, 0);
+
+        uint8_t* symbol = parity.data() + fec::PARITY_HEADER_BYTES;
+        for (size_t j = 0; j < dataFrames; ++j) {
+            mulAddSymbol(symbol, group_[j], coefficient(config_.scheme, dataFrames, p, j));
+        }
+        out.push_back(move(parity));
+    }
+    group_.clear();
+}
+
+// ============================================================
+// Decoder
+// ============================================================
+
+void FecDecoder::receive(const uint8_t* fecFrame, size_t size, steady_clock::time_point now,
+                         const function<void(vector<uint8_t>&&)>& deliver) {
+    if (size < fec::DATA_HEADER_BYTES) {
+        throw runtime_error("FEC frame shorter than its header");
+    }
+    uint32_t groupId = readU32(fecFrame);
+    uint8_t indexByte = fecFrame[4];
+    bool isParity = (indexByte & 0x80) != 0;
+
+    FecScheme scheme = FecScheme::NONE;
+    uint8_t dataFrames = 0;
+    uint8_t parityFrames = 0;
+    if (isParity) {
+        if (size < fec::PARITY_HEADER_BYTES + fec::SYMBOL_LENGTH_BYTES) {
+            throw runtime_error("FEC parity frame shorter than its header");
+        }
+        scheme = static_cast<FecScheme>(fecFrame[5]);
+        dataFrames = fecFrame[6];
+        parityFrames = fecFrame[7];
+        if ((scheme != FecScheme::XOR && scheme != FecScheme::REED_SOLOMON) ||
+            dataFrames < 1 || dataFrames > fec::MAX_DATA_FRAMES ||
+            parityFrames < 1 || parityFrames > fec::MAX_PARITY_FRAMES ||
+            (scheme == FecScheme::XOR && parityFrames != 1) ||
+            (indexByte & 0x7F) >= parityFrames) {
+            throw runtime_error("Malformed FEC parity header");
+        }
+    }
+
+    evict(now);
+    auto it = groups_.find(groupId);
+    if (it == groups_.end()) {
+        it = groups_.emplace(groupId, Group{}).first;
+        it->second.firstSeen = now;
+        arrivalOrder_.emplace_back(now, groupId);
+    }
+    Group& group = it->second;
+    if (group.complete) {
+        return;
+    }
+
+    if (!isParity) {
+        if (group.dataFrames != 0 && indexByte >= group.dataFrames) {
+            throw runtime_error("FEC data index outside its group");
+        }
+        if (group.data.count(indexByte) > 0) {
+            return;
+        }
+        vector<uint8_t> frame(fecFrame + fec::DATA_HEADER_BYTES, fecFrame + size);
+        group.data.emplace(indexByte, frame);
+        deliver(move(frame));
+    } else {
+        if (group.dataFrames == 0) {
+            if (!group.data.empty() && group.data.rbegin()->first >= dataFrames) {
+                throw runtime_error("FEC data index outside its group");
+            }
+            group.scheme = scheme;
+            group.dataFrames = dataFrames;
+            group.parityFrames = parityFrames;
+        } else if (group.scheme != scheme || group.dataFrames != dataFrames || group.parityFrames != parityFrames) {
+            throw runtime_error("FEC parity frames of one group disagree");
+        }
+        size_t symbolBytes = size - fec::PARITY_HEADER_BYTES;
+        if (!group.parity.empty() && group.parity.begin()->second.size() != symbolBytes) {
+            throw runtime_error("FEC parity frames of one group differ in length");
+        }
+        group.parity.emplace(static_cast<uint8_t>(indexByte & 0x7F),
+                             vector<uint8_t>(fecFrame + fec::PARITY_HEADER_BYTES, fecFrame + size));
+    }
+
+    tryRecover(group, deliver);
+}
+
+void FecDecoder::tryRecover(Group& group, const function<void(vector<uint8_t>&&)>& deliver) {
+    if (group.dataFrames == 0) {
+        return;
+    }
+    size_t missing = group.dataFrames - group.data.size();
+    if (missing == 0) {
+        group.complete = true;
+        group.data.clear();
+        group.parity.clear();
+        return;
+    }
+    if (group.parity.size() < missing) {
+        return;
+    }
+
+    size_t symbolBytes = group.parity.begin()->second.size();
+    vector<uint8_t> lost;
+    for (uint8_t j = 0; j < group.dataFrames; ++j) {
+        if (group.data.count(j) == 0) {
+            lost.push_back(j);
+        } else if (group.data[j].size() + fec::SYMBOL_LENGTH_BYTES > symbolBytes) {
+            throw runtime_error("FEC data frame longer than its group's parity");
+        }
+    }
+
+    // Parity minus the contribution of the frames that did arrive leaves
+    // A * lost, with A the parity rows restricted to the lost columns
+    vector<uint8_t> rows;
+    vector<vector<uint8_t>> rhs;
+    for (auto& [parityIndex, symbol] : group.parity) {
+        if (rows.size() == missing) {
+            break;
+        }
+        rows.push_back(parityIndex);
+        vector<uint8_t> value = symbol;
+        for (const auto& [dataIndex, frame] : group.data) {
+            mulAddSymbol(value.data(), frame, coefficient(group.scheme, group.dataFrames, parityIndex, dataIndex));
+        }
+        rhs.push_back(move(value));
+    }
+
+    // Gauss-Jordan: reduce [A | I] to [I | A^-1]
+    vector<vector<uint8_t>> a(missing, vector<uint8_t>(missing));
+    vector<vector<uint8_t>> inverse(missing, vector<uint8_t>(missing, 0));
+    for (size_t r = 0; r < missing; ++r) {
+        for (size_t c = 0; c < missing; ++c) {
+            a[r][c] = coefficient(group.scheme, group.dataFrames, rows[r], lost[c]);
+        }
+        inverse[r][r] = 1;
+    }
+    for (size_t col = 0; col < missing; ++col) {
+        size_t pivot = col;
+        while (pivot < missing && a[pivot][col] == 0) {
+            ++pivot;
+        }
+        if (pivot == missing) {
+            throw runtime_error("FEC decoding matrix is singular");
+        }
+        swap(a[pivot], a[col]);
+        swap(inverse[pivot], inverse[col]);
+        uint8_t scale = GaloisField::inv(a[col][col]);
+        for (size_t c = 0; c < missing; ++c) {
+            a[col][c] = GaloisField::mul(a[col][c], scale);
+            inverse[col][c] = GaloisField::mul(inverse[col][c], scale);
+        }
+        for (size_t r = 0; r < missing; ++r) {
+            uint8_t factor = a[r][col];
+            if (r == col || factor == 0) {
+                continue;
+            }
+            for (size_t c = 0; c < missing; ++c) {
+                a[r][c] ^= GaloisField::mul(factor, a[col][c]);
+                inverse[r][c] ^= GaloisField::mul(factor, inverse[col][c]);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < missing; ++i) {
+        vector<uint8_t> symbol(symbolBytes, 0);
+        for (size_t r = 0; r < missing; ++r) {
+            GaloisField::mulAddRegion(symbol.data(), rhs[r].data(), inverse[i][r], symbolBytes);
+        }
+        size_t length = (static_cast<size_t>(symbol[0]) << 8) | symbol[1];
+        if (length + fec::SYMBOL_LENGTH_BYTES > symbolBytes) {
+            throw runtime_error("FEC rebuilt a frame longer than its symbol");
+        }
+        ++recoveredFrames_;
+        deliver(vector<uint8_t>(symbol.begin() + fec::SYMBOL_LENGTH_BYTES,
+                                symbol.begin() + fec::SYMBOL_LENGTH_BYTES + length));
+    }
+
+    group.complete = true;
+    group.data.clear();
+    group.parity.clear();
+}
+
+void FecDecoder::evict(steady_clock::time_point now) {
+    while (!arrivalOrder_.empty() &&
+           (now - arrivalOrder_.front().first > GROUP_LIFETIME || groups_.size() >= MAX_GROUPS)) {
+        groups_.erase(arrivalOrder_.front().second);
+        arrivalOrder_.pop_front();
+    }
+}
@@ -0,0 +1,176 @@
+#include "GaloisField.hpp"
+
+#include <array>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define GF_HAVE_SSSE3 1
+#endif
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define GF_HAVE_NEON 1
+#endif
+
+using namespace std;
+
+namespace {
+
+struct Tables {
+    array<uint8_t, 512> exp{};
+    array<uint8_t, 256> log{};
+
+    Tables() {
+        unsigned x = 1;
+        for (int i = 0; i < 255; ++i) {
+            exp[i] = static_cast<uint8_t>(x);
+            log[x] = static_cast<uint8_t>(i);
+            x <<= 1;
+            if (x & 0x100) {
+                x ^= 0x11D;
+            }
+        }
+        // Doubled so that exp[log a + log b] needs no modulo
+        for (int i = 255; i < 512; ++i) {
+            exp[i] = exp[i - 255];
+        }
+    }
+};
+
+const Tables& tables() {
+    static const Tables instance;
+    return instance;
+}
+
+// Products of c with every low nibble and every high nibble
+void nibbleTables(uint8_t c, uint8_t* low, uint8_t* high) {
+    for (int i = 0; i < 16; ++i) {
+        low[i] = GaloisField::mul(c, static_cast<uint8_t>(i));
+        high[i] = GaloisField::mul(c, static_cast<uint8_t>(i << 4));
+    }
+}
+
+void mulAddTail(uint8_t* dst, const uint8_t* src, size_t size, const uint8_t* low, const uint8_t* high) {
+    for (size_t i = 0; i < size; ++i) {
+        dst[i] ^= static_cast<uint8_t>(low[src[i] & 0x0F] ^ high[src[i] >> 4]);
+    }
+}
+
+#ifdef GF_HAVE_SSSE3
+__attribute__((target("ssse3")))
+void mulAddSsse3(uint8_t* dst, const uint8_t* src, uint8_t c, size_t size) {
+    alignas(16) uint8_t low[16];
+    alignas(16) uint8_t high[16];
+    nibbleTables(c, low, high);
+    const __m128i lowTable = _mm_load_si128(reinterpret_cast<const __m128i*>(low));
+    const __m128i highTable = _mm_load_si128(reinterpret_cast<const __m128i*>(high));
+    const __m128i mask = _mm_set1_epi8(0x0F);
+
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i lo = _mm_and_si128(s, mask);
+        __m128i hi = _mm_and_si128(_mm_srli_epi64(s, 4), mask);
+        __m128i product = _mm_xor_si128(_mm_shuffle_epi8(lowTable, lo), _mm_shuffle_epi8(highTable, hi));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_xor_si128(d, product));
+    }
+    mulAddTail(dst + i, src + i, size - i, low, high);
+}
+#endif
+
+#ifdef GF_HAVE_NEON
+void mulAddNeon(uint8_t* dst, const uint8_t* src, uint8_t c, size_t size) {
+    uint8_t low[16];
+    uint8_t high[16];
+    nibbleTables(c, low, high);
+    const uint8x16_t lowTable = vld1q_u8(low);
+    const uint8x16_t highTable = vld1q_u8(high);
+    const uint8x16_t mask = vdupq_n_u8(0x0F);
+
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        uint8x16_t s = vld1q_u8(src + i);
+        uint8x16_t product = veorq_u8(vqtbl1q_u8(lowTable, vandq_u8(s, mask)),
+                                      vqtbl1q_u8(highTable, vshrq_n_u8(s, 4)));
+        vst1q_u8(dst + i, veorq_u8(vld1q_u8(dst + i), product));
+    }
+    mulAddTail(dst + i, src + i, size - i, low, high);
+}
+#endif
+
+using MulAddKernel = void (*)(uint8_t*, const uint8_t*, uint8_t, size_t);
+
+struct Kernel {
+    MulAddKernel mulAdd = GaloisField::mulAddRegionScalar;
+    const char* name = "scalar";
+
+    Kernel() {
+#if defined(GF_HAVE_SSSE3)
+        if (__builtin_cpu_supports("ssse3")) {
+            mulAdd = mulAddSsse3;
+            name = "ssse3";
+        }
+#elif defined(GF_HAVE_NEON)
+        mulAdd = mulAddNeon;
+        name = "neon";
+#endif
+    }
+};
+
+const Kernel& kernel() {
+    static const Kernel instance;
+    return instance;
+}
+
+}  // namespace
+
+uint8_t GaloisField::mul(uint8_t a, uint8_t b) {
+    if (a == 0 || b == 0) {
+        return 0;
+    }
+    const Tables& t = tables();
+    return t.exp[t.log[a] + t.log[b]];
+}
+
+uint8_t GaloisField::inv(uint8_t a) {
+    const Tables& t = tables();
+    return t.exp[255 - t.log[a]];
+}
+
+void GaloisField::mulAddRegionScalar(uint8_t* dst, const uint8_t* src, uint8_t c, size_t size) {
+    uint8_t low[16];
+    uint8_t high[16];
+    nibbleTables(c, low, high);
+    mulAddTail(dst, src, size, low, high);
+}
+
+void GaloisField::mulAddRegion(uint8_t* dst, const uint8_t* src, uint8_t c, size_t size) {
+    if (c == 0) {
+        return;
+    }
+    if (c == 1) {
+        xorRegion(dst, src, size);
+        return;
+    }
+    kernel().mulAdd(dst, src, c, size);
+}
+
+void GaloisField::xorRegion(uint8_t* dst, const uint8_t* src, size_t size) {
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t a;
+        uint64_t b;
+        memcpy(&a, dst + i, 8);
+        memcpy(&b, src + i, 8);
+        a ^= b;
+        memcpy(dst + i, &a, 8);
+    }
+    for (; i < size; ++i) {
+        dst[i] ^= src[i];
+    }
+}
+
+const char* GaloisField::kernelName() {
+    return kernel().name;
+}
@@ -0,0 +1,152 @@
+#include "FecCodec.hpp"
+#include "GaloisField.hpp"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+using namespace chrono;
+
+static vector<vector<uint8_t>> randomFrames(size_t count, mt19937& rng) {
+    uniform_int_distribution<size_t> length(20, 300);
+    vector<vector<uint8_t>> frames(count);
+    for (auto& frame : frames) {
+        frame.resize(length(rng));
+        for (auto& b : frame) {
+            b = static_cast<uint8_t>(rng());
+        }
+    }
+    return frames;
+}
+
+// Encodes `frames` as one group and feeds every FEC frame except `dropped`
+// (indices into the encoder output) to a decoder; returns what it delivered
+static vector<vector<uint8_t>> transfer(const FecConfig& config, const vector<vector<uint8_t>>& frames,
+                                        const set<size_t>& dropped) {
+    FecEncoder encoder(config);
+    uint32_t groupId = 77;
+    auto now = steady_clock::now();
+    vector<vector<uint8_t>> wire;
+    for (const auto& frame : frames) {
+        encoder.encode(frame, groupId, now, wire);
+    }
+    encoder.flush(now, wire, true);
+
+    FecDecoder decoder;
+    vector<vector<uint8_t>> delivered;
+    for (size_t i = 0; i < wire.size(); ++i) {
+        if (dropped.count(i) == 0) {
+            decoder.receive(wire[i].data(), wire[i].size(), now,
+                            [&](vector<uint8_t>&& frame) { delivered.push_back(move(frame)); });
+        }
+    }
+    return delivered;
+}
+
+// ============================================================
+// Test: GF(2^8) arithmetic
+// ============================================================
+TEST(GaloisField, InverseAndKernelsAgree) {
+    for (int a = 1; a < 256; ++a) {
+        EXPECT_EQ(GaloisField::mul(static_cast<uint8_t>(a), GaloisField::inv(static_cast<uint8_t>(a))), 1);
+    }
+    EXPECT_EQ(GaloisField::mul(0x80, 2), 0x1D);
+
+    // Odd size exercises the vector body and the scalar tail
+    mt19937 rng(3);
+    vector<uint8_t> src(1003);
+    vector<uint8_t> dst(src.size());
+    for (size_t i = 0; i < src.size(); ++i) {
+        src[i] = static_cast<uint8_t>(rng());
+        dst[i] = static_cast<uint8_t>(rng());
+    }
+    for (int c : {2, 0x53, 0xFF}) {
+        vector<uint8_t> fast = dst;
+        vector<uint8_t> reference = dst;
+        GaloisField::mulAddRegion(fast.data(), src.data(), static_cast<uint8_t>(c), src.size());
+        for (size_t i = 0; i < src.size(); ++i) {
+            reference[i] ^= GaloisField::mul(static_cast<uint8_t>(c), src[i]);
+        }
+        EXPECT_EQ(fast, reference) << "kernel " << GaloisField::kernelName() << " c=" << c;
+    }
+}
+
+// ============================================================
+// Test: FEC codec
+// ============================================================
+TEST(FecCodec, XorRebuildsOneLostFrame) {
+    mt19937 rng(1);
+    auto frames = randomFrames(4, rng);
+    FecConfig config{FecScheme::XOR, 4, 1};
+
+    // Output is d0 d1 d2 d3 p0; lose d2
+    auto delivered = transfer(config, frames, {2});
+    ASSERT_EQ(delivered.size(), 4u);
+    EXPECT_EQ(delivered[3], frames[2]);
+
+    // Two losses are beyond XOR: the three frames that arrived still pass
+    EXPECT_EQ(transfer(config, frames, {0, 1}).size(), 2u);
+}
+
+TEST(FecCodec, ReedSolomonRebuildsAnyMLosses) {
+    mt19937 rng(2);
+    auto frames = randomFrames(8, rng);
+    FecConfig config{FecScheme::REED_SOLOMON, 8, 3};
+
+    // Output is d0..d7 p0 p1 p2
+    for (const set<size_t>& dropped : vector<set<size_t>>{{0, 1, 2}, {7, 8, 9}, {3, 5, 10}, {1}, {4, 6}}) {
+        auto delivered = transfer(config, frames, dropped);
+        ASSERT_EQ(delivered.size(), frames.size());
+        multiset<vector<uint8_t>> expected(frames.begin(), frames.end());
+        EXPECT_EQ(multiset<vector<uint8_t>>(delivered.begin(), delivered.end()), expected);
+    }
+}
+
+TEST(FecCodec, PartialGroupAndDuplicates) {
+    mt19937 rng(4);
+    auto frames = randomFrames(3, rng);
+    FecConfig config{FecScheme::REED_SOLOMON, 8, 2};
+
+    // A flushed group of 3 frames carries K=3 in its parity
+    auto delivered = transfer(config, frames, {0, 2});
+    ASSERT_EQ(delivered.size(), 3u);
+
+    FecEncoder encoder(config);
+    uint32_t groupId = 0;
+    auto now = steady_clock::now();
+    vector<vector<uint8_t>> wire;
+    encoder.encode(frames[0], groupId, now, wire);
+    encoder.flush(now, wire);
+    EXPECT_EQ(wire.size(), 1u);
+    encoder.flush(now + config.flushInterval, wire);
+    ASSERT_EQ(wire.size(), 3u);
+
+    // A frame that arrives twice, or after it was rebuilt, is delivered once
+    FecDecoder decoder;
+    size_t count = 0;
+    auto deliver = [&](vector<uint8_t>&&) { ++count; };
+    decoder.receive(wire[1].data(), wire[1].size(), now, deliver);
+    decoder.receive(wire[0].data(), wire[0].size(), now, deliver);
+    decoder.receive(wire[0].data(), wire[0].size(), now, deliver);
+    EXPECT_EQ(count, 1u);
+    EXPECT_EQ(decoder.recoveredFrames(), 1u);
+}
+
+TEST(FecCodec, InvalidInputRejected) {
+    EXPECT_THROW(FecEncoder(FecConfig{FecScheme::XOR, 4, 2}), invalid_argument);
+    EXPECT_THROW(FecEncoder(FecConfig{FecScheme::REED_SOLOMON, 0, 1}), invalid_argument);
+    EXPECT_THROW(FecEncoder(FecConfig{FecScheme::REED_SOLOMON, 128, 1}), invalid_argument);
+    EXPECT_THROW(FecEncoder(FecConfig{FecScheme::NONE, 4, 1}), invalid_argument);
+
+    FecDecoder decoder;
+    auto now = steady_clock::now();
+    auto ignore = [](vector<uint8_t>&&) {};
+    vector<uint8_t> truncated{0, 0, 0, 1};
+    EXPECT_THROW(decoder.receive(truncated.data(), truncated.size(), now, ignore), runtime_error);
+    // Parity index 1 of a group with one parity frame
+    vector<uint8_t> badParity{0, 0, 0, 1, 0x81, 2, 4, 1, 0, 0};
+    EXPECT_THROW(decoder.receive(badParity.data(), badParity.size(), now, ignore), runtime_error);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Binary diff of a payload against a base payload both peers already hold.
+ *
+ * - Greedy copy/literal encoding; copies are found by hashing 4-byte windows
+ *   of the base and by predicting the next copy right after the previous
+ *   one (same-layout state objects diff in a handful of bytes)
+ * - Pure software, portable to ESP32/any platform
+ *
+ * Delta format (integers are LEB128 varints):
+ *   [targetSize] then ops until the end:
+ *     [length << 1 | 0][length literal bytes]
+ *     [length << 1 | 1][base offset]          copy from base
+ */
+class DeltaCodec {
+public:
+    static constexpr size_t MIN_COPY = 6;
+    static constexpr int HASH_LOG = 12;
+
+    static std::string encode(const std::string& base, const std::string& target);
+
+    /**
+     * @throws std::runtime_error on malformed input or when the target would
+     *         exceed maxOutputBytes
+     */
+    static std::string decode(const std::string& base, const char* delta, size_t deltaSize, size_t maxOutputBytes);
+};
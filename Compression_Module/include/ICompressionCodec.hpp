@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Abstract interface for payload compression.
+ * Both peers of a connection must use the same codec; the SDK negotiates
+ * CAPABILITY_COMPRESSION for the built-in Lz4Codec.
+ */
+class ICompressionCodec {
+public:
+    virtual ~ICompressionCodec() = default;
+
+    /**
+     * Compress a payload.
+     * @param data Raw payload bytes
+     * @param size Number of bytes
+     * @return Self-describing compressed blob (carries the original size)
+     */
+    virtual std::string compress(const char* data, size_t size) = 0;
+
+    /**
+     * Decompress a blob produced by compress().
+     * @param compressed Compressed blob
+     * @param maxOutputBytes Upper bound for the restored size; larger blobs are rejected
+     * @return Original payload bytes
+     * @throws std::runtime_error on malformed input
+     */
+    virtual std::string decompress(const std::string& compressed, size_t maxOutputBytes) = 0;
+};
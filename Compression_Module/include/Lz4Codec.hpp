@@ -0,0 +1,30 @@
+#pragma once
+
+#include "ICompressionCodec.hpp"
+
+/**
+ * LZ4 block-format compressor (greedy, single hash table).
+ *
+ * - Byte-compatible with the LZ4 block format, no external dependency
+ * - Pure software, portable to ESP32/any platform
+ * - Hash table lives on the stack (16 KB), no allocations besides the output
+ *
+ * Compressed format: [originalSize: 4B big-endian][LZ4 block]
+ */
+class Lz4Codec : public ICompressionCodec {
+public:
+    static constexpr size_t SIZE_PREFIX_BYTES = 4;
+    static constexpr size_t MIN_MATCH = 4;
+    // LZ4 block rules: the last 5 bytes are always literals and the last
+    // match starts at least 12 bytes before the end of the input.
+    static constexpr size_t LAST_LITERALS = 5;
+    static constexpr size_t MATCH_FIND_LIMIT = 12;
+    static constexpr size_t MAX_DISTANCE = 65535;
+    static constexpr int HASH_LOG = 12;
+
+    std::string compress(const char* data, size_t size) override;
+    std::string decompress(const std::string& compressed, size_t maxOutputBytes) override;
+
+    /** Worst-case size of compress() output for `size` input bytes. */
+    static size_t maxCompressedBytes(size_t size);
+};
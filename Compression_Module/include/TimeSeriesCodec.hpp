@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Gorilla-style codec for numeric sensor samples (timestamp, double value).
+ *
+ * - Timestamps: delta-of-delta, zigzag, prefix-coded buckets
+ *     '0'                      same interval as before
+ *     '10'   + 7 bits          |dod| small
+ *     '110'  + 9 bits
+ *     '1110' + 12 bits
+ *     '1111' + 64 bits
+ * - Values: XOR with the previous value
+ *     '0'                      unchanged
+ *     '10'   + meaningful bits inside the previous leading/trailing window
+ *     '11'   + [leading:5][length-1:6] + meaningful bits
+ * - Regular sampling of a slowly changing signal costs 1 bit per
+ *   timestamp and a few bits to a few bytes per value
+ *
+ * The two columns are separate bitstreams, so the decoder runs two
+ * independent dependency chains per sample and fills both output arrays in
+ * one pass; bits are consumed from a 64-bit register refilled a word at a
+ * time rather than bit by bit.
+ *
+ * Block format:
+ *   [count: varint]
+ *   count >= 1: [firstTimestamp: 8B BE][firstValue: 8B BE]
+ *   count >= 2: [timestampStreamBytes: varint][timestamp bits][value bits]
+ */
+class TimeSeriesCodec {
+public:
+    static std::string encode(const int64_t* timestamps, const double* values, size_t count);
+    static std::string encode(const std::vector<int64_t>& timestamps, const std::vector<double>& values);
+
+    /**
+     * Replaces the contents of `timestamps` and `values`.
+     * @throws std::runtime_error on malformed input or more than maxSamples samples
+     */
+    static void decode(const char* data, size_t size, size_t maxSamples,
+                       std::vector<int64_t>& timestamps, std::vector<double>& values);
+};
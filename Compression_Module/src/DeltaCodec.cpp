@@ -0,0 +1,147 @@
+#include "DeltaCodec.hpp"
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+static inline uint32_t read32(const uint8_t* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint32_t hashWindow(uint32_t window) {
+    return (window * 2654435761U) >> (32 - DeltaCodec::HASH_LOG);
+}
+
+static void putVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+static uint64_t getVarint(const uint8_t*& ip, const uint8_t* end) {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (ip >= end) {
+            throw std::runtime_error("DeltaCodec::decode: truncated varint");
+        }
+        uint8_t byte = *ip++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+    throw std::runtime_error("DeltaCodec::decode: varint too long");
+}
+
+static void putLiteral(std::string& out, const uint8_t* data, size_t length) {
+    if (length == 0) {
+        return;
+    }
+    putVarint(out, static_cast<uint64_t>(length) << 1);
+    out.append(reinterpret_cast<const char*>(data), length);
+}
+
+std::string DeltaCodec::encode(const std::string& base, const std::string& target) {
+    const uint8_t* b = reinterpret_cast<const uint8_t*>(base.data());
+    const uint8_t* t = reinterpret_cast<const uint8_t*>(target.data());
+    const size_t m = base.size();
+    const size_t n = target.size();
+
+    std::string out;
+    out.reserve(16 + n / 8);
+    putVarint(out, n);
+
+    size_t literalStart = 0;
+    if (m >= MIN_COPY && n >= MIN_COPY) {
+        // Base positions are stored +1 so that 0 means "empty slot"
+        std::array<uint32_t, 1U << HASH_LOG> table{};
+        for (size_t i = 0; i + 4 <= m; ++i) {
+            table[hashWindow(read32(b + i))] = static_cast<uint32_t>(i + 1);
+        }
+
+        size_t pos = 0;
+        size_t predicted = 0;
+        while (pos + 4 <= n) {
+            uint32_t window = read32(t + pos);
+            size_t candidate = m;
+            if (predicted + 4 <= m && read32(b + predicted) == window) {
+                candidate = predicted;
+            } else {
+                uint32_t slot = table[hashWindow(window)];
+                if (slot != 0 && read32(b + slot - 1) == window) {
+                    candidate = slot - 1;
+                }
+            }
+            if (candidate == m) {
+                ++pos;
+                continue;
+            }
+
+            size_t length = 4;
+            while (candidate + length < m && pos + length < n && b[candidate + length] == t[pos + length]) {
+                ++length;
+            }
+            size_t back = 0;
+            while (pos - back > literalStart && candidate - back > 0 &&
+                   b[candidate - back - 1] == t[pos - back - 1]) {
+                ++back;
+            }
+            if (length + back < MIN_COPY) {
+                ++pos;
+                continue;
+            }
+            pos -= back;
+            candidate -= back;
+            length += back;
+
+            putLiteral(out, t + literalStart, pos - literalStart);
+            putVarint(out, (static_cast<uint64_t>(length) << 1) | 1U);
+            putVarint(out, candidate);
+
+            pos += length;
+            literalStart = pos;
+            predicted = candidate + length;
+        }
+    }
+    putLiteral(out, t + literalStart, n - literalStart);
+    return out;
+}
+
+std::string DeltaCodec::decode(const std::string& base, const char* delta, size_t deltaSize, size_t maxOutputBytes) {
+    const uint8_t* ip = reinterpret_cast<const uint8_t*>(delta);
+    const uint8_t* const end = ip + deltaSize;
+    uint64_t targetSize = getVarint(ip, end);
+    if (targetSize > maxOutputBytes) {
+        throw std::runtime_error("DeltaCodec::decode: target size exceeds limit");
+    }
+
+    std::string out;
+    out.reserve(static_cast<size_t>(targetSize));
+    while (ip < end) {
+        uint64_t op = getVarint(ip, end);
+        uint64_t length = op >> 1;
+        if (length > targetSize - out.size()) {
+            throw std::runtime_error("DeltaCodec::decode: op overruns target");
+        }
+        if (op & 1U) {
+            uint64_t offset = getVarint(ip, end);
+            if (offset > base.size() || length > base.size() - offset) {
+                throw std::runtime_error("DeltaCodec::decode: copy outside base");
+            }
+            out.append(base, static_cast<size_t>(offset), static_cast<size_t>(length));
+        } else {
+            if (length > static_cast<uint64_t>(end - ip)) {
+                throw std::runtime_error("DeltaCodec::decode: truncated literal");
+            }
+            out.append(reinterpret_cast<const char*>(ip), static_cast<size_t>(length));
+            ip += length;
+        }
+    }
+    if (out.size() != targetSize) {
+        throw std::runtime_error("DeltaCodec::decode: size mismatch");
+    }
+    return out;
+}
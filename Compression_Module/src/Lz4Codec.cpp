@@ -0,0 +1,227 @@
+#include "Lz4Codec.hpp"
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+static inline uint32_t read32(const uint8_t* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint64_t read64(const uint8_t* p) {
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint32_t hashSequence(uint32_t sequence, int hashLog) {
+    return (sequence * 2654435761U) >> (32 - hashLog);
+}
+
+// Length of the common prefix of a and b, stopping at limit
+static inline size_t commonBytes(const uint8_t* a, const uint8_t* b, const uint8_t* limit) {
+    const uint8_t* start = b;
+    while (b + 8 <= limit) {
+        uint64_t diff = read64(a) ^ read64(b);
+        if (diff != 0) {
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            return static_cast<size_t>(b - start) + (__builtin_ctzll(diff) >> 3);
+#else
+            break;
+#endif
+        }
+        a += 8;
+        b += 8;
+    }
+    while (b < limit && *a == *b) {
+        ++a;
+        ++b;
+    }
+    return static_cast<size_t>(b - start);
+}
+
+static inline uint8_t* writeLength(uint8_t* op, size_t length) {
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = static_cast<uint8_t>(length);
+    return op;
+}
+
+static inline uint8_t* writeLiterals(uint8_t* op, const uint8_t* literals, size_t count, uint8_t matchNibble) {
+    uint8_t* token = op++;
+    if (count >= 15) {
+        *token = static_cast<uint8_t>(0xF0 | matchNibble);
+        op = writeLength(op, count - 15);
+    } else {
+        *token = static_cast<uint8_t>((count << 4) | matchNibble);
+    }
+    std::memcpy(op, literals, count);
+    return op + count;
+}
+
+static size_t readLength(const uint8_t*& ip, const uint8_t* end, size_t limit) {
+    size_t length = 0;
+    uint8_t byte;
+    do {
+        if (ip >= end) {
+            throw std::runtime_error("Lz4Codec::decompress: truncated length");
+        }
+        byte = *ip++;
+        length += byte;
+        if (length > limit) {
+            throw std::runtime_error("Lz4Codec::decompress: length exceeds output");
+        }
+    } while (byte == 255);
+    return length;
+}
+
+size_t Lz4Codec::maxCompressedBytes(size_t size) {
+    return SIZE_PREFIX_BYTES + size + size / 255 + 16;
+}
+
+std::string Lz4Codec::compress(const char* data, size_t size) {
+    if (size > 0xFFFFFFFFULL) {
+        throw std::runtime_error("Lz4Codec::compress: input larger than 4 GB");
+    }
+    std::string out(maxCompressedBytes(size), '\0');
+    uint8_t* const outBegin = reinterpret_cast<uint8_t*>(&out[0]);
+    uint8_t* op = outBegin;
+    *op++ = static_cast<uint8_t>(size >> 24);
+    *op++ = static_cast<uint8_t>(size >> 16);
+    *op++ = static_cast<uint8_t>(size >> 8);
+    *op++ = static_cast<uint8_t>(size);
+
+    const uint8_t* src = reinterpret_cast<const uint8_t*>(data);
+    size_t anchor = 0;
+
+    if (size > MATCH_FIND_LIMIT) {
+        // Small inputs use a smaller slice of the table, so clearing it does
+        // not dominate. Positions are stored +1 so that 0 means "empty slot".
+        int hashLog = 8;
+        while (hashLog < HASH_LOG && (size_t{1} << hashLog) < size) {
+            ++hashLog;
+        }
+        std::array<uint32_t, 1U << HASH_LOG> table;
+        std::memset(table.data(), 0, sizeof(uint32_t) << hashLog);
+        const size_t matchLimit = size - LAST_LITERALS;
+        const size_t lastMatchStart = size - MATCH_FIND_LIMIT;
+        size_t pos = 0;
+
+        while (pos <= lastMatchStart) {
+            uint32_t sequence = read32(src + pos);
+            uint32_t& slot = table[hashSequence(sequence, hashLog)];
+            size_t candidate = slot;
+            slot = static_cast<uint32_t>(pos + 1);
+
+            if (candidate == 0 || pos - (candidate - 1) > MAX_DISTANCE ||
+                read32(src + candidate - 1) != sequence) {
+                // Skip faster through incompressible data
+                pos += 1 + ((pos - anchor) >> 6);
+                continue;
+            }
+            size_t match = candidate - 1;
+
+            size_t length = MIN_MATCH + commonBytes(src + match + MIN_MATCH, src + pos + MIN_MATCH,
+                                                    src + matchLimit);
+            while (pos > anchor && match > 0 && src[pos - 1] == src[match - 1]) {
+                --pos;
+                --match;
+                ++length;
+            }
+
+            size_t matchCode = length - MIN_MATCH;
+            op = writeLiterals(op, src + anchor, pos - anchor,
+                               static_cast<uint8_t>(matchCode >= 15 ? 15 : matchCode));
+            size_t offset = pos - match;
+            *op++ = static_cast<uint8_t>(offset);
+            *op++ = static_cast<uint8_t>(offset >> 8);
+            if (matchCode >= 15) {
+                op = writeLength(op, matchCode - 15);
+            }
+
+            pos += length;
+            anchor = pos;
+            if (pos - 2 <= lastMatchStart) {
+                table[hashSequence(read32(src + pos - 2), hashLog)] = static_cast<uint32_t>(pos - 1);
+            }
+        }
+    }
+
+    op = writeLiterals(op, src + anchor, size - anchor, 0);
+    out.resize(static_cast<size_t>(op - outBegin));
+    return out;
+}
+
+std::string Lz4Codec::decompress(const std::string& compressed, size_t maxOutputBytes) {
+    if (compressed.size() < SIZE_PREFIX_BYTES + 1) {
+        throw std::runtime_error("Lz4Codec::decompress: input too short");
+    }
+    const uint8_t* ip = reinterpret_cast<const uint8_t*>(compressed.data());
+    const uint8_t* const end = ip + compressed.size();
+    size_t outSize = (static_cast<size_t>(ip[0]) << 24) | (static_cast<size_t>(ip[1]) << 16) |
+                     (static_cast<size_t>(ip[2]) << 8) | static_cast<size_t>(ip[3]);
+    ip += SIZE_PREFIX_BYTES;
+    if (outSize > maxOutputBytes) {
+        throw std::runtime_error("Lz4Codec::decompress: declared size exceeds limit");
+    }
+
+    std::string out(outSize, '\0');
+    uint8_t* const outBegin = reinterpret_cast<uint8_t*>(&out[0]);
+    uint8_t* op = outBegin;
+    uint8_t* const outEnd = outBegin + outSize;
+
+    while (ip < end) {
+        uint8_t token = *ip++;
+
+        size_t literals = token >> 4;
+        if (literals == 15) {
+            literals += readLength(ip, end, outSize);
+        }
+        if (literals > static_cast<size_t>(end - ip) || literals > static_cast<size_t>(outEnd - op)) {
+            throw std::runtime_error("Lz4Codec::decompress: literals overrun");
+        }
+        std::memcpy(op, ip, literals);
+        op += literals;
+        ip += literals;
+        if (ip == end) {
+            break;
+        }
+
+        if (end - ip < 2) {
+            throw std::runtime_error("Lz4Codec::decompress: truncated offset");
+        }
+        size_t offset = static_cast<size_t>(ip[0]) | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        if (offset == 0 || offset > static_cast<size_t>(op - outBegin)) {
+            throw std::runtime_error("Lz4Codec::decompress: invalid match offset");
+        }
+
+        size_t length = token & 0x0F;
+        if (length == 15) {
+            length += readLength(ip, end, outSize);
+        }
+        length += MIN_MATCH;
+        if (length > static_cast<size_t>(outEnd - op)) {
+            throw std::runtime_error("Lz4Codec::decompress: match overrun");
+        }
+
+        const uint8_t* match = op - offset;
+        if (offset >= length) {
+            std::memcpy(op, match, length);
+            op += length;
+        } else {
+            // Overlapping copy repeats the last `offset` bytes
+            for (size_t i = 0; i < length; ++i) {
+                *op++ = *match++;
+            }
+        }
+    }
+
+    if (op != outEnd) {
+        throw std::runtime_error("Lz4Codec::decompress: size mismatch");
+    }
+    return out;
+}
@@ -0,0 +1,363 @@
+#include "TimeSeriesCodec.hpp"
+#include <cstring>
+#include <stdexcept>
+
+static inline int leadingZeros(uint64_t x) {
+#if defined(__GNUC__)
+    return __builtin_clzll(x);
+#else
+    int n = 0;
+    while ((x & (uint64_t{1} << 63)) == 0) {
+        x <<= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+static inline int trailingZeros(uint64_t x) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(x);
+#else
+    int n = 0;
+    while ((x & 1) == 0) {
+        x >>= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+static inline uint64_t doubleBits(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static inline double bitsToDouble(uint64_t bits) {
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static inline uint64_t loadBigEndian64(const uint8_t* p) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+static void putBigEndian64(std::string& out, uint64_t value) {
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        out.push_back(static_cast<char>((value >> shift) & 0xFF));
+    }
+}
+
+static void putVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+static uint64_t getVarint(const uint8_t*& ip, const uint8_t* end) {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (ip >= end) {
+            throw std::runtime_error("TimeSeriesCodec::decode: truncated varint");
+        }
+        uint8_t byte = *ip++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+    throw std::runtime_error("TimeSeriesCodec::decode: varint too long");
+}
+
+static inline uint64_t zigzag(uint64_t value) {
+    return (value << 1) ^ (0 - (value >> 63));
+}
+
+static inline uint64_t unzigzag(uint64_t value) {
+    return (value >> 1) ^ (0 - (value & 1));
+}
+
+// ============================================================
+// Bit I/O (MSB first)
+// ============================================================
+
+namespace {
+
+class BitWriter {
+public:
+    explicit BitWriter(std::string& out) : out_(out) {}
+
+    // n <= 32
+    void write(uint64_t value, int n) {
+        acc_ = (acc_ << n) | (value & ((uint64_t{1} << n) - 1));
+        used_ += n;
+        while (used_ >= 8) {
+            used_ -= 8;
+            out_.push_back(static_cast<char>(acc_ >> used_));
+        }
+    }
+
+    // n <= 64
+    void writeWide(uint64_t value, int n) {
+        if (n > 32) {
+            write(value >> 32, n - 32);
+            write(value & 0xFFFFFFFFULL, 32);
+        } else {
+            write(value, n);
+        }
+    }
+
+    void finish() {
+        if (used_ > 0) {
+            out_.push_back(static_cast<char>(acc_ << (8 - used_)));
+            used_ = 0;
+        }
+    }
+
+private:
+    std::string& out_;
+    uint64_t acc_ = 0;
+    int used_ = 0;
+};
+
+class BitReader {
+public:
+    BitReader(const uint8_t* begin, const uint8_t* end) : ip_(begin), end_(end) {}
+
+    // n <= 32
+    uint64_t read(int n) {
+        if (available_ < n) {
+            refill();
+            if (available_ < n) {
+                throw std::runtime_error("TimeSeriesCodec::decode: truncated bitstream");
+            }
+        }
+        available_ -= n;
+        return (buffer_ >> available_) & ((uint64_t{1} << n) - 1);
+    }
+
+    // n <= 64
+    uint64_t readWide(int n) {
+        if (n > 32) {
+            uint64_t high = read(n - 32);
+            return (high << 32) | read(32);
+        }
+        return read(n);
+    }
+
+private:
+    void refill() {
+        if (end_ - ip_ >= 8) {
+            // Top up the register with as many whole bytes as fit
+            int bytes = (64 - available_) / 8;
+            uint64_t word = loadBigEndian64(ip_);
+            buffer_ = bytes == 8 ? word : (buffer_ << (bytes * 8)) | (word >> (64 - bytes * 8));
+            ip_ += bytes;
+            available_ += bytes * 8;
+            return;
+        }
+        while (available_ <= 56 && ip_ < end_) {
+            buffer_ = (buffer_ << 8) | *ip_++;
+            available_ += 8;
+        }
+    }
+
+    const uint8_t* ip_;
+    const uint8_t* end_;
+    uint64_t buffer_ = 0;
+    int available_ = 0;
+};
+
+}  // namespace
+
+// ============================================================
+// Encode
+// ============================================================
+
+static void encodeTimestamps(BitWriter& bits, const int64_t* timestamps, size_t count) {
+    uint64_t previous = static_cast<uint64_t>(timestamps[0]);
+    uint64_t previousDelta = 0;
+    for (size_t i = 1; i < count; ++i) {
+        uint64_t current = static_cast<uint64_t>(timestamps[i]);
+        uint64_t delta = current - previous;
+        uint64_t encoded = zigzag(delta - previousDelta);
+        if (encoded == 0) {
+            bits.write(0x0, 1);
+        } else if (encoded < (1u << 7)) {
+            bits.write(0x2, 2);
+            bits.write(encoded, 7);
+        } else if (encoded < (1u << 9)) {
+            bits.write(0x6, 3);
+            bits.write(encoded, 9);
+        } else if (encoded < (1u << 12)) {
+            bits.write(0xE, 4);
+            bits.write(encoded, 12);
+        } else {
+            bits.write(0xF, 4);
+            bits.writeWide(encoded, 64);
+        }
+        previous = current;
+        previousDelta = delta;
+    }
+    bits.finish();
+}
+
+static void encodeValues(BitWriter& bits, const double* values, size_t count) {
+    uint64_t previous = doubleBits(values[0]);
+    int windowLeading = -1;
+    int windowTrailing = 0;
+    for (size_t i = 1; i < count; ++i) {
+        uint64_t current = doubleBits(values[i]);
+        uint64_t x = current ^ previous;
+        previous = current;
+        if (x == 0) {
+            bits.write(0x0, 1);
+            continue;
+        }
+
+        int leading = leadingZeros(x);
+        if (leading > 31) {
+            leading = 31;
+        }
+        int trailing = trailingZeros(x);
+        if (windowLeading >= 0 && leading >= windowLeading && trailing >= windowTrailing) {
+            bits.write(0x2, 2);
+            bits.writeWide(x >> windowTrailing, 64 - windowLeading - windowTrailing);
+        } else {
+            int significant = 64 - leading - trailing;
+            bits.write(0x3, 2);
+            bits.write(static_cast<uint64_t>(leading), 5);
+            bits.write(static_cast<uint64_t>(significant - 1), 6);
+            bits.writeWide(x >> trailing, significant);
+            windowLeading = leading;
+            windowTrailing = trailing;
+        }
+    }
+    bits.finish();
+}
+
+std::string TimeSeriesCodec::encode(const int64_t* timestamps, const double* values, size_t count) {
+    std::string out;
+    putVarint(out, count);
+    if (count == 0) {
+        return out;
+    }
+    putBigEndian64(out, static_cast<uint64_t>(timestamps[0]));
+    putBigEndian64(out, doubleBits(values[0]));
+    if (count == 1) {
+        return out;
+    }
+
+    std::string timestampBits;
+    timestampBits.reserve(count / 8 + 16);
+    BitWriter timestampWriter(timestampBits);
+    encodeTimestamps(timestampWriter, timestamps, count);
+
+    putVarint(out, timestampBits.size());
+    out += timestampBits;
+    BitWriter valueWriter(out);
+    encodeValues(valueWriter, values, count);
+    return out;
+}
+
+std::string TimeSeriesCodec::encode(const std::vector<int64_t>& timestamps, const std::vector<double>& values) {
+    if (timestamps.size() != values.size()) {
+        throw std::runtime_error("TimeSeriesCodec::encode: timestamps and values differ in length");
+    }
+    return encode(timestamps.data(), values.data(), timestamps.size());
+}
+
+// ============================================================
+// Decode
+// ============================================================
+
+static inline uint64_t readDeltaOfDelta(BitReader& bits) {
+    if (bits.read(1) == 0) {
+        return 0;
+    }
+    if (bits.read(1) == 0) {
+        return unzigzag(bits.read(7));
+    }
+    if (bits.read(1) == 0) {
+        return unzigzag(bits.read(9));
+    }
+    if (bits.read(1) == 0) {
+        return unzigzag(bits.read(12));
+    }
+    return unzigzag(bits.readWide(64));
+}
+
+void TimeSeriesCodec::decode(const char* data, size_t size, size_t maxSamples,
+                             std::vector<int64_t>& timestamps, std::vector<double>& values) {
+    const uint8_t* ip = reinterpret_cast<const uint8_t*>(data);
+    const uint8_t* const end = ip + size;
+
+    uint64_t count = getVarint(ip, end);
+    if (count > maxSamples) {
+        throw std::runtime_error("TimeSeriesCodec::decode: sample count exceeds limit");
+    }
+    timestamps.resize(static_cast<size_t>(count));
+    values.resize(static_cast<size_t>(count));
+    if (count == 0) {
+        return;
+    }
+    if (end - ip < 16) {
+        throw std::runtime_error("TimeSeriesCodec::decode: truncated first sample");
+    }
+    uint64_t timestamp = loadBigEndian64(ip);
+    uint64_t value = loadBigEndian64(ip + 8);
+    ip += 16;
+
+    int64_t* const timestampOut = timestamps.data();
+    double* const valueOut = values.data();
+    timestampOut[0] = static_cast<int64_t>(timestamp);
+    valueOut[0] = bitsToDouble(value);
+    if (count == 1) {
+        return;
+    }
+
+    uint64_t timestampBytes = getVarint(ip, end);
+    if (timestampBytes > static_cast<uint64_t>(end - ip)) {
+        throw std::runtime_error("TimeSeriesCodec::decode: truncated timestamp stream");
+    }
+    BitReader timestampBits(ip, ip + timestampBytes);
+    BitReader valueBits(ip + timestampBytes, end);
+
+    uint64_t delta = 0;
+    int windowLeading = -1;
+    int windowTrailing = 0;
+    for (size_t i = 1; i < count; ++i) {
+        delta += readDeltaOfDelta(timestampBits);
+        timestamp += delta;
+        timestampOut[i] = static_cast<int64_t>(timestamp);
+
+        if (valueBits.read(1) != 0) {
+            uint64_t x;
+            if (valueBits.read(1) == 0) {
+                if (windowLeading < 0) {
+                    throw std::runtime_error("TimeSeriesCodec::decode: value window used before set");
+                }
+                x = valueBits.readWide(64 - windowLeading - windowTrailing) << windowTrailing;
+            } else {
+                int leading = static_cast<int>(valueBits.read(5));
+                int significant = static_cast<int>(valueBits.read(6)) + 1;
+                if (leading + significant > 64) {
+                    throw std::runtime_error("TimeSeriesCodec::decode: invalid value window");
+                }
+                windowLeading = leading;
+                windowTrailing = 64 - leading - significant;
+                x = valueBits.readWide(significant) << windowTrailing;
+            }
+            value ^= x;
+        }
+        valueOut[i] = bitsToDouble(value);
+    }
+}
@@ -0,0 +1,195 @@
+#include <gtest/gtest.h>
+#include "Lz4Codec.hpp"
+#include "DeltaCodec.hpp"
+#include "TimeSeriesCodec.hpp"
+#include <cstring>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// ============================================================
+// Lz4Codec Tests
+// ============================================================
+
+static std::string telemetryJson(int samples) {
+    std::string json = "[";
+    for (int i = 0; i < samples; ++i) {
+        json += "{\"sensor\":\"imu\",\"ts\":" + std::to_string(1700000000 + i * 100) +
+                ",\"ax\":" + std::to_string(i % 7) + ".12,\"ay\":-0.5" + std::to_string(i % 3) +
+                ",\"az\":9.81,\"status\":\"ok\"},";
+    }
+    json += "{}]";
+    return json;
+}
+
+TEST(Lz4Codec, RoundtripRepetitiveJson) {
+    Lz4Codec codec;
+    std::string original = telemetryJson(50);
+
+    std::string compressed = codec.compress(original.data(), original.size());
+    EXPECT_LT(compressed.size(), original.size() / 3);
+
+    EXPECT_EQ(codec.decompress(compressed, original.size()), original);
+}
+
+TEST(Lz4Codec, RoundtripRandomData) {
+    Lz4Codec codec;
+    std::mt19937 rng(42);
+    std::string original(10000, '\0');
+    for (auto& c : original) {
+        c = static_cast<char>(rng());
+    }
+
+    std::string compressed = codec.compress(original.data(), original.size());
+    EXPECT_LE(compressed.size(), Lz4Codec::maxCompressedBytes(original.size()));
+    EXPECT_EQ(codec.decompress(compressed, original.size()), original);
+}
+
+TEST(Lz4Codec, RoundtripShortAndEmpty) {
+    Lz4Codec codec;
+    for (size_t size : {0u, 1u, 5u, 12u, 13u, 17u}) {
+        std::string original(size, 'a');
+        std::string compressed = codec.compress(original.data(), original.size());
+        EXPECT_EQ(codec.decompress(compressed, size), original) << "size=" << size;
+    }
+}
+
+TEST(Lz4Codec, RoundtripLongRuns) {
+    Lz4Codec codec;
+    // Overlapping matches and length bytes beyond 255
+    std::string original(5000, 'x');
+    original += "abcabcabcabcabcabcabcabcabc";
+    original += std::string(300, 'y');
+
+    std::string compressed = codec.compress(original.data(), original.size());
+    EXPECT_LT(compressed.size(), 100u);
+    EXPECT_EQ(codec.decompress(compressed, original.size()), original);
+}
+
+TEST(Lz4Codec, DeclaredSizeAboveLimitRejected) {
+    Lz4Codec codec;
+    std::string original(1000, 'z');
+    std::string compressed = codec.compress(original.data(), original.size());
+    EXPECT_THROW(codec.decompress(compressed, 999), std::runtime_error);
+}
+
+TEST(Lz4Codec, CorruptInputRejected) {
+    Lz4Codec codec;
+    std::string original = telemetryJson(10);
+    std::string compressed = codec.compress(original.data(), original.size());
+
+    EXPECT_THROW(codec.decompress(compressed.substr(0, compressed.size() / 2), original.size()),
+                 std::runtime_error);
+    EXPECT_THROW(codec.decompress("abc", 100), std::runtime_error);
+
+    // Match offset pointing before the start of the output
+    std::string bogus("\x00\x00\x00\x08\x00\xFF\x00", 7);
+    EXPECT_THROW(codec.decompress(bogus, 100), std::runtime_error);
+}
+
+// ============================================================
+// DeltaCodec Tests
+// ============================================================
+
+static std::string sensorState(int tick, double heading) {
+    return "{\"device\":\"esp32-gyro\",\"fw\":\"1.4.2\",\"uptime\":" + std::to_string(100000 + tick) +
+           ",\"gyro\":{\"x\":0.01,\"y\":-0.02,\"z\":" + std::to_string(heading) + "}" +
+           ",\"motor\":{\"rpm\":1200,\"temp\":41.5,\"mode\":\"auto\"}" +
+           ",\"battery\":{\"voltage\":3.71,\"percent\":82},\"wifi\":{\"rssi\":-61,\"ch\":6}}";
+}
+
+TEST(DeltaCodec, SimilarStateIsTiny) {
+    std::string base = sensorState(1, 12.25);
+    std::string target = sensorState(2, 12.5);
+
+    std::string delta = DeltaCodec::encode(base, target);
+    EXPECT_LT(delta.size() * 10, target.size());
+    EXPECT_EQ(DeltaCodec::decode(base, delta.data(), delta.size(), target.size()), target);
+}
+
+TEST(DeltaCodec, RoundtripUnrelatedAndEmpty) {
+    std::mt19937 rng(3);
+    std::string base(500, '\0');
+    std::string target(700, '\0');
+    for (auto& c : base) c = static_cast<char>(rng());
+    for (auto& c : target) c = static_cast<char>(rng());
+
+    for (const auto& [b, t] : {std::make_pair(base, target), std::make_pair(std::string(), target),
+                               std::make_pair(base, std::string()), std::make_pair(target, target)}) {
+        std::string delta = DeltaCodec::encode(b, t);
+        EXPECT_EQ(DeltaCodec::decode(b, delta.data(), delta.size(), t.size()), t);
+    }
+}
+
+TEST(DeltaCodec, MalformedDeltaRejected) {
+    std::string base = sensorState(1, 1.0);
+    std::string target = sensorState(2, 2.0);
+    std::string delta = DeltaCodec::encode(base, target);
+
+    EXPECT_THROW(DeltaCodec::decode(base, delta.data(), delta.size(), target.size() - 1), std::runtime_error);
+    EXPECT_THROW(DeltaCodec::decode(base, delta.data(), delta.size() - 1, target.size()), std::runtime_error);
+    // Copy beyond the end of a shorter base
+    EXPECT_THROW(DeltaCodec::decode(base.substr(0, 20), delta.data(), delta.size(), target.size()),
+                 std::runtime_error);
+}
+
+// ============================================================
+// TimeSeriesCodec Tests
+// ============================================================
+
+static void expectSeriesRoundtrip(const std::vector<int64_t>& timestamps, const std::vector<double>& values) {
+    std::string encoded = TimeSeriesCodec::encode(timestamps, values);
+    std::vector<int64_t> decodedTimestamps;
+    std::vector<double> decodedValues;
+    TimeSeriesCodec::decode(encoded.data(), encoded.size(), timestamps.size(), decodedTimestamps, decodedValues);
+    ASSERT_EQ(decodedTimestamps, timestamps);
+    ASSERT_EQ(decodedValues.size(), values.size());
+    // Bit-exact, including NaN payloads and negative zero
+    EXPECT_EQ(std::memcmp(decodedValues.data(), values.data(), values.size() * sizeof(double)), 0);
+}
+
+TEST(TimeSeriesCodec, RegularSlowSignalIsFewBitsPerSample) {
+    std::vector<int64_t> timestamps;
+    std::vector<double> values;
+    for (int i = 0; i < 1000; ++i) {
+        timestamps.push_back(1700000000000LL + i * 100);
+        values.push_back(static_cast<float>(21.5 + (i / 100) * 0.25));
+    }
+    expectSeriesRoundtrip(timestamps, values);
+    // JSON of the same samples is ~30 bytes each
+    EXPECT_LT(TimeSeriesCodec::encode(timestamps, values).size() * 8, timestamps.size() * 3);
+}
+
+TEST(TimeSeriesCodec, RoundtripIrregularAndSpecialValues) {
+    std::mt19937_64 rng(5);
+    std::vector<int64_t> timestamps = {INT64_MIN, INT64_MAX, 0, -5, 10, 10, 3000, 2999};
+    std::vector<double> values = {0.0, -0.0, std::numeric_limits<double>::infinity(),
+                                  std::numeric_limits<double>::quiet_NaN(), 1e308, -1e-308, 1.0, 1.0};
+    for (int i = 0; i < 500; ++i) {
+        timestamps.push_back(static_cast<int64_t>(rng()) >> (rng() % 64));
+        uint64_t bits = rng();
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        values.push_back(value);
+    }
+    expectSeriesRoundtrip(timestamps, values);
+    expectSeriesRoundtrip({}, {});
+    expectSeriesRoundtrip({42}, {3.5});
+}
+
+TEST(TimeSeriesCodec, MalformedInputRejected) {
+    std::vector<int64_t> timestamps = {1000, 1010, 1020, 1035};
+    std::vector<double> values = {1.0, 1.5, 1.25, 8.0};
+    std::string encoded = TimeSeriesCodec::encode(timestamps, values);
+    std::vector<int64_t> outTimestamps;
+    std::vector<double> outValues;
+
+    EXPECT_THROW(TimeSeriesCodec::decode(encoded.data(), encoded.size(), 3, outTimestamps, outValues),
+                 std::runtime_error);
+    EXPECT_THROW(TimeSeriesCodec::decode(encoded.data(), encoded.size() - 2, 4, outTimestamps, outValues),
+                 std::runtime_error);
+    EXPECT_THROW(TimeSeriesCodec::decode(encoded.data(), 10, 4, outTimestamps, outValues), std::runtime_error);
+    EXPECT_THROW(TimeSeriesCodec::encode(timestamps, std::vector<double>{1.0}), std::runtime_error);
+}
@@ -3,8 +3,10 @@
 #include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <queue>
 #include <string>
+#include <utility>
 #include <commonTypes.hpp>
 #include <logging.hpp>
 #include <ValidationConfig.hpp>
@@ -27,15 +29,46 @@ public:
     virtual void tick() = 0;
     virtual bool tryReceive(Frame& outFrame) = 0;
 
+    // Largest frame (CRC included) that crosses the link as a single packet,
+    // i.e. without IP fragmentation. 0 means the link imposes no limit.
+    virtual size_t maxFrameBytesOnLink() const { return 0; }
+
+    // Invoked with the new maxFrameBytesOnLink() whenever the layer learns a
+    // different path MTU. Set before start().
+    void setOnLinkMtuChanged(function<void(size_t)> handler) { onLinkMtuChanged_ = std::move(handler); }
+
+    // Spreads outgoing frames at `bytesPerSecond`; 0 sends them as fast as
+    // they come. Layers without a pacer ignore it. Callable from any thread.
+    virtual void setPacingRate(double bytesPerSecond) { (void)bytesPerSecond; }
+
+    // Invoked when the link refuses a frame because its send buffer is full.
+    // The frame is kept and retried ahead of later ones. Set before start().
+    void setOnSendBackpressure(function<void()> handler) { onSendBackpressure_ = std::move(handler); }
+
+    // Multi-peer links route each frame by its connection. The SDK binds a
+    // connection to its remote device when the connection is set up and
+    // unbinds it when it is removed, and reports the link address an
+    // accepted handshake of a device came from. Point-to-point layers
+    // ignore all three.
+    virtual void bindConnection(ConnectionId connId, DeviceId remoteId) { (void)connId; (void)remoteId; }
+    virtual void unbindConnection(ConnectionId connId) { (void)connId; }
+    virtual void notePeerAddress(DeviceId remoteId, LinkAddress address) { (void)remoteId; (void)address; }
+
 protected:
     ThreadSafeQueue<Frame>* outgoingFramesFromCodingModule_{nullptr};
     CodingModule* codingModule_{nullptr};
     const ValidationConfig* validationConfig_{nullptr};
 
     size_t headerBytes_{};
+    size_t minFrameBytes_{};
     size_t payloadLimitBytes_{};
     size_t maxFrameBytesWithoutCrc_{};
     size_t maxFrameBytesWithCrc_{};
+    function<void(size_t)> onLinkMtuChanged_;
+    function<void()> onSendBackpressure_;
+
+    void notifyLinkMtuChanged();
+    void notifySendBackpressure();
 
     void setEnvironment(ThreadSafeQueue<Frame>& outgoingFrames,
                         CodingModule& codingModule,
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+using namespace std;
+
+// ============================================================
+// Pacer — token bucket that spreads outgoing frames over time.
+//
+// Tokens (bytes) accrue at the configured rate up to a burst of
+// MAX_BURST_TIME worth of data (at least MIN_BURST_BYTES), so an idle link
+// does not save up credit for a long burst later. A frame may go out once
+// the bucket holds its size or a full burst; the bucket may go into debt
+// for frames larger than the burst. Rate 0 disables pacing.
+//
+// setRate() may be called from any thread; the rest belongs to the
+// sending thread.
+// ============================================================
+class Pacer {
+public:
+    static constexpr chrono::microseconds MAX_BURST_TIME{2000};
+    static constexpr size_t MIN_BURST_BYTES = 3000;
+
+    void setRate(double bytesPerSecond) { rate_ = bytesPerSecond > 0.0 ? bytesPerSecond : 0.0; }
+    double rate() const { return rate_; }
+
+    // Zero if a frame of `bytes` may be sent now, otherwise the time until it may
+    chrono::microseconds delayFor(size_t bytes, chrono::steady_clock::time_point now);
+    void consume(size_t bytes);
+
+private:
+    atomic<double> rate_{0.0};
+    double tokens_ = 0.0;
+    chrono::steady_clock::time_point lastRefill_{};
+};
@@ -25,6 +25,11 @@
 
 class PhysicalLayerEsp32Wifi : public AbstractPhysicalLayer {
 public:
+    // 802.11 MTU minus IPv4 + UDP headers. lwIP does not expose path MTU
+    // discovery, so the WiFi link MTU is used as the path MTU.
+    static constexpr size_t WIFI_MTU = 1500;
+    static constexpr size_t IPV4_UDP_OVERHEAD_BYTES = 28;
+
     /**
      * @param localPort  UDP port to bind (receive on this port)
      * @param remoteHost IP address of the remote peer (e.g. "192.168.4.1")
@@ -43,6 +48,7 @@ public:
     void start() override;
     void tick() override;
     bool tryReceive(Frame& outFrame) override;
+    size_t maxFrameBytesOnLink() const override { return WIFI_MTU - IPV4_UDP_OVERHEAD_BYTES; }
 
     int localPort() const { return localPort_; }
     int remotePort() const { return remotePort_; }
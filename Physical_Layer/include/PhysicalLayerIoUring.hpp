@@ -0,0 +1,139 @@
+#pragma once
+
+// ============================================================
+// PhysicalLayerIoUring — PhysicalLayerUdp with an io_uring worker
+//
+// Datagrams are received by one multishot recvmsg into a ring of
+// kernel-provided buffers, so a busy socket needs no syscall per
+// datagram, and each send batch is one linked chain of sendmsg
+// submissions. Socket setup, path MTU, pacing and the send error
+// handling are those of PhysicalLayerUdp.
+//
+// Linux only (multishot recvmsg needs kernel 6.0). Use
+// makeUdpPhysicalLayer() to fall back to PhysicalLayerUdp where
+// io_uring is missing or disabled.
+// ============================================================
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "PhysicalLayerUdp.hpp"
+
+using namespace std;
+
+struct IoUringConfig {
+    // Submission queue entries; at least the I/O batch size plus a few
+    unsigned queueDepth = 256;
+    // Provided receive buffers (power of two): datagrams the kernel can
+    // take in before the worker hands buffers back
+    unsigned receiveBuffers = 256;
+    // A kernel thread polls the submission queue, so sends need no
+    // io_uring_enter while it is awake (costs a core while busy)
+    bool sqPoll = false;
+    chrono::milliseconds sqPollIdle{50};
+    // Sends go out from a buffer registered with the kernel (zero-copy
+    // send); pays off for large frames only
+    bool registeredBuffers = false;
+};
+
+// PhysicalLayerIoUring when the kernel supports it, else PhysicalLayerUdp
+unique_ptr<PhysicalLayerUdp> makeUdpPhysicalLayer(int localPort, const string& remoteHost, int remotePort,
+                                                  const IoUringConfig& config = IoUringConfig{});
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define UDP_HAVE_IO_URING 1
+#endif
+#endif
+
+#ifdef UDP_HAVE_IO_URING
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct io_uring_buf;
+
+class PhysicalLayerIoUring : public PhysicalLayerUdp {
+public:
+    // Throws runtime_error when the kernel lacks io_uring or an operation
+    // this layer needs
+    PhysicalLayerIoUring(int localPort, const string& remoteHost, int remotePort,
+                         const IoUringConfig& config = IoUringConfig{});
+    ~PhysicalLayerIoUring() override;
+
+    void configure(ThreadSafeQueue<Frame>& outgoingFramesFromCodingModule,
+                   CodingModule& codingModule,
+                   const ValidationConfig& validationConfig) override;
+
+    const IoUringConfig& config() const { return config_; }
+    // False when the kernel rejected multishot recvmsg and every receive
+    // is re-armed after its completion
+    bool multishotReceive() const { return multishotReceive_; }
+
+protected:
+    void workerLoop() override;
+    SendResult sendBatch(size_t& handled) override;
+
+private:
+    void setUpRing();
+    void setUpReceiveBuffers();
+    void releaseRing();
+    io_uring_sqe* nextSqe();
+    // Submits the queued entries and waits for at least `waitFor`
+    // completions (0 = do not wait); a negative timeout waits indefinitely
+    void submitAndWait(unsigned waitFor, chrono::microseconds timeout = chrono::microseconds{-1});
+    void processCompletions();
+    void handleReceive(const io_uring_cqe& cqe);
+    void armReceive();
+    void armWake();
+    void cancelArmedRequests();
+    void recycleReceiveBuffer(uint16_t bufferId);
+
+    IoUringConfig config_;
+    int ringFd_ = -1;
+    // Shared ring memory
+    void* sqRing_ = nullptr;
+    size_t sqRingBytes_ = 0;
+    void* cqRing_ = nullptr;
+    size_t cqRingBytes_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqesBytes_ = 0;
+    unsigned* sqHead_ = nullptr;
+    unsigned* sqTail_ = nullptr;
+    unsigned* sqFlags_ = nullptr;
+    unsigned* sqArray_ = nullptr;
+    unsigned sqMask_ = 0;
+    unsigned sqEntries_ = 0;
+    unsigned* cqHead_ = nullptr;
+    unsigned* cqTail_ = nullptr;
+    unsigned cqMask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+    // Entries queued since the last submission
+    unsigned sqPending_ = 0;
+
+    // Provided receive buffers: ring of descriptors plus the buffer memory
+    io_uring_buf* bufferRing_ = nullptr;
+    size_t bufferRingBytes_ = 0;
+    vector<uint8_t> receiveArena_;
+    size_t receiveBufferBytes_ = 0;
+    bool multishotReceive_ = true;
+    bool receiveArmed_ = false;
+    bool wakeArmed_ = false;
+    uint64_t wakeValue_ = 0;
+    // Header of the receive requests (no address, no control data)
+    msghdr receiveHeader_{};
+
+    // Per-entry state of the send batch in flight
+    vector<msghdr> sendHeaders_;
+    vector<iovec> sendIovecs_;
+    vector<int> sendResults_;
+    size_t sendsInFlight_ = 0;
+    // Zero-copy sends whose buffer the kernel still holds
+    int pendingNotifications_ = 0;
+    // Registered send buffer, one slot per batch entry
+    vector<uint8_t> sendArena_;
+    size_t sendSlotBytes_ = 0;
+};
+
+#endif // UDP_HAVE_IO_URING
@@ -0,0 +1,127 @@
+#pragma once
+
+// ============================================================
+// PhysicalLayerSharedMemory — frames between two processes on one host
+//
+// The two devices share a POSIX shared memory segment named after their
+// DeviceIds; whichever side attaches first creates and lays it out, the
+// other maps it. The segment holds one single-producer/single-consumer
+// byte ring per direction, and frames are copied straight from the
+// coding module into the peer's ring: no socket, no kernel copy. Each
+// worker sleeps on a futex doorbell in the segment that the other side
+// rings only while it sleeps, so a busy link makes no system calls.
+// The last side to detach removes the segment name.
+//
+// Linux only (futex). Point-to-point: Frame::peer is not used, and the
+// pacing rate is ignored, as there is no network queue to protect.
+// ============================================================
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <thread>
+#include <commonTypes.hpp>
+#include "AbstractPhysicalLayer.hpp"
+
+using namespace std;
+
+struct SharedMemoryConfig {
+    // Segment name is "<namePrefix>-<lower DeviceId>-<higher DeviceId>"
+    string namePrefix = "/eminent-shm";
+    // Bytes of each direction's ring; a power of two that holds at least
+    // two frames of the largest size. Both sides must agree.
+    size_t ringBytes = 1 << 20;
+    // How long the second side waits for the first to lay the segment out
+    chrono::milliseconds attachTimeout{1000};
+    // The worker keeps polling its ring this long after the last frame
+    // before it sleeps, so a steady stream is handed over without a futex
+    // wake; costs CPU for that long once the stream stops
+    chrono::microseconds spinBeforeSleep{50};
+};
+
+#if defined(__linux__)
+#define SHM_HAVE_RING 1
+#endif
+
+#ifdef SHM_HAVE_RING
+
+// Segment layout, see PhysicalLayerSharedMemory.cpp
+struct SharedSegment;
+struct SharedRing;
+struct SharedDoorbell;
+
+class PhysicalLayerSharedMemory : public AbstractPhysicalLayer {
+public:
+    static constexpr size_t MIN_RING_BYTES = 64 * 1024;
+
+    // Frames moved and the futex calls that woke or put a worker to sleep,
+    // for system calls per frame
+    struct Stats {
+        uint64_t framesSent = 0;
+        uint64_t framesReceived = 0;
+        uint64_t wakeCalls = 0;
+        uint64_t sleeps = 0;
+    };
+
+    // Attaches to the segment of (self, peer). Throws invalid_argument for
+    // a bad config and runtime_error when the segment cannot be created,
+    // has another layout, or `self` is attached by a live process already.
+    PhysicalLayerSharedMemory(DeviceId self, DeviceId peer, const SharedMemoryConfig& config = SharedMemoryConfig{});
+    ~PhysicalLayerSharedMemory() override;
+
+    void configure(ThreadSafeQueue<Frame>& outgoingFramesFromCodingModule,
+                   CodingModule& codingModule,
+                   const ValidationConfig& validationConfig) override;
+    void start() override;
+    void tick() override;
+    bool tryReceive(Frame& outFrame) override;
+
+    const string& segmentName() const { return segmentName_; }
+    const SharedMemoryConfig& config() const { return config_; }
+    // True while a live process holds the peer's side of the segment
+    bool peerAttached() const;
+    Stats stats() const;
+
+private:
+    void attach();
+    void detach();
+    void claimSide();
+    // Next record of `ring` into `out`; false when the ring is empty
+    bool readFrame(SharedRing& ring, uint8_t* data, Frame& out);
+    // False when the ring has no room for the frame yet
+    bool writeFrame(SharedRing& ring, uint8_t* data, const Frame& frame);
+    bool ringHasRoom(const SharedRing& ring, size_t frameBytes) const;
+    bool sendOutgoingFrames();
+    bool receiveIncomingFrames();
+    void workerLoop();
+    bool hasWork() const;
+    void sleepUntilRung();
+    // Wakes the worker sleeping on `bell`, if any
+    void ring(SharedDoorbell& bell, bool always = false);
+
+    DeviceId self_;
+    DeviceId peer_;
+    SharedMemoryConfig config_;
+    string segmentName_;
+    // Side 0 belongs to the lower DeviceId; side s writes rings[s]
+    int side_ = 0;
+    SharedSegment* segment_ = nullptr;
+    size_t segmentBytes_ = 0;
+    uint8_t* txData_ = nullptr;
+    uint8_t* rxData_ = nullptr;
+
+    thread worker_;
+    atomic<bool> stopWorker_{false};
+    // A frame the ring had no room for; it goes out first
+    optional<Frame> heldFrame_;
+    bool sendBlocked_ = false;
+    atomic<uint64_t> framesSent_{0};
+    atomic<uint64_t> framesReceived_{0};
+    atomic<uint64_t> wakeCalls_{0};
+    atomic<uint64_t> sleeps_{0};
+};
+
+#endif
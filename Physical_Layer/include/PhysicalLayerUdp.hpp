@@ -1,22 +1,93 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <memory>
+#include <mutex>
 #include <netinet/in.h>
+#include <optional>
 #include <queue>
 #include <string>
+#include <sys/socket.h>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 #include <commonTypes.hpp>
 #include "AbstractPhysicalLayer.hpp"
+#include "Pacer.hpp"
 
 using namespace std;
 
+// sendmmsg/recvmmsg move a batch of datagrams per syscall; elsewhere the
+// batch is sent and received with one sendto/recvfrom per datagram.
+#if defined(__linux__)
+#define UDP_HAVE_MMSG 1
+#endif
+
+// The worker blocks in epoll_wait on the socket and an eventfd the outgoing
+// frame queue signals; elsewhere it polls every WORKER_INTERVAL.
+#if defined(__linux__)
+#define UDP_HAVE_EPOLL 1
+#endif
+
+// Runs of equal-size frames go out as one UDP_SEGMENT (GSO) buffer and the
+// kernel may hand several received datagrams up as one (UDP_GRO).
+#if defined(__linux__)
+#define UDP_HAVE_GSO 1
+#endif
+
+// Several sockets share the local port (SO_REUSEPORT) and the kernel
+// spreads incoming datagrams over them by a hash of the source address.
+#if defined(__linux__) && defined(SO_REUSEPORT)
+#define UDP_HAVE_REUSEPORT 1
+#endif
+
 class PhysicalLayerUdp : public AbstractPhysicalLayer {
 public:
+    static constexpr size_t IPV4_UDP_OVERHEAD_BYTES = 28;
+    static constexpr size_t DEFAULT_PATH_MTU = 1500;
+    static constexpr size_t MIN_PATH_MTU = 576;
+    // A destination's route MTU is probed at most this often; a burst of
+    // EMSGSIZE sends reuses the last result
+    static constexpr chrono::milliseconds PATH_MTU_PROBE_INTERVAL{1000};
+    // Poll interval without epoll, and the longest the worker waits while
+    // frames are held back
+    static constexpr chrono::milliseconds WORKER_INTERVAL{10};
+    // Retry delay for a frame refused with ENOBUFS / EAGAIN
+    static constexpr chrono::milliseconds BUFFER_RETRY_INTERVAL{2};
+    static constexpr int MAX_CONSECUTIVE_ERRORS = 50;
+    // Datagrams moved per sendmmsg/recvmmsg call
+    static constexpr size_t DEFAULT_IO_BATCH_SIZE = 32;
+    static constexpr size_t MAX_IO_BATCH_SIZE = 1024;
+    // Kernel limits of one GSO buffer
+    static constexpr size_t GSO_MAX_SEGMENTS = 64;
+    static constexpr size_t MAX_UDP_PAYLOAD_BYTES = 65507;
+    // Receive slot size while GRO is on: a coalesced buffer up to 64 KB
+    static constexpr size_t GRO_BUFFER_BYTES = 65535;
+    static constexpr size_t MAX_RECEIVE_SHARDS = 64;
+
+    // Socket calls and the datagrams they moved, for syscalls-per-packet
+    struct IoStats {
+        uint64_t sendCalls = 0;
+        uint64_t datagramsSent = 0;
+        uint64_t receiveCalls = 0;
+        uint64_t datagramsReceived = 0;
+        // Sends that carried several datagrams as one GSO buffer, and
+        // received buffers the kernel had coalesced (GRO)
+        uint64_t segmentedSends = 0;
+        uint64_t coalescedReceives = 0;
+    };
+
     PhysicalLayerUdp(int localPort,
                      const string& remoteHost,
                      int remotePort);
+    // Multi-peer: one socket serves many devices. A frame goes to its
+    // Frame::peer when set, else to the device its connection is bound to.
+    // The address book starts with addPeer() and follows devices to the
+    // source address of their accepted handshakes; a device that moves is
+    // found again when it reconnects.
+    explicit PhysicalLayerUdp(int localPort);
     void configure(ThreadSafeQueue<Frame>& outgoingFramesFromCodingModule,
                    CodingModule& codingModule,
                    const ValidationConfig& validationConfig) override;
@@ -25,21 +96,213 @@ public:
     void start() override;
     void tick() override;
     bool tryReceive(Frame& outFrame) override;
+    size_t maxFrameBytesOnLink() const override;
+
+    // Path MTU is discovered by the kernel: datagrams carry the DF bit and
+    // ICMP "fragmentation needed" lowers the cached route MTU. setPathMtu()
+    // pins a fixed value and disables discovery.
+    size_t pathMtu() const { return pathMtu_; }
+    void setPathMtu(size_t mtu);
+
+    // Frames leave through a token bucket at this rate (bytes per second,
+    // 0 = unpaced), normally set by the session's congestion control.
+    void setPacingRate(double bytesPerSecond) override { pacer_.setRate(bytesPerSecond); }
+    double pacingRate() const { return pacer_.rate(); }
+
+    // Up to `batchSize` datagrams per send and receive call (1 = one syscall
+    // per datagram). Buffers are preallocated in configure(), so this must
+    // be set before; throws invalid_argument outside 1..MAX_IO_BATCH_SIZE.
+    void setIoBatchSize(size_t batchSize);
+    size_t ioBatchSize() const { return ioBatchSize_; }
+    // Linux: a run of equal-size frames in a send batch (the fragments of
+    // a large message) is one UDP_SEGMENT send, and coalesced receives
+    // (UDP_GRO) are split back into frames. On by default; switched off
+    // in configure() when the kernel lacks it. Must be set before
+    // configure(), throws runtime_error after.
+    void setSegmentationOffload(bool enabled);
+    bool segmentationOffload() const { return segmentationOffload_; }
+    IoStats ioStats() const;
+    // Linux: `shards` sockets bound to the local port with SO_REUSEPORT,
+    // each read by its own thread (the worker reads the first). The kernel
+    // picks the socket by a hash of the source address, so the datagrams of
+    // one device stay on one thread and in order; spreading needs many
+    // devices, i.e. a multi-peer layer. With `pinThreads` the receiving
+    // threads are pinned to the allowed cores in turn. Must be set before
+    // configure(); throws invalid_argument outside 1..MAX_RECEIVE_SHARDS.
+    void setReceiveShards(size_t shards, bool pinThreads = true);
+    size_t receiveShards() const { return receiveShardCount_; }
+    // Datagrams received by each shard, in shard order
+    vector<uint64_t> shardDatagramsReceived() const;
 
     int localPort() const { return localPort_; }
+    // Empty / 0 for a multi-peer layer
     int remotePort() const { return remotePort_; }
     const string& remoteHost() const { return remoteHost_; }
 
-private:
-    void workerLoop();
+    bool multiPeer() const { return multiPeer_; }
+    // Address of a device this side connects to. Throws invalid_argument for
+    // a bad address and runtime_error on a point-to-point layer.
+    void addPeer(DeviceId deviceId, const string& host, int port);
+    void removePeer(DeviceId deviceId);
+    bool hasPeer(DeviceId deviceId) const;
+    size_t peerCount() const;
+
+    void bindConnection(ConnectionId connId, DeviceId remoteId) override;
+    void unbindConnection(ConnectionId connId) override;
+    void notePeerAddress(DeviceId remoteId, LinkAddress address) override;
+
+    // IPv4 address and port packed as a LinkAddress, and back
+    static LinkAddress linkAddressOf(const sockaddr_in& address);
+    static sockaddr_in socketAddressOf(LinkAddress address);
+
+protected:
+    // Extension points for workers built on another kernel interface
+    // (PhysicalLayerIoUring): the pacing, ordering and error handling of
+    // drainOutgoingFrames() stay shared.
+    enum class SendResult { SENT, BLOCKED, FAILED };
+
+    // `shareLocalPort` sets SO_REUSEADDR before bind, so that several
+    // sockets on the host can take in the same port (multicast groups)
+    PhysicalLayerUdp(int localPort, const string& remoteHost, int remotePort, bool shareLocalPort);
+
+    virtual void workerLoop();
+    // Sends sendBatch_ from the front and sets `handled` to the number of
+    // frames that are done with, sent or failed. Stops early only when the
+    // socket buffer is full (BLOCKED).
+    virtual SendResult sendBatch(size_t& handled);
+    chrono::microseconds drainOutgoingFrames();
+    // True while a frame waits for the pacer or for socket buffer space
+    bool hasHeldFrames() const { return !pacedFrames_.empty() || !sendBatch_.empty(); }
+    // Appends a frame to sendBatch_, or drops it when it has no address
+    void batchFrame(Frame&& frame);
+    void wakeWorker();
+    void deliverReceivedFrame(const uint8_t* data, size_t length, LinkAddress source);
+    // Classifies the error of sending sendBatch_[index]
+    SendResult handleSendError(int err, size_t index);
+    const sockaddr_in& destinationOf(size_t index) const {
+        return multiPeer_ ? sendDestinations_[index] : remoteAddr_;
+    }
+    // Resets or counts consecutive send errors; pauses after too many
+    void noteSendResult(SendResult result);
+
     int sock_ = -1;
+#ifdef UDP_HAVE_EPOLL
+    // Written when the outgoing queue gets a frame or the worker must stop
+    int wakeFd_ = -1;
+#endif
+    sockaddr_in remoteAddr_{};
+    thread worker_;
+    atomic<bool> stopWorker_{false};
+    size_t ioBatchSize_ = DEFAULT_IO_BATCH_SIZE;
+    size_t recvSlotBytes_ = 0;
+    // Frames the pacer let through, sent with one call. Frames refused for
+    // lack of socket buffer space stay at the front until they go out.
+    vector<Frame> sendBatch_;
+    // Multi-peer: address of each frame of sendBatch_
+    vector<sockaddr_in> sendDestinations_;
+    atomic<uint64_t> sendCalls_{0};
+    atomic<uint64_t> datagramsSent_{0};
+    atomic<uint64_t> receiveCalls_{0};
+    atomic<uint64_t> datagramsReceived_{0};
+    atomic<uint64_t> segmentedSends_{0};
+    atomic<uint64_t> coalescedReceives_{0};
+
+private:
+#ifdef UDP_HAVE_GSO
+    // Control data (UDP_SEGMENT / UDP_GRO) of one send or receive message
+    union ControlBuffer {
+        cmsghdr align;
+        char bytes[CMSG_SPACE(sizeof(int))];
+    };
+#endif
+    // A socket of the receive group with its batch buffers. The first is
+    // sock_, read by the worker; the others have a thread each.
+    struct ReceiveShard {
+        int sock = -1;
+        // One receive slot of recvSlotBytes_ per datagram of a batch
+        vector<uint8_t> buffer;
+        vector<sockaddr_in> addrs;
+#ifdef UDP_HAVE_MMSG
+        vector<mmsghdr> msgs;
+        vector<iovec> iovecs;
+#endif
+#ifdef UDP_HAVE_GSO
+        vector<ControlBuffer> control;
+#endif
+        atomic<uint64_t> datagrams{0};
+        thread reader;
+    };
+
+    void openSocket(bool shareLocalPort);
+    // Destination of a frame of a multi-peer layer; false when its
+    // connection's device has no known address
+    bool routeFrame(const Frame& frame, sockaddr_in& destination) const;
+    void waitForWork(chrono::microseconds wait);
+    void openReceiveShards();
+    void setUpReceiveShard(ReceiveShard& shard);
+    void startReceiveShards();
+    void stopReceiveShards();
+    void receiveShardLoop(ReceiveShard& shard);
+    void receiveIncomingFrames(ReceiveShard& shard);
+    size_t receiveBatch(ReceiveShard& shard);
+#ifdef UDP_HAVE_MMSG
+    // Fills sendMsgs_ with sendBatch_[first..count): one message per frame,
+    // or per run of frames when segmentation offload is on. Frames before
+    // `unsegmentedUntil` go out alone. Returns the number of messages.
+    size_t buildSendMessages(size_t first, size_t count, size_t unsegmentedUntil);
+#else
+    SendResult sendFrame(size_t index);
+#endif
+    void enableSegmentationOffload();
+    size_t probePathMtu(const sockaddr_in& destination) const;
+    bool refreshPathMtu(const sockaddr_in& destination);
+    bool sendFragmentable(const Frame& frame, const sockaddr_in& destination);
+#ifdef UDP_HAVE_EPOLL
+    int epollFd_ = -1;
+#endif
     int remotePort_;
     int localPort_;
     string remoteHost_;
-    sockaddr_in remoteAddr_{};
     sockaddr_in localAddr_{};
     queue<Frame> incomingFrames_;
-    thread worker_;
-    atomic<bool> stopWorker_{false};
-    vector<uint8_t> recvBuffer_;
+    vector<unique_ptr<ReceiveShard>> shards_;
+    size_t receiveShardCount_ = 1;
+    bool pinReceiveThreads_ = true;
+#ifdef UDP_HAVE_REUSEPORT
+    // Written once to stop the shard threads; never read, so it stays ready
+    int shardStopFd_ = -1;
+#endif
+#ifdef UDP_HAVE_MMSG
+    vector<mmsghdr> sendMsgs_;
+    // One iovec per frame; a GSO message points at its run
+    vector<iovec> sendIovecs_;
+    // Frames carried by each message of sendMsgs_
+    vector<size_t> sendRunFrames_;
+#endif
+#ifdef UDP_HAVE_GSO
+    vector<ControlBuffer> sendControl_;
+#endif
+    atomic<bool> segmentationOffload_{true};
+    bool groEnabled_ = false;
+    atomic<size_t> pathMtu_{DEFAULT_PATH_MTU};
+    atomic<bool> pathMtuPinned_{false};
+    struct PathProbe {
+        size_t mtu = 0;
+        chrono::steady_clock::time_point probedAt;
+    };
+    // Last probe per destination IPv4 address (the route MTU does not depend
+    // on the port); addPeer() and the worker both refresh
+    mutex pathProbesMutex_;
+    unordered_map<uint32_t, PathProbe> pathProbes_;
+    Pacer pacer_;
+    // Paced frames waiting for the pacer, in send order; unpaced frames
+    // go past them.
+    queue<Frame> pacedFrames_;
+    bool sendBlocked_ = false;
+    int consecutiveSendErrors_ = 0;
+
+    bool multiPeer_ = false;
+    mutable mutex peersMutex_;
+    unordered_map<DeviceId, sockaddr_in> peers_;
+    unordered_map<ConnectionId, DeviceId> connectionPeers_;
 };
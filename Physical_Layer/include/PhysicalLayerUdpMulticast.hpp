@@ -0,0 +1,50 @@
+#pragma once
+
+// ============================================================
+// PhysicalLayerUdpMulticast — PhysicalLayerUdp on an IPv4 multicast group
+//
+// Every member binds the group port (shared, SO_REUSEADDR) and joins the
+// group; every frame goes to the group address, so one send reaches all
+// members however many there are. Carries the group feeds of
+// EminentSdk::joinGroup() / publish(); connections need a unicast layer.
+//
+// Sending, pacing, batching and path MTU are those of PhysicalLayerUdp.
+// Receive shards are not supported: the kernel would hand each datagram
+// to one socket of the SO_REUSEPORT group only.
+// ============================================================
+
+#include <string>
+#include "PhysicalLayerUdp.hpp"
+
+using namespace std;
+
+struct MulticastConfig {
+    // Interface that joins the group and sends to it; "0.0.0.0" lets the
+    // kernel pick it by route
+    string interfaceAddress = "0.0.0.0";
+    // Router hops a datagram may cross; 1 keeps it on the local subnet
+    int ttl = 1;
+    // Members on the sending host receive its datagrams too
+    bool loopback = true;
+};
+
+class PhysicalLayerUdpMulticast : public PhysicalLayerUdp {
+public:
+    // Throws invalid_argument for an address outside 224.0.0.0/4 and
+    // runtime_error when the group cannot be joined
+    PhysicalLayerUdpMulticast(const string& groupAddress, int port,
+                              const MulticastConfig& config = MulticastConfig{});
+
+    void configure(ThreadSafeQueue<Frame>& outgoingFramesFromCodingModule,
+                   CodingModule& codingModule,
+                   const ValidationConfig& validationConfig) override;
+
+    const string& groupAddress() const { return groupAddress_; }
+    const MulticastConfig& config() const { return config_; }
+
+private:
+    void joinGroup();
+
+    string groupAddress_;
+    MulticastConfig config_;
+};
@@ -1,6 +1,7 @@
 #include "AbstractPhysicalLayer.hpp"
 
 #include "CodingModule.hpp"
+#include "FecCodec.hpp"
 
 #include <stdexcept>
 
@@ -23,17 +24,33 @@ void AbstractPhysicalLayer::computeFrameLayout() {
         throw runtime_error("Physical layer not configured: validation config missing");
     }
     headerBytes_ = validationConfig_->transportHeaderBytes();
+    minFrameBytes_ = validationConfig_->minTransportHeaderBytes();
     payloadLimitBytes_ = validationConfig_->maxPayloadLengthBytes();
 
-    maxFrameBytesWithoutCrc_ = headerBytes_ + payloadLimitBytes_;
+    // Frames from the coding module may also carry an FEC group header
+    maxFrameBytesWithoutCrc_ = headerBytes_ + ValidationConfig::EXTENDED_FRAGMENT_FIELDS_BYTES +
+        ValidationConfig::DEADLINE_FIELD_BYTES + ValidationConfig::ORDERING_FIELDS_BYTES + payloadLimitBytes_ +
+        fec::MAX_OVERHEAD_BYTES;
     maxFrameBytesWithCrc_ = maxFrameBytesWithoutCrc_ + ValidationConfig::CRC_FIELD_BYTES;
 }
 
+void AbstractPhysicalLayer::notifyLinkMtuChanged() {
+    if (onLinkMtuChanged_) {
+        onLinkMtuChanged_(maxFrameBytesOnLink());
+    }
+}
+
+void AbstractPhysicalLayer::notifySendBackpressure() {
+    if (onSendBackpressure_) {
+        onSendBackpressure_();
+    }
+}
+
 void AbstractPhysicalLayer::ensureEncodableFrame(const Frame& frame) const {
     if (!isConfigured()) {
         throw runtime_error("Physical layer not configured");
     }
-    if (frame.data.size() < headerBytes_) {
+    if (frame.data.size() < minFrameBytes_) {
         throw runtime_error("Frame shorter than transport header");
     }
     if (frame.data.size() > maxFrameBytesWithoutCrc_) {
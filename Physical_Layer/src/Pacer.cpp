@@ -0,0 +1,36 @@
+#include "Pacer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+using namespace chrono;
+
+microseconds Pacer::delayFor(size_t bytes, steady_clock::time_point now) {
+    double rate = rate_;
+    if (rate == 0.0) {
+        tokens_ = 0.0;
+        lastRefill_ = now;
+        return microseconds{0};
+    }
+
+    double burst = max(rate * duration<double>(MAX_BURST_TIME).count(), static_cast<double>(MIN_BURST_BYTES));
+    if (lastRefill_ == steady_clock::time_point{}) {
+        tokens_ = burst;
+    } else {
+        tokens_ = min(tokens_ + rate * duration<double>(now - lastRefill_).count(), burst);
+    }
+    lastRefill_ = now;
+
+    double needed = min(static_cast<double>(bytes), burst);
+    if (tokens_ >= needed) {
+        return microseconds{0};
+    }
+    return microseconds{static_cast<int64_t>(ceil((needed - tokens_) / rate * 1e6))};
+}
+
+void Pacer::consume(size_t bytes) {
+    if (rate_ > 0.0) {
+        tokens_ -= static_cast<double>(bytes);
+    }
+}
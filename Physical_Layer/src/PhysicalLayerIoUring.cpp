@@ -0,0 +1,584 @@
+#include "PhysicalLayerIoUring.hpp"
+
+#include <stdexcept>
+
+#ifdef UDP_HAVE_IO_URING
+#include "CodingModule.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef __NR_io_uring_setup
+#define __NR_io_uring_setup 425
+#endif
+#ifndef __NR_io_uring_enter
+#define __NR_io_uring_enter 426
+#endif
+#ifndef __NR_io_uring_register
+#define __NR_io_uring_register 427
+#endif
+#endif
+
+using namespace std;
+using namespace chrono;
+
+unique_ptr<PhysicalLayerUdp> makeUdpPhysicalLayer(int localPort, const string& remoteHost, int remotePort,
+                                                  const IoUringConfig& config) {
+#ifdef UDP_HAVE_IO_URING
+    try {
+        return make_unique<PhysicalLayerIoUring>(localPort, remoteHost, remotePort, config);
+    } catch (const runtime_error&) {
+        // No io_uring here; socket errors repeat below and propagate
+    }
+#else
+    (void)config;
+#endif
+    return make_unique<PhysicalLayerUdp>(localPort, remoteHost, remotePort);
+}
+
+#ifdef UDP_HAVE_IO_URING
+
+// ============================================================
+// io_uring system calls (no liburing dependency)
+// ============================================================
+
+static int ioUringSetup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int ioUringEnter(int ringFd, unsigned toSubmit, unsigned minComplete, unsigned flags,
+                        const void* arg, size_t argBytes) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, arg, argBytes));
+}
+
+static int ioUringRegister(int ringFd, unsigned opcode, const void* arg, unsigned count) {
+    return static_cast<int>(syscall(__NR_io_uring_register, ringFd, opcode, arg, count));
+}
+
+static unsigned loadAcquire(const unsigned* value) {
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+static void storeRelease(unsigned* value, unsigned newValue) {
+    __atomic_store_n(value, newValue, __ATOMIC_RELEASE);
+}
+
+// Request kind in the upper half of user_data, batch index in the lower
+enum RequestKind : uint64_t {
+    REQUEST_RECEIVE = 1,
+    REQUEST_WAKE = 2,
+    REQUEST_SEND = 3,
+    REQUEST_CANCEL = 4
+};
+
+static uint64_t userData(RequestKind kind, size_t index = 0) {
+    return (static_cast<uint64_t>(kind) << 32) | static_cast<uint32_t>(index);
+}
+
+static constexpr uint16_t RECEIVE_BUFFER_GROUP = 0;
+static constexpr int RESULT_PENDING = INT32_MIN;
+
+// ============================================================
+// Setup and teardown
+// ============================================================
+
+PhysicalLayerIoUring::PhysicalLayerIoUring(int localPort, const string& remoteHost, int remotePort,
+                                           const IoUringConfig& config)
+    : PhysicalLayerUdp(localPort, remoteHost, remotePort)
+    , config_(config) {
+    setLoggerClassName("PhysicalLayerIoUring");
+    // Receives are not parsed for UDP_GRO and sends are one sendmsg per frame
+    setSegmentationOffload(false);
+    unsigned buffers = config.receiveBuffers;
+    if (buffers == 0 || buffers > 32768 || (buffers & (buffers - 1)) != 0) {
+        throw invalid_argument("PhysicalLayerIoUring: receiveBuffers must be a power of two up to 32768, got " +
+            to_string(buffers));
+    }
+    if (config.queueDepth < 8) {
+        throw invalid_argument("PhysicalLayerIoUring: queueDepth must be at least 8, got " +
+            to_string(config.queueDepth));
+    }
+    setUpRing();
+    log(LogLevel::INFO, string("io_uring ready, sqEntries=") + to_string(sqEntries_) +
+        ", receiveBuffers=" + to_string(buffers) + (config_.sqPoll ? ", SQPOLL" : "") +
+        (config_.registeredBuffers ? ", registered buffers" : ""));
+}
+
+PhysicalLayerIoUring::~PhysicalLayerIoUring() {
+    // The worker runs code of this class: stop it before members go away
+    stopWorker_ = true;
+    wakeWorker();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+    releaseRing();
+}
+
+void PhysicalLayerIoUring::setUpRing() {
+    io_uring_params params{};
+    if (config_.sqPoll) {
+        params.flags |= IORING_SETUP_SQPOLL;
+        params.sq_thread_idle = static_cast<unsigned>(config_.sqPollIdle.count());
+    }
+    ringFd_ = ioUringSetup(config_.queueDepth, &params);
+    if (ringFd_ < 0 && config_.sqPoll && errno == EPERM) {
+        log(LogLevel::WARN, "SQPOLL not permitted, submitting with io_uring_enter");
+        config_.sqPoll = false;
+        params = io_uring_params{};
+        ringFd_ = ioUringSetup(config_.queueDepth, &params);
+    }
+    if (ringFd_ < 0) {
+        throw runtime_error(string("PhysicalLayerIoUring: io_uring_setup failed: ") + strerror(errno));
+    }
+
+    try {
+        // Timed waits pass their timeout through IORING_ENTER_EXT_ARG (5.11)
+        if ((params.features & IORING_FEAT_EXT_ARG) == 0) {
+            throw runtime_error("PhysicalLayerIoUring: kernel lacks IORING_FEAT_EXT_ARG");
+        }
+
+        sqEntries_ = params.sq_entries;
+        sqRingBytes_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingBytes_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (singleMap) {
+            sqRingBytes_ = cqRingBytes_ = max(sqRingBytes_, cqRingBytes_);
+        }
+        void* sq = mmap(nullptr, sqRingBytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ringFd_, IORING_OFF_SQ_RING);
+        if (sq == MAP_FAILED) {
+            throw runtime_error(string("PhysicalLayerIoUring: failed to map SQ ring: ") + strerror(errno));
+        }
+        sqRing_ = sq;
+        if (singleMap) {
+            cqRing_ = sqRing_;
+        } else {
+            void* cq = mmap(nullptr, cqRingBytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            ringFd_, IORING_OFF_CQ_RING);
+            if (cq == MAP_FAILED) {
+                throw runtime_error(string("PhysicalLayerIoUring: failed to map CQ ring: ") + strerror(errno));
+            }
+            cqRing_ = cq;
+        }
+        sqesBytes_ = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = mmap(nullptr, sqesBytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          ringFd_, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            throw runtime_error(string("PhysicalLayerIoUring: failed to map SQEs: ") + strerror(errno));
+        }
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+        auto* sqBase = static_cast<uint8_t*>(sqRing_);
+        sqHead_ = reinterpret_cast<unsigned*>(sqBase + params.sq_off.head);
+        sqTail_ = reinterpret_cast<unsigned*>(sqBase + params.sq_off.tail);
+        sqFlags_ = reinterpret_cast<unsigned*>(sqBase + params.sq_off.flags);
+        sqMask_ = *reinterpret_cast<unsigned*>(sqBase + params.sq_off.ring_mask);
+        sqArray_ = reinterpret_cast<unsigned*>(sqBase + params.sq_off.array);
+        auto* cqBase = static_cast<uint8_t*>(cqRing_);
+        cqHead_ = reinterpret_cast<unsigned*>(cqBase + params.cq_off.head);
+        cqTail_ = reinterpret_cast<unsigned*>(cqBase + params.cq_off.tail);
+        cqMask_ = *reinterpret_cast<unsigned*>(cqBase + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cqBase + params.cq_off.cqes);
+
+        // Operations this layer issues
+        vector<uint8_t> probeMemory(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op));
+        auto* probe = reinterpret_cast<io_uring_probe*>(probeMemory.data());
+        if (ioUringRegister(ringFd_, IORING_REGISTER_PROBE, probe, 256) < 0) {
+            throw runtime_error(string("PhysicalLayerIoUring: probe failed: ") + strerror(errno));
+        }
+        auto supported = [&](unsigned op) {
+            return op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED) != 0;
+        };
+        for (unsigned op : {static_cast<unsigned>(IORING_OP_RECVMSG), static_cast<unsigned>(IORING_OP_SENDMSG),
+                            static_cast<unsigned>(IORING_OP_READ), static_cast<unsigned>(IORING_OP_ASYNC_CANCEL)}) {
+            if (!supported(op)) {
+                throw runtime_error("PhysicalLayerIoUring: kernel lacks io_uring opcode " + to_string(op));
+            }
+        }
+        if (config_.registeredBuffers && !supported(IORING_OP_SEND_ZC)) {
+            log(LogLevel::WARN, "Zero-copy send not supported, registered buffers disabled");
+            config_.registeredBuffers = false;
+        }
+
+        // Buffer ring the kernel picks receive buffers from (5.19); the
+        // buffers are added once their size is known in configure()
+        long pageBytes = sysconf(_SC_PAGESIZE);
+        size_t ringBytes = config_.receiveBuffers * sizeof(io_uring_buf);
+        bufferRingBytes_ = (ringBytes + pageBytes - 1) / pageBytes * pageBytes;
+        void* ring = mmap(nullptr, bufferRingBytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ring == MAP_FAILED) {
+            throw runtime_error(string("PhysicalLayerIoUring: failed to allocate buffer ring: ") + strerror(errno));
+        }
+        bufferRing_ = static_cast<io_uring_buf*>(ring);
+        io_uring_buf_reg registration{};
+        registration.ring_addr = reinterpret_cast<uint64_t>(bufferRing_);
+        registration.ring_entries = config_.receiveBuffers;
+        registration.bgid = RECEIVE_BUFFER_GROUP;
+        if (ioUringRegister(ringFd_, IORING_REGISTER_PBUF_RING, &registration, 1) < 0) {
+            throw runtime_error(string("PhysicalLayerIoUring: provided buffer ring not supported: ") +
+                strerror(errno));
+        }
+    } catch (...) {
+        releaseRing();
+        throw;
+    }
+}
+
+void PhysicalLayerIoUring::releaseRing() {
+    // Closing the ring ends every request before the memory is unmapped
+    if (ringFd_ >= 0) {
+        ::close(ringFd_);
+        ringFd_ = -1;
+    }
+    if (bufferRing_) {
+        munmap(bufferRing_, bufferRingBytes_);
+        bufferRing_ = nullptr;
+    }
+    if (sqes_) {
+        munmap(sqes_, sqesBytes_);
+        sqes_ = nullptr;
+    }
+    if (cqRing_ && cqRing_ != sqRing_) {
+        munmap(cqRing_, cqRingBytes_);
+    }
+    cqRing_ = nullptr;
+    if (sqRing_) {
+        munmap(sqRing_, sqRingBytes_);
+        sqRing_ = nullptr;
+    }
+}
+
+void PhysicalLayerIoUring::configure(ThreadSafeQueue<Frame>& outgoingFramesFromCodingModule,
+                                     CodingModule& codingModule,
+                                     const ValidationConfig& validationConfig) {
+    PhysicalLayerUdp::configure(outgoingFramesFromCodingModule, codingModule, validationConfig);
+    // A send batch is one linked chain; it and the two armed requests must
+    // fit in the submission queue
+    if (sqEntries_ < ioBatchSize_ + 4) {
+        throw invalid_argument("PhysicalLayerIoUring: queueDepth " + to_string(sqEntries_) +
+            " is too small for I/O batches of " + to_string(ioBatchSize_));
+    }
+    setUpReceiveBuffers();
+
+    sendHeaders_.assign(ioBatchSize_, msghdr{});
+    sendIovecs_.assign(ioBatchSize_, iovec{});
+    sendResults_.assign(ioBatchSize_, RESULT_PENDING);
+    for (size_t i = 0; i < ioBatchSize_; ++i) {
+        sendHeaders_[i].msg_name = &remoteAddr_;
+        sendHeaders_[i].msg_namelen = sizeof(remoteAddr_);
+        sendHeaders_[i].msg_iov = &sendIovecs_[i];
+        sendHeaders_[i].msg_iovlen = 1;
+    }
+
+    if (config_.registeredBuffers && sendArena_.empty()) {
+        sendSlotBytes_ = recvSlotBytes_;
+        sendArena_.assign(sendSlotBytes_ * ioBatchSize_, 0);
+        iovec region{sendArena_.data(), sendArena_.size()};
+        if (ioUringRegister(ringFd_, IORING_REGISTER_BUFFERS, &region, 1) < 0) {
+            log(LogLevel::WARN, string("Failed to register send buffers, using sendmsg: ") + strerror(errno));
+            config_.registeredBuffers = false;
+            sendArena_.clear();
+        }
+    }
+}
+
+void PhysicalLayerIoUring::setUpReceiveBuffers() {
+    // Multishot recvmsg puts an io_uring_recvmsg_out header before the payload
+    receiveBufferBytes_ = sizeof(io_uring_recvmsg_out) + recvSlotBytes_;
+    receiveArena_.assign(receiveBufferBytes_ * config_.receiveBuffers, 0);
+    __atomic_store_n(&bufferRing_[0].resv, static_cast<uint16_t>(0), __ATOMIC_RELEASE);
+    for (unsigned id = 0; id < config_.receiveBuffers; ++id) {
+        recycleReceiveBuffer(static_cast<uint16_t>(id));
+    }
+}
+
+// ============================================================
+// Submission and completion queues
+// ============================================================
+
+io_uring_sqe* PhysicalLayerIoUring::nextSqe() {
+    unsigned tail = *sqTail_ + sqPending_;
+    if (tail - loadAcquire(sqHead_) >= sqEntries_) {
+        submitAndWait(0);
+        tail = *sqTail_;
+    }
+    unsigned index = tail & sqMask_;
+    io_uring_sqe* sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqArray_[index] = index;
+    ++sqPending_;
+    return sqe;
+}
+
+void PhysicalLayerIoUring::submitAndWait(unsigned waitFor, microseconds timeout) {
+    unsigned toSubmit = sqPending_;
+    if (toSubmit > 0) {
+        storeRelease(sqTail_, *sqTail_ + toSubmit);
+        sqPending_ = 0;
+    }
+
+    unsigned flags = IORING_ENTER_EXT_ARG;
+    if (config_.sqPoll) {
+        // The kernel thread picks submissions up; it only needs a wakeup
+        // once it went idle
+        bool needsWakeup = toSubmit > 0 && (loadAcquire(sqFlags_) & IORING_SQ_NEED_WAKEUP) != 0;
+        if (needsWakeup) {
+            flags |= IORING_ENTER_SQ_WAKEUP;
+        } else if (waitFor == 0) {
+            return;
+        }
+    } else if (toSubmit == 0 && waitFor == 0) {
+        return;
+    }
+    if (waitFor > 0) {
+        flags |= IORING_ENTER_GETEVENTS;
+    }
+
+    __kernel_timespec timespec{};
+    io_uring_getevents_arg arg{};
+    arg.sigmask_sz = _NSIG / 8;
+    if (timeout.count() >= 0) {
+        timespec.tv_sec = timeout.count() / 1000000;
+        timespec.tv_nsec = (timeout.count() % 1000000) * 1000;
+        arg.ts = reinterpret_cast<uint64_t>(&timespec);
+    }
+    if (ioUringEnter(ringFd_, toSubmit, waitFor, flags, &arg, sizeof(arg)) < 0 &&
+        errno != ETIME && errno != EINTR && errno != EBUSY) {
+        log(LogLevel::WARN, string("io_uring_enter failed: ") + strerror(errno));
+    }
+}
+
+void PhysicalLayerIoUring::processCompletions() {
+    unsigned head = *cqHead_;
+    unsigned tail = loadAcquire(cqTail_);
+    while (head != tail) {
+        const io_uring_cqe& cqe = cqes_[head & cqMask_];
+        auto kind = static_cast<RequestKind>(cqe.user_data >> 32);
+        size_t index = static_cast<uint32_t>(cqe.user_data);
+        if (kind == REQUEST_RECEIVE) {
+            handleReceive(cqe);
+        } else if (kind == REQUEST_WAKE) {
+            wakeArmed_ = false;
+        } else if (kind == REQUEST_SEND) {
+            if (cqe.flags & IORING_CQE_F_NOTIF) {
+                // Zero-copy send released its buffer
+                --pendingNotifications_;
+            } else {
+                sendResults_[index] = cqe.res;
+                --sendsInFlight_;
+                if (cqe.flags & IORING_CQE_F_MORE) {
+                    ++pendingNotifications_;
+                }
+            }
+        }
+        ++head;
+    }
+    storeRelease(cqHead_, head);
+}
+
+// ============================================================
+// Receiving: multishot recvmsg into provided buffers
+// ============================================================
+
+void PhysicalLayerIoUring::armReceive() {
+    io_uring_sqe* sqe = nextSqe();
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = sock_;
+    sqe->addr = reinterpret_cast<uint64_t>(&receiveHeader_);
+    sqe->len = 1;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = RECEIVE_BUFFER_GROUP;
+    if (multishotReceive_) {
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+    }
+    sqe->user_data = userData(REQUEST_RECEIVE);
+    receiveArmed_ = true;
+}
+
+void PhysicalLayerIoUring::armWake() {
+    io_uring_sqe* sqe = nextSqe();
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = wakeFd_;
+    sqe->addr = reinterpret_cast<uint64_t>(&wakeValue_);
+    sqe->len = sizeof(wakeValue_);
+    sqe->user_data = userData(REQUEST_WAKE);
+    wakeArmed_ = true;
+}
+
+void PhysicalLayerIoUring::handleReceive(const io_uring_cqe& cqe) {
+    // Without F_MORE the request has ended and is armed again
+    if ((cqe.flags & IORING_CQE_F_MORE) == 0) {
+        receiveArmed_ = false;
+    }
+    if (cqe.res < 0) {
+        if (cqe.res == -EINVAL && multishotReceive_) {
+            log(LogLevel::WARN, "Multishot recvmsg not supported, arming one receive at a time");
+            multishotReceive_ = false;
+        } else if (cqe.res != -ENOBUFS && cqe.res != -ECANCELED) {
+            log(LogLevel::WARN, string("io_uring recvmsg failed: ") + strerror(-cqe.res));
+        }
+        return;
+    }
+    if ((cqe.flags & IORING_CQE_F_BUFFER) == 0) {
+        return;
+    }
+
+    auto bufferId = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+    const uint8_t* buffer = receiveArena_.data() + static_cast<size_t>(bufferId) * receiveBufferBytes_;
+    const uint8_t* payload = buffer;
+    size_t length = static_cast<size_t>(cqe.res);
+    if (multishotReceive_) {
+        const auto* out = reinterpret_cast<const io_uring_recvmsg_out*>(buffer);
+        size_t offset = sizeof(io_uring_recvmsg_out) + out->namelen + out->controllen;
+        payload = buffer + offset;
+        // A truncated datagram reports its full length
+        length = min<size_t>(out->payloadlen, length > offset ? length - offset : 0);
+    }
+    ++datagramsReceived_;
+    if (!stopWorker_) {
+        // Point-to-point only: every datagram is from the remote peer
+        deliverReceivedFrame(payload, length, 0);
+    }
+    recycleReceiveBuffer(bufferId);
+}
+
+void PhysicalLayerIoUring::recycleReceiveBuffer(uint16_t bufferId) {
+    // The ring's tail is the first descriptor's reserved field, so
+    // descriptors are written field by field. io_uring_buf_ring::bufs is
+    // not used: its flexible-array wrapper shifts it by 8 bytes in C++.
+    uint16_t tail = bufferRing_[0].resv;
+    io_uring_buf& descriptor = bufferRing_[tail & (config_.receiveBuffers - 1)];
+    descriptor.addr = reinterpret_cast<uint64_t>(receiveArena_.data() +
+                                                 static_cast<size_t>(bufferId) * receiveBufferBytes_);
+    descriptor.len = static_cast<uint32_t>(receiveBufferBytes_);
+    descriptor.bid = bufferId;
+    __atomic_store_n(&bufferRing_[0].resv, static_cast<uint16_t>(tail + 1), __ATOMIC_RELEASE);
+}
+
+// ============================================================
+// Worker
+// ============================================================
+
+void PhysicalLayerIoUring::workerLoop() {
+    try {
+        while (!stopWorker_) {
+            microseconds wait = drainOutgoingFrames();
+            if (!receiveArmed_) {
+                armReceive();
+            }
+            if (!wakeArmed_) {
+                armWake();
+            }
+            // Wakes on a datagram, a queued frame (eventfd) or when a held
+            // frame may move
+            ++receiveCalls_;
+            submitAndWait(1, hasHeldFrames() ? wait : microseconds{-1});
+            processCompletions();
+        }
+        cancelArmedRequests();
+    } catch (const exception& ex) {
+        log(LogLevel::ERROR, string("Worker fatal exception: ") + ex.what());
+    } catch (...) {
+        log(LogLevel::ERROR, "Worker fatal exception: unknown");
+    }
+}
+
+// Ends the armed receive and wake requests, so the kernel is done with
+// their buffers before they are freed
+void PhysicalLayerIoUring::cancelArmedRequests() {
+    for (RequestKind kind : {REQUEST_RECEIVE, REQUEST_WAKE}) {
+        if (kind == REQUEST_RECEIVE ? receiveArmed_ : wakeArmed_) {
+            io_uring_sqe* sqe = nextSqe();
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->addr = userData(kind);
+            sqe->user_data = userData(REQUEST_CANCEL);
+        }
+    }
+    auto deadline = steady_clock::now() + 1s;
+    while ((receiveArmed_ || wakeArmed_ || pendingNotifications_ > 0) && steady_clock::now() < deadline) {
+        submitAndWait(1, milliseconds{100});
+        processCompletions();
+    }
+}
+
+// ============================================================
+// Sending: one linked chain of sendmsg per batch
+// ============================================================
+
+// The chain is linked so a send that fails cancels the ones behind it: a
+// frame refused for lack of buffer space keeps its place, and no later
+// frame overtakes it.
+PhysicalLayerUdp::SendResult PhysicalLayerIoUring::sendBatch(size_t& handled) {
+    size_t count = sendBatch_.size();
+    handled = 0;
+    while (handled < count) {
+        for (size_t i = handled; i < count; ++i) {
+            const Frame& frame = sendBatch_[i];
+            io_uring_sqe* sqe = nextSqe();
+            sqe->fd = sock_;
+            if (config_.registeredBuffers && frame.data.size() <= sendSlotBytes_) {
+                uint8_t* slot = sendArena_.data() + i * sendSlotBytes_;
+                memcpy(slot, frame.data.data(), frame.data.size());
+                sqe->opcode = IORING_OP_SEND_ZC;
+                sqe->addr = reinterpret_cast<uint64_t>(slot);
+                sqe->len = static_cast<uint32_t>(frame.data.size());
+                sqe->ioprio = IORING_RECVSEND_FIXED_BUF;
+                sqe->buf_index = 0;
+                sqe->addr2 = reinterpret_cast<uint64_t>(&remoteAddr_);
+                sqe->addr_len = sizeof(remoteAddr_);
+            } else {
+                sendIovecs_[i].iov_base = const_cast<uint8_t*>(frame.data.data());
+                sendIovecs_[i].iov_len = frame.data.size();
+                sqe->opcode = IORING_OP_SENDMSG;
+                sqe->addr = reinterpret_cast<uint64_t>(&sendHeaders_[i]);
+                sqe->len = 1;
+            }
+            if (i + 1 < count) {
+                sqe->flags |= IOSQE_IO_LINK;
+            }
+            sqe->user_data = userData(REQUEST_SEND, i);
+            sendResults_[i] = RESULT_PENDING;
+        }
+        sendsInFlight_ = count - handled;
+        ++sendCalls_;
+        submitAndWait(static_cast<unsigned>(sendsInFlight_));
+        processCompletions();
+        while (sendsInFlight_ > 0 || pendingNotifications_ > 0) {
+            submitAndWait(1);
+            processCompletions();
+        }
+
+        size_t i = handled;
+        while (i < count) {
+            int res = sendResults_[i];
+            if (res >= 0) {
+                ++datagramsSent_;
+                noteSendResult(SendResult::SENT);
+                ++i;
+                continue;
+            }
+            if (res == -ECANCELED) {
+                // Behind a failed send: goes out with the next chain
+                break;
+            }
+            SendResult result = handleSendError(-res, i);
+            if (result == SendResult::BLOCKED) {
+                handled = i;
+                return result;
+            }
+            noteSendResult(result);
+            ++i;
+            break;
+        }
+        handled = i;
+    }
+    return SendResult::SENT;
+}
+
+#endif // UDP_HAVE_IO_URING
@@ -0,0 +1,505 @@
+#include "PhysicalLayerSharedMemory.hpp"
+
+#ifdef SHM_HAVE_RING
+#include "CodingModule.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <new>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace chrono;
+
+// ============================================================
+// Segment layout
+//
+//   [SharedSegment][ring 0 bytes][ring 1 bytes]
+//
+// Ring s is written by side s and read by the other. Positions are free
+// running byte counts; a record is [length:4][frame][padding to 8], and a
+// record that would run past the end of the ring is preceded by a
+// WRAP_MARKER length that sends the reader back to offset 0. The producer
+// publishes `head` with release, the consumer `tail`; producer and
+// consumer fields sit on separate cache lines.
+// ============================================================
+
+static constexpr uint32_t SEGMENT_MAGIC = 0x45534d52;   // "ESMR"
+static constexpr uint32_t SEGMENT_VERSION = 1;
+static constexpr size_t CACHE_LINE_BYTES = 64;
+static constexpr size_t RECORD_ALIGN_BYTES = 8;
+static constexpr size_t LENGTH_FIELD_BYTES = 4;
+static constexpr uint32_t WRAP_MARKER = 0xFFFFFFFF;
+
+static_assert(atomic<uint32_t>::is_always_lock_free && atomic<uint64_t>::is_always_lock_free &&
+              atomic<int32_t>::is_always_lock_free,
+              "shared memory rings need address-free atomics");
+static_assert(sizeof(atomic<uint32_t>) == sizeof(uint32_t), "futex word must be a plain 32-bit integer");
+
+struct SharedDoorbell {
+    // Bumped and futex-woken to wake the side that sleeps on it
+    alignas(CACHE_LINE_BYTES) atomic<uint32_t> sequence{0};
+    atomic<uint32_t> sleeping{0};
+};
+
+struct SharedRing {
+    alignas(CACHE_LINE_BYTES) atomic<uint64_t> head{0};
+    alignas(CACHE_LINE_BYTES) atomic<uint64_t> tail{0};
+    // Set by a producer that found the ring full; the consumer rings the
+    // producer's doorbell after making room
+    alignas(CACHE_LINE_BYTES) atomic<uint32_t> producerBlocked{0};
+};
+
+struct SharedSegment {
+    // Stored last by the creator: the rest is laid out once it is set
+    atomic<uint32_t> magic{0};
+    uint32_t version = SEGMENT_VERSION;
+    uint64_t ringBytes = 0;
+    int32_t devices[2] = {0, 0};
+    // Process attached to each side, 0 while the side is free
+    atomic<int32_t> pids[2];
+    SharedDoorbell doorbells[2];
+    SharedRing rings[2];
+};
+
+static constexpr size_t RING_DATA_OFFSET =
+    (sizeof(SharedSegment) + CACHE_LINE_BYTES - 1) / CACHE_LINE_BYTES * CACHE_LINE_BYTES;
+
+static size_t recordBytes(size_t frameBytes) {
+    return (LENGTH_FIELD_BYTES + frameBytes + RECORD_ALIGN_BYTES - 1) / RECORD_ALIGN_BYTES * RECORD_ALIGN_BYTES;
+}
+
+static uint32_t* futexWord(atomic<uint32_t>& word) {
+    return reinterpret_cast<uint32_t*>(&word);
+}
+
+// Not FUTEX_PRIVATE_FLAG: the word is shared with another process
+static void futexWait(atomic<uint32_t>& word, uint32_t expected) {
+    syscall(SYS_futex, futexWord(word), FUTEX_WAIT, expected, nullptr, nullptr, 0);
+}
+
+static void futexWake(atomic<uint32_t>& word) {
+    syscall(SYS_futex, futexWord(word), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+}
+
+static bool processAlive(int32_t pid) {
+    return kill(pid, 0) == 0 || errno == EPERM;
+}
+
+// ============================================================
+// Attach / detach
+// ============================================================
+
+PhysicalLayerSharedMemory::PhysicalLayerSharedMemory(DeviceId self, DeviceId peer, const SharedMemoryConfig& config)
+    : AbstractPhysicalLayer("PhysicalLayerSharedMemory")
+    , self_(self)
+    , peer_(peer)
+    , config_(config) {
+
+    if (self <= 0 || peer <= 0 || self == peer) {
+        throw invalid_argument("PhysicalLayerSharedMemory: self and peer must be distinct positive DeviceIds, got " +
+            to_string(self) + " and " + to_string(peer));
+    }
+    if (config.ringBytes < MIN_RING_BYTES || (config.ringBytes & (config.ringBytes - 1)) != 0) {
+        throw invalid_argument("PhysicalLayerSharedMemory: ringBytes must be a power of two of at least " +
+            to_string(MIN_RING_BYTES) + ", got " + to_string(config.ringBytes));
+    }
+    if (config.namePrefix.size() < 2 || config.namePrefix[0] != '/' ||
+        config.namePrefix.find('/', 1) != string::npos) {
+        throw invalid_argument("PhysicalLayerSharedMemory: namePrefix must be '/' and a name without '/', got '" +
+            config.namePrefix + "'");
+    }
+
+    side_ = self < peer ? 0 : 1;
+    segmentName_ = config.namePrefix + "-" + to_string(min(self, peer)) + "-" + to_string(max(self, peer));
+    segmentBytes_ = RING_DATA_OFFSET + 2 * config.ringBytes;
+    attach();
+
+    log(LogLevel::INFO, "Attached to shared memory segment " + segmentName_ + " as device " + to_string(self) +
+        ", ring=" + to_string(config.ringBytes) + " bytes, peer " + (peerAttached() ? "attached" : "not attached yet"));
+}
+
+PhysicalLayerSharedMemory::~PhysicalLayerSharedMemory() {
+    stopWorker_ = true;
+    if (outgoingFramesFromCodingModule_) {
+        outgoingFramesFromCodingModule_->setOnPush(nullptr);
+    }
+    if (segment_) {
+        ring(segment_->doorbells[side_], true);
+    }
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+    detach();
+}
+
+void PhysicalLayerSharedMemory::attach() {
+    bool creator = true;
+    int fd = shm_open(segmentName_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd >= 0) {
+        if (ftruncate(fd, static_cast<off_t>(segmentBytes_)) < 0) {
+            string err = strerror(errno);
+            ::close(fd);
+            shm_unlink(segmentName_.c_str());
+            throw runtime_error("PhysicalLayerSharedMemory: failed to size " + segmentName_ + ": " + err);
+        }
+    } else if (errno == EEXIST) {
+        creator = false;
+        fd = shm_open(segmentName_.c_str(), O_RDWR, 0);
+        if (fd < 0) {
+            throw runtime_error("PhysicalLayerSharedMemory: failed to open " + segmentName_ + ": " + strerror(errno));
+        }
+        // The creator may not have sized it yet
+        auto deadline = steady_clock::now() + config_.attachTimeout;
+        struct stat info{};
+        while (fstat(fd, &info) == 0 && info.st_size == 0 && steady_clock::now() < deadline) {
+            this_thread::sleep_for(milliseconds{1});
+        }
+        if (static_cast<size_t>(info.st_size) != segmentBytes_) {
+            ::close(fd);
+            throw runtime_error("PhysicalLayerSharedMemory: " + segmentName_ + " has " + to_string(info.st_size) +
+                " bytes, expected " + to_string(segmentBytes_) + " (ring size differs, or a stale segment)");
+        }
+    } else {
+        throw runtime_error("PhysicalLayerSharedMemory: failed to create " + segmentName_ + ": " + strerror(errno));
+    }
+
+    void* mapping = mmap(nullptr, segmentBytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    string mapError = mapping == MAP_FAILED ? strerror(errno) : "";
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        if (creator) {
+            shm_unlink(segmentName_.c_str());
+        }
+        throw runtime_error("PhysicalLayerSharedMemory: failed to map " + segmentName_ + ": " + mapError);
+    }
+
+    if (creator) {
+        segment_ = new (mapping) SharedSegment();
+        segment_->ringBytes = config_.ringBytes;
+        segment_->devices[0] = min(self_, peer_);
+        segment_->devices[1] = max(self_, peer_);
+        segment_->pids[0].store(0, memory_order_relaxed);
+        segment_->pids[1].store(0, memory_order_relaxed);
+        segment_->magic.store(SEGMENT_MAGIC, memory_order_release);
+    } else {
+        segment_ = static_cast<SharedSegment*>(mapping);
+        auto deadline = steady_clock::now() + config_.attachTimeout;
+        while (segment_->magic.load(memory_order_acquire) != SEGMENT_MAGIC && steady_clock::now() < deadline) {
+            this_thread::sleep_for(milliseconds{1});
+        }
+        string mismatch;
+        if (segment_->magic.load(memory_order_acquire) != SEGMENT_MAGIC) {
+            mismatch = "was never laid out";
+        } else if (segment_->version != SEGMENT_VERSION || segment_->ringBytes != config_.ringBytes) {
+            mismatch = "has another layout";
+        } else if (segment_->devices[0] != min(self_, peer_) || segment_->devices[1] != max(self_, peer_)) {
+            mismatch = "belongs to other devices";
+        }
+        if (!mismatch.empty()) {
+            munmap(mapping, segmentBytes_);
+            segment_ = nullptr;
+            throw runtime_error("PhysicalLayerSharedMemory: " + segmentName_ + " " + mismatch);
+        }
+    }
+
+    uint8_t* rings = static_cast<uint8_t*>(mapping) + RING_DATA_OFFSET;
+    txData_ = rings + static_cast<size_t>(side_) * config_.ringBytes;
+    rxData_ = rings + static_cast<size_t>(1 - side_) * config_.ringBytes;
+    try {
+        claimSide();
+    } catch (...) {
+        munmap(mapping, segmentBytes_);
+        segment_ = nullptr;
+        throw;
+    }
+}
+
+// A side left behind by a process that died is taken over; frames it left
+// in the rings are delivered and dropped above on CRC or session checks
+void PhysicalLayerSharedMemory::claimSide() {
+    int32_t pid = static_cast<int32_t>(getpid());
+    int32_t holder = 0;
+    while (!segment_->pids[side_].compare_exchange_strong(holder, pid)) {
+        if (processAlive(holder)) {
+            throw runtime_error("PhysicalLayerSharedMemory: device " + to_string(self_) + " is already attached to " +
+                segmentName_ + " by process " + to_string(holder));
+        }
+        log(LogLevel::WARN, "Taking over side of device " + to_string(self_) + " in " + segmentName_ +
+            " from exited process " + to_string(holder));
+    }
+}
+
+// The last side out removes the name; a side attaching later creates a
+// fresh segment
+void PhysicalLayerSharedMemory::detach() {
+    if (!segment_) {
+        return;
+    }
+    segment_->pids[side_].store(0);
+    bool last = segment_->pids[1 - side_].load() == 0;
+    munmap(segment_, segmentBytes_);
+    segment_ = nullptr;
+    if (last) {
+        shm_unlink(segmentName_.c_str());
+    }
+}
+
+bool PhysicalLayerSharedMemory::peerAttached() const {
+    int32_t pid = segment_ ? segment_->pids[1 - side_].load() : 0;
+    return pid != 0 && processAlive(pid);
+}
+
+PhysicalLayerSharedMemory::Stats PhysicalLayerSharedMemory::stats() const {
+    Stats stats;
+    stats.framesSent = framesSent_.load();
+    stats.framesReceived = framesReceived_.load();
+    stats.wakeCalls = wakeCalls_.load();
+    stats.sleeps = sleeps_.load();
+    return stats;
+}
+
+// ============================================================
+// Layer interface
+// ============================================================
+
+void PhysicalLayerSharedMemory::configure(ThreadSafeQueue<Frame>& outgoingFramesFromCodingModule,
+                                          CodingModule& codingModule,
+                                          const ValidationConfig& validationConfig) {
+    setEnvironment(outgoingFramesFromCodingModule, codingModule, validationConfig);
+    // An empty ring must take the largest frame wherever its head stands
+    if (2 * recordBytes(maxFrameBytesWithCrc()) > config_.ringBytes) {
+        throw runtime_error("PhysicalLayerSharedMemory: ring of " + to_string(config_.ringBytes) +
+            " bytes is too small for frames of " + to_string(maxFrameBytesWithCrc()) + " bytes");
+    }
+    outgoingFramesFromCodingModule.setOnPush([this]() { ring(segment_->doorbells[side_]); });
+    stopWorker_ = false;
+}
+
+void PhysicalLayerSharedMemory::start() {
+    if (!isConfigured()) {
+        throw runtime_error("PhysicalLayerSharedMemory cannot start before configuration");
+    }
+    if (worker_.joinable()) {
+        return;
+    }
+    worker_ = thread([this]() { workerLoop(); });
+}
+
+// The rings have one reader and one writer per side: without a started
+// worker only
+void PhysicalLayerSharedMemory::tick() {
+    if (!isConfigured()) {
+        throw runtime_error("PhysicalLayerSharedMemory tick called before configuration");
+    }
+    if (worker_.joinable()) {
+        return;
+    }
+    sendOutgoingFrames();
+    receiveIncomingFrames();
+}
+
+bool PhysicalLayerSharedMemory::tryReceive(Frame& outFrame) {
+    (void)outFrame;
+    return false;
+}
+
+// ============================================================
+// Rings
+// ============================================================
+
+bool PhysicalLayerSharedMemory::ringHasRoom(const SharedRing& ring, size_t frameBytes) const {
+    uint64_t head = ring.head.load(memory_order_relaxed);
+    uint64_t tail = ring.tail.load(memory_order_acquire);
+    size_t contiguous = config_.ringBytes - static_cast<size_t>(head & (config_.ringBytes - 1));
+    size_t record = recordBytes(frameBytes);
+    // A record that does not fit before the end also uses up the rest
+    size_t needed = record <= contiguous ? record : contiguous + record;
+    return config_.ringBytes - static_cast<size_t>(head - tail) >= needed;
+}
+
+bool PhysicalLayerSharedMemory::writeFrame(SharedRing& ring, uint8_t* data, const Frame& frame) {
+    if (!ringHasRoom(ring, frame.data.size())) {
+        return false;
+    }
+    uint64_t head = ring.head.load(memory_order_relaxed);
+    size_t offset = static_cast<size_t>(head & (config_.ringBytes - 1));
+    size_t record = recordBytes(frame.data.size());
+    if (record > config_.ringBytes - offset) {
+        memcpy(data + offset, &WRAP_MARKER, LENGTH_FIELD_BYTES);
+        head += config_.ringBytes - offset;
+        offset = 0;
+    }
+    uint32_t length = static_cast<uint32_t>(frame.data.size());
+    memcpy(data + offset, &length, LENGTH_FIELD_BYTES);
+    memcpy(data + offset + LENGTH_FIELD_BYTES, frame.data.data(), frame.data.size());
+    ring.head.store(head + record, memory_order_release);
+    return true;
+}
+
+bool PhysicalLayerSharedMemory::readFrame(SharedRing& ring, uint8_t* data, Frame& out) {
+    uint64_t tail = ring.tail.load(memory_order_relaxed);
+    uint64_t head = ring.head.load(memory_order_acquire);
+    if (tail == head) {
+        return false;
+    }
+    size_t offset = static_cast<size_t>(tail & (config_.ringBytes - 1));
+    uint32_t length = 0;
+    memcpy(&length, data + offset, LENGTH_FIELD_BYTES);
+    if (length == WRAP_MARKER) {
+        tail += config_.ringBytes - offset;
+        offset = 0;
+        memcpy(&length, data, LENGTH_FIELD_BYTES);
+    }
+    // Only a peer that died mid-write or a foreign writer gets here: the
+    // rest of the ring cannot be parsed, so it is dropped
+    if (length > maxFrameBytesWithCrc() || recordBytes(length) > config_.ringBytes - offset ||
+        tail + recordBytes(length) > head) {
+        log(LogLevel::ERROR, "Corrupt record of " + to_string(length) + " bytes in " + segmentName_ +
+            ", dropping " + to_string(head - tail) + " ring bytes");
+        ring.tail.store(head, memory_order_release);
+        return false;
+    }
+    const uint8_t* frame = data + offset + LENGTH_FIELD_BYTES;
+    out.data.assign(frame, frame + length);
+    out.connId = -1;
+    out.peer = 0;
+    ring.tail.store(tail + recordBytes(length), memory_order_release);
+    return true;
+}
+
+bool PhysicalLayerSharedMemory::sendOutgoingFrames() {
+    SharedRing& tx = segment_->rings[side_];
+    bool sent = false;
+    while (true) {
+        if (!heldFrame_) {
+            Frame frame;
+            if (!outgoingFramesFromCodingModule_ || !outgoingFramesFromCodingModule_->tryPop(frame)) {
+                break;
+            }
+            ensureEncodableFrame(frame);
+            heldFrame_ = move(frame);
+        }
+        if (!writeFrame(tx, txData_, *heldFrame_)) {
+            // Announce the wait, then look again: the consumer may have
+            // made room before it could see the flag
+            tx.producerBlocked.store(1);
+            atomic_thread_fence(memory_order_seq_cst);
+            if (!writeFrame(tx, txData_, *heldFrame_)) {
+                if (!sendBlocked_) {
+                    sendBlocked_ = true;
+                    log(LogLevel::WARN, "Shared memory ring full, holding frame size=" +
+                        to_string(heldFrame_->data.size()));
+                    notifySendBackpressure();
+                }
+                break;
+            }
+        }
+        heldFrame_.reset();
+        sendBlocked_ = false;
+        ++framesSent_;
+        sent = true;
+    }
+    if (sent) {
+        ring(segment_->doorbells[1 - side_]);
+    }
+    return sent;
+}
+
+bool PhysicalLayerSharedMemory::receiveIncomingFrames() {
+    SharedRing& rx = segment_->rings[1 - side_];
+    bool received = false;
+    Frame frame;
+    while (readFrame(rx, rxData_, frame)) {
+        received = true;
+        ++framesReceived_;
+        try {
+            ensureDecodableFrame(frame);
+            if (codingModule_) {
+                codingModule_->receiveFrameWithCrc(frame);
+            }
+        } catch (const exception& ex) {
+            log(LogLevel::WARN, string("Dropping invalid received frame: ") + ex.what() +
+                " (size=" + to_string(frame.data.size()) + ")");
+        }
+    }
+    if (received) {
+        atomic_thread_fence(memory_order_seq_cst);
+        if (rx.producerBlocked.load(memory_order_relaxed) != 0) {
+            rx.producerBlocked.store(0, memory_order_relaxed);
+            ring(segment_->doorbells[1 - side_]);
+        }
+    }
+    return received;
+}
+
+// ============================================================
+// Worker and doorbells
+// ============================================================
+
+void PhysicalLayerSharedMemory::workerLoop() {
+    try {
+        auto lastWork = steady_clock::now();
+        while (!stopWorker_) {
+            bool worked = sendOutgoingFrames();
+            worked = receiveIncomingFrames() || worked;
+            if (worked) {
+                lastWork = steady_clock::now();
+            } else if (steady_clock::now() - lastWork < config_.spinBeforeSleep) {
+                this_thread::yield();
+            } else {
+                sleepUntilRung();
+                lastWork = steady_clock::now();
+            }
+        }
+    } catch (const exception& ex) {
+        log(LogLevel::ERROR, string("Worker fatal exception: ") + ex.what());
+    } catch (...) {
+        log(LogLevel::ERROR, "Worker fatal exception: unknown");
+    }
+}
+
+bool PhysicalLayerSharedMemory::hasWork() const {
+    const SharedRing& rx = segment_->rings[1 - side_];
+    if (stopWorker_ || rx.head.load(memory_order_acquire) != rx.tail.load(memory_order_relaxed)) {
+        return true;
+    }
+    if (heldFrame_) {
+        return ringHasRoom(segment_->rings[side_], heldFrame_->data.size());
+    }
+    return outgoingFramesFromCodingModule_ && !outgoingFramesFromCodingModule_->empty();
+}
+
+// Raises the sleeping flag before the last look for work, so whoever adds
+// work after that look sees the flag and rings. No timeout: an idle link
+// does not wake the worker at all.
+void PhysicalLayerSharedMemory::sleepUntilRung() {
+    SharedDoorbell& bell = segment_->doorbells[side_];
+    uint32_t sequence = bell.sequence.load(memory_order_acquire);
+    bell.sleeping.store(1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!hasWork()) {
+        ++sleeps_;
+        futexWait(bell.sequence, sequence);
+    }
+    bell.sleeping.store(0, memory_order_relaxed);
+}
+
+void PhysicalLayerSharedMemory::ring(SharedDoorbell& bell, bool always) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (always || bell.sleeping.load(memory_order_relaxed) != 0) {
+        bell.sequence.fetch_add(1, memory_order_release);
+        futexWake(bell.sequence);
+        ++wakeCalls_;
+    }
+}
+
+#endif
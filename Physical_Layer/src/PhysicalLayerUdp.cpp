@@ -1,6 +1,7 @@
 #include "PhysicalLayerUdp.hpp"
 #include "CodingModule.hpp"
 
+#include <algorithm>
 #include <arpa/inet.h>
 #include <cerrno>
 #include <chrono>
@@ -8,6 +9,26 @@
 #include <fcntl.h>
 #include <stdexcept>
 #include <unistd.h>
+#ifdef UDP_HAVE_EPOLL
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+#ifdef UDP_HAVE_GSO
+#include <netinet/udp.h>
+// Older C libraries lack the names (Linux 4.18 / 5.0)
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+#endif
+#ifdef UDP_HAVE_REUSEPORT
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#endif
 
 using namespace std;
 using namespace chrono;
@@ -15,6 +36,13 @@ using namespace chrono;
 PhysicalLayerUdp::PhysicalLayerUdp(int localPort,
                                    const string& remoteHost,
                                    int remotePort)
+    : PhysicalLayerUdp(localPort, remoteHost, remotePort, false) {
+}
+
+PhysicalLayerUdp::PhysicalLayerUdp(int localPort,
+                                   const string& remoteHost,
+                                   int remotePort,
+                                   bool shareLocalPort)
     : AbstractPhysicalLayer("PhysicalLayerUdp")
     , remotePort_(remotePort)
     , localPort_(localPort)
@@ -30,49 +58,224 @@ PhysicalLayerUdp::PhysicalLayerUdp(int localPort,
         throw invalid_argument("PhysicalLayerUdp: remoteHost must not be empty");
     }
 
+    memset(&remoteAddr_, 0, sizeof(remoteAddr_));
+    remoteAddr_.sin_family = AF_INET;
+    remoteAddr_.sin_port = htons(remotePort);
+    if (inet_pton(AF_INET, remoteHost.c_str(), &remoteAddr_.sin_addr) != 1) {
+        throw runtime_error(string("PhysicalLayerUdp: invalid remote address '") + remoteHost + "'");
+    }
+
+    openSocket(shareLocalPort);
+    size_t probedMtu = probePathMtu(remoteAddr_);
+    if (probedMtu > 0) {
+        pathMtu_ = max(probedMtu, MIN_PATH_MTU);
+    }
+
+    log(LogLevel::INFO, string("UDP socket bound to port ") + to_string(localPort) +
+        ", remote=" + remoteHost + ":" + to_string(remotePort) +
+        ", pathMtu=" + to_string(pathMtu_.load()));
+}
+
+PhysicalLayerUdp::PhysicalLayerUdp(int localPort)
+    : AbstractPhysicalLayer("PhysicalLayerUdp")
+    , remotePort_(0)
+    , localPort_(localPort) {
+
+    if (localPort <= 0 || localPort > 65535) {
+        throw invalid_argument("PhysicalLayerUdp: localPort must be in range 1-65535, got " + to_string(localPort));
+    }
+    multiPeer_ = true;
+    openSocket(false);
+
+    log(LogLevel::INFO, string("UDP socket bound to port ") + to_string(localPort) +
+        ", multi-peer, pathMtu=" + to_string(pathMtu_.load()));
+}
+
+void PhysicalLayerUdp::openSocket(bool shareLocalPort) {
     sock_ = socket(AF_INET, SOCK_DGRAM, 0);
     if (sock_ < 0) {
         throw runtime_error(string("PhysicalLayerUdp: failed to create socket: ") + strerror(errno));
     }
+    int reuse = 1;
+    if (shareLocalPort && setsockopt(sock_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0) {
+        string err = strerror(errno);
+        ::close(sock_);
+        throw runtime_error("PhysicalLayerUdp: failed to share port " + to_string(localPort_) + ": " + err);
+    }
 
     memset(&localAddr_, 0, sizeof(localAddr_));
     localAddr_.sin_family = AF_INET;
     localAddr_.sin_addr.s_addr = INADDR_ANY;
-    localAddr_.sin_port = htons(localPort);
+    localAddr_.sin_port = htons(localPort_);
     if (::bind(sock_, reinterpret_cast<struct sockaddr*>(&localAddr_), sizeof(localAddr_)) < 0) {
         string err = strerror(errno);
         ::close(sock_);
         throw runtime_error(string("PhysicalLayerUdp: failed to bind to port ") +
-            to_string(localPort) + ": " + err);
+            to_string(localPort_) + ": " + err);
     }
 
-    memset(&remoteAddr_, 0, sizeof(remoteAddr_));
-    remoteAddr_.sin_family = AF_INET;
-    remoteAddr_.sin_port = htons(remotePort);
-    if (inet_pton(AF_INET, remoteHost.c_str(), &remoteAddr_.sin_addr) != 1) {
-        ::close(sock_);
-        throw runtime_error(string("PhysicalLayerUdp: invalid remote address '") + remoteHost + "'");
+    fcntl(sock_, F_SETFL, O_NONBLOCK);
+
+#ifdef UDP_HAVE_EPOLL
+    epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epoll_event socketEvent{};
+    socketEvent.events = EPOLLIN;
+    socketEvent.data.fd = sock_;
+    epoll_event wakeEvent{};
+    wakeEvent.events = EPOLLIN;
+    wakeEvent.data.fd = wakeFd_;
+    if (epollFd_ < 0 || wakeFd_ < 0 ||
+        epoll_ctl(epollFd_, EPOLL_CTL_ADD, sock_, &socketEvent) < 0 ||
+        epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeFd_, &wakeEvent) < 0) {
+        string err = strerror(errno);
+        for (int fd : {epollFd_, wakeFd_, sock_}) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+        throw runtime_error("PhysicalLayerUdp: failed to set up epoll: " + err);
     }
+#endif
 
-    fcntl(sock_, F_SETFL, O_NONBLOCK);
-    log(LogLevel::INFO, string("UDP socket bound to port ") + to_string(localPort) +
-        ", remote=" + remoteHost + ":" + to_string(remotePort));
+#ifdef IP_MTU_DISCOVER
+    // Set DF on every datagram so oversized frames fail with EMSGSIZE instead
+    // of being split into IP fragments (losing one fragment loses the frame).
+    int pmtuMode = IP_PMTUDISC_DO;
+    if (setsockopt(sock_, IPPROTO_IP, IP_MTU_DISCOVER, &pmtuMode, sizeof(pmtuMode)) < 0) {
+        log(LogLevel::WARN, string("Failed to enable path MTU discovery: ") + strerror(errno));
+    }
+#endif
 }
 
 void PhysicalLayerUdp::configure(ThreadSafeQueue<Frame>& outgoingFramesFromCodingModule,
                                  CodingModule& codingModule,
                                  const ValidationConfig& validationConfig) {
     setEnvironment(outgoingFramesFromCodingModule, codingModule, validationConfig);
-    recvBuffer_.resize(maxFrameBytesWithCrc());
+    if (segmentationOffload_) {
+        enableSegmentationOffload();
+    }
+    recvSlotBytes_ = groEnabled_ ? GRO_BUFFER_BYTES : maxFrameBytesWithCrc();
+    openReceiveShards();
+    sendBatch_.reserve(ioBatchSize_);
+    if (multiPeer_) {
+        sendDestinations_.reserve(ioBatchSize_);
+    }
+#ifdef UDP_HAVE_MMSG
+    sendMsgs_.assign(ioBatchSize_, mmsghdr{});
+    sendIovecs_.resize(ioBatchSize_);
+    sendRunFrames_.assign(ioBatchSize_, 1);
+    for (size_t i = 0; i < ioBatchSize_; ++i) {
+        sendMsgs_[i].msg_hdr.msg_name = &remoteAddr_;
+        sendMsgs_[i].msg_hdr.msg_namelen = sizeof(remoteAddr_);
+        sendMsgs_[i].msg_hdr.msg_iov = &sendIovecs_[i];
+        sendMsgs_[i].msg_hdr.msg_iovlen = 1;
+    }
+#endif
+#ifdef UDP_HAVE_GSO
+    if (segmentationOffload_) {
+        sendControl_.assign(ioBatchSize_, ControlBuffer{});
+    }
+#endif
+#ifdef UDP_HAVE_EPOLL
+    outgoingFramesFromCodingModule.setOnPush([this]() { wakeWorker(); });
+#endif
     stopWorker_ = false;
 }
 
+void PhysicalLayerUdp::setIoBatchSize(size_t batchSize) {
+    if (batchSize == 0 || batchSize > MAX_IO_BATCH_SIZE) {
+        throw invalid_argument("PhysicalLayerUdp: I/O batch size must be in range 1-" +
+            to_string(MAX_IO_BATCH_SIZE) + ", got " + to_string(batchSize));
+    }
+    if (isConfigured()) {
+        throw runtime_error("PhysicalLayerUdp: I/O batch size must be set before configuration");
+    }
+    ioBatchSize_ = batchSize;
+}
+
+void PhysicalLayerUdp::setSegmentationOffload(bool enabled) {
+    if (isConfigured()) {
+        throw runtime_error("PhysicalLayerUdp: segmentation offload must be set before configuration");
+    }
+    segmentationOffload_ = enabled;
+}
+
+// GSO needs Linux 4.18 and GRO 5.0; without GSO neither is used, without
+// GRO the kernel splits coalesced datagrams before they reach the socket.
+void PhysicalLayerUdp::enableSegmentationOffload() {
+#ifdef UDP_HAVE_GSO
+    int segmentBytes = 0;
+    socklen_t optionLen = sizeof(segmentBytes);
+    if (getsockopt(sock_, IPPROTO_UDP, UDP_SEGMENT, &segmentBytes, &optionLen) < 0) {
+        log(LogLevel::WARN, string("UDP segmentation offload unavailable: ") + strerror(errno));
+        segmentationOffload_ = false;
+        return;
+    }
+    int enable = 1;
+    groEnabled_ = setsockopt(sock_, IPPROTO_UDP, UDP_GRO, &enable, sizeof(enable)) == 0;
+    if (!groEnabled_) {
+        log(LogLevel::WARN, string("UDP receive coalescing unavailable: ") + strerror(errno));
+    }
+#else
+    segmentationOffload_ = false;
+#endif
+}
+
+void PhysicalLayerUdp::setReceiveShards(size_t shards, bool pinThreads) {
+    if (shards == 0 || shards > MAX_RECEIVE_SHARDS) {
+        throw invalid_argument("PhysicalLayerUdp: receive shards must be in range 1-" +
+            to_string(MAX_RECEIVE_SHARDS) + ", got " + to_string(shards));
+    }
+    if (isConfigured()) {
+        throw runtime_error("PhysicalLayerUdp: receive shards must be set before configuration");
+    }
+#ifndef UDP_HAVE_REUSEPORT
+    if (shards > 1) {
+        log(LogLevel::WARN, "Receive shards need SO_REUSEPORT load balancing, using one socket");
+        shards = 1;
+    }
+#endif
+    receiveShardCount_ = shards;
+    pinReceiveThreads_ = pinThreads;
+}
+
+vector<uint64_t> PhysicalLayerUdp::shardDatagramsReceived() const {
+    vector<uint64_t> counts;
+    for (const auto& shard : shards_) {
+        counts.push_back(shard->datagrams);
+    }
+    return counts;
+}
+
+PhysicalLayerUdp::IoStats PhysicalLayerUdp::ioStats() const {
+    IoStats stats;
+    stats.sendCalls = sendCalls_;
+    stats.datagramsSent = datagramsSent_;
+    stats.receiveCalls = receiveCalls_;
+    stats.datagramsReceived = datagramsReceived_;
+    stats.segmentedSends = segmentedSends_;
+    stats.coalescedReceives = coalescedReceives_;
+    return stats;
+}
+
 PhysicalLayerUdp::~PhysicalLayerUdp() {
     log(LogLevel::DEBUG, "Destructor invoked, stopping worker");
     stopWorker_ = true;
+#ifdef UDP_HAVE_EPOLL
+    if (outgoingFramesFromCodingModule_) {
+        outgoingFramesFromCodingModule_->setOnPush(nullptr);
+    }
+    wakeWorker();
+#endif
     if (worker_.joinable()) {
         worker_.join();
     }
+    stopReceiveShards();
+#ifdef UDP_HAVE_EPOLL
+    close(epollFd_);
+    close(wakeFd_);
+#endif
     if (sock_ >= 0) {
         close(sock_);
     }
@@ -87,79 +290,15 @@ void PhysicalLayerUdp::start() {
         return;
     }
     worker_ = thread([this]() { workerLoop(); });
+    startReceiveShards();
 }
 
 void PhysicalLayerUdp::workerLoop() {
-    int consecutiveErrors = 0;
-    static constexpr int MAX_CONSECUTIVE_ERRORS = 50;
-
     try {
         while (!stopWorker_) {
-            Frame frame;
-            while (outgoingFramesFromCodingModule_ && outgoingFramesFromCodingModule_->tryPop(frame)) {
-                ensureEncodableFrame(frame);
-                ssize_t sent = sendto(sock_, frame.data.data(), frame.data.size(), 0,
-                                       reinterpret_cast<struct sockaddr*>(&remoteAddr_), sizeof(remoteAddr_));
-                if (sent < 0) {
-                    int err = errno;
-                    string errMsg = string("UDP send failed: ") + strerror(err) +
-                        " (errno=" + to_string(err) + ", frameSize=" + to_string(frame.data.size()) + ")";
-
-                    if (err == ENETUNREACH || err == EHOSTUNREACH) {
-                        log(LogLevel::ERROR, errMsg + " [network unreachable]");
-                    } else if (err == EMSGSIZE) {
-                        log(LogLevel::ERROR, errMsg + " [message too large for MTU]");
-                    } else if (err == ENOBUFS || err == ENOMEM) {
-                        log(LogLevel::WARN, errMsg + " [buffer full, will retry]");
-                        // Re-queue the frame for retry
-                        if (outgoingFramesFromCodingModule_) {
-                            outgoingFramesFromCodingModule_->push(frame);
-                        }
-                        this_thread::sleep_for(5ms);
-                    } else {
-                        log(LogLevel::ERROR, errMsg);
-                    }
-
-                    consecutiveErrors++;
-                    if (consecutiveErrors >= MAX_CONSECUTIVE_ERRORS) {
-                        log(LogLevel::ERROR, "Too many consecutive send errors (" +
-                            to_string(consecutiveErrors) + "), pausing worker for 1s");
-                        this_thread::sleep_for(1s);
-                        consecutiveErrors = 0;
-                    }
-                    continue;
-                }
-                consecutiveErrors = 0;
-                log(LogLevel::DEBUG, string("Sent frame size=") + to_string(frame.data.size()));
-            }
-
-            sockaddr_in sender{};
-            socklen_t senderLen = sizeof(sender);
-            ssize_t received = recvfrom(sock_, recvBuffer_.data(), recvBuffer_.size(), 0,
-                                        reinterpret_cast<struct sockaddr*>(&sender), &senderLen);
-            while (received > 0) {
-                Frame rxFrame;
-                rxFrame.data.assign(recvBuffer_.begin(), recvBuffer_.begin() + received);
-                try {
-                    ensureDecodableFrame(rxFrame);
-                    log(LogLevel::DEBUG, string("Received frame size=") + to_string(received));
-                    if (codingModule_) {
-                        codingModule_->receiveFrameWithCrc(rxFrame);
-                    }
-                } catch (const exception& ex) {
-                    log(LogLevel::WARN, string("Dropping invalid received frame: ") + ex.what() +
-                        " (size=" + to_string(received) + ")");
-                }
-                received = recvfrom(sock_, recvBuffer_.data(), recvBuffer_.size(), 0,
-                                    reinterpret_cast<struct sockaddr*>(&sender), &senderLen);
-            }
-
-            // Check for recv errors (other than EAGAIN/EWOULDBLOCK which is normal for non-blocking)
-            if (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
-                log(LogLevel::WARN, string("UDP recv error: ") + strerror(errno));
-            }
-
-            this_thread::sleep_for(10ms);
+            microseconds wait = drainOutgoingFrames();
+            receiveIncomingFrames(*shards_[0]);
+            waitForWork(wait);
         }
     } catch (const exception& ex) {
         log(LogLevel::ERROR, string("Worker fatal exception: ") + ex.what());
@@ -168,42 +307,582 @@ void PhysicalLayerUdp::workerLoop() {
     }
 }
 
+// Blocks until a datagram arrives, the coding module queues a frame or a
+// held-back frame may move (`wait`). Without held-back frames an idle link
+// does not wake the worker at all.
+void PhysicalLayerUdp::waitForWork(microseconds wait) {
+#ifdef UDP_HAVE_EPOLL
+    int timeoutMs = -1;
+    if (hasHeldFrames()) {
+        // Rounded up so a wait below 1 ms does not spin
+        timeoutMs = static_cast<int>(max<int64_t>(1, (wait.count() + 999) / 1000));
+    }
+    epoll_event events[2];
+    int ready = epoll_wait(epollFd_, events, 2, timeoutMs);
+    if (ready < 0) {
+        if (errno != EINTR) {
+            log(LogLevel::WARN, string("epoll_wait failed: ") + strerror(errno));
+            this_thread::sleep_for(wait);
+        }
+        return;
+    }
+    for (int i = 0; i < ready; ++i) {
+        if (events[i].data.fd == wakeFd_) {
+            uint64_t signals = 0;
+            ssize_t ignored = read(wakeFd_, &signals, sizeof(signals));
+            (void)ignored;
+        }
+    }
+#else
+    this_thread::sleep_for(wait);
+#endif
+}
+
+void PhysicalLayerUdp::wakeWorker() {
+#ifdef UDP_HAVE_EPOLL
+    uint64_t signal = 1;
+    ssize_t ignored = write(wakeFd_, &signal, sizeof(signal));
+    (void)ignored;
+#endif
+}
+
 void PhysicalLayerUdp::tick() {
     if (!isConfigured()) {
         throw runtime_error("PhysicalLayerUdp tick called before configuration");
     }
 
-    Frame frame;
-    while (outgoingFramesFromCodingModule_->tryPop(frame)) {
-        ensureEncodableFrame(frame);
-        ssize_t sent = sendto(sock_, frame.data.data(), frame.data.size(), 0,
-                               reinterpret_cast<struct sockaddr*>(&remoteAddr_), sizeof(remoteAddr_));
-        if (sent < 0) {
-            int err = errno;
-            log(LogLevel::ERROR, string("Tick send failed: ") + strerror(err) +
-                " (errno=" + to_string(err) + ", size=" + to_string(frame.data.size()) + ")");
-        } else {
-            log(LogLevel::DEBUG, string("Tick sent frame size=") + to_string(frame.data.size()));
-        }
-    }
-
-    sockaddr_in sender{};
-    socklen_t senderLen = sizeof(sender);
-    ssize_t received = recvfrom(sock_, recvBuffer_.data(), recvBuffer_.size(), 0,
-                                reinterpret_cast<struct sockaddr*>(&sender), &senderLen);
-    while (received > 0) {
-        Frame rxFrame;
-        rxFrame.data.assign(recvBuffer_.begin(), recvBuffer_.begin() + received);
-        try {
-            ensureDecodableFrame(rxFrame);
-            log(LogLevel::DEBUG, string("Tick received frame size=") + to_string(received));
+    drainOutgoingFrames();
+    receiveIncomingFrames(*shards_[0]);
+}
+
+// ============================================================
+// Receiving: batched reads
+// ============================================================
+
+// Reads until the socket is empty. A short batch means nothing was left
+// queued, which saves the final EAGAIN call.
+void PhysicalLayerUdp::receiveIncomingFrames(ReceiveShard& shard) {
+    while (receiveBatch(shard) == ioBatchSize_) {
+    }
+}
+
+#ifdef UDP_HAVE_GSO
+// Segment size of a buffer the kernel coalesced from several datagrams of
+// one flow, or 0 for a single datagram
+static size_t coalescedSegmentBytes(msghdr& header) {
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&header); cmsg != nullptr; cmsg = CMSG_NXTHDR(&header, cmsg)) {
+        if (cmsg->cmsg_level == IPPROTO_UDP && cmsg->cmsg_type == UDP_GRO) {
+            int segmentBytes = 0;
+            memcpy(&segmentBytes, CMSG_DATA(cmsg), sizeof(segmentBytes));
+            return segmentBytes > 0 ? static_cast<size_t>(segmentBytes) : 0;
+        }
+    }
+    return 0;
+}
+#endif
+
+// Reads up to ioBatchSize_ buffers of a shard's socket and hands their
+// frames to the coding module. Returns how many buffers were read.
+size_t PhysicalLayerUdp::receiveBatch(ReceiveShard& shard) {
+#ifdef UDP_HAVE_MMSG
+    // The kernel overwrites both lengths with what it filled in
+    for (size_t i = 0; i < ioBatchSize_; ++i) {
+        shard.msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+#ifdef UDP_HAVE_GSO
+        if (groEnabled_) {
+            shard.msgs[i].msg_hdr.msg_controllen = sizeof(ControlBuffer);
+        }
+#endif
+    }
+    int received = recvmmsg(shard.sock, shard.msgs.data(), static_cast<unsigned int>(ioBatchSize_), 0, nullptr);
+    ++receiveCalls_;
+    if (received < 0) {
+        // EAGAIN/EWOULDBLOCK is normal for the non-blocking socket
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            log(LogLevel::WARN, string("UDP recv error: ") + strerror(errno));
+        }
+        return 0;
+    }
+    for (int i = 0; i < received; ++i) {
+        const uint8_t* data = shard.buffer.data() + i * recvSlotBytes_;
+        size_t length = shard.msgs[i].msg_len;
+        LinkAddress source = linkAddressOf(shard.addrs[i]);
+        size_t segmentBytes = 0;
+#ifdef UDP_HAVE_GSO
+        if (groEnabled_) {
+            segmentBytes = coalescedSegmentBytes(shard.msgs[i].msg_hdr);
+        }
+#endif
+        if (segmentBytes == 0 || segmentBytes >= length) {
+            ++datagramsReceived_;
+            ++shard.datagrams;
+            deliverReceivedFrame(data, length, source);
+            continue;
+        }
+        // Every datagram but the last of a coalesced buffer has segmentBytes
+        ++coalescedReceives_;
+        for (size_t offset = 0; offset < length; offset += segmentBytes) {
+            ++datagramsReceived_;
+            ++shard.datagrams;
+            deliverReceivedFrame(data + offset, min(segmentBytes, length - offset), source);
+        }
+    }
+    return static_cast<size_t>(received);
+#else
+    size_t count = 0;
+    while (count < ioBatchSize_) {
+        socklen_t addressLen = sizeof(sockaddr_in);
+        ssize_t received = recvfrom(shard.sock, shard.buffer.data(), recvSlotBytes_, 0,
+                                    reinterpret_cast<struct sockaddr*>(&shard.addrs[0]), &addressLen);
+        ++receiveCalls_;
+        if (received < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                log(LogLevel::WARN, string("UDP recv error: ") + strerror(errno));
+            }
+            break;
+        }
+        ++datagramsReceived_;
+        ++shard.datagrams;
+        ++count;
+        deliverReceivedFrame(shard.buffer.data(), static_cast<size_t>(received), linkAddressOf(shard.addrs[0]));
+    }
+    return count;
+#endif
+}
+
+void PhysicalLayerUdp::deliverReceivedFrame(const uint8_t* data, size_t length, LinkAddress source) {
+    Frame rxFrame;
+    rxFrame.data.assign(data, data + length);
+    rxFrame.peer = source;
+    try {
+        ensureDecodableFrame(rxFrame);
+        log(LogLevel::DEBUG, string("Received frame size=") + to_string(length));
+        if (codingModule_) {
             codingModule_->receiveFrameWithCrc(rxFrame);
-        } catch (const exception& ex) {
-            log(LogLevel::WARN, string("Tick: dropping invalid frame: ") + ex.what());
         }
-        received = recvfrom(sock_, recvBuffer_.data(), recvBuffer_.size(), 0,
-                            reinterpret_cast<struct sockaddr*>(&sender), &senderLen);
+    } catch (const exception& ex) {
+        log(LogLevel::WARN, string("Dropping invalid received frame: ") + ex.what() +
+            " (size=" + to_string(length) + ")");
+    }
+}
+
+// ============================================================
+// Receive shards: one SO_REUSEPORT socket per receiving thread
+// ============================================================
+
+// The first shard reads sock_. A socket joins a SO_REUSEPORT group only
+// when the bound members have the option too, so sock_ gets it first.
+void PhysicalLayerUdp::openReceiveShards() {
+    if (shards_.empty()) {
+        auto primary = make_unique<ReceiveShard>();
+        primary->sock = sock_;
+        shards_.push_back(move(primary));
+    }
+#ifdef UDP_HAVE_REUSEPORT
+    int enable = 1;
+    if (shards_.size() < receiveShardCount_) {
+        if (setsockopt(sock_, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) < 0) {
+            throw runtime_error(string("PhysicalLayerUdp: failed to share port ") + to_string(localPort_) +
+                ": " + strerror(errno));
+        }
+        if (shardStopFd_ < 0) {
+            shardStopFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (shardStopFd_ < 0) {
+                throw runtime_error(string("PhysicalLayerUdp: failed to create eventfd: ") + strerror(errno));
+            }
+        }
+    }
+    while (shards_.size() < receiveShardCount_) {
+        int sock = socket(AF_INET, SOCK_DGRAM, 0);
+        if (sock < 0) {
+            throw runtime_error(string("PhysicalLayerUdp: failed to create socket: ") + strerror(errno));
+        }
+        if (setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) < 0 ||
+            ::bind(sock, reinterpret_cast<struct sockaddr*>(&localAddr_), sizeof(localAddr_)) < 0) {
+            string err = strerror(errno);
+            ::close(sock);
+            throw runtime_error(string("PhysicalLayerUdp: failed to open receive shard on port ") +
+                to_string(localPort_) + ": " + err);
+        }
+        fcntl(sock, F_SETFL, O_NONBLOCK);
+#ifdef UDP_HAVE_GSO
+        // Receive slots are sized for coalesced buffers on every shard
+        if (groEnabled_ && setsockopt(sock, IPPROTO_UDP, UDP_GRO, &enable, sizeof(enable)) < 0) {
+            log(LogLevel::WARN, string("UDP receive coalescing unavailable on shard: ") + strerror(errno));
+        }
+#endif
+        auto shard = make_unique<ReceiveShard>();
+        shard->sock = sock;
+        shards_.push_back(move(shard));
+    }
+    if (shards_.size() > 1) {
+        log(LogLevel::INFO, string("Receiving on ") + to_string(shards_.size()) +
+            " SO_REUSEPORT sockets, port " + to_string(localPort_));
+    }
+#endif
+    for (auto& shard : shards_) {
+        setUpReceiveShard(*shard);
+    }
+}
+
+void PhysicalLayerUdp::setUpReceiveShard(ReceiveShard& shard) {
+    shard.buffer.assign(recvSlotBytes_ * ioBatchSize_, 0);
+    shard.addrs.assign(ioBatchSize_, sockaddr_in{});
+#ifdef UDP_HAVE_MMSG
+    shard.msgs.assign(ioBatchSize_, mmsghdr{});
+    shard.iovecs.resize(ioBatchSize_);
+    for (size_t i = 0; i < ioBatchSize_; ++i) {
+        shard.iovecs[i].iov_base = shard.buffer.data() + i * recvSlotBytes_;
+        shard.iovecs[i].iov_len = recvSlotBytes_;
+        shard.msgs[i].msg_hdr.msg_name = &shard.addrs[i];
+        shard.msgs[i].msg_hdr.msg_iov = &shard.iovecs[i];
+        shard.msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+#endif
+#ifdef UDP_HAVE_GSO
+    if (groEnabled_) {
+        shard.control.assign(ioBatchSize_, ControlBuffer{});
+        for (size_t i = 0; i < ioBatchSize_; ++i) {
+            shard.msgs[i].msg_hdr.msg_control = shard.control[i].bytes;
+        }
+    }
+#endif
+}
+
+#ifdef UDP_HAVE_REUSEPORT
+// Pins a thread to the `index`-th CPU this process may run on, wrapping
+// around when there are fewer CPUs than threads
+static bool pinToAllowedCpu(thread& worker, size_t index) {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return false;
+    }
+    vector<int> cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &allowed)) {
+            cpus.push_back(cpu);
+        }
+    }
+    if (cpus.empty()) {
+        return false;
+    }
+    cpu_set_t target;
+    CPU_ZERO(&target);
+    CPU_SET(cpus[index % cpus.size()], &target);
+    return pthread_setaffinity_np(worker.native_handle(), sizeof(target), &target) == 0;
+}
+#endif
+
+// Runs after the worker started: it reads the first shard
+void PhysicalLayerUdp::startReceiveShards() {
+#ifdef UDP_HAVE_REUSEPORT
+    if (shards_.size() < 2) {
+        return;
+    }
+    for (size_t i = 1; i < shards_.size(); ++i) {
+        ReceiveShard& shard = *shards_[i];
+        shard.reader = thread([this, &shard]() { receiveShardLoop(shard); });
+    }
+    if (pinReceiveThreads_) {
+        bool pinned = pinToAllowedCpu(worker_, 0);
+        for (size_t i = 1; i < shards_.size(); ++i) {
+            pinned = pinToAllowedCpu(shards_[i]->reader, i) && pinned;
+        }
+        if (!pinned) {
+            log(LogLevel::WARN, "Failed to pin receive threads to cores");
+        }
+    }
+#endif
+}
+
+void PhysicalLayerUdp::stopReceiveShards() {
+#ifdef UDP_HAVE_REUSEPORT
+    if (shardStopFd_ < 0) {
+        return;
+    }
+    uint64_t signal = 1;
+    ssize_t ignored = write(shardStopFd_, &signal, sizeof(signal));
+    (void)ignored;
+    for (size_t i = 1; i < shards_.size(); ++i) {
+        if (shards_[i]->reader.joinable()) {
+            shards_[i]->reader.join();
+        }
+        close(shards_[i]->sock);
+    }
+    close(shardStopFd_);
+    shardStopFd_ = -1;
+#endif
+}
+
+// Blocks until the shard's socket has datagrams or the layer stops
+void PhysicalLayerUdp::receiveShardLoop(ReceiveShard& shard) {
+#ifdef UDP_HAVE_REUSEPORT
+    pollfd fds[2]{};
+    fds[0].fd = shard.sock;
+    fds[0].events = POLLIN;
+    fds[1].fd = shardStopFd_;
+    fds[1].events = POLLIN;
+    try {
+        while (true) {
+            int ready = poll(fds, 2, -1);
+            if (ready < 0) {
+                if (errno != EINTR) {
+                    log(LogLevel::WARN, string("Receive shard poll failed: ") + strerror(errno));
+                    this_thread::sleep_for(WORKER_INTERVAL);
+                }
+                continue;
+            }
+            if (fds[1].revents != 0) {
+                break;
+            }
+            receiveIncomingFrames(shard);
+        }
+    } catch (const exception& ex) {
+        log(LogLevel::ERROR, string("Receive shard fatal exception: ") + ex.what());
+    } catch (...) {
+        log(LogLevel::ERROR, "Receive shard fatal exception: unknown");
     }
+#else
+    (void)shard;
+#endif
+}
+
+// ============================================================
+// Sending: pacing and socket buffer backpressure
+// ============================================================
+
+// Sends queued frames while the pacer and the socket allow, up to
+// ioBatchSize_ per call. Only Frame::paced frames wait for the pacer, in
+// their order; the others go out at once. Returns how long the caller may
+// wait before frames can move again.
+microseconds PhysicalLayerUdp::drainOutgoingFrames() {
+    microseconds wait = WORKER_INTERVAL;
+    auto now = steady_clock::now();
+    while (true) {
+        bool queueEmpty = false;
+        while (sendBatch_.size() < ioBatchSize_) {
+            if (!pacedFrames_.empty()) {
+                microseconds delay = pacer_.delayFor(pacedFrames_.front().data.size(), now);
+                if (delay.count() == 0) {
+                    pacer_.consume(pacedFrames_.front().data.size());
+                    batchFrame(move(pacedFrames_.front()));
+                    pacedFrames_.pop();
+                    continue;
+                }
+                wait = min(wait, delay);
+            }
+            Frame frame;
+            if (!outgoingFramesFromCodingModule_ || !outgoingFramesFromCodingModule_->tryPop(frame)) {
+                queueEmpty = true;
+                break;
+            }
+            ensureEncodableFrame(frame);
+            if (frame.paced) {
+                pacedFrames_.push(move(frame));
+            } else {
+                batchFrame(move(frame));
+            }
+        }
+        if (sendBatch_.empty()) {
+            break;
+        }
+
+        size_t handled = 0;
+        SendResult result = sendBatch(handled);
+        sendBatch_.erase(sendBatch_.begin(), sendBatch_.begin() + static_cast<ptrdiff_t>(handled));
+        if (multiPeer_) {
+            sendDestinations_.erase(sendDestinations_.begin(),
+                                    sendDestinations_.begin() + static_cast<ptrdiff_t>(handled));
+        }
+        if (result == SendResult::BLOCKED) {
+            // The refused frame stays at the head; the session backs off meanwhile
+            if (!sendBlocked_) {
+                sendBlocked_ = true;
+                log(LogLevel::WARN, string("UDP send buffer full, holding frame size=") +
+                    to_string(sendBatch_.front().data.size()));
+                notifySendBackpressure();
+            }
+            wait = min<microseconds>(wait, BUFFER_RETRY_INTERVAL);
+            break;
+        }
+        sendBlocked_ = false;
+        if (queueEmpty) {
+            break;
+        }
+    }
+    return wait;
+}
+
+void PhysicalLayerUdp::batchFrame(Frame&& frame) {
+    sockaddr_in destination{};
+    if (multiPeer_ && !routeFrame(frame, destination)) {
+        log(LogLevel::WARN, string("No address for connection ") + to_string(frame.connId) +
+            ", dropping frame size=" + to_string(frame.data.size()));
+        return;
+    }
+    if (multiPeer_) {
+        sendDestinations_.push_back(destination);
+    }
+    sendBatch_.push_back(move(frame));
+}
+
+PhysicalLayerUdp::SendResult PhysicalLayerUdp::sendBatch(size_t& handled) {
+    size_t count = sendBatch_.size();
+    handled = 0;
+#ifdef UDP_HAVE_MMSG
+    for (size_t i = 0; i < count; ++i) {
+        sendIovecs_[i].iov_base = const_cast<uint8_t*>(sendBatch_[i].data.data());
+        sendIovecs_[i].iov_len = sendBatch_[i].data.size();
+    }
+    size_t unsegmentedUntil = 0;
+#endif
+    while (handled < count) {
+        SendResult result;
+#ifdef UDP_HAVE_MMSG
+        // The kernel stops at the first message it cannot take: a short count
+        // means the next call reports that message's error
+        size_t messages = buildSendMessages(handled, count, unsegmentedUntil);
+        int sent = sendmmsg(sock_, sendMsgs_.data(), static_cast<unsigned int>(messages), 0);
+        ++sendCalls_;
+        if (sent > 0) {
+            size_t frames = 0;
+            for (int m = 0; m < sent; ++m) {
+                frames += sendRunFrames_[m];
+                if (sendRunFrames_[m] > 1) {
+                    ++segmentedSends_;
+                }
+            }
+            datagramsSent_ += frames;
+            handled += frames;
+            noteSendResult(SendResult::SENT);
+            log(LogLevel::DEBUG, string("Sent ") + to_string(frames) + " frames in " + to_string(sent) + " messages");
+            continue;
+        }
+        int err = errno;
+        if (sendRunFrames_[0] > 1 && err != ENOBUFS && err != ENOMEM && err != EAGAIN && err != EWOULDBLOCK) {
+            // The run goes out frame by frame, so a frame the path cannot
+            // take (EMSGSIZE) gets the usual handling. EIO: the device has
+            // no checksum offload, which GSO needs.
+            if (err == EIO) {
+                log(LogLevel::WARN, "UDP segmentation offload refused by the device, disabling it");
+                segmentationOffload_ = false;
+            }
+            unsegmentedUntil = handled + sendRunFrames_[0];
+            continue;
+        }
+        result = handleSendError(err, handled);
+#else
+        result = sendFrame(handled);
+#endif
+        if (result == SendResult::BLOCKED) {
+            return result;
+        }
+        ++handled;
+        noteSendResult(result);
+    }
+    return SendResult::SENT;
+}
+
+#ifdef UDP_HAVE_MMSG
+// A run is frames of one size to one destination, optionally ended by a
+// shorter one, as the kernel cuts a GSO buffer into segments of the first
+// frame's size.
+size_t PhysicalLayerUdp::buildSendMessages(size_t first, size_t count, size_t unsegmentedUntil) {
+    bool segment = segmentationOffload_;
+    size_t maxSegmentBytes = maxFrameBytesOnLink();
+    size_t messages = 0;
+    for (size_t i = first; i < count; ++messages) {
+        size_t run = 1;
+        size_t segmentBytes = sendBatch_[i].data.size();
+        if (segment && i >= unsegmentedUntil && segmentBytes <= maxSegmentBytes) {
+            size_t runBytes = segmentBytes;
+            while (i + run < count && run < GSO_MAX_SEGMENTS) {
+                size_t nextBytes = sendBatch_[i + run].data.size();
+                if (nextBytes > segmentBytes || runBytes + nextBytes > MAX_UDP_PAYLOAD_BYTES ||
+                    (multiPeer_ && linkAddressOf(sendDestinations_[i + run]) != linkAddressOf(sendDestinations_[i]))) {
+                    break;
+                }
+                runBytes += nextBytes;
+                ++run;
+                if (nextBytes < segmentBytes) {
+                    break;
+                }
+            }
+        }
+        msghdr& header = sendMsgs_[messages].msg_hdr;
+        header.msg_name = const_cast<sockaddr_in*>(&destinationOf(i));
+        header.msg_iov = &sendIovecs_[i];
+        header.msg_iovlen = run;
+        header.msg_control = nullptr;
+        header.msg_controllen = 0;
+#ifdef UDP_HAVE_GSO
+        if (run > 1) {
+            header.msg_control = sendControl_[messages].bytes;
+            header.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+            cmsghdr* cmsg = CMSG_FIRSTHDR(&header);
+            cmsg->cmsg_level = IPPROTO_UDP;
+            cmsg->cmsg_type = UDP_SEGMENT;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            uint16_t gsoSize = static_cast<uint16_t>(segmentBytes);
+            memcpy(CMSG_DATA(cmsg), &gsoSize, sizeof(gsoSize));
+        }
+#endif
+        sendRunFrames_[messages] = run;
+        i += run;
+    }
+    return messages;
+}
+#endif
+
+void PhysicalLayerUdp::noteSendResult(SendResult result) {
+    if (result == SendResult::SENT) {
+        consecutiveSendErrors_ = 0;
+    } else if (++consecutiveSendErrors_ >= MAX_CONSECUTIVE_ERRORS) {
+        log(LogLevel::ERROR, "Too many consecutive send errors (" +
+            to_string(consecutiveSendErrors_) + "), pausing worker for 1s");
+        this_thread::sleep_for(1s);
+        consecutiveSendErrors_ = 0;
+    }
+}
+
+#ifndef UDP_HAVE_MMSG
+PhysicalLayerUdp::SendResult PhysicalLayerUdp::sendFrame(size_t index) {
+    const Frame& frame = sendBatch_[index];
+    ssize_t sent = sendto(sock_, frame.data.data(), frame.data.size(), 0,
+                          reinterpret_cast<const struct sockaddr*>(&destinationOf(index)), sizeof(sockaddr_in));
+    ++sendCalls_;
+    if (sent >= 0) {
+        ++datagramsSent_;
+        log(LogLevel::DEBUG, string("Sent frame size=") + to_string(frame.data.size()));
+        return SendResult::SENT;
+    }
+    return handleSendError(errno, index);
+}
+#endif
+
+PhysicalLayerUdp::SendResult PhysicalLayerUdp::handleSendError(int err, size_t index) {
+    const Frame& frame = sendBatch_[index];
+    if (err == ENOBUFS || err == ENOMEM || err == EAGAIN || err == EWOULDBLOCK) {
+        return SendResult::BLOCKED;
+    }
+
+    string errMsg = string("UDP send failed: ") + strerror(err) +
+        " (errno=" + to_string(err) + ", frameSize=" + to_string(frame.data.size()) + ")";
+    if (err == ENETUNREACH || err == EHOSTUNREACH) {
+        log(LogLevel::ERROR, errMsg + " [network unreachable]");
+    } else if (err == EMSGSIZE) {
+        log(LogLevel::WARN, errMsg + " [exceeds path MTU " + to_string(pathMtu_.load()) + "]");
+        refreshPathMtu(destinationOf(index));
+        // The frame was cut for the old MTU; let IP fragment it this once
+        // so it is not lost. Later packages are sized for the new MTU.
+        if (sendFragmentable(frame, destinationOf(index))) {
+            return SendResult::SENT;
+        }
+    } else {
+        log(LogLevel::ERROR, errMsg);
+    }
+    return SendResult::FAILED;
 }
 
 bool PhysicalLayerUdp::tryReceive(Frame& outFrame) {
@@ -214,3 +893,198 @@ bool PhysicalLayerUdp::tryReceive(Frame& outFrame) {
     incomingFrames_.pop();
     return true;
 }
+
+// ============================================================
+// Path MTU
+// ============================================================
+
+size_t PhysicalLayerUdp::maxFrameBytesOnLink() const {
+    return pathMtu_ - IPV4_UDP_OVERHEAD_BYTES;
+}
+
+void PhysicalLayerUdp::setPathMtu(size_t mtu) {
+    if (mtu < MIN_PATH_MTU) {
+        throw invalid_argument("PhysicalLayerUdp: path MTU must be at least " +
+            to_string(MIN_PATH_MTU) + ", got " + to_string(mtu));
+    }
+    pathMtuPinned_ = true;
+    pathMtu_ = mtu;
+    log(LogLevel::INFO, string("Path MTU pinned to ") + to_string(mtu));
+    notifyLinkMtuChanged();
+}
+
+// Asks the kernel for the route MTU towards a peer. The unconnected data
+// socket cannot be queried, so a connected probe socket shares the same
+// route cache entry, including MTUs learned from ICMP. Returns 0 if unknown.
+size_t PhysicalLayerUdp::probePathMtu(const sockaddr_in& destination) const {
+#ifdef IP_MTU
+    int probe = socket(AF_INET, SOCK_DGRAM, 0);
+    if (probe < 0) {
+        return 0;
+    }
+    int mtu = 0;
+    socklen_t mtuLen = sizeof(mtu);
+    bool ok = ::connect(probe, reinterpret_cast<const struct sockaddr*>(&destination), sizeof(destination)) == 0 &&
+              getsockopt(probe, IPPROTO_IP, IP_MTU, &mtu, &mtuLen) == 0;
+    ::close(probe);
+    return ok && mtu > 0 ? static_cast<size_t>(mtu) : 0;
+#else
+    (void)destination;
+    return 0;
+#endif
+}
+
+// A multi-peer layer keeps the lowest MTU of the paths it has probed.
+// Probes are rate-limited per destination, see PATH_MTU_PROBE_INTERVAL.
+bool PhysicalLayerUdp::refreshPathMtu(const sockaddr_in& destination) {
+    if (pathMtuPinned_) {
+        return false;
+    }
+    size_t probed;
+    {
+        lock_guard<mutex> lock(pathProbesMutex_);
+        auto now = chrono::steady_clock::now();
+        auto [it, inserted] = pathProbes_.try_emplace(destination.sin_addr.s_addr);
+        if (inserted || now - it->second.probedAt >= PATH_MTU_PROBE_INTERVAL) {
+            it->second.mtu = probePathMtu(destination);
+            it->second.probedAt = now;
+        }
+        probed = it->second.mtu;
+    }
+    if (probed == 0 || probed >= pathMtu_) {
+        return false;
+    }
+    size_t mtu = max(probed, MIN_PATH_MTU);
+    log(LogLevel::INFO, string("Path MTU lowered from ") + to_string(pathMtu_.load()) + " to " + to_string(mtu));
+    pathMtu_ = mtu;
+    notifyLinkMtuChanged();
+    return true;
+}
+
+bool PhysicalLayerUdp::sendFragmentable(const Frame& frame, const sockaddr_in& destination) {
+#ifdef IP_MTU_DISCOVER
+    int allowFragments = IP_PMTUDISC_DONT;
+    setsockopt(sock_, IPPROTO_IP, IP_MTU_DISCOVER, &allowFragments, sizeof(allowFragments));
+    ssize_t sent = sendto(sock_, frame.data.data(), frame.data.size(), 0,
+                          reinterpret_cast<const struct sockaddr*>(&destination), sizeof(destination));
+    ++sendCalls_;
+    if (sent >= 0) {
+        ++datagramsSent_;
+    }
+    int setDontFragment = IP_PMTUDISC_DO;
+    setsockopt(sock_, IPPROTO_IP, IP_MTU_DISCOVER, &setDontFragment, sizeof(setDontFragment));
+    return sent >= 0;
+#else
+    (void)frame;
+    (void)destination;
+    return false;
+#endif
+}
+
+// ============================================================
+// Multi-peer address book
+// ============================================================
+
+LinkAddress PhysicalLayerUdp::linkAddressOf(const sockaddr_in& address) {
+    return (static_cast<LinkAddress>(ntohl(address.sin_addr.s_addr)) << 16) | ntohs(address.sin_port);
+}
+
+sockaddr_in PhysicalLayerUdp::socketAddressOf(LinkAddress address) {
+    sockaddr_in result{};
+    result.sin_family = AF_INET;
+    result.sin_addr.s_addr = htonl(static_cast<uint32_t>(address >> 16));
+    result.sin_port = htons(static_cast<uint16_t>(address & 0xFFFF));
+    return result;
+}
+
+static string describeAddress(const sockaddr_in& address) {
+    char host[INET_ADDRSTRLEN] = {};
+    inet_ntop(AF_INET, &address.sin_addr, host, sizeof(host));
+    return string(host) + ":" + to_string(ntohs(address.sin_port));
+}
+
+void PhysicalLayerUdp::addPeer(DeviceId deviceId, const string& host, int port) {
+    if (!multiPeer_) {
+        throw runtime_error("PhysicalLayerUdp: addPeer needs a multi-peer layer");
+    }
+    if (port <= 0 || port > 65535) {
+        throw invalid_argument("PhysicalLayerUdp: peer port must be in range 1-65535, got " + to_string(port));
+    }
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1) {
+        throw invalid_argument("PhysicalLayerUdp: invalid peer address '" + host + "'");
+    }
+    {
+        lock_guard<mutex> lock(peersMutex_);
+        peers_[deviceId] = address;
+    }
+    log(LogLevel::INFO, string("Device ") + to_string(deviceId) + " at " + describeAddress(address));
+    refreshPathMtu(address);
+}
+
+void PhysicalLayerUdp::removePeer(DeviceId deviceId) {
+    lock_guard<mutex> lock(peersMutex_);
+    peers_.erase(deviceId);
+}
+
+bool PhysicalLayerUdp::hasPeer(DeviceId deviceId) const {
+    lock_guard<mutex> lock(peersMutex_);
+    return peers_.count(deviceId) > 0;
+}
+
+size_t PhysicalLayerUdp::peerCount() const {
+    lock_guard<mutex> lock(peersMutex_);
+    return peers_.size();
+}
+
+void PhysicalLayerUdp::bindConnection(ConnectionId connId, DeviceId remoteId) {
+    if (!multiPeer_) {
+        return;
+    }
+    lock_guard<mutex> lock(peersMutex_);
+    connectionPeers_[connId] = remoteId;
+}
+
+void PhysicalLayerUdp::unbindConnection(ConnectionId connId) {
+    if (!multiPeer_) {
+        return;
+    }
+    lock_guard<mutex> lock(peersMutex_);
+    connectionPeers_.erase(connId);
+}
+
+void PhysicalLayerUdp::notePeerAddress(DeviceId remoteId, LinkAddress address) {
+    if (!multiPeer_ || address == 0) {
+        return;
+    }
+    sockaddr_in source = socketAddressOf(address);
+    {
+        lock_guard<mutex> lock(peersMutex_);
+        auto it = peers_.find(remoteId);
+        if (it != peers_.end() && linkAddressOf(it->second) == address) {
+            return;
+        }
+        peers_[remoteId] = source;
+    }
+    log(LogLevel::INFO, string("Device ") + to_string(remoteId) + " now at " + describeAddress(source));
+}
+
+bool PhysicalLayerUdp::routeFrame(const Frame& frame, sockaddr_in& destination) const {
+    if (frame.peer != 0) {
+        destination = socketAddressOf(frame.peer);
+        return true;
+    }
+    lock_guard<mutex> lock(peersMutex_);
+    auto connIt = connectionPeers_.find(frame.connId);
+    if (connIt == connectionPeers_.end()) {
+        return false;
+    }
+    auto peerIt = peers_.find(connIt->second);
+    if (peerIt == peers_.end()) {
+        return false;
+    }
+    destination = peerIt->second;
+    return true;
+}
@@ -0,0 +1,69 @@
+#include "PhysicalLayerUdpMulticast.hpp"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+// Checked before the base class binds the port
+static const string& multicastGroup(const string& groupAddress) {
+    in_addr group{};
+    if (inet_pton(AF_INET, groupAddress.c_str(), &group) != 1 || !IN_MULTICAST(ntohl(group.s_addr))) {
+        throw invalid_argument("PhysicalLayerUdpMulticast: '" + groupAddress + "' is not an IPv4 multicast address");
+    }
+    return groupAddress;
+}
+
+PhysicalLayerUdpMulticast::PhysicalLayerUdpMulticast(const string& groupAddress, int port,
+                                                     const MulticastConfig& config)
+    : PhysicalLayerUdp(port, multicastGroup(groupAddress), port, true)
+    , groupAddress_(groupAddress)
+    , config_(config) {
+
+    if (config.ttl < 0 || config.ttl > 255) {
+        throw invalid_argument("PhysicalLayerUdpMulticast: ttl must be in range 0-255, got " +
+            to_string(config.ttl));
+    }
+    joinGroup();
+
+    log(LogLevel::INFO, "UDP socket joined group " + groupAddress + ":" + to_string(port) +
+        " on interface " + config.interfaceAddress + ", ttl=" + to_string(config.ttl));
+}
+
+void PhysicalLayerUdpMulticast::joinGroup() {
+    in_addr interface{};
+    if (inet_pton(AF_INET, config_.interfaceAddress.c_str(), &interface) != 1) {
+        throw invalid_argument("PhysicalLayerUdpMulticast: invalid interface address '" +
+            config_.interfaceAddress + "'");
+    }
+
+    ip_mreq membership{};
+    membership.imr_multiaddr = remoteAddr_.sin_addr;
+    membership.imr_interface = interface;
+    int ttl = config_.ttl;
+    int loop = config_.loopback ? 1 : 0;
+    if (setsockopt(sock_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) < 0 ||
+        setsockopt(sock_, IPPROTO_IP, IP_MULTICAST_IF, &interface, sizeof(interface)) < 0 ||
+        setsockopt(sock_, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) < 0 ||
+        setsockopt(sock_, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) < 0) {
+        throw runtime_error("PhysicalLayerUdpMulticast: failed to join group " + groupAddress_ + ": " +
+            strerror(errno));
+    }
+#ifdef IP_MULTICAST_ALL
+    // The socket is bound to the wildcard address: without this it would
+    // also get the datagrams of other groups joined on the host at this port
+    int all = 0;
+    setsockopt(sock_, IPPROTO_IP, IP_MULTICAST_ALL, &all, sizeof(all));
+#endif
+}
+
+void PhysicalLayerUdpMulticast::configure(ThreadSafeQueue<Frame>& outgoingFramesFromCodingModule,
+                                          CodingModule& codingModule,
+                                          const ValidationConfig& validationConfig) {
+    if (receiveShards() > 1) {
+        throw runtime_error("PhysicalLayerUdpMulticast: receive shards are not supported");
+    }
+    PhysicalLayerUdp::configure(outgoingFramesFromCodingModule, codingModule, validationConfig);
+}
@@ -1,12 +1,27 @@
 #include "PhysicalLayerInMemory.hpp"
+#include "PhysicalLayerUdp.hpp"
+#include "PhysicalLayerIoUring.hpp"
+#include "PhysicalLayerUdpMulticast.hpp"
+#include "PhysicalLayerSharedMemory.hpp"
+#include "Pacer.hpp"
 #include "EminentSdk.hpp"
 #include "ValidationConfig.hpp"
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <arpa/inet.h>
 #include <atomic>
 #include <chrono>
+#include <fcntl.h>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <random>
 #include <string>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
 #include <thread>
+#include <unistd.h>
 #include <vector>
 
 using namespace std;
@@ -177,3 +192,825 @@ TEST(PhysicalLayer, CrcIntegrityPreserved) {
     EXPECT_TRUE(received.load());
     EXPECT_EQ(receivedPayload, testPayload);
 }
+
+// ============================================================
+// UDP path MTU tests
+// ============================================================
+
+TEST(PhysicalLayer, UdpPathMtuLimitsFrameSize) {
+    PhysicalLayerUdp layer(47311, "127.0.0.1", 47312);
+    EXPECT_GE(layer.pathMtu(), PhysicalLayerUdp::MIN_PATH_MTU);
+    EXPECT_EQ(layer.maxFrameBytesOnLink(), layer.pathMtu() - PhysicalLayerUdp::IPV4_UDP_OVERHEAD_BYTES);
+
+    size_t notified = 0;
+    layer.setOnLinkMtuChanged([&](size_t maxFrameBytes) { notified = maxFrameBytes; });
+    layer.setPathMtu(1400);
+    EXPECT_EQ(layer.pathMtu(), 1400u);
+    EXPECT_EQ(notified, 1400u - PhysicalLayerUdp::IPV4_UDP_OVERHEAD_BYTES);
+
+    EXPECT_THROW(layer.setPathMtu(100), invalid_argument);
+}
+
+TEST(PhysicalLayer, UdpFragmentsFollowPathMtu) {
+    EminentSdk sdkA(47321, "127.0.0.1", 47322);
+    EminentSdk sdkB(47322, "127.0.0.1", 47321);
+    sdkA.setPathMtu(1500);
+    sdkB.setPathMtu(1500);
+
+    ValidationConfig vc;
+    size_t expected = 1500 - PhysicalLayerUdp::IPV4_UDP_OVERHEAD_BYTES -
+        vc.transportHeaderBytes() - ValidationConfig::CRC_FIELD_BYTES;
+    EXPECT_EQ(sdkA.getMaxFragmentPayload(), expected);
+
+    sdkA.initialize(1001, [](){}, [](const string&){},
+        [](DeviceId, const string&) { return true; });
+
+    atomic<bool> received{false};
+    string receivedPayload;
+    sdkB.initialize(2002, [](){}, [](const string&){},
+        [](DeviceId, const string&) { return true; },
+        [&](ConnectionId cid, DeviceId) {
+            sdkB.setOnMessageHandler(cid, [&](const Message& msg) {
+                receivedPayload = msg.payload;
+                received = true;
+            });
+        });
+
+    atomic<ConnectionId> connA{-1};
+    sdkA.connect(2002, 5, nullptr, nullptr, nullptr, nullptr,
+        [&](ConnectionId cid) { connA = cid; }, nullptr);
+
+    auto deadline = steady_clock::now() + 5s;
+    while (connA.load() == -1 && steady_clock::now() < deadline) {
+        this_thread::sleep_for(50ms);
+    }
+    ASSERT_NE(connA.load(), -1);
+
+    string payload(20000, 'M');
+    atomic<bool> delivered{false};
+    sdkA.send(connA.load(), payload, MessageFormat::JSON, 5, true, [&]() { delivered = true; });
+
+    deadline = steady_clock::now() + 10s;
+    while ((!received.load() || !delivered.load()) && steady_clock::now() < deadline) {
+        this_thread::sleep_for(50ms);
+    }
+    EXPECT_TRUE(received.load());
+    EXPECT_TRUE(delivered.load());
+    EXPECT_EQ(receivedPayload, payload);
+}
+
+// ============================================================
+// Pacing
+// ============================================================
+
+TEST(PhysicalLayer, PacerSpreadsFramesAtRate) {
+    Pacer pacer;
+    auto now = steady_clock::now();
+    EXPECT_EQ(pacer.delayFor(1000, now), microseconds{0});  // unpaced
+
+    pacer.setRate(1e6);  // 1000-byte frames: one per millisecond
+    int sent = 0;
+    auto end = now + 100ms;
+    while (now < end) {
+        microseconds delay = pacer.delayFor(1000, now);
+        if (delay.count() > 0) {
+            now += delay;
+            continue;
+        }
+        pacer.consume(1000);
+        ++sent;
+    }
+    // 100 ms of tokens plus the initial burst
+    EXPECT_GE(sent, 98);
+    EXPECT_LE(sent, 100 + static_cast<int>(Pacer::MIN_BURST_BYTES / 1000) + 1);
+
+    // Idle time does not build up more than one burst
+    now += 1s;
+    int burst = 0;
+    while (pacer.delayFor(1000, now).count() == 0) {
+        pacer.consume(1000);
+        ++burst;
+    }
+    EXPECT_EQ(burst, static_cast<int>(Pacer::MIN_BURST_BYTES / 1000));
+}
+
+TEST(PhysicalLayer, UdpPacingFollowsCongestionControl) {
+    auto layerA = make_unique<PhysicalLayerUdp>(47331, "127.0.0.1", 47332);
+    PhysicalLayerUdp* udpA = layerA.get();
+    ValidationConfig vc;
+    EminentSdk sdkA(std::move(layerA), vc);
+    EminentSdk sdkB(47332, "127.0.0.1", 47331);
+
+    sdkA.initialize(1001, [](){}, [](const string&){},
+        [](DeviceId, const string&) { return true; });
+    sdkB.initialize(2002, [](){}, [](const string&){},
+        [](DeviceId, const string&) { return true; },
+        [&](ConnectionId cid, DeviceId) { sdkB.setOnMessageHandler(cid, [](const Message&){}); });
+
+    atomic<ConnectionId> connA{-1};
+    sdkA.connect(2002, 5, nullptr, nullptr, nullptr, nullptr,
+        [&](ConnectionId cid) { connA = cid; }, nullptr);
+    auto deadline = steady_clock::now() + 5s;
+    while (connA.load() == -1 && steady_clock::now() < deadline) {
+        this_thread::sleep_for(50ms);
+    }
+    ASSERT_NE(connA.load(), -1);
+
+    atomic<int> delivered{0};
+    for (int i = 0; i < 10; ++i) {
+        sdkA.send(connA.load(), "paced_" + to_string(i), [&]() { delivered++; });
+    }
+    deadline = steady_clock::now() + 10s;
+    while (delivered.load() < 10 && steady_clock::now() < deadline) {
+        this_thread::sleep_for(20ms);
+    }
+    ASSERT_EQ(delivered.load(), 10);
+    // AIMD paces at window * fragment size / RTT once the RTT is known
+    EXPECT_GT(udpA->pacingRate(), 0.0);
+
+    sdkA.setCongestionControl(nullptr);
+    EXPECT_EQ(udpA->pacingRate(), 0.0);
+}
+
+TEST(PhysicalLayer, UdpPacerHoldsOnlyAcknowledgedData) {
+    auto layerA = make_unique<PhysicalLayerUdp>(47333, "127.0.0.1", 47334);
+    PhysicalLayerUdp* udpA = layerA.get();
+    ValidationConfig vc;
+    EminentSdk sdkA(std::move(layerA), vc);
+    EminentSdk sdkB(47334, "127.0.0.1", 47333);
+
+    mutex guard;
+    vector<string> received;
+    sdkA.initialize(1001, [](){}, [](const string&){},
+        [](DeviceId, const string&) { return true; });
+    sdkB.initialize(2002, [](){}, [](const string&){},
+        [](DeviceId, const string&) { return true; },
+        [&](ConnectionId cid, DeviceId) {
+            sdkB.setOnMessageHandler(cid, [&](const Message& msg) {
+                lock_guard<mutex> lock(guard);
+                received.push_back(msg.payload);
+            });
+        });
+    atomic<ConnectionId> connA{-1};
+    sdkA.connect(2002, 5, nullptr, nullptr, nullptr, nullptr,
+        [&](ConnectionId cid) { connA = cid; }, nullptr);
+    auto deadline = steady_clock::now() + 5s;
+    while (connA.load() == -1 && steady_clock::now() < deadline) {
+        this_thread::sleep_for(50ms);
+    }
+    ASSERT_NE(connA.load(), -1);
+
+    // Without congestion control the session leaves the rate alone; the
+    // first loopback-MTU fragment alone puts the pacer half a minute in debt
+    sdkA.setCongestionControl(nullptr);
+    udpA->setPacingRate(2000.0);
+    mt19937 rng(5);
+    vector<uint8_t> bulk(200000);
+    for (auto& b : bulk) {
+        b = static_cast<uint8_t>(rng());
+    }
+    atomic<bool> bulkDelivered{false};
+    sdkA.sendBinary(connA.load(), bulk, [&]() { bulkDelivered = true; });
+    this_thread::sleep_for(100ms);
+
+    // Unacknowledged traffic and the peer's ACKs pass the held fragments
+    sdkA.send(connA.load(), "urgent", MessageFormat::JSON, 5, false, nullptr);
+    auto gotUrgent = [&]() {
+        lock_guard<mutex> lock(guard);
+        return find(received.begin(), received.end(), "urgent") != received.end();
+    };
+    deadline = steady_clock::now() + 1s;
+    while (!gotUrgent() && steady_clock::now() < deadline) {
+        this_thread::sleep_for(10ms);
+    }
+    EXPECT_TRUE(gotUrgent());
+    EXPECT_FALSE(bulkDelivered.load());
+
+    udpA->setPacingRate(0.0);
+    deadline = steady_clock::now() + 5s;
+    while (!bulkDelivered.load() && steady_clock::now() < deadline) {
+        this_thread::sleep_for(20ms);
+    }
+    EXPECT_TRUE(bulkDelivered.load());
+}
+
+// ============================================================
+// Batched socket I/O
+// ============================================================
+
+TEST(PhysicalLayer, UdpBatchesDatagramsPerSyscall) {
+    auto layerA = make_unique<PhysicalLayerUdp>(47341, "127.0.0.1", 47342);
+    PhysicalLayerUdp* udpA = layerA.get();
+    EXPECT_THROW(udpA->setIoBatchSize(0), invalid_argument);
+    EXPECT_THROW(udpA->setIoBatchSize(PhysicalLayerUdp::MAX_IO_BATCH_SIZE + 1), invalid_argument);
+    udpA->setIoBatchSize(16);
+
+    ValidationConfig vc;
+    EminentSdk sdkA(std::move(layerA), vc);
+    EminentSdk sdkB(47342, "127.0.0.1", 47341);
+    // Buffers are sized for the batch at configuration
+    EXPECT_THROW(udpA->setIoBatchSize(8), runtime_error);
+
+    atomic<int> received{0};
+    sdkA.initialize(1001, [](){}, [](const string&){},
+        [](DeviceId, const string&) { return true; });
+    sdkB.initialize(2002, [](){}, [](const string&){},
+        [](DeviceId, const string&) { return true; },
+        [&](ConnectionId cid, DeviceId) {
+            sdkB.setOnMessageHandler(cid, [&](const Message&) { received++; });
+        });
+
+    atomic<ConnectionId> connA{-1};
+    sdkA.connect(2002, 5, nullptr, nullptr, nullptr, nullptr,
+        [&](ConnectionId cid) { connA = cid; }, nullptr);
+    auto deadline = steady_clock::now() + 5s;
+    while (connA.load() == -1 && steady_clock::now() < deadline) {
+        this_thread::sleep_for(50ms);
+    }
+    ASSERT_NE(connA.load(), -1);
+
+    const int messages = 200;
+    atomic<int> delivered{0};
+    for (int i = 0; i < messages; ++i) {
+        sdkA.send(connA.load(), "batched_" + to_string(i), [&]() { delivered++; });
+    }
+    deadline = steady_clock::now() + 10s;
+    while ((delivered.load() < messages || received.load() < messages) && steady_clock::now() < deadline) {
+        this_thread::sleep_for(20ms);
+    }
+    EXPECT_EQ(delivered.load(), messages);
+    EXPECT_EQ(received.load(), messages);
+
+    // Frames queued in the same tick leave together
+    PhysicalLayerUdp::IoStats stats = udpA->ioStats();
+    EXPECT_GE(stats.datagramsSent, static_cast<uint64_t>(messages));
+#ifdef UDP_HAVE_MMSG
+    EXPECT_GT(stats.datagramsSent, stats.sendCalls);
+#endif
+    EXPECT_GT(stats.datagramsReceived, 0u);
+}
+
+TEST(PhysicalLayer, UdpSegmentationOffloadCarriesFragmentRuns) {
+    auto layerA = make_unique<PhysicalLayerUdp>(47371, "127.0.0.1", 47372);
+    auto layerB = make_unique<PhysicalLayerUdp>(47372, "127.0.0.1", 47371);
+    PhysicalLayerUdp* udpA = layerA.get();
+    PhysicalLayerUdp* udpB = layerB.get();
+    // Loopback's 64 KB MTU would carry each message in one frame
+    udpA->setPathMtu(1500);
+    udpB->setPathMtu(1500);
+
+    ValidationConfig vc;
+    EminentSdk sdkA(std::move(layerA), vc);
+    EminentSdk sdkB(std::move(layerB), vc);
+    EXPECT_THROW(udpA->setSegmentationOffload(false), runtime_error);
+    if (!udpA->segmentationOffload() || !udpB->segmentationOffload()) {
+        GTEST_SKIP() << "UDP segmentation offload not available";
+    }
+
+    mutex guard;
+    vector<string> received;
+    sdkA.initialize(1001, [](){}, [](const string&){},
+        [](DeviceId, const string&) { return true; });
+    sdkB.initialize(2002, [](){}, [](const string&){},
+        [](DeviceId, const string&) { return true; },
+        [&](ConnectionId cid, DeviceId) {
+            sdkB.setOnMessageHandler(cid, [&](const Message& msg) {
+                lock_guard<mutex> lock(guard);
+                received.push_back(msg.payload);
+            });
+        });
+
+    atomic<ConnectionId> connA{-1};
+    sdkA.connect(2002, 5, nullptr, nullptr, nullptr, nullptr,
+        [&](ConnectionId cid) { connA = cid; }, nullptr);
+    auto deadline = steady_clock::now() + 5s;
+    while (connA.load() == -1 && steady_clock::now() < deadline) {
+        this_thread::sleep_for(50ms);
+    }
+    ASSERT_NE(connA.load(), -1);
+
+    // Incompressible payloads, so each message is a burst of equal fragments
+    const int messages = 4;
+    vector<string> payloads;
+    uint32_t seed = 12345;
+    for (int m = 0; m < messages; ++m) {
+        string payload(40000, '\0');
+        for (char& c : payload) {
+            seed = seed * 1103515245u + 12345u;
+            c = static_cast<char>('a' + (seed >> 16) % 26);
+        }
+        payloads.push_back(payload);
+    }
+    atomic<int> delivered{0};
+    for (const string& payload : payloads) {
+        sdkA.send(connA.load(), payload, MessageFormat::JSON, 5, true, [&]() { delivered++; });
+    }
+    deadline = steady_clock::now() + 10s;
+    while (delivered.load() < messages && steady_clock::now() < deadline) {
+        this_thread::sleep_for(20ms);
+    }
+    EXPECT_EQ(delivered.load(), messages);
+    {
+        lock_guard<mutex> lock(guard);
+        ASSERT_EQ(received.size(), static_cast<size_t>(messages));
+        for (const string& payload : payloads) {
+            EXPECT_NE(find(received.begin(), received.end(), payload), received.end());
+        }
+    }
+
+    // Loopback hands a GSO buffer to a GRO socket as it was sent
+    PhysicalLayerUdp::IoStats statsA = udpA->ioStats();
+    PhysicalLayerUdp::IoStats statsB = udpB->ioStats();
+    EXPECT_GT(statsA.segmentedSends, 0u);
+    EXPECT_GT(statsB.coalescedReceives, 0u);
+    EXPECT_GT(statsB.datagramsReceived, statsB.coalescedReceives);
+}
+
+TEST(PhysicalLayer, UdpMultiPeerLayerServesSeveralDevices) {
+    auto hubLayer = make_unique<PhysicalLayerUdp>(47381);
+    PhysicalLayerUdp* hubUdp = hubLayer.get();
+    EXPECT_TRUE(hubUdp->multiPeer());
+    EXPECT_THROW(hubUdp->addPeer(3003, "not-an-address", 47384), invalid_argument);
+    EXPECT_THROW(hubUdp->addPeer(3003, "127.0.0.1", 0), invalid_argument);
+    // Device 3003 is reached from the hub; 2001 and 2002 are learned
+    hubUdp->addPeer(3003, "127.0.0.1", 47384);
+    {
+        PhysicalLayerUdp pointToPoint(47385, "127.0.0.1", 47386);
+        EXPECT_FALSE(pointToPoint.multiPeer());
+        EXPECT_THROW(pointToPoint.addPeer(3003, "127.0.0.1", 47384), runtime_error);
+    }
+
+    ValidationConfig vc;
+    EminentSdk hub(std::move(hubLayer), vc);
+    EminentSdk deviceA(47382, "127.0.0.1", 47381);
+    EminentSdk deviceB(47383, "127.0.0.1", 47381);
+    EminentSdk deviceC(47384, "127.0.0.1", 47381);
+
+    mutex guard;
+    map<DeviceId, ConnectionId> hubConnections;
+    map<ConnectionId, vector<string>> hubReceived;
+    map<DeviceId, vector<string>> deviceReceived;
+    hub.initialize(1000, [](){}, [](const string&){},
+        [](DeviceId, const string&) { return true; },
+        [&](ConnectionId cid, DeviceId remoteId) {
+            lock_guard<mutex> lock(guard);
+            hubConnections[remoteId] = cid;
+            hub.setOnMessageHandler(cid, [&, cid](const Message& msg) {
+                lock_guard<mutex> lock(guard);
+                hubReceived[cid].push_back(msg.payload);
+            });
+        });
+    auto recordFor = [&](DeviceId id) {
+        return [&, id](const Message& msg) {
+            lock_guard<mutex> lock(guard);
+            deviceReceived[id].push_back(msg.payload);
+        };
+    };
+    deviceA.initialize(2001, [](){}, [](const string&){}, [](DeviceId, const string&) { return true; });
+    deviceB.initialize(2002, [](){}, [](const string&){}, [](DeviceId, const string&) { return true; });
+    deviceC.initialize(3003, [](){}, [](const string&){}, [](DeviceId, const string&) { return true; },
+        [&](ConnectionId cid, DeviceId) { deviceC.setOnMessageHandler(cid, recordFor(3003)); });
+
+    // The hub's own connection first: an initiator cannot steer the id the
+    // accepting side combines
+    atomic<ConnectionId> hubToC{-1};
+    hub.connect(3003, 5, nullptr, nullptr, nullptr, nullptr,
+        [&](ConnectionId cid) { hubToC = cid; }, nullptr);
+    auto deadline = steady_clock::now() + 5s;
+    while (hubToC.load() == -1 && steady_clock::now() < deadline) {
+        this_thread::sleep_for(20ms);
+    }
+    atomic<ConnectionId> connA{-1};
+    atomic<ConnectionId> connB{-1};
+    deviceA.connect(1000, 5, nullptr, nullptr, nullptr, nullptr,
+        [&](ConnectionId cid) { connA = cid; }, recordFor(2001));
+    deviceB.connect(1000, 5, nullptr, nullptr, nullptr, nullptr,
+        [&](ConnectionId cid) { connB = cid; }, recordFor(2002));
+    auto connected = [&]() {
+        lock_guard<mutex> lock(guard);
+        return connA.load() != -1 && connB.load() != -1 && hubToC.load() != -1 && hubConnections.size() == 2;
+    };
+    deadline = steady_clock::now() + 5s;
+    while (!connected() && steady_clock::now() < deadline) {
+        this_thread::sleep_for(50ms);
+    }
+    ASSERT_TRUE(connected());
+    EXPECT_TRUE(hubUdp->hasPeer(2001));
+    EXPECT_TRUE(hubUdp->hasPeer(2002));
+    EXPECT_EQ(hubUdp->peerCount(), 3u);
+
+    atomic<int> delivered{0};
+    deviceA.send(connA.load(), "from_2001", [&]() { delivered++; });
+    deviceB.send(connB.load(), "from_2002", [&]() { delivered++; });
+    {
+        lock_guard<mutex> lock(guard);
+        hub.send(hubConnections[2001], "to_2001", [&]() { delivered++; });
+        hub.send(hubConnections[2002], "to_2002", [&]() { delivered++; });
+    }
+    hub.send(hubToC.load(), "to_3003", [&]() { delivered++; });
+    deadline = steady_clock::now() + 5s;
+    while (delivered.load() < 5 && steady_clock::now() < deadline) {
+        this_thread::sleep_for(20ms);
+    }
+    EXPECT_EQ(delivered.load(), 5);
+
+    lock_guard<mutex> lock(guard);
+    EXPECT_EQ(hubReceived[hubConnections[2001]], vector<string>{"from_2001"});
+    EXPECT_EQ(hubReceived[hubConnections[2002]], vector<string>{"from_2002"});
+    EXPECT_EQ(deviceReceived[2001], vector<string>{"to_2001"});
+    EXPECT_EQ(deviceReceived[2002], vector<string>{"to_2002"});
+    EXPECT_EQ(deviceReceived[3003], vector<string>{"to_3003"});
+}
+
+#ifdef UDP_HAVE_REUSEPORT
+TEST(PhysicalLayer, UdpReceiveShardsKeepEachSourceOnOneSocket) {
+    auto layer = make_unique<PhysicalLayerUdp>(47391);
+    PhysicalLayerUdp* udp = layer.get();
+    EXPECT_THROW(udp->setReceiveShards(0), invalid_argument);
+    EXPECT_THROW(udp->setReceiveShards(PhysicalLayerUdp::MAX_RECEIVE_SHARDS + 1), invalid_argument);
+    udp->setReceiveShards(4);
+    ValidationConfig vc;
+    EminentSdk sdk(std::move(layer), vc);
+    EXPECT_THROW(udp->setReceiveShards(2), runtime_error);
+    ASSERT_EQ(udp->shardDatagramsReceived().size(), 4u);
+
+    sockaddr_in target{};
+    target.sin_family = AF_INET;
+    target.sin_port = htons(47391);
+    inet_pton(AF_INET, "127.0.0.1", &target.sin_addr);
+    auto waitForCount = [&](uint64_t count) {
+        auto deadline = steady_clock::now() + 2s;
+        while (udp->ioStats().datagramsReceived < count && steady_clock::now() < deadline) {
+            this_thread::sleep_for(1ms);
+        }
+        return udp->ioStats().datagramsReceived >= count;
+    };
+
+    // Junk datagrams from 16 source ports, one source at a time: all of a
+    // source's datagrams land on one shard, and the sources spread out
+    uint8_t junk[16] = {};
+    vector<int> sourcesPerShard(4, 0);
+    uint64_t expected = 0;
+    for (int source = 0; source < 16; ++source) {
+        int sender = socket(AF_INET, SOCK_DGRAM, 0);
+        ASSERT_GE(sender, 0);
+        vector<uint64_t> before = udp->shardDatagramsReceived();
+        for (int i = 0; i < 8; ++i) {
+            ASSERT_EQ(sendto(sender, junk, sizeof(junk), 0, reinterpret_cast<sockaddr*>(&target), sizeof(target)),
+                      static_cast<ssize_t>(sizeof(junk)));
+        }
+        expected += 8;
+        ASSERT_TRUE(waitForCount(expected));
+        ::close(sender);
+        vector<uint64_t> after = udp->shardDatagramsReceived();
+        int shardsHit = 0;
+        for (size_t shard = 0; shard < after.size(); ++shard) {
+            if (after[shard] != before[shard]) {
+                EXPECT_EQ(after[shard] - before[shard], 8u);
+                ++shardsHit;
+                ++sourcesPerShard[shard];
+            }
+        }
+        EXPECT_EQ(shardsHit, 1);
+    }
+    EXPECT_GT(count_if(sourcesPerShard.begin(), sourcesPerShard.end(), [](int n) { return n > 0; }), 1);
+}
+#endif
+
+TEST(PhysicalLayer, UdpMulticastGroupReachesEverySubscriber) {
+    EXPECT_THROW(PhysicalLayerUdpMulticast("127.0.0.1", 47511), invalid_argument);
+    MulticastConfig loopback;
+    loopback.interfaceAddress = "127.0.0.1";
+    vector<unique_ptr<PhysicalLayerUdpMulticast>> layers;
+    try {
+        for (int i = 0; i < 3; ++i) {
+            layers.push_back(make_unique<PhysicalLayerUdpMulticast>("239.255.42.1", 47511, loopback));
+        }
+    } catch (const runtime_error& ex) {
+        GTEST_SKIP() << "Multicast unavailable: " << ex.what();
+    }
+    layers[0]->setReceiveShards(2);
+
+    ValidationConfig vc;
+    vector<unique_ptr<EminentSdk>> members;
+    EXPECT_THROW(EminentSdk(std::move(layers[0]), vc), runtime_error);
+    for (int i = 0; i < 3; ++i) {
+        auto layer = i == 0 ? make_unique<PhysicalLayerUdpMulticast>("239.255.42.1", 47511, loopback)
+                            : std::move(layers[i]);
+        members.push_back(make_unique<EminentSdk>(std::move(layer), vc));
+        members[i]->initialize(4001 + i, [](){}, [](const string&){}, [](DeviceId, const string&) { return true; });
+    }
+    EXPECT_THROW(members[0]->publish(500, "before join"), runtime_error);
+
+    mutex guard;
+    map<int, vector<string>> received;
+    for (int i = 0; i < 3; ++i) {
+        members[i]->joinGroup(500, [&, i](DeviceId publisher, const string& payload) {
+            lock_guard<mutex> lock(guard);
+            EXPECT_EQ(publisher, 4001);
+            received[i].push_back(payload);
+        });
+    }
+    EXPECT_THROW(members[1]->joinGroup(500, nullptr), runtime_error);
+
+    const int messages = 20;
+    vector<string> expected;
+    for (int i = 0; i < messages; ++i) {
+        expected.push_back("tick-" + to_string(i));
+        members[0]->publish(500, expected.back());
+    }
+    EXPECT_THROW(members[0]->publish(500, string(64 * 1024, 'x')), runtime_error);
+    auto delivered = [&]() {
+        lock_guard<mutex> lock(guard);
+        return received[1].size() == expected.size() && received[2].size() == expected.size();
+    };
+    auto deadline = steady_clock::now() + 5s;
+    while (!delivered() && steady_clock::now() < deadline) {
+        this_thread::sleep_for(20ms);
+    }
+
+    lock_guard<mutex> lock(guard);
+    EXPECT_EQ(received[1], expected);
+    EXPECT_EQ(received[2], expected);
+    // The publisher does not hear itself
+    EXPECT_TRUE(received[0].empty());
+    EXPECT_EQ(members[0]->getGroupStats(500).published, static_cast<uint64_t>(messages));
+    EXPECT_EQ(members[1]->getGroupStats(500).delivered, static_cast<uint64_t>(messages));
+}
+
+#ifdef UDP_HAVE_EPOLL
+TEST(PhysicalLayer, UdpWorkerWakesOnDatagram) {
+    auto layer = make_unique<PhysicalLayerUdp>(47351, "127.0.0.1", 47352);
+    PhysicalLayerUdp* udp = layer.get();
+    ValidationConfig vc;
+    EminentSdk sdk(std::move(layer), vc);
+
+    // No connections, no traffic: after its first pass the worker stays blocked
+    this_thread::sleep_for(50ms);
+    uint64_t idleCalls = udp->ioStats().receiveCalls;
+    this_thread::sleep_for(200ms);
+    EXPECT_EQ(udp->ioStats().receiveCalls, idleCalls);
+
+    int sender = socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE(sender, 0);
+    sockaddr_in target{};
+    target.sin_family = AF_INET;
+    target.sin_port = htons(47351);
+    inet_pton(AF_INET, "127.0.0.1", &target.sin_addr);
+
+    // Junk datagrams are read (and dropped) as soon as they arrive, not on
+    // the next poll interval
+    vector<double> latenciesMs;
+    uint8_t junk[16] = {};
+    for (int i = 0; i < 20; ++i) {
+        uint64_t before = udp->ioStats().datagramsReceived;
+        auto sentAt = steady_clock::now();
+        ASSERT_EQ(sendto(sender, junk, sizeof(junk), 0, reinterpret_cast<sockaddr*>(&target), sizeof(target)),
+                  static_cast<ssize_t>(sizeof(junk)));
+        while (udp->ioStats().datagramsReceived == before && steady_clock::now() - sentAt < 1s) {
+            this_thread::yield();
+        }
+        latenciesMs.push_back(duration<double, milli>(steady_clock::now() - sentAt).count());
+        this_thread::sleep_for(3ms);
+    }
+    ::close(sender);
+    sort(latenciesMs.begin(), latenciesMs.end());
+    EXPECT_LT(latenciesMs[latenciesMs.size() / 2], 2.0);
+}
+#endif
+
+// ============================================================
+// io_uring backend
+// ============================================================
+
+TEST(PhysicalLayer, IoUringLayerExchangesMessages) {
+    IoUringConfig zeroCopy;
+    zeroCopy.registeredBuffers = true;
+    auto layerA = makeUdpPhysicalLayer(47361, "127.0.0.1", 47362, zeroCopy);
+    auto layerB = makeUdpPhysicalLayer(47362, "127.0.0.1", 47361);
+#ifdef UDP_HAVE_IO_URING
+    if (!dynamic_cast<PhysicalLayerIoUring*>(layerA.get()) || !dynamic_cast<PhysicalLayerIoUring*>(layerB.get())) {
+        GTEST_SKIP() << "io_uring not available, sockets used instead";
+    }
+#else
+    GTEST_SKIP() << "io_uring not available on this platform";
+#endif
+    PhysicalLayerUdp* udpA = layerA.get();
+    PhysicalLayerUdp* udpB = layerB.get();
+
+    ValidationConfig vc;
+    EminentSdk sdkA(std::move(layerA), vc);
+    EminentSdk sdkB(std::move(layerB), vc);
+
+    mutex guard;
+    vector<string> received;
+    sdkA.initialize(1001, [](){}, [](const string&){},
+        [](DeviceId, const string&) { return true; });
+    sdkB.initialize(2002, [](){}, [](const string&){},
+        [](DeviceId, const string&) { return true; },
+        [&](ConnectionId cid, DeviceId) {
+            sdkB.setOnMessageHandler(cid, [&](const Message& msg) {
+                lock_guard<mutex> lock(guard);
+                received.push_back(msg.payload);
+            });
+        });
+
+    atomic<ConnectionId> connA{-1};
+    sdkA.connect(2002, 5, nullptr, nullptr, nullptr, nullptr,
+        [&](ConnectionId cid) { connA = cid; }, nullptr);
+    auto deadline = steady_clock::now() + 5s;
+    while (connA.load() == -1 && steady_clock::now() < deadline) {
+        this_thread::sleep_for(50ms);
+    }
+    ASSERT_NE(connA.load(), -1);
+
+    // Small messages and one that fragments into many datagrams
+    const int messages = 100;
+    string large(30000, 'U');
+    atomic<int> delivered{0};
+    for (int i = 0; i < messages; ++i) {
+        sdkA.send(connA.load(), "uring_" + to_string(i), [&]() { delivered++; });
+    }
+    sdkA.send(connA.load(), large, MessageFormat::JSON, 5, true, [&]() { delivered++; });
+    deadline = steady_clock::now() + 10s;
+    while (delivered.load() < messages + 1 && steady_clock::now() < deadline) {
+        this_thread::sleep_for(20ms);
+    }
+    EXPECT_EQ(delivered.load(), messages + 1);
+    {
+        lock_guard<mutex> lock(guard);
+        EXPECT_EQ(received.size(), static_cast<size_t>(messages + 1));
+        EXPECT_NE(find(received.begin(), received.end(), large), received.end());
+    }
+    EXPECT_GT(udpA->ioStats().datagramsSent, static_cast<uint64_t>(messages));
+    EXPECT_GT(udpB->ioStats().datagramsReceived, static_cast<uint64_t>(messages));
+}
+
+// ============================================================
+// Shared memory rings
+// ============================================================
+
+#ifdef SHM_HAVE_RING
+static SharedMemoryConfig testSharedMemoryConfig() {
+    SharedMemoryConfig config;
+    config.namePrefix = "/eminent-test";
+    // Four frames of the largest size: long messages wrap the ring often
+    config.ringBytes = 4 * PhysicalLayerSharedMemory::MIN_RING_BYTES;
+    return config;
+}
+
+TEST(PhysicalLayer, SharedMemoryRingsCarryMessagesBothWays) {
+    SharedMemoryConfig config = testSharedMemoryConfig();
+    EXPECT_THROW(PhysicalLayerSharedMemory(5001, 5001, config), invalid_argument);
+    SharedMemoryConfig odd = config;
+    odd.ringBytes = 100000;
+    EXPECT_THROW(PhysicalLayerSharedMemory(5001, 5002, odd), invalid_argument);
+
+    auto layerA = make_unique<PhysicalLayerSharedMemory>(5001, 5002, config);
+    EXPECT_FALSE(layerA->peerAttached());
+    // A device attaches once, and both sides must agree on the ring size
+    EXPECT_THROW(PhysicalLayerSharedMemory(5001, 5002, config), runtime_error);
+    SharedMemoryConfig larger = config;
+    larger.ringBytes *= 2;
+    EXPECT_THROW(PhysicalLayerSharedMemory(5002, 5001, larger), runtime_error);
+    auto layerB = make_unique<PhysicalLayerSharedMemory>(5002, 5001, config);
+    EXPECT_TRUE(layerA->peerAttached());
+    EXPECT_EQ(layerA->segmentName(), "/eminent-test-5001-5002");
+    PhysicalLayerSharedMemory* shmA = layerA.get();
+    PhysicalLayerSharedMemory* shmB = layerB.get();
+
+    {
+        ValidationConfig vc;
+        EminentSdk sdkA(std::move(layerA), vc);
+        EminentSdk sdkB(std::move(layerB), vc);
+        mutex guard;
+        vector<string> receivedA;
+        vector<string> receivedB;
+        atomic<ConnectionId> connB{-1};
+        sdkA.initialize(5001, [](){}, [](const string&){}, [](DeviceId, const string&) { return true; });
+        sdkB.initialize(5002, [](){}, [](const string&){}, [](DeviceId, const string&) { return true; },
+            [&](ConnectionId cid, DeviceId) {
+                sdkB.setOnMessageHandler(cid, [&](const Message& msg) {
+                    lock_guard<mutex> lock(guard);
+                    receivedB.push_back(msg.payload);
+                });
+                connB = cid;
+            });
+        atomic<ConnectionId> connA{-1};
+        sdkA.connect(5002, 5, nullptr, nullptr, nullptr, nullptr,
+            [&](ConnectionId cid) { connA = cid; },
+            [&](const Message& msg) {
+                lock_guard<mutex> lock(guard);
+                receivedA.push_back(msg.payload);
+            });
+        auto deadline = steady_clock::now() + 5s;
+        while ((connA.load() == -1 || connB.load() == -1) && steady_clock::now() < deadline) {
+            this_thread::sleep_for(20ms);
+        }
+        ASSERT_NE(connA.load(), -1);
+        ASSERT_NE(connB.load(), -1);
+
+        // Messages of many full-size fragments fill and wrap the rings
+        vector<string> expected;
+        atomic<int> delivered{0};
+        for (int i = 0; i < 30; ++i) {
+            expected.push_back(i % 10 == 0 ? string(150000, static_cast<char>('a' + i / 10)) : "shm_" + to_string(i));
+            sdkA.send(connA.load(), expected.back(), MessageFormat::JSON, 1, true, [&]() { delivered++; });
+            sdkB.send(connB.load(), expected.back(), MessageFormat::JSON, 1, true, [&]() { delivered++; });
+        }
+        deadline = steady_clock::now() + 10s;
+        while (delivered.load() < 60 && steady_clock::now() < deadline) {
+            this_thread::sleep_for(20ms);
+        }
+        EXPECT_EQ(delivered.load(), 60);
+        lock_guard<mutex> lock(guard);
+        EXPECT_EQ(receivedA.size(), expected.size());
+        EXPECT_EQ(receivedB.size(), expected.size());
+        for (const string& payload : {expected[0], expected[10], expected[20], expected[29]}) {
+            EXPECT_NE(find(receivedA.begin(), receivedA.end(), payload), receivedA.end());
+            EXPECT_NE(find(receivedB.begin(), receivedB.end(), payload), receivedB.end());
+        }
+        EXPECT_GT(shmA->stats().framesSent, 30u);
+        EXPECT_GT(shmB->stats().framesReceived, 30u);
+    }
+
+    // The last side to detach removes the segment
+    int fd = shm_open("/eminent-test-5001-5002", O_RDWR, 0);
+    EXPECT_LT(fd, 0);
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+TEST(PhysicalLayer, SharedMemoryLinksTwoProcesses) {
+    SharedMemoryConfig config = testSharedMemoryConfig();
+    const int messages = 40;
+    ValidationConfig vc;
+
+    // The child echoes every message back and reports through its exit
+    // status; both race to create the segment
+    pid_t child = fork();
+    ASSERT_GE(child, 0);
+    if (child == 0) {
+        alarm(20);
+        int status = 1;
+        {
+            EminentSdk echo(make_unique<PhysicalLayerSharedMemory>(6002, 6001, config), vc, LogLevel::NONE);
+            atomic<int> echoed{0};
+            echo.initialize(6002, [](){}, [](const string&){}, [](DeviceId, const string&) { return true; },
+                [&](ConnectionId cid, DeviceId) {
+                    echo.setOnMessageHandler(cid, [&echo, &echoed, cid](const Message& msg) {
+                        echo.send(cid, "echo:" + msg.payload, [&echoed]() { echoed++; });
+                    });
+                });
+            auto deadline = steady_clock::now() + 15s;
+            while (echoed.load() < messages && steady_clock::now() < deadline) {
+                this_thread::sleep_for(10ms);
+            }
+            status = echoed.load() == messages ? 0 : 1;
+        }
+        _exit(status);
+    }
+
+    {
+        mutex guard;
+        vector<string> echoes;
+        EminentSdk sdk(make_unique<PhysicalLayerSharedMemory>(6001, 6002, config), vc);
+        sdk.initialize(6001, [](){}, [](const string&){}, [](DeviceId, const string&) { return true; });
+        atomic<ConnectionId> conn{-1};
+        sdk.connect(6002, 5, nullptr, nullptr, nullptr, nullptr,
+            [&](ConnectionId cid) { conn = cid; },
+            [&](const Message& msg) {
+                lock_guard<mutex> lock(guard);
+                echoes.push_back(msg.payload);
+            });
+        auto deadline = steady_clock::now() + 10s;
+        while (conn.load() == -1 && steady_clock::now() < deadline) {
+            this_thread::sleep_for(20ms);
+        }
+        EXPECT_NE(conn.load(), -1);
+        if (conn.load() != -1) {
+            for (int i = 0; i < messages; ++i) {
+                sdk.send(conn.load(), i == 0 ? string(100000, 'p') : "ping_" + to_string(i), nullptr);
+            }
+        }
+        auto echoed = [&]() {
+            lock_guard<mutex> lock(guard);
+            return echoes.size() == static_cast<size_t>(messages);
+        };
+        deadline = steady_clock::now() + 10s;
+        while (!echoed() && steady_clock::now() < deadline) {
+            this_thread::sleep_for(20ms);
+        }
+        lock_guard<mutex> lock(guard);
+        EXPECT_EQ(echoes.size(), static_cast<size_t>(messages));
+        EXPECT_NE(find(echoes.begin(), echoes.end(), "echo:" + string(100000, 'p')), echoes.end());
+        EXPECT_NE(find(echoes.begin(), echoes.end(), "echo:ping_39"), echoes.end());
+    }
+
+    int status = 0;
+    ASSERT_EQ(waitpid(child, &status, 0), child);
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+}
+#endif
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+using namespace std;
+
+// ============================================================
+// ControlMessageCodec — fixed-layout binary encoding of the SDK
+// control plane (HANDSHAKE, HEARTBEAT, HEARTBEAT_ACK, DISCONNECT).
+//
+// Every binary payload starts with VERSION_TAG. A legacy JSON control
+// payload always starts with '{', so receivers dispatch on the first
+// byte and keep understanding older peers.
+//
+// Layout (integers are big-endian):
+//   [tag:1][kind:1][deviceId:4][body]
+//   HANDSHAKE_REQUEST / HANDSHAKE_FINAL  body = [specialCode:4][capabilities:4]
+//   HANDSHAKE_RESPONSE                   body = [specialCode:4][capabilities:4][newId:4]
+//   HEARTBEAT / HEARTBEAT_ACK            body = [timestampMs:8]
+//   DISCONNECT                           body = [connId:4]
+//
+// Heartbeats are 14 bytes and fit in the small-string buffer of
+// std::string, so encoding them does not touch the heap.
+// ============================================================
+class ControlMessageCodec {
+public:
+    static constexpr uint8_t VERSION_TAG = 0xC1;
+    static constexpr size_t PREFIX_BYTES = 6;
+    static constexpr size_t HEARTBEAT_BYTES = PREFIX_BYTES + 8;
+    static constexpr size_t MAX_ENCODED_BYTES = PREFIX_BYTES + 12;
+
+    enum class Kind : uint8_t {
+        HANDSHAKE_REQUEST = 1,
+        HANDSHAKE_RESPONSE = 2,
+        HANDSHAKE_FINAL = 3,
+        HEARTBEAT = 4,
+        HEARTBEAT_ACK = 5,
+        DISCONNECT = 6
+    };
+
+    struct ControlMessage {
+        Kind kind = Kind::HEARTBEAT;
+        int deviceId = 0;
+        int specialCode = 0;
+        uint32_t capabilities = 0;
+        int newId = 0;
+        int connId = 0;
+        int64_t timestampMs = 0;
+    };
+
+    static bool isBinary(const string& payload) {
+        return !payload.empty() && static_cast<uint8_t>(payload[0]) == VERSION_TAG;
+    }
+
+    static string encode(const ControlMessage& message);
+    static optional<ControlMessage> decode(const string& payload);
+
+    static string encodeHeartbeat(Kind kind, int deviceId, int64_t timestampMs);
+
+private:
+    static size_t bodyBytes(Kind kind);
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+// ============================================================
+// DeltaChannel — per (connection, format) state of the opt-in delta mode
+// (EminentSdk::setDeltaEncoding).
+//
+// The sender diffs each payload against the newest payload the peer has
+// acknowledged. A full snapshot is sent every SNAPSHOT_INTERVAL messages,
+// when no base has been acknowledged for MAX_BASE_AGE messages (loss or no
+// ACKs), or when the diff would not be smaller.
+//
+// An ACK only means the packages arrived, not that the base was decoded: it
+// can still sit in a reorder buffer, have been dropped, or have left the
+// receiver's history. A receiver missing a base answers with a RESYNC
+// record; the sender then drops its base and re-sends its latest payload as
+// a snapshot unless one newer than the failed diff is already on the way.
+//
+// Record layout (big-endian), carried as the message payload:
+//   SNAPSHOT  [kind:1][sequence:4][payload...]
+//   DIFF      [kind:1][sequence:4][baseSequence:4][DeltaCodec delta...]
+//   RESYNC    [kind:1][failedSequence:4]             (receiver -> sender)
+// ============================================================
+class DeltaSender {
+public:
+    static constexpr uint8_t KIND_SNAPSHOT = 0;
+    static constexpr uint8_t KIND_DIFF = 1;
+    static constexpr uint8_t KIND_RESYNC = 2;
+    static constexpr size_t SNAPSHOT_HEADER_BYTES = 5;
+    static constexpr size_t DIFF_HEADER_BYTES = 9;
+    static constexpr int SNAPSHOT_INTERVAL = 64;
+    static constexpr uint32_t MAX_BASE_AGE = 8;
+
+    // Returns the record for `payload`. With trackAck the payload is kept
+    // until onAcked(sequence) promotes it to the diff base.
+    string encode(const string& payload, bool trackAck, uint32_t& sequence);
+    void onAcked(uint32_t sequence);
+    // Handles a RESYNC for `failedSequence`: the next record is a snapshot.
+    // Returns true with the latest payload when that snapshot has to be
+    // sent now because none newer than the failed diff has gone out.
+    bool resync(uint32_t failedSequence, string& latest);
+
+private:
+    mutex guard_;
+    uint32_t nextSequence_ = 1;
+    uint32_t lastSnapshotSequence_ = 0;
+    int sinceSnapshot_ = 0;
+    bool hasBase_ = false;
+    uint32_t baseSequence_ = 0;
+    string base_;
+    string latest_;
+    map<uint32_t, string> awaitingAck_;
+};
+
+class DeltaReceiver {
+public:
+    // Comfortably above DeltaSender::MAX_BASE_AGE, so an acknowledged base
+    // is still known when the diffs against it arrive.
+    static constexpr size_t HISTORY_SIZE = 16;
+
+    // Returns false if the record is malformed or its base is unknown.
+    bool decode(const string& record, string& payload, size_t maxPayloadBytes);
+    // After decode() failed on an unknown base: the RESYNC record to send
+    // back. Only the first diff of a gap asks; the next snapshot closes it.
+    bool takeResyncRequest(string& record);
+
+    static bool isResync(const string& record);
+    static uint32_t resyncSequence(const string& record);
+
+private:
+    deque<pair<uint32_t, string>> history_;
+    bool resyncRequested_ = false;
+    bool resyncPending_ = false;
+    uint32_t resyncSequence_ = 0;
+};
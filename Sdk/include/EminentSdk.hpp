@@ -3,6 +3,7 @@
 #include <atomic>
 #include <chrono>
 #include <functional>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <optional>
@@ -19,6 +20,11 @@
 #include "TransportLayer.hpp"
 #include "CodingModule.hpp"
 #include "ICryptoModule.hpp"
+#include "ICompressionCodec.hpp"
+#include "ControlMessageCodec.hpp"
+#include "StreamWriter.hpp"
+#include "DeltaChannel.hpp"
+#include "GroupFeed.hpp"
 
 #define EMINENT_SDK_VERSION_MAJOR 1
 #define EMINENT_SDK_VERSION_MINOR 0
@@ -65,13 +71,17 @@ public:
     void close(ConnectionId id); // legacy alias for disconnect
 
     // --- Send text data ---
+    // onFailed runs, on the session thread, instead of onDelivered when the
+    // message is given up: retransmits exhausted, the link refused it or the
+    // connection was disconnected first. Its argument says why.
     void send(
         ConnectionId id,
         const string& payload,
         MessageFormat format,
         Priority priority,
         bool requireAck,
-        function<void()> onDelivered
+        function<void()> onDelivered,
+        function<void(const string& reason)> onFailed = nullptr
     );
 
     // Simplified send (uses connection default priority, requireAck=true)
@@ -93,9 +103,146 @@ public:
         const vector<uint8_t>& data,
         Priority priority,
         bool requireAck,
-        function<void()> onDelivered
+        function<void()> onDelivered,
+        function<void(const string& reason)> onFailed = nullptr
     );
 
+    // --- Send with a deadline ---
+    // For data that is worthless when late (telemetry, motor commands). Once
+    // `ttl` has passed since the call the message is no longer sent or
+    // retransmitted, onExpired runs instead of onDelivered, and the peer
+    // discards fragments it could not complete in time. Zero ttl = no deadline.
+    // Expiries are counted in ConnectionStats.
+    void send(
+        ConnectionId id,
+        const string& payload,
+        MessageFormat format,
+        Priority priority,
+        bool requireAck,
+        chrono::milliseconds ttl,
+        function<void()> onDelivered,
+        function<void()> onExpired = nullptr,
+        function<void(const string& reason)> onFailed = nullptr
+    );
+
+    void sendBinary(
+        ConnectionId id,
+        const vector<uint8_t>& data,
+        Priority priority,
+        bool requireAck,
+        chrono::milliseconds ttl,
+        function<void()> onDelivered,
+        function<void()> onExpired = nullptr,
+        function<void(const string& reason)> onFailed = nullptr
+    );
+
+    // --- Conflating sends ---
+    // Latest value wins per (connection, key), for state feeds where only the
+    // newest value matters. A message replaces the previous one sent under the
+    // same key while that one is still queued, waiting for the window or, if
+    // it fits one fragment, unacknowledged; the replaced message is never
+    // (re)sent and gets onFailed("superseded by message <id>") instead of
+    // onDelivered. However fast the producer writes, at most one message per
+    // key waits for the link.
+    // Replacements are counted in ConnectionStats.
+    void sendLatest(
+        ConnectionId id,
+        const string& key,
+        const string& payload,
+        function<void()> onDelivered = nullptr
+    );
+
+    void sendLatest(
+        ConnectionId id,
+        const string& key,
+        const string& payload,
+        MessageFormat format,
+        Priority priority,
+        bool requireAck,
+        function<void()> onDelivered,
+        function<void(const string& reason)> onFailed = nullptr
+    );
+
+    // --- Delivery order ---
+    // UNORDERED (default) hands each message up as soon as it is complete.
+    // ORDERED needs CAPABILITY_ORDERED on both peers; send(), sendBinary()
+    // and sendLatest() messages then arrive in send order (ordered stream 0).
+    // A message the sender gives up on (expired, failed, conflated) is
+    // skipped once the peer learns of it; unacknowledged ones are only
+    // sequenced, and dropped when they arrive after a later message.
+    void setDeliveryMode(ConnectionId id, DeliveryMode mode);
+
+    // Acknowledged send on one of 256 independent ordered streams, whatever
+    // the connection's delivery mode: a message held back on one stream does
+    // not delay the others (e.g. bulk data on 1, control on 0).
+    void sendOrdered(
+        ConnectionId id,
+        uint8_t stream,
+        const string& payload,
+        MessageFormat format,
+        Priority priority,
+        function<void()> onDelivered = nullptr,
+        function<void(const string& reason)> onFailed = nullptr
+    );
+
+    // --- Delta encoding ---
+    // Opt-in per connection; the peer must have negotiated CAPABILITY_DELTA.
+    // send()/sendBinary() payloads then travel as diffs against the last
+    // payload the peer acknowledged and are rebuilt before onMessage. Meant
+    // for state-sync feeds sent with requireAck (see DeltaChannel.hpp).
+    void setDeltaEncoding(ConnectionId id, bool enabled);
+
+    // --- Forward error correction ---
+    // Opt-in per connection; the peer must have negotiated CAPABILITY_FEC.
+    // Outgoing frames are grouped by config.dataFrames and followed by parity
+    // frames (XOR: one, REED_SOLOMON: config.parityFrames), so the peer
+    // rebuilds up to that many lost frames per group without a retransmit.
+    // While any connection uses FEC fragments shrink by the FEC overhead.
+    void setForwardErrorCorrection(ConnectionId id, const FecConfig& config);
+
+    // --- Streams ---
+    // Opens an outbound byte stream for payloads that do not fit in memory.
+    // The peer must have negotiated CAPABILITY_STREAMS; it receives the data
+    // in order through setOnStreamChunk().
+    unique_ptr<StreamWriter> openStream(
+        ConnectionId id,
+        size_t windowChunks = StreamWriter::DEFAULT_WINDOW_CHUNKS
+    );
+    void setOnStreamChunk(ConnectionId id, function<void(StreamId, const string& data, bool finished)> handler);
+
+    // --- Telemetry ---
+    // Numeric samples of one channel (0-65535) are sent with ACK as
+    // Gorilla-style batches (TimeSeriesCodec) of at most
+    // MAX_SAMPLES_PER_BATCH samples; onDelivered fires once all batches are
+    // acknowledged. The peer must have negotiated CAPABILITY_TELEMETRY and
+    // receives the batches through setOnSamples().
+    static constexpr size_t MAX_SAMPLES_PER_BATCH = 1024;
+    void sendSamples(
+        ConnectionId id,
+        ChannelId channel,
+        const vector<int64_t>& timestamps,
+        const vector<double>& values,
+        function<void()> onDelivered = nullptr
+    );
+    void setOnSamples(ConnectionId id,
+                      function<void(ChannelId, const vector<int64_t>& timestamps, const vector<double>& values)> handler);
+
+    // --- Multicast groups ---
+    // One-to-many feed over a multicast link (PhysicalLayerUdpMulticast).
+    // Every member joins the same group id, agreed out of band; there is no
+    // handshake and no per-subscriber state, so publish() costs one
+    // encryption and one datagram whatever the number of subscribers. Each
+    // publisher's messages reach onMessage in publish order. Subscribers
+    // NACK gaps (see setNackInterval()) and the publisher resends from its
+    // last GroupPublisher::HISTORY_SIZE messages; a gap still open after
+    // GroupSubscriber::MAX_NACK_ATTEMPTS NACKs is skipped. A published
+    // message must fit one fragment. The group id must not be in use by a
+    // connection; throws runtime_error otherwise or before initialize().
+    void joinGroup(ConnectionId groupId, function<void(DeviceId publisher, const string& payload)> onMessage);
+    void leaveGroup(ConnectionId groupId);
+    void publish(ConnectionId groupId, const string& payload, Priority priority = 0);
+    GroupStats getGroupStats(ConnectionId groupId) const;
+
     // --- Connection management ---
     void setOnMessageHandler(ConnectionId id, function<void(const Message&)> handler);
     void setOnDisconnected(ConnectionId id, function<void()> handler);
@@ -104,9 +251,47 @@ public:
     vector<DeviceId> getConnectedDeviceIds() const;
 
     // --- Retransmission configuration ---
+    // `interval` is the timeout until a connection has measured its RTT;
+    // afterwards each connection derives its own timeout from the smoothed
+    // RTT, kept within the bounds below and doubled per retransmit.
     void setRetransmissionConfig(int maxAttempts, chrono::milliseconds interval);
     int getMaxRetransmitAttempts() const;
     chrono::milliseconds getRetransmitInterval() const;
+    void setRetransmitTimeoutBounds(chrono::milliseconds minTimeout, chrono::milliseconds maxTimeout);
+    // Receivers NACK fragment gaps of acknowledged messages so the sender
+    // resends them after about one RTT; zero stops this side sending NACKs.
+    void setNackInterval(chrono::milliseconds interval);
+    // Incomplete inbound messages hold at most `maxBytes` in total (further
+    // fragments wait for a retransmit); one without a deadline is discarded
+    // after `idleTimeout` without a new fragment.
+    void setReassemblyLimits(size_t maxBytes, chrono::milliseconds idleTimeout);
+
+    // --- Path MTU ---
+    // Fragments are sized to fit one link-layer packet. UDP discovers the
+    // path MTU on its own; setPathMtu() pins it (e.g. for tunnels).
+    void setPathMtu(size_t mtu);
+    size_t getMaxFragmentPayload() const;
+
+    // --- Large messages ---
+    // Messages above ValidationConfig::maxStandardMessageBytes() need a peer
+    // that negotiated CAPABILITY_LARGE_MESSAGES. The sender buffers at most
+    // `packages` fragments of such a message at a time.
+    void setLargeMessageWindow(size_t packages);
+
+    // --- Flow control ---
+    // At most `packages` acknowledged fragments per connection are on the
+    // wire unacknowledged; new fragments are released as ACKs arrive. The
+    // receive window is advertised in every ACK and caps the peer's flow
+    // window, so a slow receiver can throttle its senders.
+    void setFlowWindow(size_t packages);
+    void setReceiveWindow(size_t packages);
+
+    // --- Congestion control ---
+    // One controller per connection caps its unacknowledged packages and sets
+    // the pacing rate of the link (UDP spreads frames with a token bucket).
+    // Default makeAimdController; makeDelayBasedController keeps queues short
+    // on links with deep buffers; nullptr disables congestion control.
+    void setCongestionControl(CongestionControllerFactory factory);
 
     // --- Encryption ---
     void setCryptoModule(shared_ptr<ICryptoModule> cryptoModule);
@@ -117,6 +302,17 @@ public:
     void enableEncryption(bool enabled);
     bool isEncryptionEnabled() const;
 
+    // --- Compression ---
+    // send()/sendBinary() payloads of at least `threshold` bytes are
+    // compressed before encryption on connections that negotiated
+    // CAPABILITY_COMPRESSION; results that do not shrink are sent as-is.
+    // A custom codec must be used by both peers.
+    static constexpr size_t DEFAULT_COMPRESSION_THRESHOLD_BYTES = 128;
+    void setCompressionCodec(shared_ptr<ICompressionCodec> codec);
+    void setCompressionThreshold(size_t bytes);
+    void enableCompression(bool enabled);
+    bool isCompressionEnabled() const;
+
     // --- Error callback (transport-level issues) ---
     void setOnTransportError(function<void(const string&)> handler);
 
@@ -149,7 +345,7 @@ private:
     function<void(ConnectionId, DeviceId)> onConnectionEstablished_;
     function<void(const string&)> onTransportError_;
     unordered_map<int, Connection> connections_;
-    queue<Message> outgoingQueue_;
+    ThreadSafeQueue<Message> outgoingQueue_;
 
     // --- Handshake timeout ---
     struct PendingHandshake {
@@ -159,6 +355,13 @@ private:
     };
     vector<PendingHandshake> pendingHandshakes_;
     void checkHandshakeTimeouts();
+    void applyLinkMtu(size_t maxFrameBytes);
+    void disableForwardErrorCorrection(ConnectionId id);
+    // Common path of send(); an empty conflationKey means no conflation
+    void queueSend(ConnectionId id, const string& payload, MessageFormat format, Priority priority,
+                   bool requireAck, chrono::milliseconds ttl, const string& conflationKey,
+                   function<void()> onDelivered, function<void()> onExpired,
+                   function<void(const string&)> onFailed, optional<uint8_t> orderedStream = nullopt);
 
     ValidationConfig validationConfig_;
     SessionManager sessionManager_;
@@ -199,9 +402,12 @@ private:
         int newId = 0;
         bool hasFinalConfirmation = false;
         bool finalConfirmation = false;
+        bool hasCapabilities = false;
+        uint32_t capabilities = 0;
     };
 
     optional<HandshakePayload> parseHandshakePayload(const string& payload);
+    optional<HandshakePayload> parseBinaryHandshakePayload(const string& payload);
     void handleHandshakeRequest(const Message& msg, const HandshakePayload& payload);
     void handleHandshakeResponse(const Message& msg, const HandshakePayload& payload);
     void handleHandshakeFinalConfirmation(const Message& msg, const HandshakePayload& payload);
@@ -210,6 +416,50 @@ private:
     Message decryptMessageIfNeeded(const Message& msg);
     string statusToString(ConnectionStatus status) const;
 
+    // --- Control plane encoding ---
+    // Capabilities this SDK advertises in its handshakes.
+    uint32_t localCapabilities_ = CAPABILITY_BINARY_CONTROL | CAPABILITY_LARGE_MESSAGES | CAPABILITY_STREAMS |
+                                  CAPABILITY_HEADER_COMPRESSION | CAPABILITY_COMPRESSION | CAPABILITY_DELTA |
+                                  CAPABILITY_TELEMETRY | CAPABILITY_FEC | CAPABILITY_ORDERED;
+    bool usesBinaryControl(ConnectionId id);
+    bool usesLargeMessages(ConnectionId id);
+    static int64_t steadyNowMs();
+
+    // --- Streams ---
+    // Chunks further ahead of the next expected sequence are dropped
+    static constexpr uint32_t MAX_STREAM_REORDER_CHUNKS = 1024;
+    struct InboundStream {
+        uint32_t nextSequence = 0;
+        map<uint32_t, pair<string, bool>> pending;
+    };
+    StreamId nextStreamId_ = 1;
+    unordered_map<ConnectionId, unordered_map<StreamId, InboundStream>> inboundStreams_;
+    friend class StreamWriter;
+    void sendStreamChunk(ConnectionId id, string&& payload, Priority priority, function<void()> onDelivered);
+    void handleStreamMessage(const Message& msg);
+
+    // --- Telemetry ---
+    // Batch payload: [channel:2][TimeSeriesCodec block]
+    static constexpr size_t TELEMETRY_HEADER_BYTES = 2;
+    void handleTelemetryMessage(const Message& msg);
+
+    // --- Multicast groups ---
+    struct GroupState {
+        function<void(DeviceId, const string&)> onMessage;
+        GroupPublisher publisher;
+        // Per publisher heard in the group
+        unordered_map<DeviceId, GroupSubscriber> subscribers;
+        GroupStats stats;
+    };
+    unordered_map<ConnectionId, GroupState> groups_;
+    void handleGroupMessage(const Message& msg);
+    void queueGroupRecord(ConnectionId groupId, string&& record, Priority priority);
+    // NACKs the subscriber's due gaps and hands up what became ready
+    void serviceGroupSubscriber(ConnectionId groupId, GroupState& group, DeviceId publisher,
+                                vector<string>&& ready);
+    // Announces and NACK retries, from the heartbeat thread
+    void serviceGroups();
+
     // --- Encryption state ---
     shared_ptr<ICryptoModule> cryptoModule_;
     uint8_t defaultKeyId_ = 0;
@@ -222,6 +472,26 @@ private:
     bool shouldEncrypt(MessageFormat format) const;
     uint8_t getKeyForConnection(ConnectionId connId) const;
 
+    // --- Compression state ---
+    shared_ptr<ICompressionCodec> compressionCodec_;
+    size_t compressionThreshold_ = DEFAULT_COMPRESSION_THRESHOLD_BYTES;
+    bool compressionEnabled_ = true;
+
+    // --- Compression helpers ---
+    bool compressPayloadIfWorthIt(ConnectionId connId, MessageFormat format, string& payload);
+    bool decompressMessageIfNeeded(Message& msg);
+    size_t maxInboundMessageBytes(ConnectionId connId);
+
+    // --- Delta encoding state (per connection, per format) ---
+    // Senders are shared with the onDelivered wrappers that feed them ACKs
+    unordered_map<ConnectionId, map<MessageFormat, shared_ptr<DeltaSender>>> deltaSenders_;
+    unordered_map<ConnectionId, map<MessageFormat, DeltaReceiver>> deltaReceivers_;
+    bool encodeDeltaIfEnabled(ConnectionId connId, MessageFormat format, bool requireAck,
+                              string& payload, function<void()>& onDelivered);
+    bool decodeDeltaIfNeeded(Message& msg);
+    void sendDeltaResync(ConnectionId connId, MessageFormat format, string record);
+    void handleDeltaResync(ConnectionId connId, MessageFormat format, uint32_t failedSequence);
+
     // --- Helpers ---
     unordered_map<int, Connection>::iterator findConnection(ConnectionId id);
 };
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include <commonTypes.hpp>
+
+using namespace std;
+
+// ============================================================
+// GroupFeed — state of the multicast group feeds of
+// EminentSdk::joinGroup() / publish().
+//
+// A publisher numbers its messages per group and keeps the last
+// HISTORY_SIZE records. Subscribers hand each publisher's messages up in
+// that order and multicast a NACK for every gap, so one repair serves all
+// subscribers that missed it and a subscriber that sees another's NACK
+// holds back its own. A publisher gone quiet announces its last sequence
+// so a lost tail is noticed too. There are no ACKs: the publisher's cost
+// does not grow with the number of subscribers.
+//
+// Record layout (big-endian), carried as a GROUP message payload:
+//   DATA      [kind:1][publisher:4][sequence:4][payload...]
+//   NACK      [kind:1][publisher:4][firstSequence:4][count:2]
+//   ANNOUNCE  [kind:1][publisher:4][lastSequence:4]
+// `publisher` is the device that numbered the sequences, also in a NACK.
+// ============================================================
+struct GroupRecord {
+    static constexpr uint8_t KIND_DATA = 0;
+    static constexpr uint8_t KIND_NACK = 1;
+    static constexpr uint8_t KIND_ANNOUNCE = 2;
+    static constexpr size_t HEADER_BYTES = 9;
+    static constexpr size_t NACK_BYTES = HEADER_BYTES + 2;
+
+    uint8_t kind = KIND_DATA;
+    DeviceId publisher = 0;
+    uint32_t sequence = 0;
+    // NACK only: sequences asked for, from `sequence` on
+    uint16_t count = 0;
+
+    static string encode(uint8_t kind, DeviceId publisher, uint32_t sequence);
+    static string encodeNack(DeviceId publisher, uint32_t firstSequence, uint16_t count);
+    // Returns false for a truncated record or an unknown kind; a DATA
+    // payload starts at HEADER_BYTES
+    static bool decode(const string& record, GroupRecord& out);
+};
+
+// Counters of one group on this device, see EminentSdk::getGroupStats()
+struct GroupStats {
+    uint64_t published = 0;
+    uint64_t repairsSent = 0;
+    uint64_t nacksSent = 0;
+    uint64_t delivered = 0;
+    // Messages given up on after MAX_NACK_ATTEMPTS or left behind a jump
+    uint64_t skipped = 0;
+};
+
+class GroupPublisher {
+public:
+    static constexpr size_t HISTORY_SIZE = 1024;
+    // Idle publishers repeat their last sequence this often
+    static constexpr chrono::milliseconds ANNOUNCE_INTERVAL{1000};
+
+    explicit GroupPublisher(DeviceId self) : self_(self) {}
+
+    // DATA record for an (already encrypted) payload, kept for repairs
+    string encodeData(const string& payload);
+    // Kept records of [first, first + count); one resent less than
+    // `holdoff` ago is left out, as its repair is still on the way
+    vector<string> repairs(uint32_t first, uint16_t count, chrono::steady_clock::time_point now,
+                           chrono::milliseconds holdoff);
+    // ANNOUNCE record after new messages, or every ANNOUNCE_INTERVAL
+    optional<string> announceDue(chrono::steady_clock::time_point now);
+
+private:
+    struct Entry {
+        uint32_t sequence;
+        string record;
+        chrono::steady_clock::time_point lastRepair{};
+    };
+
+    DeviceId self_;
+    uint32_t nextSequence_ = 1;
+    deque<Entry> history_;
+    bool announced_ = true;
+    chrono::steady_clock::time_point lastAnnounce_{};
+};
+
+// One publisher as seen by one subscriber
+class GroupSubscriber {
+public:
+    // Furthest a message may run ahead of the next one to hand up; beyond
+    // that the subscriber skips to it
+    static constexpr uint32_t MAX_REORDER = 1024;
+    static constexpr int MAX_NACK_ATTEMPTS = 5;
+
+    // Payloads now in order are appended to `ready`. The first record seen
+    // from a publisher sets where this subscriber starts.
+    void onData(uint32_t sequence, string&& payload, vector<string>& ready);
+    void onAnnounce(uint32_t lastSequence);
+    // Another subscriber asked for these: no NACK of ours for an interval
+    void onNackSeen(uint32_t first, uint16_t count, chrono::steady_clock::time_point now);
+    // Gaps to NACK now, as (first, count) ranges. Gaps out of attempts, or
+    // all of them with a zero interval, are skipped; what that frees is
+    // appended to `ready`.
+    vector<pair<uint32_t, uint16_t>> dueNacks(chrono::steady_clock::time_point now, chrono::milliseconds interval,
+                                              vector<string>& ready);
+    uint64_t skipped() const { return skipped_; }
+
+private:
+    struct Gap {
+        int attempts = 0;
+        chrono::steady_clock::time_point lastNack{};
+    };
+
+    void markMissingUpTo(uint32_t end);
+    void release(vector<string>& ready);
+
+    bool started_ = false;
+    // Next sequence to hand up, and one past the highest one known of
+    uint32_t next_ = 0;
+    uint32_t end_ = 0;
+    map<uint32_t, string> held_;
+    map<uint32_t, Gap> missing_;
+    set<uint32_t> abandoned_;
+    uint64_t skipped_ = 0;
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <commonTypes.hpp>
+
+using namespace std;
+
+class EminentSdk;
+
+// ============================================================
+// StreamWriter — incremental sender returned by EminentSdk::openStream().
+//
+// Written bytes are cut into chunks that each fit one fragment and are
+// queued as STREAM messages with ACK. At most `windowChunks` chunks are
+// unacknowledged at a time; write() blocks while the window is full, so
+// memory stays constant regardless of the total stream length.
+//
+// Chunk payload layout (big-endian):
+//   [streamId:4][sequence:4][flags:1][data...]
+// FLAG_END marks the last chunk of the stream.
+// ============================================================
+class StreamWriter {
+public:
+    static constexpr size_t HEADER_BYTES = 9;
+    static constexpr uint8_t FLAG_END = 0x01;
+    // Room left in a chunk for the crypto header when encryption is on
+    static constexpr size_t ENCRYPTION_RESERVE_BYTES = 32;
+    static constexpr size_t DEFAULT_WINDOW_CHUNKS = 64;
+
+    struct ChunkHeader {
+        StreamId streamId = 0;
+        uint32_t sequence = 0;
+        uint8_t flags = 0;
+    };
+
+    ~StreamWriter();
+
+    StreamWriter(const StreamWriter&) = delete;
+    StreamWriter& operator=(const StreamWriter&) = delete;
+
+    // Returns false if the window did not open within `timeout` or the
+    // stream is already closed; throws if the connection is gone.
+    bool write(const uint8_t* data, size_t size,
+               chrono::milliseconds timeout = chrono::milliseconds{10000});
+    bool write(const vector<uint8_t>& data,
+               chrono::milliseconds timeout = chrono::milliseconds{10000});
+
+    // Sends buffered bytes with FLAG_END and waits until every chunk is
+    // acknowledged. Returns false on timeout.
+    bool close(chrono::milliseconds timeout = chrono::milliseconds{10000});
+
+    StreamId id() const { return streamId_; }
+    ConnectionId connectionId() const { return connId_; }
+    bool isOpen() const { return open_; }
+    size_t chunkBytes() const { return chunkBytes_; }
+    uint64_t bytesWritten() const { return bytesWritten_; }
+
+    static string encodeHeader(const ChunkHeader& header);
+    static bool decodeHeader(const string& payload, ChunkHeader& out);
+
+private:
+    friend class EminentSdk;
+
+    // Shared with the onDelivered callbacks so they stay valid after the
+    // writer is destroyed.
+    struct Window {
+        mutex guard;
+        condition_variable cv;
+        size_t inFlight = 0;
+    };
+
+    StreamWriter(EminentSdk& sdk, ConnectionId connId, StreamId streamId,
+                 Priority priority, size_t chunkBytes, size_t windowChunks);
+
+    bool sendChunk(bool end, chrono::milliseconds timeout);
+    bool waitForWindow(size_t maxInFlight, chrono::milliseconds timeout);
+
+    EminentSdk& sdk_;
+    ConnectionId connId_;
+    StreamId streamId_;
+    Priority priority_;
+    size_t chunkBytes_;
+    size_t windowChunks_;
+    shared_ptr<Window> window_;
+    string pending_;
+    uint32_t nextSequence_ = 0;
+    uint64_t bytesWritten_ = 0;
+    bool open_ = true;
+};
@@ -0,0 +1,116 @@
+#include "ControlMessageCodec.hpp"
+
+using namespace std;
+
+static void putU32(char* out, uint32_t value) {
+    out[0] = static_cast<char>((value >> 24) & 0xFF);
+    out[1] = static_cast<char>((value >> 16) & 0xFF);
+    out[2] = static_cast<char>((value >> 8) & 0xFF);
+    out[3] = static_cast<char>(value & 0xFF);
+}
+
+static void putU64(char* out, uint64_t value) {
+    putU32(out, static_cast<uint32_t>(value >> 32));
+    putU32(out + 4, static_cast<uint32_t>(value & 0xFFFFFFFFULL));
+}
+
+static uint32_t getU32(const string& in, size_t offset) {
+    return (static_cast<uint32_t>(static_cast<uint8_t>(in[offset])) << 24) |
+           (static_cast<uint32_t>(static_cast<uint8_t>(in[offset + 1])) << 16) |
+           (static_cast<uint32_t>(static_cast<uint8_t>(in[offset + 2])) << 8) |
+           static_cast<uint32_t>(static_cast<uint8_t>(in[offset + 3]));
+}
+
+static uint64_t getU64(const string& in, size_t offset) {
+    return (static_cast<uint64_t>(getU32(in, offset)) << 32) | getU32(in, offset + 4);
+}
+
+size_t ControlMessageCodec::bodyBytes(Kind kind) {
+    switch (kind) {
+        case Kind::HANDSHAKE_REQUEST:
+        case Kind::HANDSHAKE_FINAL:
+            return 8;
+        case Kind::HANDSHAKE_RESPONSE:
+            return 12;
+        case Kind::HEARTBEAT:
+        case Kind::HEARTBEAT_ACK:
+            return 8;
+        case Kind::DISCONNECT:
+            return 4;
+    }
+    return 0;
+}
+
+string ControlMessageCodec::encode(const ControlMessage& message) {
+    char buffer[MAX_ENCODED_BYTES];
+    buffer[0] = static_cast<char>(VERSION_TAG);
+    buffer[1] = static_cast<char>(message.kind);
+    putU32(buffer + 2, static_cast<uint32_t>(message.deviceId));
+
+    char* body = buffer + PREFIX_BYTES;
+    switch (message.kind) {
+        case Kind::HANDSHAKE_RESPONSE:
+            putU32(body + 8, static_cast<uint32_t>(message.newId));
+            [[fallthrough]];
+        case Kind::HANDSHAKE_REQUEST:
+        case Kind::HANDSHAKE_FINAL:
+            putU32(body, static_cast<uint32_t>(message.specialCode));
+            putU32(body + 4, message.capabilities);
+            break;
+        case Kind::HEARTBEAT:
+        case Kind::HEARTBEAT_ACK:
+            putU64(body, static_cast<uint64_t>(message.timestampMs));
+            break;
+        case Kind::DISCONNECT:
+            putU32(body, static_cast<uint32_t>(message.connId));
+            break;
+    }
+    return string(buffer, PREFIX_BYTES + bodyBytes(message.kind));
+}
+
+string ControlMessageCodec::encodeHeartbeat(Kind kind, int deviceId, int64_t timestampMs) {
+    char buffer[HEARTBEAT_BYTES];
+    buffer[0] = static_cast<char>(VERSION_TAG);
+    buffer[1] = static_cast<char>(kind);
+    putU32(buffer + 2, static_cast<uint32_t>(deviceId));
+    putU64(buffer + PREFIX_BYTES, static_cast<uint64_t>(timestampMs));
+    return string(buffer, HEARTBEAT_BYTES);
+}
+
+optional<ControlMessageCodec::ControlMessage> ControlMessageCodec::decode(const string& payload) {
+    if (payload.size() < PREFIX_BYTES || !isBinary(payload)) {
+        return nullopt;
+    }
+    uint8_t rawKind = static_cast<uint8_t>(payload[1]);
+    if (rawKind < static_cast<uint8_t>(Kind::HANDSHAKE_REQUEST) ||
+        rawKind > static_cast<uint8_t>(Kind::DISCONNECT)) {
+        return nullopt;
+    }
+
+    ControlMessage message;
+    message.kind = static_cast<Kind>(rawKind);
+    if (payload.size() != PREFIX_BYTES + bodyBytes(message.kind)) {
+        return nullopt;
+    }
+    message.deviceId = static_cast<int>(getU32(payload, 2));
+
+    const size_t body = PREFIX_BYTES;
+    switch (message.kind) {
+        case Kind::HANDSHAKE_RESPONSE:
+            message.newId = static_cast<int>(getU32(payload, body + 8));
+            [[fallthrough]];
+        case Kind::HANDSHAKE_REQUEST:
+        case Kind::HANDSHAKE_FINAL:
+            message.specialCode = static_cast<int>(getU32(payload, body));
+            message.capabilities = getU32(payload, body + 4);
+            break;
+        case Kind::HEARTBEAT:
+        case Kind::HEARTBEAT_ACK:
+            message.timestampMs = static_cast<int64_t>(getU64(payload, body));
+            break;
+        case Kind::DISCONNECT:
+            message.connId = static_cast<int>(getU32(payload, body));
+            break;
+    }
+    return message;
+}
@@ -0,0 +1,163 @@
+#include "DeltaChannel.hpp"
+#include "DeltaCodec.hpp"
+
+#include <exception>
+
+using namespace std;
+
+static void putU32(string& out, uint32_t value) {
+    out.push_back(static_cast<char>((value >> 24) & 0xFF));
+    out.push_back(static_cast<char>((value >> 16) & 0xFF));
+    out.push_back(static_cast<char>((value >> 8) & 0xFF));
+    out.push_back(static_cast<char>(value & 0xFF));
+}
+
+static uint32_t getU32(const string& in, size_t offset) {
+    return (static_cast<uint32_t>(static_cast<uint8_t>(in[offset])) << 24) |
+           (static_cast<uint32_t>(static_cast<uint8_t>(in[offset + 1])) << 16) |
+           (static_cast<uint32_t>(static_cast<uint8_t>(in[offset + 2])) << 8) |
+           static_cast<uint32_t>(static_cast<uint8_t>(in[offset + 3]));
+}
+
+// Sequence numbers wrap; compare through the signed distance
+static bool sequenceAfter(uint32_t a, uint32_t b) {
+    return static_cast<int32_t>(a - b) > 0;
+}
+
+// ============================================================
+// DeltaSender
+// ============================================================
+
+string DeltaSender::encode(const string& payload, bool trackAck, uint32_t& sequence) {
+    lock_guard<mutex> lock(guard_);
+    sequence = nextSequence_++;
+
+    string record;
+    if (hasBase_ && sinceSnapshot_ < SNAPSHOT_INTERVAL && sequence - baseSequence_ <= MAX_BASE_AGE) {
+        string delta = DeltaCodec::encode(base_, payload);
+        if (DIFF_HEADER_BYTES + delta.size() < SNAPSHOT_HEADER_BYTES + payload.size()) {
+            record.reserve(DIFF_HEADER_BYTES + delta.size());
+            record.push_back(static_cast<char>(KIND_DIFF));
+            putU32(record, sequence);
+            putU32(record, baseSequence_);
+            record += delta;
+            ++sinceSnapshot_;
+        }
+    }
+    if (record.empty()) {
+        record.reserve(SNAPSHOT_HEADER_BYTES + payload.size());
+        record.push_back(static_cast<char>(KIND_SNAPSHOT));
+        putU32(record, sequence);
+        record += payload;
+        sinceSnapshot_ = 0;
+        lastSnapshotSequence_ = sequence;
+    }
+    latest_ = payload;
+
+    if (trackAck) {
+        awaitingAck_[sequence] = payload;
+        // Payloads this old could no longer serve as a base anyway
+        while (awaitingAck_.size() > MAX_BASE_AGE) {
+            awaitingAck_.erase(awaitingAck_.begin());
+        }
+    }
+    return record;
+}
+
+void DeltaSender::onAcked(uint32_t sequence) {
+    lock_guard<mutex> lock(guard_);
+    auto it = awaitingAck_.find(sequence);
+    if (it == awaitingAck_.end()) {
+        return;
+    }
+    if (!hasBase_ || sequenceAfter(sequence, baseSequence_)) {
+        base_ = move(it->second);
+        baseSequence_ = sequence;
+        hasBase_ = true;
+    }
+    awaitingAck_.erase(awaitingAck_.begin(), next(it));
+}
+
+bool DeltaSender::resync(uint32_t failedSequence, string& latest) {
+    lock_guard<mutex> lock(guard_);
+    hasBase_ = false;
+    awaitingAck_.clear();
+    // Nothing sent yet, a stale request, or a snapshot already in flight
+    if (nextSequence_ == 1 || !sequenceAfter(nextSequence_, failedSequence) ||
+        sequenceAfter(lastSnapshotSequence_, failedSequence)) {
+        return false;
+    }
+    latest = latest_;
+    return true;
+}
+
+// ============================================================
+// DeltaReceiver
+// ============================================================
+
+bool DeltaReceiver::decode(const string& record, string& payload, size_t maxPayloadBytes) {
+    if (record.size() < DeltaSender::SNAPSHOT_HEADER_BYTES) {
+        return false;
+    }
+    uint8_t kind = static_cast<uint8_t>(record[0]);
+    uint32_t sequence = getU32(record, 1);
+
+    if (kind == DeltaSender::KIND_SNAPSHOT) {
+        payload.assign(record, DeltaSender::SNAPSHOT_HEADER_BYTES, string::npos);
+        resyncRequested_ = false;
+    } else if (kind == DeltaSender::KIND_DIFF && record.size() >= DeltaSender::DIFF_HEADER_BYTES) {
+        uint32_t baseSequence = getU32(record, 5);
+        const string* base = nullptr;
+        for (const auto& [seq, data] : history_) {
+            if (seq == baseSequence) {
+                base = &data;
+                break;
+            }
+        }
+        if (!base) {
+            if (!resyncRequested_) {
+                resyncRequested_ = true;
+                resyncPending_ = true;
+                resyncSequence_ = sequence;
+            }
+            return false;
+        }
+        try {
+            payload = DeltaCodec::decode(*base, record.data() + DeltaSender::DIFF_HEADER_BYTES,
+                                         record.size() - DeltaSender::DIFF_HEADER_BYTES, maxPayloadBytes);
+        } catch (const exception&) {
+            return false;
+        }
+    } else {
+        return false;
+    }
+
+    if (payload.size() > maxPayloadBytes) {
+        return false;
+    }
+    history_.emplace_back(sequence, payload);
+    if (history_.size() > HISTORY_SIZE) {
+        history_.pop_front();
+    }
+    return true;
+}
+
+bool DeltaReceiver::takeResyncRequest(string& record) {
+    if (!resyncPending_) {
+        return false;
+    }
+    resyncPending_ = false;
+    record.clear();
+    record.push_back(static_cast<char>(DeltaSender::KIND_RESYNC));
+    putU32(record, resyncSequence_);
+    return true;
+}
+
+bool DeltaReceiver::isResync(const string& record) {
+    return record.size() == DeltaSender::SNAPSHOT_HEADER_BYTES &&
+           static_cast<uint8_t>(record[0]) == DeltaSender::KIND_RESYNC;
+}
+
+uint32_t DeltaReceiver::resyncSequence(const string& record) {
+    return getU32(record, 1);
+}
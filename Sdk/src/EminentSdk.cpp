@@ -2,6 +2,8 @@
 
 #include "AbstractPhysicalLayer.hpp"
 #include "PhysicalLayerUdp.hpp"
+#include "Lz4Codec.hpp"
+#include "TimeSeriesCodec.hpp"
 
 #include <algorithm>
 #include <cctype>
@@ -28,7 +30,8 @@ EminentSdk::EminentSdk(unique_ptr<AbstractPhysicalLayer> physicalLayer,
       physicalLayer_(std::move(physicalLayer)),
       localPort_(0),
       remoteHost_(),
-      remotePort_(0) {
+      remotePort_(0),
+      compressionCodec_(make_shared<Lz4Codec>()) {
     if (!physicalLayer_) {
         throw invalid_argument("physicalLayer must not be null");
     }
@@ -39,6 +42,12 @@ EminentSdk::EminentSdk(unique_ptr<AbstractPhysicalLayer> physicalLayer,
     }
     LoggerConfig::setLevel(logLevel);
     physicalLayer_->configure(codingModule_.getOutgoingFrames(), codingModule_, validationConfig_);
+    physicalLayer_->setOnLinkMtuChanged([this](size_t maxFrameBytes) { applyLinkMtu(maxFrameBytes); });
+    physicalLayer_->setOnSendBackpressure([this]() { sessionManager_.onLinkBackpressure(); });
+    sessionManager_.setOnPacingRateChanged([layer = physicalLayer_.get()](double bytesPerSecond) {
+        layer->setPacingRate(bytesPerSecond);
+    });
+    applyLinkMtu(physicalLayer_->maxFrameBytesOnLink());
     physicalLayer_->start();
 }
 
@@ -104,6 +113,15 @@ void EminentSdk::onMessageReceived(const Message& msg) {
         case MessageFormat::HEARTBEAT_ACK:
             handleHeartbeatAck(msg);
             break;
+        case MessageFormat::STREAM:
+            handleStreamMessage(msg);
+            break;
+        case MessageFormat::TELEMETRY:
+            handleTelemetryMessage(msg);
+            break;
+        case MessageFormat::GROUP:
+            handleGroupMessage(msg);
+            break;
         default:
             log(LogLevel::WARN, string("Unknown message format: ") + to_string(static_cast<int>(msg.format)));
             break;
@@ -113,6 +131,9 @@ void EminentSdk::onMessageReceived(const Message& msg) {
 void EminentSdk::handleJsonMessage(const Message& msg) {
     // Decrypt payload if encryption is active
     Message decMsg = decryptMessageIfNeeded(msg);
+    if (!decompressMessageIfNeeded(decMsg) || !decodeDeltaIfNeeded(decMsg)) {
+        return;
+    }
 
     auto it = connections_.find(decMsg.connId);
     if (it == connections_.end()) {
@@ -205,6 +226,9 @@ void EminentSdk::handleVideoMessage(const Message& msg) {
     // VIDEO format is used internally for binary user data
     // Decrypt payload if encryption is active
     Message decMsg = decryptMessageIfNeeded(msg);
+    if (!decompressMessageIfNeeded(decMsg) || !decodeDeltaIfNeeded(decMsg)) {
+        return;
+    }
 
     auto it = findConnection(decMsg.connId);
     if (it == connections_.end()) {
@@ -288,6 +312,7 @@ void EminentSdk::complexConsoleInfo(const string& title) {
             summary << "  defaultPriority: " << conn.defaultPriority << '\n';
             summary << "  status: " << statusToString(conn.status) << '\n';
             summary << "  specialCode: " << conn.specialCode << '\n';
+            summary << "  capabilities: 0x" << hex << conn.capabilities << dec << '\n';
             summary << "  callbacks: onMessage=" << (conn.onMessage ? "yes" : "no")
                     << ", onTrouble=" << (conn.onTrouble ? "yes" : "no")
                     << ", onDisconnected=" << (conn.onDisconnected ? "yes" : "no")
@@ -320,8 +345,16 @@ void EminentSdk::handleHandshakeRequest(const Message& msg, const HandshakePaylo
 
     log(LogLevel::INFO, string("Handshake connId=") + to_string(msg.connId) + " accepted -> sending response");
 
+    // Peers pick their primes independently, so a node that also initiates
+    // or serves many devices can meet a product it already uses
     ConnectionId myConnId = nextPrime();
     long long combinedProduct = static_cast<long long>(msg.connId) * static_cast<long long>(myConnId);
+    while (combinedProduct > 0 && combinedProduct <= numeric_limits<int>::max() &&
+           (connections_.count(static_cast<int>(combinedProduct)) > 0 ||
+            groups_.count(static_cast<int>(combinedProduct)) > 0)) {
+        myConnId = nextPrime();
+        combinedProduct = static_cast<long long>(msg.connId) * static_cast<long long>(myConnId);
+    }
     if (combinedProduct <= 0 || combinedProduct > numeric_limits<int>::max()) {
         log(LogLevel::WARN, "Handshake combined connection id overflow");
         return;
@@ -340,22 +373,48 @@ void EminentSdk::handleHandshakeRequest(const Message& msg, const HandshakePaylo
     conn.defaultPriority = 0;
     conn.status = ConnectionStatus::ACCEPTED;
     conn.specialCode = payload.specialCode;
+    conn.capabilities = (payload.hasCapabilities ? payload.capabilities : 0U) & localCapabilities_;
     connections_[combinedId] = conn;
+    // Addresses are learned only from handshakes the application accepted:
+    // the source of any other datagram can be forged, and payloads carry no
+    // authentication tag to tell a forged one apart
+    if (msg.peer != 0) {
+        physicalLayer_->notePeerAddress(payload.deviceId, msg.peer);
+    }
+    physicalLayer_->bindConnection(combinedId, payload.deviceId);
 
     log(LogLevel::INFO, string("Connection ") + to_string(combinedId) + " status set to ACCEPTED");
 
     MessageId mid = nextMessageId();
-    ostringstream oss;
-    oss << "{\"deviceId\": " << deviceId_ << ", \"specialCode\": " << conn.specialCode << ", \"newId\": " << myConnId << "}";
-    string respPayload = oss.str();
+    string respPayload;
+    if (conn.capabilities & CAPABILITY_BINARY_CONTROL) {
+        ControlMessageCodec::ControlMessage resp;
+        resp.kind = ControlMessageCodec::Kind::HANDSHAKE_RESPONSE;
+        resp.deviceId = deviceId_;
+        resp.specialCode = conn.specialCode;
+        resp.capabilities = localCapabilities_;
+        resp.newId = myConnId;
+        respPayload = ControlMessageCodec::encode(resp);
+    } else {
+        ostringstream oss;
+        oss << "{\"deviceId\": " << deviceId_ << ", \"specialCode\": " << conn.specialCode << ", \"newId\": " << myConnId
+            << ", \"caps\": " << localCapabilities_ << "}";
+        respPayload = oss.str();
+    }
     Message respMsg{mid, msg.connId, respPayload, MessageFormat::HANDSHAKE, 0, false, nullptr};
+    // The requester's connection id is not bound here; answer where it came from
+    respMsg.peer = msg.peer;
     try {
         validationConfig_.validateMessage(respMsg);
     } catch (const exception& ex) {
         log(LogLevel::WARN, string("Failed to queue handshake response: ") + ex.what());
         connections_.erase(combinedId);
+        physicalLayer_->unbindConnection(combinedId);
         return;
     }
+    if (conn.capabilities & CAPABILITY_HEADER_COMPRESSION) {
+        transportLayer_.setHeaderCompression(combinedId, true);
+    }
     outgoingQueue_.push(respMsg);
 }
 
@@ -380,6 +439,7 @@ void EminentSdk::handleHandshakeResponse(const Message& msg, const HandshakePayl
 
     Connection conn = it->second;
     connections_.erase(it);
+    physicalLayer_->unbindConnection(msg.connId);
 
     long long combinedProduct = static_cast<long long>(msg.connId) * static_cast<long long>(payload.newId);
     if (combinedProduct <= 0 || combinedProduct > numeric_limits<int>::max()) {
@@ -396,8 +456,13 @@ void EminentSdk::handleHandshakeResponse(const Message& msg, const HandshakePayl
     conn.id = combinedId;
     conn.remoteId = payload.deviceId;
     conn.specialCode = payload.specialCode;
+    conn.capabilities = (payload.hasCapabilities ? payload.capabilities : 0U) & localCapabilities_;
     conn.status = ConnectionStatus::ACTIVE;
     connections_[combinedId] = conn;
+    if (msg.peer != 0) {
+        physicalLayer_->notePeerAddress(payload.deviceId, msg.peer);
+    }
+    physicalLayer_->bindConnection(combinedId, payload.deviceId);
 
     // Remove from pending handshakes (handshake succeeded)
     pendingHandshakes_.erase(
@@ -423,17 +488,32 @@ void EminentSdk::handleHandshakeResponse(const Message& msg, const HandshakePayl
     }
 
     MessageId ackId = nextMessageId();
-    ostringstream oss;
-    oss << "{\"deviceId\": " << deviceId_ << ", \"specialCode\": " << conn.specialCode << ", \"finalConfirmation\": true}";
-    string ackPayload = oss.str();
+    string ackPayload;
+    if (conn.capabilities & CAPABILITY_BINARY_CONTROL) {
+        ControlMessageCodec::ControlMessage finalMsg;
+        finalMsg.kind = ControlMessageCodec::Kind::HANDSHAKE_FINAL;
+        finalMsg.deviceId = deviceId_;
+        finalMsg.specialCode = conn.specialCode;
+        finalMsg.capabilities = localCapabilities_;
+        ackPayload = ControlMessageCodec::encode(finalMsg);
+    } else {
+        ostringstream oss;
+        oss << "{\"deviceId\": " << deviceId_ << ", \"specialCode\": " << conn.specialCode << ", \"finalConfirmation\": true"
+            << ", \"caps\": " << localCapabilities_ << "}";
+        ackPayload = oss.str();
+    }
     Message finalAck{ackId, combinedId, ackPayload, MessageFormat::HANDSHAKE, 0, false, nullptr};
     try {
         validationConfig_.validateMessage(finalAck);
     } catch (const exception& ex) {
         log(LogLevel::WARN, string("Failed to queue final handshake ack: ") + ex.what());
         connections_.erase(combinedId);
+        physicalLayer_->unbindConnection(combinedId);
         return;
     }
+    if (conn.capabilities & CAPABILITY_HEADER_COMPRESSION) {
+        transportLayer_.setHeaderCompression(combinedId, true);
+    }
     outgoingQueue_.push(finalAck);
 }
 
@@ -475,7 +555,41 @@ void EminentSdk::handleHandshakeFinalConfirmation(const Message& msg, const Hand
     }
 }
 
+optional<EminentSdk::HandshakePayload> EminentSdk::parseBinaryHandshakePayload(const string& payload) {
+    auto decoded = ControlMessageCodec::decode(payload);
+    if (!decoded.has_value()) {
+        return nullopt;
+    }
+
+    HandshakePayload result;
+    switch (decoded->kind) {
+        case ControlMessageCodec::Kind::HANDSHAKE_RESPONSE:
+            result.hasNewId = true;
+            result.newId = decoded->newId;
+            break;
+        case ControlMessageCodec::Kind::HANDSHAKE_FINAL:
+            result.hasFinalConfirmation = true;
+            result.finalConfirmation = true;
+            break;
+        case ControlMessageCodec::Kind::HANDSHAKE_REQUEST:
+            break;
+        default:
+            return nullopt;
+    }
+    result.hasDeviceId = true;
+    result.deviceId = decoded->deviceId;
+    result.hasSpecialCode = true;
+    result.specialCode = decoded->specialCode;
+    result.hasCapabilities = true;
+    result.capabilities = decoded->capabilities;
+    return result;
+}
+
 optional<EminentSdk::HandshakePayload> EminentSdk::parseHandshakePayload(const string& payload) {
+    if (ControlMessageCodec::isBinary(payload)) {
+        return parseBinaryHandshakePayload(payload);
+    }
+
     HandshakePayload result;
 
     auto parseIntField = [&](const string& key) -> optional<int> {
@@ -546,6 +660,10 @@ optional<EminentSdk::HandshakePayload> EminentSdk::parseHandshakePayload(const s
         result.hasFinalConfirmation = true;
         result.finalConfirmation = *val;
     }
+    if (auto val = parseIntField("caps")) {
+        result.hasCapabilities = true;
+        result.capabilities = static_cast<uint32_t>(*val);
+    }
 
     if (!result.hasDeviceId && !result.hasSpecialCode && !result.hasNewId) {
         return nullopt;
@@ -639,7 +757,8 @@ ConnectionId EminentSdk::nextPrime() {
                 break;
             }
         }
-        if (isPrime) {
+        // Group ids are chosen by the application and share the id space
+        if (isPrime && groups_.count(candidate) == 0) {
             nextConnectionId_ = candidate + 1;
             return candidate;
         }
@@ -686,16 +805,21 @@ void EminentSdk::connect(
     conn.status = ConnectionStatus::PENDING;
     conn.specialCode = generateSpecialCode();
     connections_[cid] = conn;
+    physicalLayer_->bindConnection(cid, targetId);
 
+    // The request stays JSON: the peer's version is not known yet. Older peers
+    // ignore "caps" and keep answering in JSON.
     MessageId mid = nextMessageId();
     ostringstream oss;
-    oss << "{\"deviceId\": " << deviceId_ << ", \"specialCode\": " << conn.specialCode << "}";
+    oss << "{\"deviceId\": " << deviceId_ << ", \"specialCode\": " << conn.specialCode
+        << ", \"caps\": " << localCapabilities_ << "}";
     string payload = oss.str();
     Message handshakeMsg{mid, cid, payload, MessageFormat::HANDSHAKE, defaultPriority, true, [onSuccess, cid]() { if (onSuccess) onSuccess(cid); }};
     try {
         validationConfig_.validateMessage(handshakeMsg);
     } catch (const exception& ex) {
         connections_.erase(cid);
+        physicalLayer_->unbindConnection(cid);
         if (onFailure) {
             onFailure(ex.what());
         }
@@ -740,11 +864,18 @@ void EminentSdk::disconnect(ConnectionId id) {
         it->second.onDisconnected();
     }
 
-    // Remove heartbeat state
+    // Remove heartbeat and inbound stream state
     heartbeats_.erase(it->second.id);
+    inboundStreams_.erase(it->second.id);
+    deltaSenders_.erase(it->second.id);
+    deltaReceivers_.erase(it->second.id);
 
     // Remove connection
     ConnectionId actualId = it->second.id;
+    transportLayer_.setHeaderCompression(actualId, false);
+    disableForwardErrorCorrection(actualId);
+    sessionManager_.purgeConnection(actualId);
+    physicalLayer_->unbindConnection(actualId);
     connections_.erase(it);
     log(LogLevel::INFO, string("Connection ") + to_string(actualId) + " disconnected");
 }
@@ -759,8 +890,97 @@ void EminentSdk::send(
     MessageFormat format,
     Priority priority,
     bool requireAck,
+    function<void()> onDelivered,
+    function<void(const string& reason)> onFailed
+) {
+    send(id, payload, format, priority, requireAck, chrono::milliseconds{0}, move(onDelivered), nullptr,
+         move(onFailed));
+}
+
+void EminentSdk::send(
+    ConnectionId id,
+    const string& payload,
+    MessageFormat format,
+    Priority priority,
+    bool requireAck,
+    chrono::milliseconds ttl,
+    function<void()> onDelivered,
+    function<void()> onExpired,
+    function<void(const string& reason)> onFailed
+) {
+    queueSend(id, payload, format, priority, requireAck, ttl, string(), move(onDelivered), move(onExpired),
+              move(onFailed));
+}
+
+void EminentSdk::sendLatest(
+    ConnectionId id,
+    const string& key,
+    const string& payload,
     function<void()> onDelivered
 ) {
+    lock_guard<recursive_mutex> lock(mutex_);
+    auto it = findConnection(id);
+    if (it == connections_.end()) {
+        throw runtime_error("Send failed: invalid connection ID.");
+    }
+    sendLatest(it->second.id, key, payload, MessageFormat::JSON, it->second.defaultPriority, true, onDelivered);
+}
+
+void EminentSdk::sendLatest(
+    ConnectionId id,
+    const string& key,
+    const string& payload,
+    MessageFormat format,
+    Priority priority,
+    bool requireAck,
+    function<void()> onDelivered,
+    function<void(const string& reason)> onFailed
+) {
+    if (key.empty()) {
+        throw runtime_error("Send failed: conflation key must not be empty.");
+    }
+    queueSend(id, payload, format, priority, requireAck, chrono::milliseconds{0}, key, move(onDelivered), nullptr,
+              move(onFailed));
+}
+
+void EminentSdk::sendOrdered(
+    ConnectionId id,
+    uint8_t stream,
+    const string& payload,
+    MessageFormat format,
+    Priority priority,
+    function<void()> onDelivered,
+    function<void(const string& reason)> onFailed
+) {
+    lock_guard<recursive_mutex> lock(mutex_);
+    auto it = findConnection(id);
+    if (it == connections_.end()) {
+        throw runtime_error("Send failed: invalid connection ID.");
+    }
+    if (!(it->second.capabilities & CAPABILITY_ORDERED)) {
+        throw runtime_error("Send failed: peer did not negotiate ordered delivery.");
+    }
+    queueSend(it->second.id, payload, format, priority, true, chrono::milliseconds{0}, string(), move(onDelivered),
+              nullptr, move(onFailed), stream);
+}
+
+void EminentSdk::queueSend(
+    ConnectionId id,
+    const string& payload,
+    MessageFormat format,
+    Priority priority,
+    bool requireAck,
+    chrono::milliseconds ttl,
+    const string& conflationKey,
+    function<void()> onDelivered,
+    function<void()> onExpired,
+    function<void(const string&)> onFailed,
+    optional<uint8_t> orderedStream
+) {
+    if (ttl.count() < 0) {
+        throw runtime_error("Send failed: negative time-to-live.");
+    }
+    auto deadline = ttl.count() > 0 ? chrono::steady_clock::now() + ttl : chrono::steady_clock::time_point{};
     lock_guard<recursive_mutex> lock(mutex_);
     if (!connections_.count(id)) {
         throw runtime_error("Send failed: invalid connection ID.");
@@ -775,22 +995,41 @@ void EminentSdk::send(
         throw runtime_error(string("Send failed: ") + ex.what());
     }
 
-    // Encrypt payload if encryption is enabled for this format
+    // Delta-encode, compress, then encrypt payload if enabled for this format
     string finalPayload = payload;
+    bool delta = encodeDeltaIfEnabled(id, format, requireAck, finalPayload, onDelivered);
+    bool compressed = compressPayloadIfWorthIt(id, format, finalPayload);
     if (shouldEncrypt(format)) {
-        vector<uint8_t> plainBytes(payload.begin(), payload.end());
+        vector<uint8_t> plainBytes(finalPayload.begin(), finalPayload.end());
         vector<uint8_t> encrypted = encryptPayload(id, plainBytes);
         finalPayload = string(encrypted.begin(), encrypted.end());
     }
 
+    bool largeMessages = usesLargeMessages(id);
+    if (!largeMessages && finalPayload.size() > validationConfig_.maxStandardMessageBytes()) {
+        throw runtime_error("Send failed: message of " + to_string(finalPayload.size()) +
+            " bytes needs large-message mode, which the peer did not negotiate.");
+    }
+
     MessageId mid = nextMessageId();
-    Message msg{ mid, id, finalPayload, format, priority, requireAck, onDelivered };
+    Message msg(mid, id, move(finalPayload), format, priority, requireAck, onDelivered);
+    msg.allowExtendedFragments = largeMessages;
+    msg.compressed = compressed;
+    msg.delta = delta;
+    msg.deadline = deadline;
+    msg.onExpired = move(onExpired);
+    msg.conflationKey = conflationKey;
+    msg.onFailed = move(onFailed);
+    if (orderedStream.has_value() || connections_[id].deliveryMode == DeliveryMode::ORDERED) {
+        msg.ordered = true;
+        msg.orderedStream = orderedStream.value_or(0);
+    }
     try {
         validationConfig_.validateMessage(msg);
     } catch (const exception& ex) {
         throw runtime_error(string("Send failed: ") + ex.what());
     }
-    outgoingQueue_.push(msg);
+    outgoingQueue_.push(move(msg));
 
     log(LogLevel::DEBUG, string("Queued message id=") + to_string(mid) + " connection=" + to_string(id));
 }
@@ -831,14 +1070,47 @@ void EminentSdk::getStats(
     function<void(const vector<ConnectionStats>&)> onStats,
     ConnectionId id
 ) {
-    lock_guard<recursive_mutex> lock(mutex_);
+    vector<ConnectionId> ids;
+    {
+        lock_guard<recursive_mutex> lock(mutex_);
+        if (id == -1) {
+            for (auto& [cid, conn] : connections_) {
+                ids.push_back(cid);
+            }
+        } else if (connections_.count(id)) {
+            ids.push_back(id);
+        }
+    }
+
+    auto toMs = [](chrono::microseconds value) { return static_cast<double>(value.count()) / 1000.0; };
+    auto now = chrono::steady_clock::now();
     vector<ConnectionStats> stats;
-    if (id == -1) {
-        for (auto& [cid, conn] : connections_) {
-            stats.push_back({cid, 10.0, 0.1, 5.0, 0});
+    for (ConnectionId cid : ids) {
+        ConnectionStats entry{cid, 0.0, 0.0, 0.0, 0};
+        entry.retransmitTimeoutMs = toMs(sessionManager_.getRetransmitInterval());
+        if (auto link = sessionManager_.getLinkStats(cid)) {
+            entry.avgLatencyMs = toMs(link->smoothedRtt);
+            entry.rttVarianceMs = toMs(link->rttVariance);
+            entry.retransmitTimeoutMs = toMs(link->retransmitTimeout);
+            uint64_t transmissions = link->packagesSent + link->retransmits;
+            if (transmissions > 0) {
+                entry.packetLossPercent = 100.0 * static_cast<double>(link->retransmits) /
+                                          static_cast<double>(transmissions);
+            }
+            double seconds = chrono::duration<double>(now - link->firstSent).count();
+            if (link->packagesSent > 0 && seconds > 0.0) {
+                entry.throughputMbps = static_cast<double>(link->acknowledgedBytes) * 8.0 / seconds / 1e6;
+            }
+            entry.queuedMessages = static_cast<int>(link->queuedMessages);
+            entry.congestionWindow = static_cast<int>(link->congestionWindow);
+            entry.pacingRateMbps = link->pacingRate * 8.0 / 1e6;
+            entry.expiredMessages = link->expiredMessages;
+            entry.expiredReassemblies = link->expiredReassemblies;
+            entry.conflatedMessages = link->conflatedMessages;
+            entry.reorderedMessages = link->reorderedMessages;
+            entry.skippedMessages = link->skippedMessages;
         }
-    } else if (connections_.count(id)) {
-        stats.push_back({id, 12.0, 0.05, 6.0, 0});
+        stats.push_back(entry);
     }
     onStats(stats);
 }
@@ -882,8 +1154,26 @@ void EminentSdk::sendBinary(
     const vector<uint8_t>& data,
     Priority priority,
     bool requireAck,
-    function<void()> onDelivered
+    function<void()> onDelivered,
+    function<void(const string& reason)> onFailed
 ) {
+    sendBinary(id, data, priority, requireAck, chrono::milliseconds{0}, move(onDelivered), nullptr, move(onFailed));
+}
+
+void EminentSdk::sendBinary(
+    ConnectionId id,
+    const vector<uint8_t>& data,
+    Priority priority,
+    bool requireAck,
+    chrono::milliseconds ttl,
+    function<void()> onDelivered,
+    function<void()> onExpired,
+    function<void(const string& reason)> onFailed
+) {
+    if (ttl.count() < 0) {
+        throw runtime_error("sendBinary failed: negative time-to-live.");
+    }
+    auto deadline = ttl.count() > 0 ? chrono::steady_clock::now() + ttl : chrono::steady_clock::time_point{};
     lock_guard<recursive_mutex> lock(mutex_);
     if (!connections_.count(id)) {
         auto it = findConnection(id);
@@ -902,28 +1192,440 @@ void EminentSdk::sendBinary(
         throw runtime_error(string("sendBinary failed: ") + ex.what());
     }
 
-    // Encrypt binary data if encryption is enabled
-    vector<uint8_t> finalData = data;
+    // Store binary data in string (std::string can hold arbitrary bytes).
+    // Delta-encode, compress, then encrypt binary data if enabled
+    string payload(data.begin(), data.end());
+    bool delta = encodeDeltaIfEnabled(id, MessageFormat::VIDEO, requireAck, payload, onDelivered);
+    bool compressed = compressPayloadIfWorthIt(id, MessageFormat::VIDEO, payload);
     if (shouldEncrypt(MessageFormat::VIDEO)) {
-        finalData = encryptPayload(id, data);
+        vector<uint8_t> encrypted = encryptPayload(id, vector<uint8_t>(payload.begin(), payload.end()));
+        payload.assign(encrypted.begin(), encrypted.end());
     }
 
-    // Store binary data in string (std::string can hold arbitrary bytes)
-    string payload(finalData.begin(), finalData.end());
+    bool largeMessages = usesLargeMessages(id);
+    if (!largeMessages && payload.size() > validationConfig_.maxStandardMessageBytes()) {
+        throw runtime_error("sendBinary failed: message of " + to_string(payload.size()) +
+            " bytes needs large-message mode, which the peer did not negotiate.");
+    }
 
     MessageId mid = nextMessageId();
-    Message msg{ mid, id, payload, MessageFormat::VIDEO, priority, requireAck, onDelivered };
+    Message msg(mid, id, move(payload), MessageFormat::VIDEO, priority, requireAck, onDelivered);
+    msg.allowExtendedFragments = largeMessages;
+    msg.compressed = compressed;
+    msg.delta = delta;
+    msg.deadline = deadline;
+    msg.onExpired = move(onExpired);
+    msg.onFailed = move(onFailed);
+    msg.ordered = connections_[id].deliveryMode == DeliveryMode::ORDERED;
     try {
         validationConfig_.validateMessage(msg);
     } catch (const exception& ex) {
         throw runtime_error(string("sendBinary failed: ") + ex.what());
     }
-    outgoingQueue_.push(msg);
+    outgoingQueue_.push(move(msg));
 
     log(LogLevel::DEBUG, string("Queued binary message id=") + to_string(mid) +
         " connection=" + to_string(id) + " size=" + to_string(data.size()));
 }
 
+// ============================================================
+// Streams
+// ============================================================
+
+unique_ptr<StreamWriter> EminentSdk::openStream(ConnectionId id, size_t windowChunks) {
+    lock_guard<recursive_mutex> lock(mutex_);
+    auto it = findConnection(id);
+    if (it == connections_.end()) {
+        throw runtime_error("openStream failed: invalid connection ID.");
+    }
+    if (it->second.status == ConnectionStatus::PENDING) {
+        throw runtime_error("openStream failed: connection is still pending.");
+    }
+    if (!(it->second.capabilities & CAPABILITY_STREAMS)) {
+        throw runtime_error("openStream failed: peer did not negotiate streams.");
+    }
+
+    // One chunk per fragment, leaving room for the chunk header and crypto
+    size_t reserve = StreamWriter::HEADER_BYTES +
+        (shouldEncrypt(MessageFormat::STREAM) ? StreamWriter::ENCRYPTION_RESERVE_BYTES : 0);
+    size_t fragment = sessionManager_.getMaxPacketSize();
+    size_t chunkBytes = fragment > reserve ? fragment - reserve : 1;
+
+    StreamId streamId = nextStreamId_++;
+    log(LogLevel::INFO, string("Opened stream ") + to_string(streamId) + " on connection " +
+        to_string(it->second.id) + " chunk=" + to_string(chunkBytes) + " window=" + to_string(windowChunks));
+    return unique_ptr<StreamWriter>(new StreamWriter(
+        *this, it->second.id, streamId, it->second.defaultPriority, chunkBytes, windowChunks));
+}
+
+void EminentSdk::setOnStreamChunk(ConnectionId id, function<void(StreamId, const string&, bool)> handler) {
+    lock_guard<recursive_mutex> lock(mutex_);
+    auto it = findConnection(id);
+    if (it == connections_.end()) {
+        log(LogLevel::WARN, string("setOnStreamChunk: connection ") + to_string(id) + " not found");
+        return;
+    }
+    it->second.onStreamChunk = std::move(handler);
+}
+
+void EminentSdk::sendStreamChunk(ConnectionId id, string&& payload, Priority priority, function<void()> onDelivered) {
+    lock_guard<recursive_mutex> lock(mutex_);
+    auto it = findConnection(id);
+    if (it == connections_.end()) {
+        throw runtime_error("Stream write failed: connection closed.");
+    }
+
+    if (shouldEncrypt(MessageFormat::STREAM)) {
+        vector<uint8_t> encrypted = encryptPayload(id, vector<uint8_t>(payload.begin(), payload.end()));
+        payload.assign(encrypted.begin(), encrypted.end());
+    }
+
+    Message msg(nextMessageId(), id, move(payload), MessageFormat::STREAM, priority, true, std::move(onDelivered));
+    msg.allowExtendedFragments = usesLargeMessages(id);
+    outgoingQueue_.push(move(msg));
+}
+
+// Chunks may arrive out of order after retransmission; they are held until
+// the gap closes and handed up strictly in sequence.
+void EminentSdk::handleStreamMessage(const Message& msg) {
+    Message decMsg = decryptMessageIfNeeded(msg);
+
+    auto it = findConnection(decMsg.connId);
+    if (it == connections_.end()) {
+        log(LogLevel::WARN, string("Stream chunk for unknown connectionId=") + to_string(decMsg.connId));
+        return;
+    }
+
+    StreamWriter::ChunkHeader header;
+    if (!StreamWriter::decodeHeader(decMsg.payload, header)) {
+        log(LogLevel::WARN, "Dropping truncated stream chunk");
+        return;
+    }
+
+    auto& stream = inboundStreams_[it->second.id][header.streamId];
+    uint32_t ahead = header.sequence - stream.nextSequence;
+    if (header.sequence < stream.nextSequence || ahead > MAX_STREAM_REORDER_CHUNKS) {
+        log(LogLevel::DEBUG, string("Dropping stream ") + to_string(header.streamId) +
+            " chunk seq=" + to_string(header.sequence) + " (expected " + to_string(stream.nextSequence) + ")");
+        return;
+    }
+    stream.pending.emplace(header.sequence,
+        make_pair(decMsg.payload.substr(StreamWriter::HEADER_BYTES), (header.flags & StreamWriter::FLAG_END) != 0));
+
+    vector<pair<string, bool>> ready;
+    while (!stream.pending.empty() && stream.pending.begin()->first == stream.nextSequence) {
+        ready.push_back(std::move(stream.pending.begin()->second));
+        stream.pending.erase(stream.pending.begin());
+        ++stream.nextSequence;
+        if (ready.back().second) {
+            inboundStreams_[it->second.id].erase(header.streamId);
+            break;
+        }
+    }
+
+    // The handler may call back into the SDK, so stream state is settled first
+    auto handler = it->second.onStreamChunk;
+    if (!handler && !ready.empty()) {
+        log(LogLevel::WARN, string("No onStreamChunk callback for connection ") + to_string(it->second.id));
+        return;
+    }
+    for (auto& [data, finished] : ready) {
+        handler(header.streamId, data, finished);
+    }
+}
+
+// ============================================================
+// Telemetry
+// ============================================================
+
+void EminentSdk::sendSamples(
+    ConnectionId id,
+    ChannelId channel,
+    const vector<int64_t>& timestamps,
+    const vector<double>& values,
+    function<void()> onDelivered
+) {
+    if (timestamps.size() != values.size()) {
+        throw runtime_error("sendSamples failed: timestamps and values differ in length.");
+    }
+    if (channel < 0 || channel > 0xFFFF) {
+        throw runtime_error("sendSamples failed: channel out of range.");
+    }
+
+    lock_guard<recursive_mutex> lock(mutex_);
+    auto it = findConnection(id);
+    if (it == connections_.end()) {
+        throw runtime_error("sendSamples failed: invalid connection ID.");
+    }
+    if (it->second.status == ConnectionStatus::PENDING) {
+        throw runtime_error("sendSamples failed: connection is still pending.");
+    }
+    if (!(it->second.capabilities & CAPABILITY_TELEMETRY)) {
+        throw runtime_error("sendSamples failed: peer did not negotiate telemetry.");
+    }
+    if (timestamps.empty()) {
+        return;
+    }
+
+    size_t batches = (timestamps.size() + MAX_SAMPLES_PER_BATCH - 1) / MAX_SAMPLES_PER_BATCH;
+    auto remaining = make_shared<atomic<size_t>>(batches);
+    bool largeMessages = usesLargeMessages(it->second.id);
+    for (size_t first = 0; first < timestamps.size(); first += MAX_SAMPLES_PER_BATCH) {
+        size_t count = min(MAX_SAMPLES_PER_BATCH, timestamps.size() - first);
+        string payload(TELEMETRY_HEADER_BYTES, '\0');
+        payload[0] = static_cast<char>((channel >> 8) & 0xFF);
+        payload[1] = static_cast<char>(channel & 0xFF);
+        payload += TimeSeriesCodec::encode(timestamps.data() + first, values.data() + first, count);
+
+        if (shouldEncrypt(MessageFormat::TELEMETRY)) {
+            vector<uint8_t> encrypted = encryptPayload(it->second.id, vector<uint8_t>(payload.begin(), payload.end()));
+            payload.assign(encrypted.begin(), encrypted.end());
+        }
+
+        function<void()> batchDelivered;
+        if (onDelivered) {
+            batchDelivered = [remaining, onDelivered]() {
+                if (--*remaining == 0) {
+                    onDelivered();
+                }
+            };
+        }
+        Message msg(nextMessageId(), it->second.id, move(payload), MessageFormat::TELEMETRY,
+                    it->second.defaultPriority, true, std::move(batchDelivered));
+        msg.allowExtendedFragments = largeMessages;
+        outgoingQueue_.push(move(msg));
+    }
+
+    log(LogLevel::DEBUG, string("Queued ") + to_string(timestamps.size()) + " samples of channel " +
+        to_string(channel) + " in " + to_string(batches) + " batch(es) on connection " + to_string(it->second.id));
+}
+
+void EminentSdk::setOnSamples(ConnectionId id,
+                              function<void(ChannelId, const vector<int64_t>&, const vector<double>&)> handler) {
+    lock_guard<recursive_mutex> lock(mutex_);
+    auto it = findConnection(id);
+    if (it == connections_.end()) {
+        log(LogLevel::WARN, string("setOnSamples: connection ") + to_string(id) + " not found");
+        return;
+    }
+    it->second.onSamples = std::move(handler);
+}
+
+void EminentSdk::handleTelemetryMessage(const Message& msg) {
+    Message decMsg = decryptMessageIfNeeded(msg);
+
+    auto it = findConnection(decMsg.connId);
+    if (it == connections_.end()) {
+        log(LogLevel::WARN, string("Telemetry batch for unknown connectionId=") + to_string(decMsg.connId));
+        return;
+    }
+    if (decMsg.payload.size() < TELEMETRY_HEADER_BYTES) {
+        log(LogLevel::WARN, "Dropping truncated telemetry batch");
+        return;
+    }
+
+    ChannelId channel = (static_cast<uint8_t>(decMsg.payload[0]) << 8) | static_cast<uint8_t>(decMsg.payload[1]);
+    vector<int64_t> timestamps;
+    vector<double> values;
+    try {
+        TimeSeriesCodec::decode(decMsg.payload.data() + TELEMETRY_HEADER_BYTES,
+                                decMsg.payload.size() - TELEMETRY_HEADER_BYTES,
+                                MAX_SAMPLES_PER_BATCH, timestamps, values);
+    } catch (const exception& ex) {
+        log(LogLevel::WARN, string("Dropping telemetry batch: ") + ex.what());
+        return;
+    }
+
+    auto handler = it->second.onSamples;
+    if (!handler) {
+        log(LogLevel::WARN, string("No onSamples callback for connection ") + to_string(it->second.id));
+        return;
+    }
+    handler(channel, timestamps, values);
+}
+
+// ============================================================
+// Multicast groups
+// ============================================================
+
+void EminentSdk::joinGroup(ConnectionId groupId, function<void(DeviceId, const string&)> onMessage) {
+    lock_guard<recursive_mutex> lock(mutex_);
+    if (!initialized_) {
+        throw runtime_error("joinGroup failed: SDK not initialized.");
+    }
+    try {
+        validationConfig_.validateConnectionId(groupId);
+    } catch (const exception& ex) {
+        throw runtime_error(string("joinGroup failed: ") + ex.what());
+    }
+    if (findConnection(groupId) != connections_.end()) {
+        throw runtime_error("joinGroup failed: id " + to_string(groupId) + " is in use by a connection.");
+    }
+    if (groups_.count(groupId) > 0) {
+        throw runtime_error("joinGroup failed: already a member of group " + to_string(groupId) + ".");
+    }
+    groups_.emplace(groupId, GroupState{std::move(onMessage), GroupPublisher(deviceId_), {}, {}});
+    log(LogLevel::INFO, string("Joined group ") + to_string(groupId));
+}
+
+void EminentSdk::leaveGroup(ConnectionId groupId) {
+    lock_guard<recursive_mutex> lock(mutex_);
+    if (groups_.erase(groupId) == 0) {
+        log(LogLevel::WARN, string("leaveGroup: group ") + to_string(groupId) + " not joined");
+        return;
+    }
+    sessionManager_.purgeConnection(groupId);
+    log(LogLevel::INFO, string("Left group ") + to_string(groupId));
+}
+
+void EminentSdk::publish(ConnectionId groupId, const string& payload, Priority priority) {
+    lock_guard<recursive_mutex> lock(mutex_);
+    auto it = groups_.find(groupId);
+    if (it == groups_.end()) {
+        throw runtime_error("publish failed: not a member of group " + to_string(groupId) + ".");
+    }
+    try {
+        validationConfig_.validatePriority(priority);
+    } catch (const exception& ex) {
+        throw runtime_error(string("publish failed: ") + ex.what());
+    }
+
+    // Encrypted once for all subscribers; the record header stays readable
+    // so that NACKs and repairs need no key
+    string body = payload;
+    if (shouldEncrypt(MessageFormat::GROUP)) {
+        vector<uint8_t> encrypted = encryptPayload(groupId, vector<uint8_t>(body.begin(), body.end()));
+        body.assign(encrypted.begin(), encrypted.end());
+    }
+    // Group messages are never fragmented: publishers pick message ids
+    // independently, so fragments of two of them could be reassembled together
+    if (GroupRecord::HEADER_BYTES + body.size() > sessionManager_.getMaxPacketSize()) {
+        throw runtime_error("publish failed: " + to_string(payload.size()) + " bytes do not fit one fragment of " +
+                            to_string(sessionManager_.getMaxPacketSize()) + " bytes.");
+    }
+    GroupState& group = it->second;
+    queueGroupRecord(groupId, group.publisher.encodeData(body), priority);
+    ++group.stats.published;
+}
+
+GroupStats EminentSdk::getGroupStats(ConnectionId groupId) const {
+    lock_guard<recursive_mutex> lock(mutex_);
+    auto it = groups_.find(groupId);
+    if (it == groups_.end()) {
+        throw runtime_error("getGroupStats failed: not a member of group " + to_string(groupId) + ".");
+    }
+    GroupStats stats = it->second.stats;
+    for (const auto& [publisher, subscriber] : it->second.subscribers) {
+        stats.skipped += subscriber.skipped();
+    }
+    return stats;
+}
+
+// Unacknowledged: loss is repaired by the subscribers' NACKs instead
+void EminentSdk::queueGroupRecord(ConnectionId groupId, string&& record, Priority priority) {
+    Message msg{ nextMessageId(), groupId, move(record), MessageFormat::GROUP, priority, false, nullptr };
+    outgoingQueue_.push(move(msg));
+}
+
+void EminentSdk::handleGroupMessage(const Message& msg) {
+    auto it = groups_.find(msg.connId);
+    if (it == groups_.end()) {
+        log(LogLevel::DEBUG, string("Group record for group ") + to_string(msg.connId) + " not joined");
+        return;
+    }
+    GroupState& group = it->second;
+    GroupRecord record;
+    if (!GroupRecord::decode(msg.payload, record)) {
+        log(LogLevel::WARN, string("Dropping malformed group record in group ") + to_string(msg.connId));
+        return;
+    }
+    auto now = steady_clock::now();
+
+    if (record.kind == GroupRecord::KIND_NACK) {
+        if (record.publisher == deviceId_) {
+            // A repair resent within a NACK interval is still on its way to
+            // the other subscribers that asked for it
+            for (string& repair : group.publisher.repairs(record.sequence, record.count, now,
+                                                          sessionManager_.getNackInterval())) {
+                queueGroupRecord(msg.connId, move(repair), msg.priority);
+                ++group.stats.repairsSent;
+            }
+        } else {
+            auto sub = group.subscribers.find(record.publisher);
+            if (sub != group.subscribers.end()) {
+                sub->second.onNackSeen(record.sequence, record.count, now);
+            }
+        }
+        return;
+    }
+    if (record.publisher == deviceId_) {
+        return; // Own records come back over multicast loopback
+    }
+
+    GroupSubscriber& subscriber = group.subscribers[record.publisher];
+    vector<string> ready;
+    if (record.kind == GroupRecord::KIND_ANNOUNCE) {
+        subscriber.onAnnounce(record.sequence);
+    } else {
+        string body = msg.payload.substr(GroupRecord::HEADER_BYTES);
+        if (shouldEncrypt(MessageFormat::GROUP)) {
+            try {
+                vector<uint8_t> plain = decryptPayload(vector<uint8_t>(body.begin(), body.end()));
+                body.assign(plain.begin(), plain.end());
+            } catch (const exception& ex) {
+                log(LogLevel::WARN, string("Dropping group message: decryption failed: ") + ex.what());
+                return;
+            }
+        }
+        subscriber.onData(record.sequence, move(body), ready);
+    }
+    serviceGroupSubscriber(msg.connId, group, record.publisher, move(ready));
+}
+
+void EminentSdk::serviceGroupSubscriber(ConnectionId groupId, GroupState& group, DeviceId publisher,
+                                        vector<string>&& ready) {
+    GroupSubscriber& subscriber = group.subscribers[publisher];
+    for (const auto& [first, count] : subscriber.dueNacks(steady_clock::now(), sessionManager_.getNackInterval(),
+                                                          ready)) {
+        queueGroupRecord(groupId, GroupRecord::encodeNack(publisher, first, count), 0);
+        ++group.stats.nacksSent;
+    }
+    if (ready.empty()) {
+        return;
+    }
+    group.stats.delivered += ready.size();
+
+    // Copied: the handler may leave the group
+    auto handler = group.onMessage;
+    if (!handler) {
+        log(LogLevel::WARN, string("No onMessage callback for group ") + to_string(groupId));
+        return;
+    }
+    for (const string& payload : ready) {
+        handler(publisher, payload);
+    }
+}
+
+void EminentSdk::serviceGroups() {
+    auto now = steady_clock::now();
+    vector<pair<ConnectionId, DeviceId>> subscribers;
+    for (auto& [groupId, group] : groups_) {
+        if (auto announce = group.publisher.announceDue(now)) {
+            queueGroupRecord(groupId, move(*announce), 0);
+        }
+        for (const auto& [publisher, subscriber] : group.subscribers) {
+            subscribers.emplace_back(groupId, publisher);
+        }
+    }
+    // Looked up again each time, as a handler may have left the group
+    for (const auto& [groupId, publisher] : subscribers) {
+        auto it = groups_.find(groupId);
+        if (it != groups_.end()) {
+            serviceGroupSubscriber(groupId, it->second, publisher, {});
+        }
+    }
+}
+
 // ============================================================
 // setOnDisconnected
 // ============================================================
@@ -972,10 +1674,19 @@ vector<DeviceId> EminentSdk::getConnectedDeviceIds() const {
 void EminentSdk::sendDisconnectMessage(ConnectionId id) {
     try {
         MessageId mid = nextMessageId();
-        ostringstream oss;
-        oss << "{\"deviceId\": " << deviceId_ << ", \"connId\": " << id << "}";
-        string payload = oss.str();
-        Message msg{mid, id, payload, MessageFormat::DISCONNECT, 0, false, nullptr};
+        string payload;
+        if (usesBinaryControl(id)) {
+            ControlMessageCodec::ControlMessage disconnectMsg;
+            disconnectMsg.kind = ControlMessageCodec::Kind::DISCONNECT;
+            disconnectMsg.deviceId = deviceId_;
+            disconnectMsg.connId = id;
+            payload = ControlMessageCodec::encode(disconnectMsg);
+        } else {
+            ostringstream oss;
+            oss << "{\"deviceId\": " << deviceId_ << ", \"connId\": " << id << "}";
+            payload = oss.str();
+        }
+        Message msg{mid, id, move(payload), MessageFormat::DISCONNECT, 0, false, nullptr};
         validationConfig_.validateMessage(msg);
         outgoingQueue_.push(msg);
         log(LogLevel::INFO, string("Sent DISCONNECT for connection ") + to_string(id));
@@ -999,10 +1710,17 @@ void EminentSdk::handleDisconnectMessage(const Message& msg) {
         it->second.onDisconnected();
     }
 
-    // Remove heartbeat state
+    // Remove heartbeat and inbound stream state
     heartbeats_.erase(it->second.id);
+    inboundStreams_.erase(it->second.id);
+    deltaSenders_.erase(it->second.id);
+    deltaReceivers_.erase(it->second.id);
 
     // Remove connection
+    transportLayer_.setHeaderCompression(it->second.id, false);
+    disableForwardErrorCorrection(it->second.id);
+    sessionManager_.purgeConnection(it->second.id);
+    physicalLayer_->unbindConnection(it->second.id);
     connections_.erase(it);
 }
 
@@ -1018,6 +1736,7 @@ void EminentSdk::heartbeatLoop() {
 
             // Check for handshake timeouts
             checkHandshakeTimeouts();
+            serviceGroups();
 
             for (auto& [connId, hb] : heartbeats_) {
                 // Only send heartbeats for ACTIVE connections
@@ -1060,11 +1779,15 @@ void EminentSdk::heartbeatLoop() {
 void EminentSdk::sendHeartbeat(ConnectionId connId) {
     try {
         MessageId mid = nextMessageId();
-        ostringstream oss;
-        oss << "{\"deviceId\": " << deviceId_ << ", \"ts\": " 
-            << duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count() << "}";
-        string payload = oss.str();
-        Message msg{mid, connId, payload, MessageFormat::HEARTBEAT, 0, false, nullptr};
+        string payload;
+        if (usesBinaryControl(connId)) {
+            payload = ControlMessageCodec::encodeHeartbeat(ControlMessageCodec::Kind::HEARTBEAT, deviceId_, steadyNowMs());
+        } else {
+            ostringstream oss;
+            oss << "{\"deviceId\": " << deviceId_ << ", \"ts\": " << steadyNowMs() << "}";
+            payload = oss.str();
+        }
+        Message msg{mid, connId, move(payload), MessageFormat::HEARTBEAT, 0, false, nullptr};
         validationConfig_.validateMessage(msg);
         outgoingQueue_.push(msg);
         log(LogLevel::DEBUG, string("Sent HEARTBEAT on connection ") + to_string(connId));
@@ -1078,11 +1801,18 @@ void EminentSdk::handleHeartbeat(const Message& msg) {
     log(LogLevel::DEBUG, string("Received HEARTBEAT on connection ") + to_string(msg.connId));
     try {
         MessageId mid = nextMessageId();
-        ostringstream oss;
-        oss << "{\"deviceId\": " << deviceId_ << ", \"ts\": "
-            << duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count() << "}";
-        string payload = oss.str();
-        Message ack{mid, msg.connId, payload, MessageFormat::HEARTBEAT_ACK, 0, false, nullptr};
+        string payload;
+        // Answer in the encoding the heartbeat arrived in; a binary ACK echoes the sender's timestamp.
+        if (ControlMessageCodec::isBinary(msg.payload)) {
+            auto heartbeat = ControlMessageCodec::decode(msg.payload);
+            int64_t ts = heartbeat.has_value() ? heartbeat->timestampMs : steadyNowMs();
+            payload = ControlMessageCodec::encodeHeartbeat(ControlMessageCodec::Kind::HEARTBEAT_ACK, deviceId_, ts);
+        } else {
+            ostringstream oss;
+            oss << "{\"deviceId\": " << deviceId_ << ", \"ts\": " << steadyNowMs() << "}";
+            payload = oss.str();
+        }
+        Message ack{mid, msg.connId, move(payload), MessageFormat::HEARTBEAT_ACK, 0, false, nullptr};
         validationConfig_.validateMessage(ack);
         outgoingQueue_.push(ack);
         log(LogLevel::DEBUG, string("Sent HEARTBEAT_ACK on connection ") + to_string(msg.connId));
@@ -1133,12 +1863,26 @@ void EminentSdk::shutdown() {
             connections_[cid].onDisconnected();
         }
     }
+    for (const auto& [cid, conn] : connections_) {
+        transportLayer_.setHeaderCompression(conn.id, false);
+        disableForwardErrorCorrection(conn.id);
+        sessionManager_.purgeConnection(conn.id);
+    }
     connections_.clear();
     heartbeats_.clear();
+    inboundStreams_.clear();
+    deltaSenders_.clear();
+    deltaReceivers_.clear();
     pendingHandshakes_.clear();
+    for (const auto& [groupId, group] : groups_) {
+        sessionManager_.purgeConnection(groupId);
+    }
+    groups_.clear();
 
     // Allow time for disconnect messages to be sent
     this_thread::sleep_for(50ms);
+    // The physical layer is destroyed before the session manager
+    sessionManager_.setOnPacingRateChanged(nullptr);
 
     log(LogLevel::INFO, "Shutdown complete");
 }
@@ -1174,8 +1918,10 @@ void EminentSdk::checkHandshakeTimeouts() {
             auto failCb = it->onFailure;
             ConnectionId cid = it->initialCid;
 
-            // Cleanup heartbeat state
+            // Cleanup heartbeat state and the unanswered handshake retransmits
             heartbeats_.erase(cid);
+            sessionManager_.purgeConnection(cid);
+            physicalLayer_->unbindConnection(cid);
             // Remove the pending connection
             connections_.erase(connIt);
 
@@ -1224,6 +1970,69 @@ chrono::milliseconds EminentSdk::getRetransmitInterval() const {
     return sessionManager_.getRetransmitInterval();
 }
 
+void EminentSdk::setRetransmitTimeoutBounds(chrono::milliseconds minTimeout, chrono::milliseconds maxTimeout) {
+    sessionManager_.setRetransmitTimeoutBounds(minTimeout, maxTimeout);
+}
+
+void EminentSdk::setNackInterval(chrono::milliseconds interval) {
+    sessionManager_.setNackInterval(interval);
+}
+
+void EminentSdk::setReassemblyLimits(size_t maxBytes, chrono::milliseconds idleTimeout) {
+    sessionManager_.setReassemblyLimits(maxBytes, idleTimeout);
+}
+
+// ============================================================
+// Path MTU / fragment size
+// ============================================================
+
+void EminentSdk::setPathMtu(size_t mtu) {
+    auto* udpLayer = dynamic_cast<PhysicalLayerUdp*>(physicalLayer_.get());
+    if (!udpLayer) {
+        log(LogLevel::WARN, "setPathMtu ignored: physical layer has no path MTU");
+        return;
+    }
+    udpLayer->setPathMtu(mtu);
+}
+
+size_t EminentSdk::getMaxFragmentPayload() const {
+    return sessionManager_.getMaxPacketSize();
+}
+
+void EminentSdk::setLargeMessageWindow(size_t packages) {
+    sessionManager_.setLargeMessageWindow(packages);
+}
+
+void EminentSdk::setFlowWindow(size_t packages) {
+    sessionManager_.setFlowWindow(packages);
+}
+
+void EminentSdk::setReceiveWindow(size_t packages) {
+    sessionManager_.setReceiveWindow(packages);
+}
+
+void EminentSdk::setCongestionControl(CongestionControllerFactory factory) {
+    sessionManager_.setCongestionControl(move(factory));
+}
+
+// Sizes fragments so that header + payload + CRC fits in one link-layer
+// packet. Without a link limit fragments use the full payload length field.
+void EminentSdk::applyLinkMtu(size_t maxFrameBytes) {
+    size_t maxPayload = validationConfig_.maxPayloadLengthBytes();
+    size_t overhead = validationConfig_.transportHeaderBytes() + ValidationConfig::CRC_FIELD_BYTES +
+        codingModule_.frameOverheadBytes();
+    if (maxFrameBytes == 0) {
+        sessionManager_.setMaxPacketSize(maxPayload);
+        return;
+    }
+    if (maxFrameBytes <= overhead) {
+        log(LogLevel::WARN, string("Link frame limit ") + to_string(maxFrameBytes) +
+            " leaves no room for payload; keeping fragment size " + to_string(sessionManager_.getMaxPacketSize()));
+        return;
+    }
+    sessionManager_.setMaxPacketSize(min(maxFrameBytes - overhead, maxPayload));
+}
+
 // ============================================================
 // Encryption API
 // ============================================================
@@ -1288,7 +2097,8 @@ uint8_t EminentSdk::getKeyForConnection(ConnectionId connId) const {
 
 bool EminentSdk::shouldEncrypt(MessageFormat format) const {
     if (!encryptionEnabled_ || !cryptoModule_) return false;
-    return (format == MessageFormat::JSON || format == MessageFormat::VIDEO);
+    return (format == MessageFormat::JSON || format == MessageFormat::VIDEO || format == MessageFormat::STREAM ||
+            format == MessageFormat::TELEMETRY || format == MessageFormat::GROUP);
 }
 
 vector<uint8_t> EminentSdk::encryptPayload(ConnectionId connId, const vector<uint8_t>& plaintext) {
@@ -1307,6 +2117,234 @@ vector<uint8_t> EminentSdk::decryptPayload(const vector<uint8_t>& ciphertext) {
     return cryptoModule_->decrypt(ciphertext);
 }
 
+// ============================================================
+// Compression API
+// ============================================================
+
+void EminentSdk::setCompressionCodec(shared_ptr<ICompressionCodec> codec) {
+    lock_guard<recursive_mutex> lock(mutex_);
+    compressionCodec_ = std::move(codec);
+    log(LogLevel::INFO, "Compression codec set");
+}
+
+void EminentSdk::setCompressionThreshold(size_t bytes) {
+    lock_guard<recursive_mutex> lock(mutex_);
+    compressionThreshold_ = bytes;
+    log(LogLevel::INFO, string("Compression threshold set to ") + to_string(bytes) + " bytes");
+}
+
+void EminentSdk::enableCompression(bool enabled) {
+    lock_guard<recursive_mutex> lock(mutex_);
+    compressionEnabled_ = enabled;
+    log(LogLevel::INFO, string("Compression ") + (enabled ? "enabled" : "disabled"));
+}
+
+bool EminentSdk::isCompressionEnabled() const {
+    lock_guard<recursive_mutex> lock(mutex_);
+    return compressionEnabled_;
+}
+
+bool EminentSdk::compressPayloadIfWorthIt(ConnectionId connId, MessageFormat format, string& payload) {
+    if (!compressionEnabled_ || !compressionCodec_ || payload.size() < compressionThreshold_) {
+        return false;
+    }
+    if (format != MessageFormat::JSON && format != MessageFormat::VIDEO) {
+        return false;
+    }
+    auto it = findConnection(connId);
+    if (it == connections_.end() || !(it->second.capabilities & CAPABILITY_COMPRESSION)) {
+        return false;
+    }
+    string compressed = compressionCodec_->compress(payload.data(), payload.size());
+    if (compressed.size() >= payload.size()) {
+        return false;
+    }
+    payload = std::move(compressed);
+    return true;
+}
+
+// Returns false when the message has to be dropped
+bool EminentSdk::decompressMessageIfNeeded(Message& msg) {
+    if (!msg.compressed) {
+        return true;
+    }
+    if (!compressionCodec_) {
+        log(LogLevel::WARN, "Compressed message received but no codec is set - dropping");
+        return false;
+    }
+    try {
+        msg.payload = compressionCodec_->decompress(msg.payload, maxInboundMessageBytes(msg.connId));
+        msg.compressed = false;
+        return true;
+    } catch (const exception& ex) {
+        log(LogLevel::WARN, string("Decompression failed: ") + ex.what() + " - dropping message");
+        return false;
+    }
+}
+
+size_t EminentSdk::maxInboundMessageBytes(ConnectionId connId) {
+    return usesLargeMessages(connId) ? numeric_limits<uint32_t>::max() : validationConfig_.maxStandardMessageBytes();
+}
+
+// ============================================================
+// Delivery order
+// ============================================================
+
+void EminentSdk::setDeliveryMode(ConnectionId id, DeliveryMode mode) {
+    lock_guard<recursive_mutex> lock(mutex_);
+    auto it = findConnection(id);
+    if (it == connections_.end()) {
+        throw runtime_error("setDeliveryMode failed: invalid connection ID.");
+    }
+    if (mode == DeliveryMode::ORDERED && !(it->second.capabilities & CAPABILITY_ORDERED)) {
+        throw runtime_error("setDeliveryMode failed: peer did not negotiate ordered delivery.");
+    }
+    it->second.deliveryMode = mode;
+    log(LogLevel::INFO, string("Connection ") + to_string(it->second.id) + " delivery mode " +
+        (mode == DeliveryMode::ORDERED ? "ordered" : "unordered"));
+}
+
+// ============================================================
+// Delta encoding
+// ============================================================
+
+void EminentSdk::setDeltaEncoding(ConnectionId id, bool enabled) {
+    lock_guard<recursive_mutex> lock(mutex_);
+    auto it = findConnection(id);
+    if (it == connections_.end()) {
+        throw runtime_error("setDeltaEncoding failed: invalid connection ID.");
+    }
+    if (!enabled) {
+        deltaSenders_.erase(it->second.id);
+    } else if (!(it->second.capabilities & CAPABILITY_DELTA)) {
+        throw runtime_error("setDeltaEncoding failed: peer did not negotiate delta mode.");
+    } else {
+        deltaSenders_[it->second.id];
+    }
+    log(LogLevel::INFO, string("Delta encoding ") + (enabled ? "enabled" : "disabled") +
+        " on connection " + to_string(it->second.id));
+}
+
+bool EminentSdk::encodeDeltaIfEnabled(ConnectionId connId, MessageFormat format, bool requireAck,
+                                      string& payload, function<void()>& onDelivered) {
+    if (format != MessageFormat::JSON && format != MessageFormat::VIDEO) {
+        return false;
+    }
+    auto it = deltaSenders_.find(connId);
+    if (it == deltaSenders_.end()) {
+        return false;
+    }
+    auto& sender = it->second[format];
+    if (!sender) {
+        sender = make_shared<DeltaSender>();
+    }
+
+    uint32_t sequence = 0;
+    payload = sender->encode(payload, requireAck, sequence);
+    if (requireAck) {
+        onDelivered = [sender, sequence, userCallback = std::move(onDelivered)]() {
+            sender->onAcked(sequence);
+            if (userCallback) {
+                userCallback();
+            }
+        };
+    }
+    return true;
+}
+
+// Returns false when the message has to be dropped
+bool EminentSdk::decodeDeltaIfNeeded(Message& msg) {
+    if (!msg.delta) {
+        return true;
+    }
+    auto it = findConnection(msg.connId);
+    if (it == connections_.end()) {
+        log(LogLevel::WARN, string("Delta record for unknown connectionId=") + to_string(msg.connId));
+        return false;
+    }
+    ConnectionId connId = it->second.id;
+    if (DeltaReceiver::isResync(msg.payload)) {
+        handleDeltaResync(connId, msg.format, DeltaReceiver::resyncSequence(msg.payload));
+        return false;
+    }
+    string payload;
+    auto& receiver = deltaReceivers_[connId][msg.format];
+    if (!receiver.decode(msg.payload, payload, maxInboundMessageBytes(msg.connId))) {
+        log(LogLevel::WARN, string("Delta record on connection ") + to_string(connId) +
+            " is malformed or its base is unknown - dropping");
+        string request;
+        if (receiver.takeResyncRequest(request)) {
+            sendDeltaResync(connId, msg.format, move(request));
+        }
+        return false;
+    }
+    msg.payload = std::move(payload);
+    msg.delta = false;
+    return true;
+}
+
+// The RESYNC record bypasses delta encoding and compression; it is encrypted
+// like any other payload of its format.
+void EminentSdk::sendDeltaResync(ConnectionId connId, MessageFormat format, string record) {
+    try {
+        if (shouldEncrypt(format)) {
+            vector<uint8_t> encrypted = encryptPayload(connId, vector<uint8_t>(record.begin(), record.end()));
+            record.assign(encrypted.begin(), encrypted.end());
+        }
+        Message request(nextMessageId(), connId, move(record), format, connections_[connId].defaultPriority, true);
+        request.delta = true;
+        validationConfig_.validateMessage(request);
+        outgoingQueue_.push(move(request));
+        log(LogLevel::INFO, string("Requested a delta snapshot on connection ") + to_string(connId));
+    } catch (const exception& ex) {
+        log(LogLevel::WARN, string("Failed to request a delta snapshot: ") + ex.what());
+    }
+}
+
+void EminentSdk::handleDeltaResync(ConnectionId connId, MessageFormat format, uint32_t failedSequence) {
+    auto it = deltaSenders_.find(connId);
+    if (it == deltaSenders_.end() || !it->second.count(format) || !it->second[format]) {
+        return;
+    }
+    string latest;
+    if (!it->second[format]->resync(failedSequence, latest)) {
+        return;
+    }
+    log(LogLevel::INFO, string("Peer lost a delta base on connection ") + to_string(connId) +
+        " - re-sending the latest payload as a snapshot");
+    try {
+        queueSend(connId, latest, format, connections_[connId].defaultPriority, true, chrono::milliseconds{0},
+                  string(), nullptr, nullptr, nullptr, nullopt);
+    } catch (const exception& ex) {
+        log(LogLevel::WARN, string("Failed to re-send delta snapshot: ") + ex.what());
+    }
+}
+
+// ============================================================
+// Forward error correction
+// ============================================================
+
+void EminentSdk::setForwardErrorCorrection(ConnectionId id, const FecConfig& config) {
+    lock_guard<recursive_mutex> lock(mutex_);
+    auto it = findConnection(id);
+    if (it == connections_.end()) {
+        throw runtime_error("setForwardErrorCorrection failed: invalid connection ID.");
+    }
+    if (config.scheme != FecScheme::NONE && !(it->second.capabilities & CAPABILITY_FEC)) {
+        throw runtime_error("setForwardErrorCorrection failed: peer did not negotiate FEC.");
+    }
+    codingModule_.setForwardErrorCorrection(it->second.id, config);
+    applyLinkMtu(physicalLayer_->maxFrameBytesOnLink());
+}
+
+void EminentSdk::disableForwardErrorCorrection(ConnectionId id) {
+    size_t overheadBefore = codingModule_.frameOverheadBytes();
+    codingModule_.setForwardErrorCorrection(id, FecConfig{});
+    if (physicalLayer_ && codingModule_.frameOverheadBytes() != overheadBefore) {
+        applyLinkMtu(physicalLayer_->maxFrameBytesOnLink());
+    }
+}
+
 // ============================================================
 // Transport error callback
 // ============================================================
@@ -1316,6 +2354,24 @@ void EminentSdk::setOnTransportError(function<void(const string&)> handler) {
     log(LogLevel::INFO, "Transport error handler registered");
 }
 
+// ============================================================
+// Control plane encoding helpers
+// ============================================================
+
+bool EminentSdk::usesBinaryControl(ConnectionId id) {
+    auto it = findConnection(id);
+    return it != connections_.end() && (it->second.capabilities & CAPABILITY_BINARY_CONTROL);
+}
+
+bool EminentSdk::usesLargeMessages(ConnectionId id) {
+    auto it = findConnection(id);
+    return it != connections_.end() && (it->second.capabilities & CAPABILITY_LARGE_MESSAGES);
+}
+
+int64_t EminentSdk::steadyNowMs() {
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
 // ============================================================
 // findConnection helper
 // ============================================================
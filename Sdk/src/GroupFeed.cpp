@@ -0,0 +1,225 @@
+#include "GroupFeed.hpp"
+
+using namespace std;
+using namespace chrono;
+
+static void putU32(string& out, uint32_t value) {
+    out.push_back(static_cast<char>((value >> 24) & 0xFF));
+    out.push_back(static_cast<char>((value >> 16) & 0xFF));
+    out.push_back(static_cast<char>((value >> 8) & 0xFF));
+    out.push_back(static_cast<char>(value & 0xFF));
+}
+
+static uint32_t getU32(const string& in, size_t offset) {
+    return (static_cast<uint32_t>(static_cast<uint8_t>(in[offset])) << 24) |
+           (static_cast<uint32_t>(static_cast<uint8_t>(in[offset + 1])) << 16) |
+           (static_cast<uint32_t>(static_cast<uint8_t>(in[offset + 2])) << 8) |
+           static_cast<uint32_t>(static_cast<uint8_t>(in[offset + 3]));
+}
+
+// Sequence numbers wrap; compare through the signed distance
+static bool sequenceBefore(uint32_t a, uint32_t b) {
+    return static_cast<int32_t>(a - b) < 0;
+}
+
+// ============================================================
+// GroupRecord
+// ============================================================
+
+string GroupRecord::encode(uint8_t kind, DeviceId publisher, uint32_t sequence) {
+    string record;
+    record.push_back(static_cast<char>(kind));
+    putU32(record, static_cast<uint32_t>(publisher));
+    putU32(record, sequence);
+    return record;
+}
+
+string GroupRecord::encodeNack(DeviceId publisher, uint32_t firstSequence, uint16_t count) {
+    string record = encode(KIND_NACK, publisher, firstSequence);
+    record.push_back(static_cast<char>((count >> 8) & 0xFF));
+    record.push_back(static_cast<char>(count & 0xFF));
+    return record;
+}
+
+bool GroupRecord::decode(const string& record, GroupRecord& out) {
+    if (record.size() < HEADER_BYTES) {
+        return false;
+    }
+    out.kind = static_cast<uint8_t>(record[0]);
+    out.publisher = static_cast<DeviceId>(getU32(record, 1));
+    out.sequence = getU32(record, 5);
+    out.count = 0;
+    switch (out.kind) {
+        case KIND_DATA:
+            return true;
+        case KIND_ANNOUNCE:
+            return record.size() == HEADER_BYTES;
+        case KIND_NACK:
+            if (record.size() != NACK_BYTES) {
+                return false;
+            }
+            out.count = static_cast<uint16_t>((static_cast<uint8_t>(record[HEADER_BYTES]) << 8) |
+                                              static_cast<uint8_t>(record[HEADER_BYTES + 1]));
+            return out.count > 0;
+        default:
+            return false;
+    }
+}
+
+// ============================================================
+// GroupPublisher
+// ============================================================
+
+string GroupPublisher::encodeData(const string& payload) {
+    uint32_t sequence = nextSequence_++;
+    string record = GroupRecord::encode(GroupRecord::KIND_DATA, self_, sequence);
+    record += payload;
+    history_.push_back(Entry{sequence, record});
+    if (history_.size() > HISTORY_SIZE) {
+        history_.pop_front();
+    }
+    announced_ = false;
+    return record;
+}
+
+vector<string> GroupPublisher::repairs(uint32_t first, uint16_t count, steady_clock::time_point now,
+                                       milliseconds holdoff) {
+    vector<string> records;
+    if (history_.empty()) {
+        return records;
+    }
+    // History holds consecutive sequences, so an entry is found by offset
+    uint32_t oldest = history_.front().sequence;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t offset = first + i - oldest;
+        if (sequenceBefore(first + i, oldest) || offset >= history_.size()) {
+            continue;
+        }
+        Entry& entry = history_[offset];
+        if (entry.lastRepair != steady_clock::time_point{} && now - entry.lastRepair < holdoff) {
+            continue;
+        }
+        entry.lastRepair = now;
+        records.push_back(entry.record);
+    }
+    return records;
+}
+
+optional<string> GroupPublisher::announceDue(steady_clock::time_point now) {
+    if (history_.empty() || (announced_ && now - lastAnnounce_ < ANNOUNCE_INTERVAL)) {
+        return nullopt;
+    }
+    announced_ = true;
+    lastAnnounce_ = now;
+    return GroupRecord::encode(GroupRecord::KIND_ANNOUNCE, self_, nextSequence_ - 1);
+}
+
+// ============================================================
+// GroupSubscriber
+// ============================================================
+
+void GroupSubscriber::onData(uint32_t sequence, string&& payload, vector<string>& ready) {
+    if (!started_) {
+        started_ = true;
+        next_ = sequence;
+        end_ = sequence;
+    }
+    if (sequenceBefore(sequence, next_) || held_.count(sequence) > 0) {
+        return;
+    }
+    if (sequence - next_ >= MAX_REORDER) {
+        // Too far ahead to wait for the gap: hand up what is held and
+        // start over at this message
+        for (auto& [held, heldPayload] : held_) {
+            ready.push_back(move(heldPayload));
+        }
+        skipped_ += (sequence - next_) - held_.size() - abandoned_.size();
+        held_.clear();
+        missing_.clear();
+        abandoned_.clear();
+        next_ = sequence;
+        end_ = sequence;
+    }
+    markMissingUpTo(sequence);
+    if (!sequenceBefore(sequence, end_)) {
+        end_ = sequence + 1;
+    }
+    missing_.erase(sequence);
+    held_.emplace(sequence, move(payload));
+    release(ready);
+}
+
+void GroupSubscriber::onAnnounce(uint32_t lastSequence) {
+    if (!started_) {
+        // Joined after these were published: nothing to recover
+        started_ = true;
+        next_ = lastSequence + 1;
+        end_ = next_;
+        return;
+    }
+    if (lastSequence - next_ >= MAX_REORDER && !sequenceBefore(lastSequence, next_)) {
+        return;
+    }
+    markMissingUpTo(lastSequence + 1);
+}
+
+void GroupSubscriber::onNackSeen(uint32_t first, uint16_t count, steady_clock::time_point now) {
+    for (uint32_t i = 0; i < count; ++i) {
+        auto it = missing_.find(first + i);
+        if (it != missing_.end()) {
+            it->second.lastNack = now;
+        }
+    }
+}
+
+vector<pair<uint32_t, uint16_t>> GroupSubscriber::dueNacks(steady_clock::time_point now, milliseconds interval,
+                                                           vector<string>& ready) {
+    vector<pair<uint32_t, uint16_t>> ranges;
+    for (auto it = missing_.begin(); it != missing_.end();) {
+        Gap& gap = it->second;
+        if (gap.lastNack != steady_clock::time_point{} && now - gap.lastNack < interval) {
+            ++it;
+            continue;
+        }
+        if (interval.count() == 0 || gap.attempts >= MAX_NACK_ATTEMPTS) {
+            abandoned_.insert(it->first);
+            ++skipped_;
+            it = missing_.erase(it);
+            continue;
+        }
+        ++gap.attempts;
+        gap.lastNack = now;
+        if (!ranges.empty() && ranges.back().first + ranges.back().second == it->first &&
+            ranges.back().second < UINT16_MAX) {
+            ++ranges.back().second;
+        } else {
+            ranges.emplace_back(it->first, 1);
+        }
+        ++it;
+    }
+    release(ready);
+    return ranges;
+}
+
+// Sequences between the highest known one and `end` were lost on the way
+void GroupSubscriber::markMissingUpTo(uint32_t end) {
+    while (sequenceBefore(end_, end)) {
+        if (held_.count(end_) == 0) {
+            missing_.emplace(end_, Gap{});
+        }
+        ++end_;
+    }
+}
+
+void GroupSubscriber::release(vector<string>& ready) {
+    while (true) {
+        auto held = held_.find(next_);
+        if (held != held_.end()) {
+            ready.push_back(move(held->second));
+            held_.erase(held);
+        } else if (abandoned_.erase(next_) == 0) {
+            break;
+        }
+        ++next_;
+    }
+}
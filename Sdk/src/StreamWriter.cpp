@@ -0,0 +1,130 @@
+#include "StreamWriter.hpp"
+#include "EminentSdk.hpp"
+
+#include <algorithm>
+
+using namespace std;
+
+StreamWriter::StreamWriter(EminentSdk& sdk, ConnectionId connId, StreamId streamId,
+                           Priority priority, size_t chunkBytes, size_t windowChunks)
+    : sdk_(sdk),
+      connId_(connId),
+      streamId_(streamId),
+      priority_(priority),
+      chunkBytes_(max<size_t>(chunkBytes, 1)),
+      windowChunks_(max<size_t>(windowChunks, 1)),
+      window_(make_shared<Window>()) {
+    pending_.reserve(chunkBytes_);
+}
+
+StreamWriter::~StreamWriter() {
+    if (!open_) {
+        return;
+    }
+    // Best effort: terminate the stream without waiting for ACKs
+    try {
+        sendChunk(true, chrono::milliseconds{0});
+    } catch (...) {
+    }
+    open_ = false;
+}
+
+bool StreamWriter::write(const vector<uint8_t>& data, chrono::milliseconds timeout) {
+    return write(data.data(), data.size(), timeout);
+}
+
+bool StreamWriter::write(const uint8_t* data, size_t size, chrono::milliseconds timeout) {
+    if (!open_) {
+        return false;
+    }
+    size_t offset = 0;
+    while (offset < size) {
+        size_t take = min(chunkBytes_ - pending_.size(), size - offset);
+        pending_.append(reinterpret_cast<const char*>(data) + offset, take);
+        offset += take;
+        bytesWritten_ += take;
+        if (pending_.size() == chunkBytes_ && !sendChunk(false, timeout)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool StreamWriter::close(chrono::milliseconds timeout) {
+    if (!open_) {
+        return false;
+    }
+    open_ = false;
+    if (!sendChunk(true, timeout)) {
+        return false;
+    }
+    return waitForWindow(0, timeout);
+}
+
+bool StreamWriter::sendChunk(bool end, chrono::milliseconds timeout) {
+    if (!waitForWindow(windowChunks_ - 1, timeout)) {
+        return false;
+    }
+
+    ChunkHeader header;
+    header.streamId = streamId_;
+    header.sequence = nextSequence_;
+    header.flags = end ? FLAG_END : 0;
+    string payload = encodeHeader(header);
+    payload += pending_;
+
+    {
+        lock_guard<mutex> lock(window_->guard);
+        ++window_->inFlight;
+    }
+    try {
+        sdk_.sendStreamChunk(connId_, move(payload), priority_,
+            [window = window_]() {
+                {
+                    lock_guard<mutex> lock(window->guard);
+                    --window->inFlight;
+                }
+                window->cv.notify_all();
+            });
+    } catch (...) {
+        lock_guard<mutex> lock(window_->guard);
+        --window_->inFlight;
+        throw;
+    }
+
+    ++nextSequence_;
+    pending_.clear();
+    return true;
+}
+
+bool StreamWriter::waitForWindow(size_t maxInFlight, chrono::milliseconds timeout) {
+    unique_lock<mutex> lock(window_->guard);
+    return window_->cv.wait_for(lock, timeout, [&]() { return window_->inFlight <= maxInFlight; });
+}
+
+string StreamWriter::encodeHeader(const ChunkHeader& header) {
+    string out(HEADER_BYTES, '\0');
+    uint32_t streamId = static_cast<uint32_t>(header.streamId);
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<char>((streamId >> (24 - 8 * i)) & 0xFF);
+        out[4 + i] = static_cast<char>((header.sequence >> (24 - 8 * i)) & 0xFF);
+    }
+    out[8] = static_cast<char>(header.flags);
+    return out;
+}
+
+bool StreamWriter::decodeHeader(const string& payload, ChunkHeader& out) {
+    if (payload.size() < HEADER_BYTES) {
+        return false;
+    }
+    uint32_t streamId = 0;
+    uint32_t sequence = 0;
+    for (int i = 0; i < 4; ++i) {
+        streamId = (streamId << 8) | static_cast<uint8_t>(payload[i]);
+        sequence = (sequence << 8) | static_cast<uint8_t>(payload[4 + i]);
+    }
+    out.streamId = static_cast<StreamId>(streamId);
+    out.sequence = sequence;
+    out.flags = static_cast<uint8_t>(payload[8]);
+    return true;
+}
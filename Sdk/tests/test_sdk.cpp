@@ -1,9 +1,12 @@
 #include "EminentSdk.hpp"
 #include "PhysicalLayerInMemory.hpp"
 #include "ValidationConfig.hpp"
+#include "ControlMessageCodec.hpp"
+#include "TransportLayer.hpp"
 #include <gtest/gtest.h>
 #include <atomic>
 #include <chrono>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <vector>
@@ -452,6 +455,450 @@ TEST(SdkConfig, RetransmissionConfig) {
     sdk.shutdown();
 }
 
+// ============================================================
+// Test: Streams
+// ============================================================
+TEST(SdkStream, ChunkHeaderRoundtrip) {
+    StreamWriter::ChunkHeader header;
+    header.streamId = 7;
+    header.sequence = 0x01020304;
+    header.flags = StreamWriter::FLAG_END;
+    string encoded = StreamWriter::encodeHeader(header) + "data";
+
+    StreamWriter::ChunkHeader decoded;
+    ASSERT_TRUE(StreamWriter::decodeHeader(encoded, decoded));
+    EXPECT_EQ(decoded.streamId, 7);
+    EXPECT_EQ(decoded.sequence, 0x01020304u);
+    EXPECT_EQ(decoded.flags, StreamWriter::FLAG_END);
+    EXPECT_FALSE(StreamWriter::decodeHeader("short", decoded));
+}
+
+TEST(SdkStream, ChunksArriveInOrder) {
+    TestSdkPair p;
+    p.initBoth();
+    auto [cidA, cidB] = p.connectAtoB();
+
+    if (cidA <= 0 || cidB <= 0) {
+        GTEST_SKIP() << "Handshake did not complete in time";
+    }
+
+    string received;
+    atomic<bool> finished{false};
+    atomic<int> chunks{0};
+    p.sdkB->setOnStreamChunk(cidB, [&](StreamId, const string& data, bool last) {
+        received += data;
+        chunks++;
+        if (last) {
+            finished = true;
+        }
+    });
+
+    vector<uint8_t> piece(7000);
+    string expected;
+    auto writer = p.sdkA->openStream(cidA, 4);
+    for (int i = 0; i < 90; ++i) {
+        for (size_t j = 0; j < piece.size(); ++j) {
+            piece[j] = static_cast<uint8_t>(i + j * 13);
+        }
+        ASSERT_TRUE(writer->write(piece));
+        expected.append(piece.begin(), piece.end());
+    }
+    EXPECT_TRUE(writer->close());
+
+    auto deadline = steady_clock::now() + seconds{10};
+    while (!finished && steady_clock::now() < deadline) {
+        this_thread::sleep_for(milliseconds{20});
+    }
+    ASSERT_TRUE(finished.load());
+    EXPECT_GT(chunks.load(), 1);
+    EXPECT_EQ(received, expected);
+    EXPECT_EQ(writer->bytesWritten(), expected.size());
+}
+
+TEST(SdkHeaderCompression, ManySmallMessagesRoundtrip) {
+    TestSdkPair p;
+    p.initBoth();
+    auto [cidA, cidB] = p.connectAtoB();
+
+    if (cidA <= 0 || cidB <= 0) {
+        GTEST_SKIP() << "Handshake did not complete in time";
+    }
+
+    // Enough frames per (connection, format) to cross several full-header refreshes
+    mutex receivedGuard;
+    vector<string> received;
+    p.sdkB->setOnStreamChunk(cidB, [&](StreamId, const string& data, bool) {
+        lock_guard<mutex> lock(receivedGuard);
+        received.push_back(data);
+    });
+
+    const int streams = 3 * TransportLayer::COMPACT_REFRESH_INTERVAL / 2;
+    for (int i = 0; i < streams; ++i) {
+        auto writer = p.sdkA->openStream(cidA, 1);
+        string text = "m" + to_string(i);
+        ASSERT_TRUE(writer->write(reinterpret_cast<const uint8_t*>(text.data()), text.size()));
+        ASSERT_TRUE(writer->close());
+    }
+
+    auto deadline = steady_clock::now() + seconds{10};
+    while (steady_clock::now() < deadline) {
+        {
+            lock_guard<mutex> lock(receivedGuard);
+            if (received.size() >= static_cast<size_t>(streams)) {
+                break;
+            }
+        }
+        this_thread::sleep_for(milliseconds{20});
+    }
+    lock_guard<mutex> lock(receivedGuard);
+    ASSERT_EQ(received.size(), static_cast<size_t>(streams));
+    for (int i = 0; i < streams; ++i) {
+        EXPECT_EQ(received[i], "m" + to_string(i));
+    }
+}
+
+// ============================================================
+// Test: Telemetry samples
+// ============================================================
+TEST(SdkTelemetry, SampleBatchesRoundtrip) {
+    TestSdkPair p;
+    p.initBoth();
+    auto [cidA, cidB] = p.connectAtoB();
+
+    if (cidA <= 0 || cidB <= 0) {
+        GTEST_SKIP() << "Handshake did not complete in time";
+    }
+
+    mutex receivedGuard;
+    vector<int64_t> receivedTimestamps;
+    vector<double> receivedValues;
+    atomic<int> batches{0};
+    p.sdkB->setOnSamples(cidB, [&](ChannelId channel, const vector<int64_t>& timestamps,
+                                   const vector<double>& values) {
+        EXPECT_EQ(channel, 3);
+        lock_guard<mutex> lock(receivedGuard);
+        receivedTimestamps.insert(receivedTimestamps.end(), timestamps.begin(), timestamps.end());
+        receivedValues.insert(receivedValues.end(), values.begin(), values.end());
+        batches++;
+    });
+
+    // More than two batches; each is acknowledged before the next is sent,
+    // so they arrive in order
+    vector<int64_t> timestamps;
+    vector<double> values;
+    for (size_t i = 0; i < EminentSdk::MAX_SAMPLES_PER_BATCH * 2 + 100; ++i) {
+        timestamps.push_back(1700000000000LL + static_cast<int64_t>(i) * 10);
+        values.push_back(static_cast<float>(i % 200) / 131.0f);
+    }
+    for (size_t first = 0; first < timestamps.size(); first += EminentSdk::MAX_SAMPLES_PER_BATCH) {
+        size_t last = min(first + EminentSdk::MAX_SAMPLES_PER_BATCH, timestamps.size());
+        atomic<bool> delivered{false};
+        p.sdkA->sendSamples(cidA, 3, vector<int64_t>(timestamps.begin() + first, timestamps.begin() + last),
+                            vector<double>(values.begin() + first, values.begin() + last),
+                            [&]() { delivered = true; });
+        auto deadline = steady_clock::now() + seconds{5};
+        while (!delivered && steady_clock::now() < deadline) {
+            this_thread::sleep_for(milliseconds{5});
+        }
+        ASSERT_TRUE(delivered.load());
+    }
+
+    {
+        lock_guard<mutex> lock(receivedGuard);
+        EXPECT_EQ(batches.load(), 3);
+        EXPECT_EQ(receivedTimestamps, timestamps);
+        EXPECT_EQ(receivedValues, values);
+    }
+
+    // One call is split into batches; onDelivered fires after the last ACK
+    atomic<int> deliveredCalls{0};
+    p.sdkA->sendSamples(cidA, 3, timestamps, values, [&]() { deliveredCalls++; });
+    auto deadline = steady_clock::now() + seconds{5};
+    while (deliveredCalls == 0 && steady_clock::now() < deadline) {
+        this_thread::sleep_for(milliseconds{5});
+    }
+    this_thread::sleep_for(milliseconds{50});
+    EXPECT_EQ(deliveredCalls.load(), 1);
+    EXPECT_EQ(batches.load(), 6);
+}
+
+TEST(SdkTelemetry, InvalidArgumentsThrow) {
+    TestSdkPair p;
+    p.initBoth();
+    auto [cidA, cidB] = p.connectAtoB();
+
+    if (cidA <= 0 || cidB <= 0) {
+        GTEST_SKIP() << "Handshake did not complete in time";
+    }
+
+    EXPECT_THROW(p.sdkA->sendSamples(cidA, 0, {1, 2}, {1.0}), runtime_error);
+    EXPECT_THROW(p.sdkA->sendSamples(cidA, 0x10000, {1}, {1.0}), runtime_error);
+    EXPECT_THROW(p.sdkA->sendSamples(99999, 0, {1}, {1.0}), runtime_error);
+}
+
+// ============================================================
+// Test: Delta encoding
+// ============================================================
+static string feedState(int tick) {
+    return "{\"device\":\"esp32-gyro\",\"uptime\":" + to_string(100000 + tick) +
+           ",\"gyro\":{\"x\":0.01,\"y\":-0.02,\"z\":" + to_string(tick % 360) + ".5}" +
+           ",\"motor\":{\"rpm\":1200,\"temp\":41.5,\"mode\":\"auto\"}" +
+           ",\"battery\":{\"voltage\":3.71,\"percent\":82},\"wifi\":{\"rssi\":-61,\"ch\":6}}";
+}
+
+TEST(SdkDelta, DiffsAgainstAcknowledgedBase) {
+    DeltaSender sender;
+    DeltaReceiver receiver;
+    string decoded;
+    uint32_t sequence = 0;
+
+    // No acknowledged base yet: snapshot
+    string first = sender.encode(feedState(1), true, sequence);
+    EXPECT_EQ(static_cast<uint8_t>(first[0]), DeltaSender::KIND_SNAPSHOT);
+    ASSERT_TRUE(receiver.decode(first, decoded, 1 << 20));
+    EXPECT_EQ(decoded, feedState(1));
+    sender.onAcked(sequence);
+
+    string second = sender.encode(feedState(2), true, sequence);
+    EXPECT_EQ(static_cast<uint8_t>(second[0]), DeltaSender::KIND_DIFF);
+    EXPECT_LT(second.size() * 5, feedState(2).size());
+    ASSERT_TRUE(receiver.decode(second, decoded, 1 << 20));
+    EXPECT_EQ(decoded, feedState(2));
+
+    // A receiver that missed the base cannot decode the diff
+    DeltaReceiver fresh;
+    EXPECT_FALSE(fresh.decode(second, decoded, 1 << 20));
+
+    // It asks once per gap; the sender answers with its latest payload as a snapshot
+    string request;
+    ASSERT_TRUE(fresh.takeResyncRequest(request));
+    EXPECT_FALSE(fresh.decode(second, decoded, 1 << 20));
+    EXPECT_FALSE(fresh.takeResyncRequest(request));
+    ASSERT_TRUE(DeltaReceiver::isResync(request));
+    string latest;
+    ASSERT_TRUE(sender.resync(DeltaReceiver::resyncSequence(request), latest));
+    EXPECT_EQ(latest, feedState(2));
+    string snapshot = sender.encode(latest, true, sequence);
+    EXPECT_EQ(static_cast<uint8_t>(snapshot[0]), DeltaSender::KIND_SNAPSHOT);
+    ASSERT_TRUE(fresh.decode(snapshot, decoded, 1 << 20));
+    EXPECT_EQ(decoded, feedState(2));
+    // A request older than a snapshot already sent needs no answer
+    EXPECT_FALSE(sender.resync(DeltaReceiver::resyncSequence(request), latest));
+}
+
+TEST(SdkDelta, SnapshotWhenAcksStall) {
+    DeltaSender sender;
+    uint32_t sequence = 0;
+    sender.encode(feedState(0), true, sequence);
+    sender.onAcked(sequence);
+
+    string record;
+    for (uint32_t i = 1; i <= DeltaSender::MAX_BASE_AGE + 1; ++i) {
+        record = sender.encode(feedState(static_cast<int>(i)), true, sequence);
+    }
+    EXPECT_EQ(static_cast<uint8_t>(record[0]), DeltaSender::KIND_SNAPSHOT);
+}
+
+TEST(SdkDelta, FeedRoundtripOverSdk) {
+    TestSdkPair p;
+    p.initBoth();
+    auto [cidA, cidB] = p.connectAtoB();
+
+    if (cidA <= 0 || cidB <= 0) {
+        GTEST_SKIP() << "Handshake did not complete in time";
+    }
+
+    mutex receivedGuard;
+    vector<string> received;
+    p.sdkB->setOnMessageHandler(cidB, [&](const Message& msg) {
+        lock_guard<mutex> lock(receivedGuard);
+        received.push_back(msg.payload);
+    });
+    p.sdkA->setDeltaEncoding(cidA, true);
+
+    const int messages = 20;
+    for (int i = 0; i < messages; ++i) {
+        atomic<bool> delivered{false};
+        p.sdkA->send(cidA, feedState(i), MessageFormat::JSON, 1, true, [&]() { delivered = true; });
+        auto deadline = steady_clock::now() + seconds{5};
+        while (!delivered && steady_clock::now() < deadline) {
+            this_thread::sleep_for(milliseconds{5});
+        }
+        ASSERT_TRUE(delivered.load());
+    }
+
+    lock_guard<mutex> lock(receivedGuard);
+    ASSERT_EQ(received.size(), static_cast<size_t>(messages));
+    for (int i = 0; i < messages; ++i) {
+        EXPECT_EQ(received[i], feedState(i));
+    }
+}
+
+// ============================================================
+// Test: Forward error correction
+// ============================================================
+TEST(SdkFec, MessagesRoundtripWithParity) {
+    TestSdkPair p;
+    p.initBoth();
+    auto [cidA, cidB] = p.connectAtoB();
+
+    if (cidA <= 0 || cidB <= 0) {
+        GTEST_SKIP() << "Handshake did not complete in time";
+    }
+
+    mutex receivedGuard;
+    vector<string> received;
+    p.sdkB->setOnMessageHandler(cidB, [&](const Message& msg) {
+        lock_guard<mutex> lock(receivedGuard);
+        received.push_back(msg.payload);
+    });
+    EXPECT_THROW(p.sdkA->setForwardErrorCorrection(99999, FecConfig{FecScheme::XOR, 4, 1}), runtime_error);
+    EXPECT_THROW(p.sdkA->setForwardErrorCorrection(cidA, FecConfig{FecScheme::XOR, 4, 2}), invalid_argument);
+    p.sdkA->setForwardErrorCorrection(cidA, FecConfig{FecScheme::REED_SOLOMON, 4, 2});
+
+    // A fragmented message and short ones that leave groups partial
+    vector<string> payloads{string(150000, 'f')};
+    for (int i = 0; i < 5; ++i) {
+        payloads.push_back("fec-" + to_string(i));
+    }
+    for (const auto& payload : payloads) {
+        atomic<bool> delivered{false};
+        p.sdkA->send(cidA, payload, MessageFormat::JSON, 1, true, [&]() { delivered = true; });
+        auto deadline = steady_clock::now() + seconds{5};
+        while (!delivered && steady_clock::now() < deadline) {
+            this_thread::sleep_for(milliseconds{5});
+        }
+        ASSERT_TRUE(delivered.load());
+    }
+
+    lock_guard<mutex> lock(receivedGuard);
+    EXPECT_EQ(received, payloads);
+}
+
+// ============================================================
+// Test: Multicast group feeds
+// ============================================================
+TEST(SdkGroup, NackedGapIsRepairedInOrder) {
+    GroupPublisher publisher(7);
+    GroupSubscriber subscriber;
+    vector<string> records;
+    for (int i = 1; i <= 4; ++i) {
+        records.push_back(publisher.encodeData("m" + to_string(i)));
+    }
+    auto feed = [&](const string& record, vector<string>& ready) {
+        GroupRecord header;
+        ASSERT_TRUE(GroupRecord::decode(record, header));
+        ASSERT_EQ(header.kind, GroupRecord::KIND_DATA);
+        EXPECT_EQ(header.publisher, 7);
+        subscriber.onData(header.sequence, record.substr(GroupRecord::HEADER_BYTES), ready);
+    };
+
+    // Record 2 is lost: 3 and 4 wait for it
+    vector<string> ready;
+    feed(records[0], ready);
+    feed(records[2], ready);
+    feed(records[3], ready);
+    EXPECT_EQ(ready, vector<string>{"m1"});
+    auto now = steady_clock::now();
+    auto nacks = subscriber.dueNacks(now, milliseconds{20}, ready);
+    ASSERT_EQ(nacks.size(), 1u);
+    EXPECT_EQ(nacks[0], make_pair(2u, static_cast<uint16_t>(1)));
+    EXPECT_TRUE(subscriber.dueNacks(now, milliseconds{20}, ready).empty());
+
+    string nack = GroupRecord::encodeNack(7, nacks[0].first, nacks[0].second);
+    GroupRecord header;
+    ASSERT_TRUE(GroupRecord::decode(nack, header));
+    EXPECT_EQ(header.kind, GroupRecord::KIND_NACK);
+    EXPECT_EQ(header.count, 1);
+    auto repairs = publisher.repairs(header.sequence, header.count, now, milliseconds{20});
+    ASSERT_EQ(repairs.size(), 1u);
+    // A second NACK within the holdoff gets no second repair
+    EXPECT_TRUE(publisher.repairs(header.sequence, header.count, now, milliseconds{20}).empty());
+    feed(repairs[0], ready);
+    EXPECT_EQ(ready, (vector<string>{"m1", "m2", "m3", "m4"}));
+    EXPECT_EQ(subscriber.skipped(), 0u);
+}
+
+TEST(SdkGroup, LostTailIsFoundAndGivenUp) {
+    GroupPublisher publisher(7);
+    GroupSubscriber subscriber;
+    vector<string> ready;
+    string first = publisher.encodeData("m1");
+    publisher.encodeData("m2");
+    subscriber.onData(1, first.substr(GroupRecord::HEADER_BYTES), ready);
+
+    // Only the announce tells that m2 exists
+    auto now = steady_clock::now();
+    auto announce = publisher.announceDue(now);
+    ASSERT_TRUE(announce.has_value());
+    EXPECT_FALSE(publisher.announceDue(now).has_value());
+    GroupRecord header;
+    ASSERT_TRUE(GroupRecord::decode(*announce, header));
+    EXPECT_EQ(header.kind, GroupRecord::KIND_ANNOUNCE);
+    subscriber.onAnnounce(header.sequence);
+
+    // Another subscriber's NACK holds ours back for an interval
+    subscriber.onNackSeen(2, 1, now);
+    EXPECT_TRUE(subscriber.dueNacks(now, milliseconds{20}, ready).empty());
+    for (int attempt = 1; attempt <= GroupSubscriber::MAX_NACK_ATTEMPTS; ++attempt) {
+        now += milliseconds{20};
+        EXPECT_EQ(subscriber.dueNacks(now, milliseconds{20}, ready).size(), 1u);
+    }
+    now += milliseconds{20};
+    EXPECT_TRUE(subscriber.dueNacks(now, milliseconds{20}, ready).empty());
+    EXPECT_EQ(subscriber.skipped(), 1u);
+
+    // Delivery goes on past the skipped message
+    subscriber.onData(3, publisher.encodeData("m3").substr(GroupRecord::HEADER_BYTES), ready);
+    EXPECT_EQ(ready, (vector<string>{"m1", "m3"}));
+}
+
+// ============================================================
+// Test: Binary control-plane codec
+// ============================================================
+TEST(ControlCodec, HeartbeatRoundtripIsCompact) {
+    string payload = ControlMessageCodec::encodeHeartbeat(
+        ControlMessageCodec::Kind::HEARTBEAT, 1001, 123456789012LL);
+    EXPECT_EQ(payload.size(), ControlMessageCodec::HEARTBEAT_BYTES);
+    EXPECT_TRUE(ControlMessageCodec::isBinary(payload));
+
+    auto decoded = ControlMessageCodec::decode(payload);
+    ASSERT_TRUE(decoded.has_value());
+    EXPECT_EQ(decoded->kind, ControlMessageCodec::Kind::HEARTBEAT);
+    EXPECT_EQ(decoded->deviceId, 1001);
+    EXPECT_EQ(decoded->timestampMs, 123456789012LL);
+}
+
+TEST(ControlCodec, HandshakeResponseRoundtrip) {
+    ControlMessageCodec::ControlMessage msg;
+    msg.kind = ControlMessageCodec::Kind::HANDSHAKE_RESPONSE;
+    msg.deviceId = 2002;
+    msg.specialCode = 54321;
+    msg.capabilities = CAPABILITY_BINARY_CONTROL;
+    msg.newId = 7;
+
+    auto decoded = ControlMessageCodec::decode(ControlMessageCodec::encode(msg));
+    ASSERT_TRUE(decoded.has_value());
+    EXPECT_EQ(decoded->kind, ControlMessageCodec::Kind::HANDSHAKE_RESPONSE);
+    EXPECT_EQ(decoded->deviceId, 2002);
+    EXPECT_EQ(decoded->specialCode, 54321);
+    EXPECT_EQ(decoded->capabilities, static_cast<uint32_t>(CAPABILITY_BINARY_CONTROL));
+    EXPECT_EQ(decoded->newId, 7);
+}
+
+TEST(ControlCodec, LegacyJsonIsNotBinary) {
+    string legacy = "{\"deviceId\": 1001, \"ts\": 42}";
+    EXPECT_FALSE(ControlMessageCodec::isBinary(legacy));
+    EXPECT_FALSE(ControlMessageCodec::decode(legacy).has_value());
+}
+
+TEST(ControlCodec, TruncatedPayloadRejected) {
+    string payload = ControlMessageCodec::encodeHeartbeat(
+        ControlMessageCodec::Kind::HEARTBEAT_ACK, 1, 2);
+    payload.pop_back();
+    EXPECT_FALSE(ControlMessageCodec::decode(payload).has_value());
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
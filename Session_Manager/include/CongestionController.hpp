@@ -0,0 +1,137 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+
+using namespace std;
+
+// ============================================================
+// CongestionController — congestion window and pacing rate of the
+// acknowledged traffic on one connection.
+//
+// SessionManager keeps one controller per connection and reports every
+// acknowledged package (with an RTT sample when Karn's rule allows one) and
+// every congestion signal: a retransmission timeout or a full socket buffer
+// on the link. At most congestionWindow() packages are unacknowledged on
+// the connection, on top of the flow window; the summed pacingRate() of all
+// connections is handed to the physical layer.
+// ============================================================
+class CongestionController {
+public:
+    virtual ~CongestionController() = default;
+
+    virtual const char* name() const = 0;
+
+    virtual void onAck(size_t bytes, optional<chrono::microseconds> rtt,
+                       chrono::steady_clock::time_point now) = 0;
+    virtual void onCongestion(chrono::steady_clock::time_point now) = 0;
+
+    // Packages allowed in flight
+    virtual size_t congestionWindow() const = 0;
+
+    // Bytes per second for fragments of `packetBytes`; 0 leaves the link unpaced
+    virtual double pacingRate(size_t packetBytes) const = 0;
+};
+
+using CongestionControllerFactory = function<unique_ptr<CongestionController>()>;
+
+// ============================================================
+// AimdController — loss-based, in the manner of TCP NewReno.
+//
+// Slow start adds one package per ACK until the first congestion signal,
+// congestion avoidance one package per window. A signal halves the window,
+// at most once per round trip. Paced at twice the window rate in slow
+// start and 1.25x afterwards, so the window rather than the pacer limits.
+// ============================================================
+class AimdController : public CongestionController {
+public:
+    static constexpr double INITIAL_WINDOW = 10.0;
+    static constexpr double MIN_WINDOW = 2.0;
+    static constexpr double MAX_WINDOW = 4096.0;
+    static constexpr double DECREASE_FACTOR = 0.5;
+
+    const char* name() const override { return "aimd"; }
+    void onAck(size_t bytes, optional<chrono::microseconds> rtt,
+               chrono::steady_clock::time_point now) override;
+    void onCongestion(chrono::steady_clock::time_point now) override;
+    size_t congestionWindow() const override { return static_cast<size_t>(window_); }
+    double pacingRate(size_t packetBytes) const override;
+
+    bool inSlowStart() const { return window_ < slowStartThreshold_; }
+
+private:
+    double window_ = INITIAL_WINDOW;
+    double slowStartThreshold_ = MAX_WINDOW;
+    chrono::microseconds srtt_{0};
+    chrono::steady_clock::time_point recoveryEnd_{};
+};
+
+// ============================================================
+// DelayBasedController — model-based, in the manner of BBR.
+//
+// Tracks the bottleneck bandwidth (windowed maximum of delivery-rate
+// samples, one per round of min RTT) and the minimum RTT (10 s window).
+// The window is twice the bandwidth-delay product; the pacing rate is the
+// bandwidth times a gain that cycles through probing phases:
+//   STARTUP   gain 2.89 until bandwidth stops growing by 25% for 3 rounds
+//   DRAIN     gain 1/2.89 for one round, to empty the queue STARTUP built
+//   PROBE_BW  gains 1.25, 0.75, 1 x 6, one per round
+// Queueing delay therefore stays near zero instead of filling buffers up
+// to the first loss. A congestion signal restarts the bandwidth estimate
+// from the latest sample.
+// ============================================================
+class DelayBasedController : public CongestionController {
+public:
+    enum class State { STARTUP, DRAIN, PROBE_BW };
+
+    static constexpr double STARTUP_GAIN = 2.89;
+    static constexpr double WINDOW_GAIN = 2.0;
+    static constexpr size_t INITIAL_WINDOW = 10;
+    static constexpr size_t MIN_WINDOW = 4;
+    static constexpr size_t MAX_WINDOW = 4096;
+    static constexpr size_t BANDWIDTH_FILTER_ROUNDS = 10;
+    static constexpr chrono::seconds MIN_RTT_WINDOW{10};
+
+    const char* name() const override { return "delay"; }
+    void onAck(size_t bytes, optional<chrono::microseconds> rtt,
+               chrono::steady_clock::time_point now) override;
+    void onCongestion(chrono::steady_clock::time_point now) override;
+    size_t congestionWindow() const override;
+    double pacingRate(size_t packetBytes) const override;
+
+    State state() const { return state_; }
+    // Bytes per second; 0 before the first round completes
+    double bottleneckBandwidth() const;
+    chrono::microseconds minRtt() const { return minRtt_; }
+
+private:
+    struct BandwidthSample {
+        uint64_t round;
+        double bytesPerSecond;
+    };
+
+    void endRound(chrono::steady_clock::time_point now);
+    double pacingGain() const;
+
+    State state_ = State::STARTUP;
+    chrono::microseconds minRtt_{0};
+    chrono::steady_clock::time_point minRttStamp_{};
+    // Delivery-rate round in progress
+    chrono::steady_clock::time_point roundStart_{};
+    uint64_t roundBytes_ = 0;
+    uint64_t round_ = 0;
+    deque<BandwidthSample> bandwidth_;
+    // STARTUP exit detection
+    double fullBandwidth_ = 0.0;
+    int roundsWithoutGrowth_ = 0;
+    size_t probeCycle_ = 0;
+    double averagePacketBytes_ = 0.0;
+};
+
+unique_ptr<CongestionController> makeAimdController();
+unique_ptr<CongestionController> makeDelayBasedController();
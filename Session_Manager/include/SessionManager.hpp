@@ -1,12 +1,19 @@
 #pragma once
+#include <atomic>
+#include <deque>
+#include <limits>
+#include <map>
+#include <set>
 #include <string>
 #include <queue>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <chrono>
 #include <optional>
 #include <commonTypes.hpp>
 #include <logging.hpp>
+#include "CongestionController.hpp"
 #include <ValidationConfig.hpp>
 #include <ThreadSafeQueue.hpp>
 #include <thread>
@@ -19,7 +26,56 @@ class EminentSdk;
 
 class SessionManager : public LoggerBase {
 public:
-    SessionManager(queue<Message>& sdkQueue, EminentSdk& sdk, const ValidationConfig& validationConfig, size_t maxPacketSize);
+    static constexpr size_t DEFAULT_LARGE_MESSAGE_WINDOW = 128;
+    // Roughly 90 KB of MTU-sized fragments: below the default UDP socket buffers
+    static constexpr size_t DEFAULT_FLOW_WINDOW = 64;
+    static constexpr size_t DEFAULT_RECEIVE_WINDOW = 256;
+    // Bounds of the adaptive retransmission timeout (RFC 6298 without the 1 s floor)
+    static constexpr chrono::milliseconds DEFAULT_MIN_RETRANSMIT_TIMEOUT{50};
+    static constexpr chrono::milliseconds DEFAULT_MAX_RETRANSMIT_TIMEOUT{10000};
+    // Shortest gap between two NACKs for one message; fragment ids per NACK
+    static constexpr chrono::milliseconds DEFAULT_NACK_INTERVAL{20};
+    static constexpr size_t MAX_NACK_FRAGMENTS = 32;
+    // Acknowledged messages remembered after delivery to drop retransmits whose ACK was lost
+    static constexpr size_t DELIVERED_HISTORY = 1024;
+    // Payload bytes of all incomplete inbound messages together, and how long
+    // one without a deadline waits for its next fragment: longer than the
+    // sender keeps retransmitting with the default retransmission config
+    static constexpr size_t DEFAULT_REASSEMBLY_BYTES = 64 * 1024 * 1024;
+    static constexpr chrono::milliseconds DEFAULT_REASSEMBLY_IDLE_TIMEOUT{60000};
+    // Largest sequence gap an ordered package announces; half the 16-bit
+    // sequence space, so the receiver can tell older from newer
+    static constexpr uint16_t MAX_SEQUENCE_GAP = 0x7FFF;
+
+    // Live transmission figures of one connection, see getLinkStats()
+    struct LinkStats {
+        // Zero until the first ACK of a never-retransmitted package arrives
+        chrono::microseconds smoothedRtt{0};
+        chrono::microseconds rttVariance{0};
+        // Timeout of a first transmission; doubles with every retransmit
+        chrono::microseconds retransmitTimeout{0};
+        size_t inFlight = 0;
+        size_t queuedMessages = 0;
+        uint64_t packagesSent = 0;
+        uint64_t retransmits = 0;
+        // Retransmits requested by the peer's NACKs (also counted in retransmits)
+        uint64_t fastRetransmits = 0;
+        uint64_t acknowledgedBytes = 0;
+        chrono::steady_clock::time_point firstSent;
+        size_t congestionWindow = 0;
+        double pacingRate = 0.0;
+        // Outgoing messages dropped at their deadline, and incomplete inbound
+        // ones discarded at the deadline the peer sent with them or idle
+        uint64_t expiredMessages = 0;
+        uint64_t expiredReassemblies = 0;
+        // Messages replaced by a newer one with the same conflation key
+        uint64_t conflatedMessages = 0;
+        // Inbound ordered messages held for an earlier one / earlier ones skipped
+        uint64_t reorderedMessages = 0;
+        uint64_t skippedMessages = 0;
+    };
+
+    SessionManager(ThreadSafeQueue<Message>& sdkQueue, EminentSdk& sdk, const ValidationConfig& validationConfig, size_t maxPacketSize);
 
     void processMessages();
 
@@ -28,17 +84,106 @@ private:
         Package pkg;
         chrono::steady_clock::time_point lastSent;
         int attempts = 0;
+        // Message deadline; every (re)transmission carries the time left
+        chrono::steady_clock::time_point deadline{};
+        // Sequence of an ordered message; packages carry its low 16 bits
+        uint64_t sequence = 0;
     };
 
     struct PendingMessageInfo {
         Message message;
         unordered_map<PackageId, PendingPackageInfo> packages;
+        // Fragments are cut lazily from message.payload: acknowledged messages
+        // as the connection window opens, unacknowledged large messages one
+        // largeMessageWindow_ per tick.
+        bool extended = false;
+        size_t fragmentSize = 0;
+        int fragmentsCount = 0;
+        int nextFragment = 0;
+        // Bytes cut off the front of message.payload; fragments already
+        // sent are dropped from it as the message advances
+        size_t payloadOffset = 0;
+        uint64_t sequence = 0;
+    };
+
+    // One ordered stream of a connection, both directions
+    struct OrderedStream {
+        // Sender: next sequence, and those of messages still (re)sent
+        uint64_t nextSequence = 0;
+        set<uint64_t> unfinished;
+        // Receiver: next sequence to hand up, complete messages waiting for
+        // an earlier one, and sequences known never to arrive
+        uint16_t expected = 0;
+        map<uint16_t, Message> held;
+        set<uint16_t> abandoned;
+    };
+
+    // Flow control and round-trip timing of acknowledged traffic on one
+    // connection, plus its deadline expiries in both directions and conflations
+    struct ConnectionWindow {
+        size_t inFlight = 0;
+        // Last window advertised in the peer's ACKs; unlimited until it sends one
+        size_t peerWindow = numeric_limits<size_t>::max();
+        // Messages with fragments not yet released, in queue order
+        deque<MessageId> waiting;
+        // RTT estimator; rto is retransmitInterval_ until the first sample
+        bool hasRttSample = false;
+        chrono::microseconds srtt{0};
+        chrono::microseconds rttvar{0};
+        chrono::microseconds rto{0};
+        uint64_t packagesSent = 0;
+        uint64_t retransmits = 0;
+        uint64_t fastRetransmits = 0;
+        uint64_t acknowledgedBytes = 0;
+        chrono::steady_clock::time_point firstSent;
+        uint64_t expiredMessages = 0;
+        uint64_t expiredReassemblies = 0;
+        uint64_t conflatedMessages = 0;
+        uint64_t reorderedMessages = 0;
+        uint64_t skippedMessages = 0;
+        // Newest message per conflation key
+        unordered_map<string, MessageId> latestByKey;
+        unordered_map<uint8_t, OrderedStream> orderedStreams;
+        // Null when congestion control is off
+        unique_ptr<CongestionController> congestion;
+    };
+
+    struct AckInfo {
+        PackageId packageId = 0;
+        optional<size_t> window;
+    };
+
+    struct NackInfo {
+        MessageId messageId = 0;
+        vector<int> fragments;
+        optional<size_t> window;
+    };
+
+    struct ReassemblyBuffer {
+        int fragmentsCount = 0;
+        size_t bytes = 0;
+        map<int, string> fragments;
+        // Gap detection: fragments [0, contiguous) arrived, none above highest did
+        int contiguous = 0;
+        int highest = -1;
+        // Each missing fragment is NACKed once; a lost retransmit is left to the RTO
+        set<int> nacked;
+        chrono::steady_clock::time_point lastNack{};
+        // Earliest deadline announced by a fragment; default = none
+        chrono::steady_clock::time_point deadline{};
+        // Arrival of the last new fragment, for the idle timeout
+        chrono::steady_clock::time_point lastActivity{};
+        bool ordered = false;
+        uint8_t orderedStream = 0;
+        uint16_t sequence = 0;
     };
 
-    queue<Message>& sdkQueue_;
+    ThreadSafeQueue<Message>& sdkQueue_;
     EminentSdk& sdk_;
     const ValidationConfig& validationConfig_;
-    size_t maxPacketSize_;
+    // Written under queueMutex_ from the physical layer's thread, read
+    // without it by getMaxPacketSize()
+    atomic<size_t> maxPacketSize_;
     PackageId nextPackageId_ = 1;
     MessageId nextAckMessageId_ = 0;
     uint64_t maxPackageIdValue_ = 0;
@@ -48,34 +193,161 @@ private:
     uint64_t maxPriorityValue_ = 0;
     ThreadSafeQueue<Package> outgoingPackages_;
     unordered_map<MessageId, PendingMessageInfo> pendingMessages_;
-    unordered_map<MessageId, vector<Package>> receivedPackages_;
+    // Keyed by reassemblyKey(connId, messageId); fragments deduplicated by fragmentId
+    unordered_map<uint64_t, ReassemblyBuffer> receivedPackages_;
+    // Sum of ReassemblyBuffer::bytes, kept below maxReassemblyBytes_
+    size_t reassemblyBytes_ = 0;
+    size_t maxReassemblyBytes_ = DEFAULT_REASSEMBLY_BYTES;
+    chrono::milliseconds reassemblyIdleTimeout_ = DEFAULT_REASSEMBLY_IDLE_TIMEOUT;
+    // reassemblyKey of the last DELIVERED_HISTORY acknowledged messages handed up
+    unordered_set<uint64_t> delivered_;
+    deque<uint64_t> deliveredOrder_;
     unordered_map<PackageId, MessageId> packageToMessage_;
+    // onFailed of given-up messages, run outside the lock by whoever takes them next
+    vector<function<void()>> failedCallbacks_;
+    // Ordered messages released for delivery. Whichever thread released them
+    // hands them up unless another one is at it, see deliverOrderedMessages().
+    deque<Message> readyOrdered_;
+    bool deliveringOrdered_ = false;
+    // Messages in OrderedStream::held over all connections
+    size_t heldOrderedMessages_ = 0;
     chrono::milliseconds retransmitInterval_{500};
+    chrono::milliseconds minRetransmitTimeout_ = DEFAULT_MIN_RETRANSMIT_TIMEOUT;
+    chrono::milliseconds maxRetransmitTimeout_ = DEFAULT_MAX_RETRANSMIT_TIMEOUT;
     chrono::milliseconds workerSleepInterval_{20};
+    chrono::milliseconds nackInterval_ = DEFAULT_NACK_INTERVAL;
     int maxRetransmitAttempts_ = 5;
+    size_t largeMessageWindow_ = DEFAULT_LARGE_MESSAGE_WINDOW;
+    size_t flowWindow_ = DEFAULT_FLOW_WINDOW;
+    size_t receiveWindow_ = DEFAULT_RECEIVE_WINDOW;
+    unordered_map<ConnectionId, ConnectionWindow> windows_;
+    CongestionControllerFactory congestionFactory_ = makeAimdController;
+    function<void(double)> onPacingRateChanged_;
+    double pacingRate_ = 0.0;
     thread worker_;
     mutex queueMutex_;
     bool stopWorker_ = false;
     void workerLoop();
     void processSdkQueueLocked(const chrono::steady_clock::time_point& now, vector<function<void()>>& callbacks);
-    void retransmitPendingLocked(const chrono::steady_clock::time_point& now);
+    void retransmitPendingLocked(const chrono::steady_clock::time_point& now, vector<function<void()>>& callbacks);
+    void expireReassembliesLocked(const chrono::steady_clock::time_point& now);
+    void countExpiredMessageLocked(Message& msg, vector<function<void()>>& callbacks);
+    void countExpiredReassemblyLocked(uint64_t key, const ReassemblyBuffer& buffer, const char* reason);
+    unordered_map<uint64_t, ReassemblyBuffer>::iterator eraseReassemblyLocked(
+        unordered_map<uint64_t, ReassemblyBuffer>::iterator it);
+    void conflateLocked(const Message& msg);
+    void queueLargeMessageLocked(Message&& msg, const chrono::steady_clock::time_point& now);
+    void queuePendingMessageLocked(PendingMessageInfo&& pending, const chrono::steady_clock::time_point& now);
+    void advanceMessageLocked(PendingMessageInfo& pending, const chrono::steady_clock::time_point& now,
+                              ConnectionWindow* window);
+    void releaseFragmentsLocked(ConnectionId connId, const chrono::steady_clock::time_point& now);
+    size_t windowLimitLocked(const ConnectionWindow& window) const;
+    chrono::microseconds retransmitTimeoutLocked(ConnectionId connId) const;
+    void addRttSampleLocked(ConnectionWindow& window, chrono::microseconds sample);
+    void updatePacingRateLocked();
+    bool isMessageCompleteLocked(const PendingMessageInfo& pending) const;
+    unordered_map<MessageId, PendingMessageInfo>::iterator dropPendingMessageLocked(
+        unordered_map<MessageId, PendingMessageInfo>::iterator it, const string& reason,
+        LogLevel level = LogLevel::ERROR);
+    unordered_map<MessageId, PendingMessageInfo>::iterator failPendingMessageLocked(
+        unordered_map<MessageId, PendingMessageInfo>::iterator it, const string& reason,
+        LogLevel level = LogLevel::ERROR);
+    void failMessageLocked(Message& msg, const string& reason);
+    void takeFailedCallbacksLocked(vector<function<void()>>& callbacks);
+    uint64_t assignSequenceLocked(const Message& msg, bool tracked);
+    void finishSequenceLocked(const PendingMessageInfo& pending);
+    uint16_t sequenceGapLocked(ConnectionId connId, uint8_t stream, uint64_t sequence);
+    void orderMessageLocked(const Package& pkg, Message&& msg);
+    void abandonSequenceLocked(ConnectionId connId, uint8_t stream, uint16_t sequence);
+    void releaseOrderedLocked(ConnectionWindow& window, OrderedStream& stream);
+    void deliverOrderedMessages();
+    static bool sequenceBefore(uint16_t a, uint16_t b);
+    static uint64_t reassemblyKey(ConnectionId connId, MessageId messageId);
     void sendPackageLocked(PendingPackageInfo& info, const chrono::steady_clock::time_point& now);
     void sendAckForPackageLocked(const Package& pkg);
+    size_t advertisedWindowLocked() const;
+    void sendNackForGapsLocked(const Package& pkg, ReassemblyBuffer& buffer, const chrono::steady_clock::time_point& now);
+    void queueConfirmationLocked(const Package& pkg, string&& payload);
     void handleAckPackage(const Package& pkg);
-    optional<PackageId> parseAckPayload(const string& payload) const;
+    void handleNack(const Package& pkg, const NackInfo& nack);
+    optional<AckInfo> parseAckPayload(const string& payload) const;
+    optional<NackInfo> parseNackPayload(const string& payload) const;
     PackageId allocatePackageId();
     MessageId allocateAckMessageId();
     uint64_t maxValueForBits(uint8_t bits) const;
     bool ensureFragmentsFit(int total) const;
+    size_t fragmentSizeFor(size_t payloadSize, size_t headerExtensionBytes) const;
+    static bool hasDeadline(const Message& msg);
+    static size_t headerExtensionFor(const Message& msg);
 public:
     bool getNextPackage(Package& out);
     void receivePackage(const Package& pkg);
     ThreadSafeQueue<Package>& getOutgoingPackages() { return outgoingPackages_; }
 
-    // Retransmission configuration
+    // Retransmission configuration. `interval` is the timeout used before a
+    // connection has an RTT sample; afterwards the timeout follows the
+    // measured RTT and backs off exponentially per retransmit.
     void setRetransmissionConfig(int maxAttempts, chrono::milliseconds interval);
     int getMaxRetransmitAttempts() const { return maxRetransmitAttempts_; }
     chrono::milliseconds getRetransmitInterval() const { return retransmitInterval_; }
 
+    // Range of the RTT-derived timeout, backoff included
+    void setRetransmitTimeoutBounds(chrono::milliseconds minTimeout, chrono::milliseconds maxTimeout);
+
+    // A receiver that sees later fragments of an acknowledged message arrive
+    // before earlier ones NACKs the missing ids, at most once per interval per
+    // message, and the sender resends them at once instead of after its
+    // timeout. Zero stops sending NACKs (received ones are still honoured).
+    void setNackInterval(chrono::milliseconds interval);
+    chrono::milliseconds getNackInterval() const { return nackInterval_; }
+
+    // Incomplete inbound messages may hold `maxBytes` of fragments in total;
+    // a fragment beyond that is dropped unacknowledged, so its sender tries
+    // again later. One without a deadline is discarded once no new fragment
+    // arrived for `idleTimeout`, counted as an expired reassembly.
+    void setReassemblyLimits(size_t maxBytes, chrono::milliseconds idleTimeout);
+
+    // Fragment payload size; follows the link MTU. Applies to messages queued after the call.
+    void setMaxPacketSize(size_t maxPacketSize);
+    size_t getMaxPacketSize() const { return maxPacketSize_; }
+
+    // Fragments of one large message buffered (in flight or queued) at a time.
+    void setLargeMessageWindow(size_t packages);
+    size_t getLargeMessageWindow() const { return largeMessageWindow_; }
+
+    // Unacknowledged packages per connection at a time; the effective window
+    // is the smaller of this and the window the peer advertises in its ACKs.
+    void setFlowWindow(size_t packages);
+    size_t getFlowWindow() const { return flowWindow_; }
+
+    // Window advertised in every ACK this side sends, less the messages this
+    // side is still reassembling or has not handed up yet. A slow receiver
+    // lowers it to throttle its senders.
+    void setReceiveWindow(size_t packages);
+    size_t getReceiveWindow() const { return receiveWindow_; }
+
+    // Creates the controller of every connection; nullptr turns congestion
+    // control off (only the flow window limits, the link is unpaced).
+    // Existing connections restart with a fresh controller.
+    void setCongestionControl(CongestionControllerFactory factory);
+
+    // Receives the summed pacing rate of all connections in bytes per second
+    // (0 = unpaced) whenever it changes. Called with the session lock held.
+    void setOnPacingRateChanged(function<void(double)> handler);
+
+    // The link could not take a frame (socket buffer full): treated as a
+    // congestion signal on every connection.
+    void onLinkBackpressure();
+
+    // Forgets everything held for a closed connection at once: its queued
+    // acknowledged messages and pending messages fail with "connection
+    // closed" (onFailed runs on the session worker), partial reassemblies,
+    // delivery history and window state are dropped. Queued unacknowledged
+    // messages, such as the DISCONNECT notice, still go out.
+    void purgeConnection(ConnectionId connId);
+
+    // Nullopt if nothing acknowledged was ever sent on the connection
+    optional<LinkStats> getLinkStats(ConnectionId connId);
+
     ~SessionManager();
 };
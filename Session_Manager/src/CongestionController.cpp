@@ -0,0 +1,154 @@
+#include "CongestionController.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+using namespace chrono;
+
+static double toSeconds(microseconds value) {
+    return duration<double>(value).count();
+}
+
+// ============================================================
+// AIMD
+// ============================================================
+
+void AimdController::onAck(size_t, optional<microseconds> rtt, steady_clock::time_point) {
+    if (rtt.has_value()) {
+        srtt_ = srtt_.count() == 0 ? *rtt : (7 * srtt_ + *rtt) / 8;
+    }
+    if (inSlowStart()) {
+        window_ += 1.0;
+    } else {
+        window_ += 1.0 / window_;
+    }
+    window_ = min(window_, MAX_WINDOW);
+}
+
+void AimdController::onCongestion(steady_clock::time_point now) {
+    // Losses of one window are one congestion event
+    if (now < recoveryEnd_) {
+        return;
+    }
+    slowStartThreshold_ = max(window_ * DECREASE_FACTOR, MIN_WINDOW);
+    window_ = slowStartThreshold_;
+    recoveryEnd_ = now + srtt_;
+}
+
+double AimdController::pacingRate(size_t packetBytes) const {
+    if (srtt_.count() == 0) {
+        return 0.0;
+    }
+    double gain = inSlowStart() ? 2.0 : 1.25;
+    return gain * window_ * static_cast<double>(packetBytes) / toSeconds(srtt_);
+}
+
+// ============================================================
+// Delay-based (BBR-style)
+// ============================================================
+
+static constexpr double PROBE_BW_GAINS[] = {1.25, 0.75, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0};
+static constexpr size_t PROBE_BW_PHASES = sizeof(PROBE_BW_GAINS) / sizeof(PROBE_BW_GAINS[0]);
+
+void DelayBasedController::onAck(size_t bytes, optional<microseconds> rtt, steady_clock::time_point now) {
+    averagePacketBytes_ = averagePacketBytes_ == 0.0
+        ? static_cast<double>(bytes)
+        : 0.875 * averagePacketBytes_ + 0.125 * static_cast<double>(bytes);
+
+    if (rtt.has_value() &&
+        (minRtt_.count() == 0 || *rtt <= minRtt_ || now - minRttStamp_ > MIN_RTT_WINDOW)) {
+        minRtt_ = *rtt;
+        minRttStamp_ = now;
+    }
+
+    if (roundStart_ == steady_clock::time_point{}) {
+        roundStart_ = now;
+    }
+    roundBytes_ += bytes;
+    if (minRtt_.count() > 0 && now - roundStart_ >= minRtt_) {
+        endRound(now);
+    }
+}
+
+void DelayBasedController::endRound(steady_clock::time_point now) {
+    double elapsed = duration<double>(now - roundStart_).count();
+    ++round_;
+    bandwidth_.push_back({round_, static_cast<double>(roundBytes_) / elapsed});
+    while (bandwidth_.front().round + BANDWIDTH_FILTER_ROUNDS <= round_) {
+        bandwidth_.pop_front();
+    }
+    roundStart_ = now;
+    roundBytes_ = 0;
+
+    switch (state_) {
+        case State::STARTUP: {
+            double bandwidth = bottleneckBandwidth();
+            if (bandwidth >= fullBandwidth_ * 1.25) {
+                fullBandwidth_ = bandwidth;
+                roundsWithoutGrowth_ = 0;
+            } else if (++roundsWithoutGrowth_ >= 3) {
+                state_ = State::DRAIN;
+            }
+            break;
+        }
+        case State::DRAIN:
+            state_ = State::PROBE_BW;
+            probeCycle_ = 0;
+            break;
+        case State::PROBE_BW:
+            probeCycle_ = (probeCycle_ + 1) % PROBE_BW_PHASES;
+            break;
+    }
+}
+
+void DelayBasedController::onCongestion(steady_clock::time_point) {
+    if (bandwidth_.size() > 1) {
+        bandwidth_.erase(bandwidth_.begin(), bandwidth_.end() - 1);
+    }
+    if (state_ == State::STARTUP) {
+        state_ = State::DRAIN;
+    }
+}
+
+double DelayBasedController::bottleneckBandwidth() const {
+    double best = 0.0;
+    for (const auto& sample : bandwidth_) {
+        best = max(best, sample.bytesPerSecond);
+    }
+    return best;
+}
+
+size_t DelayBasedController::congestionWindow() const {
+    double bandwidth = bottleneckBandwidth();
+    if (bandwidth == 0.0 || minRtt_.count() == 0 || averagePacketBytes_ == 0.0) {
+        return INITIAL_WINDOW;
+    }
+    double gain = state_ == State::STARTUP ? STARTUP_GAIN : WINDOW_GAIN;
+    double packets = ceil(gain * bandwidth * toSeconds(minRtt_) / averagePacketBytes_);
+    return static_cast<size_t>(clamp(packets, static_cast<double>(MIN_WINDOW), static_cast<double>(MAX_WINDOW)));
+}
+
+double DelayBasedController::pacingGain() const {
+    switch (state_) {
+        case State::STARTUP:
+            return STARTUP_GAIN;
+        case State::DRAIN:
+            return 1.0 / STARTUP_GAIN;
+        case State::PROBE_BW:
+            return PROBE_BW_GAINS[probeCycle_];
+    }
+    return 1.0;
+}
+
+double DelayBasedController::pacingRate(size_t) const {
+    return pacingGain() * bottleneckBandwidth();
+}
+
+unique_ptr<CongestionController> makeAimdController() {
+    return make_unique<AimdController>();
+}
+
+unique_ptr<CongestionController> makeDelayBasedController() {
+    return make_unique<DelayBasedController>();
+}
@@ -2,8 +2,10 @@
 #include "EminentSdk.hpp"
 #include <algorithm>
 #include <cctype>
+#include <cmath>
 #include <chrono>
 #include <functional>
+#include <iterator>
 #include <limits>
 #include <utility>
 #include <mutex>
@@ -13,7 +15,7 @@
 using namespace std;
 using namespace chrono;
 
-SessionManager::SessionManager(queue<Message>& sdkQueue, EminentSdk& sdk, const ValidationConfig& validationConfig, size_t maxPacketSize)
+SessionManager::SessionManager(ThreadSafeQueue<Message>& sdkQueue, EminentSdk& sdk, const ValidationConfig& validationConfig, size_t maxPacketSize)
     : LoggerBase("SessionManager"),
       sdkQueue_(sdkQueue),
       sdk_(sdk),
@@ -22,7 +24,8 @@ SessionManager::SessionManager(queue<Message>& sdkQueue, EminentSdk& sdk, const
         if (maxPacketSize_ == 0) {
                 throw invalid_argument("SessionManager requires positive maxPacketSize");
         }
-    maxPackageIdValue_ = maxValueForBits(validationConfig_.packageIdBitWidth());
+    maxPackageIdValue_ = min(maxValueForBits(validationConfig_.packageIdBitWidth()),
+                             validationConfig_.maxAllocatablePackageId());
     maxMessageIdValue_ = maxValueForBits(validationConfig_.messageIdBitWidth());
     maxFragmentIdValue_ = maxValueForBits(validationConfig_.fragmentIdBitWidth());
     maxFragmentsCountValue_ = maxValueForBits(validationConfig_.fragmentsCountBitWidth());
@@ -58,13 +61,16 @@ void SessionManager::workerLoop() {
                 break;
             }
             processSdkQueueLocked(now, callbacks);
-            retransmitPendingLocked(now);
+            retransmitPendingLocked(now, callbacks);
+            expireReassembliesLocked(now);
+            takeFailedCallbacksLocked(callbacks);
         }
         for (auto& cb : callbacks) {
             if (cb) {
                 cb();
             }
         }
+        deliverOrderedMessages();
         this_thread::sleep_for(workerSleepInterval_);
     }
 }
@@ -75,153 +81,862 @@ void SessionManager::processMessages() {
     {
         lock_guard<mutex> lock(queueMutex_);
         processSdkQueueLocked(now, callbacks);
-        retransmitPendingLocked(now);
+        retransmitPendingLocked(now, callbacks);
+        expireReassembliesLocked(now);
+        takeFailedCallbacksLocked(callbacks);
     }
     for (auto& cb : callbacks) {
         if (cb) {
             cb();
         }
     }
+    deliverOrderedMessages();
 }
 
 void SessionManager::processSdkQueueLocked(const steady_clock::time_point& now, vector<function<void()>>& callbacks) {
-    while (!sdkQueue_.empty()) {
-        Message msg = sdkQueue_.front();
-        sdkQueue_.pop();
+    vector<Message> batch;
+    Message popped;
+    while (sdkQueue_.tryPop(popped)) {
+        batch.push_back(move(popped));
+    }
+    // Of several messages queued under one conflation key only the newest goes out
+    map<pair<ConnectionId, string>, MessageId> newest;
+    vector<bool> superseded(batch.size(), false);
+    for (size_t i = batch.size(); i-- > 0;) {
+        Message& msg = batch[i];
+        if (msg.conflationKey.empty()) {
+            continue;
+        }
+        auto [newestIt, inserted] = newest.emplace(make_pair(msg.connId, msg.conflationKey), msg.id);
+        if (!inserted) {
+            superseded[i] = true;
+            ++windows_[msg.connId].conflatedMessages;
+            failMessageLocked(msg, string("superseded by message ") + to_string(newestIt->second));
+        }
+    }
+
+    for (size_t i = 0; i < batch.size(); ++i) {
+        if (superseded[i]) {
+            continue;
+        }
+        Message& msg = batch[i];
 
         try {
             validationConfig_.validateMessage(msg);
         } catch (const exception& ex) {
             log(LogLevel::WARN, string("Dropping message due to validation failure: ") + ex.what());
+            failMessageLocked(msg, string("validation failed: ") + ex.what());
+            continue;
+        }
+
+        if (hasDeadline(msg) && now >= msg.deadline) {
+            log(LogLevel::INFO, string("Dropping message id=") + to_string(msg.id) + ": deadline passed before it was sent");
+            countExpiredMessageLocked(msg, callbacks);
+            continue;
+        }
+
+        if (!msg.conflationKey.empty()) {
+            conflateLocked(msg);
+        }
+
+        // With large-message mode negotiated, keep MTU-sized fragments and switch
+        // to the extended fields instead of growing fragments past the MTU.
+        uint64_t mtuFragments = (msg.payload.size() + maxPacketSize_ - 1) / maxPacketSize_;
+        if (msg.allowExtendedFragments && mtuFragments > 0 &&
+            (mtuFragments > static_cast<uint64_t>(numeric_limits<int>::max()) ||
+             !ensureFragmentsFit(static_cast<int>(mtuFragments)))) {
+            queueLargeMessageLocked(move(msg), now);
             continue;
         }
 
-        int total = static_cast<int>((msg.payload.size() + maxPacketSize_ - 1) / maxPacketSize_);
+        size_t fragmentSize = fragmentSizeFor(msg.payload.size(), headerExtensionFor(msg));
+        int total = static_cast<int>((msg.payload.size() + fragmentSize - 1) / fragmentSize);
         if (total <= 0) {
             total = 1;
         }
 
         if (!ensureFragmentsFit(total)) {
-            log(LogLevel::WARN, string("Dropping message id=") + to_string(msg.id) +
-                " because fragments exceed configured bit width");
-            if (msg.onDelivered) {
-                callbacks.push_back([cb = msg.onDelivered]() { if (cb) cb(); });
-            }
+            log(LogLevel::ERROR, string("Dropping message id=") + to_string(msg.id) +
+                " (" + to_string(msg.payload.size()) + " bytes): fragments exceed configured bit width" +
+                " and the connection has no large-message mode");
+            failMessageLocked(msg, "message too large for the connection");
             continue;
         }
 
-        bool trackForAck = msg.requireAck;
-        PendingMessageInfo pending;
-        if (trackForAck) {
-            pending.message = msg;
+        if (msg.requireAck) {
+            PendingMessageInfo pending;
+            pending.fragmentSize = fragmentSize;
+            pending.fragmentsCount = total;
+            pending.message = move(msg);
+            queuePendingMessageLocked(move(pending), now);
+            continue;
         }
 
+        // Nothing acknowledges these packages, so no window can clock them.
+        // Ordered ones are only sequenced: the receiver drops them if late.
+        uint64_t sequence = msg.ordered ? assignSequenceLocked(msg, false) : 0;
+        bool sent = true;
         for (int frag = 0; frag < total; ++frag) {
-            if (static_cast<uint64_t>(frag) > maxFragmentIdValue_) {
-                log(LogLevel::WARN, string("Fragment index ") + to_string(frag) +
-                        " exceeds configured bit width; dropping message id=" + to_string(msg.id));
-                trackForAck = false;
-                pending.packages.clear();
-                break;
-            }
-
-            string fragment = msg.payload.substr(static_cast<size_t>(frag) * maxPacketSize_, maxPacketSize_);
-            Package pkg{
+            PendingPackageInfo info;
+            info.pkg = Package{
                 allocatePackageId(),
                 msg.id,
                 msg.connId,
                 frag,
                 total,
-                fragment,
+                msg.payload.substr(static_cast<size_t>(frag) * fragmentSize, fragmentSize),
                 msg.format,
                 msg.priority,
                 msg.requireAck,
                 PackageStatus::QUEUED
             };
-
+            info.pkg.compressed = msg.compressed;
+            info.pkg.delta = msg.delta;
+            info.pkg.ordered = msg.ordered;
+            info.pkg.orderedStream = msg.orderedStream;
+            info.pkg.peer = msg.peer;
+            info.deadline = msg.deadline;
+            info.sequence = sequence;
             try {
-                validationConfig_.validatePackage(pkg);
+                sendPackageLocked(info, now);
             } catch (const exception& ex) {
-                log(LogLevel::WARN, string("Package validation failed: ") + ex.what());
-                trackForAck = false;
-                pending.packages.clear();
+                log(LogLevel::WARN, string("Failed to send package: ") + ex.what());
+                failMessageLocked(msg, string("fragment send failed: ") + ex.what());
+                sent = false;
                 break;
             }
+        }
 
-            PendingPackageInfo info;
-            info.pkg = pkg;
+        if (sent && msg.onDelivered) {
+            callbacks.push_back(msg.onDelivered);
+        }
+    }
+}
+
+void SessionManager::retransmitPendingLocked(const steady_clock::time_point& now, vector<function<void()>>& callbacks) {
+    // Windows freed by dropped messages are refilled after the scan, since
+    // releasing fragments may drop further messages
+    vector<ConnectionId> reopened;
+    vector<ConnectionWindow*> congested;
+    for (auto msgIt = pendingMessages_.begin(); msgIt != pendingMessages_.end();) {
+        auto& pending = msgIt->second;
+        // Late data is useless to the peer: stop retransmitting and free the window
+        if (hasDeadline(pending.message) && now >= pending.message.deadline) {
+            if (pending.message.requireAck) {
+                reopened.push_back(pending.message.connId);
+            }
+            countExpiredMessageLocked(pending.message, callbacks);
+            msgIt = dropPendingMessageLocked(msgIt, "deadline passed", LogLevel::INFO);
+            continue;
+        }
+
+        string failure;
+        ConnectionWindow* window = nullptr;
+        microseconds timeout{0};
+        if (!pending.packages.empty()) {
+            auto winIt = windows_.find(pending.message.connId);
+            window = winIt != windows_.end() ? &winIt->second : nullptr;
+            timeout = retransmitTimeoutLocked(pending.message.connId);
+        }
+
+        for (auto& [packageId, info] : pending.packages) {
+            // Exponential backoff: every retransmit of a package doubles its timeout
+            microseconds backedOff = timeout * (int64_t{1} << min(info.attempts - 1, 16));
+            if (now - info.lastSent < min<microseconds>(backedOff, maxRetransmitTimeout_)) {
+                continue;
+            }
+            if (info.attempts >= maxRetransmitAttempts_) {
+                log(LogLevel::WARN, string("Package ") + to_string(packageId) +
+                        " failed after " + to_string(maxRetransmitAttempts_) +
+                        " retransmit attempts (connId=" + to_string(info.pkg.connId) +
+                        ", msgId=" + to_string(info.pkg.messageId) + ")");
+                failure = "retransmission attempts exhausted";
+                break;
+            }
             try {
                 sendPackageLocked(info, now);
+                if (window != nullptr) {
+                    ++window->retransmits;
+                    if (window->congestion && find(congested.begin(), congested.end(), window) == congested.end()) {
+                        congested.push_back(window);
+                    }
+                }
+                log(LogLevel::DEBUG, string("Retransmit #") + to_string(info.attempts) +
+                    " for package " + to_string(packageId));
             } catch (const exception& ex) {
-                log(LogLevel::WARN, string("Failed to send package: ") + ex.what());
-                trackForAck = false;
-                pending.packages.clear();
+                failure = string("retransmit failed: ") + ex.what();
                 break;
             }
+        }
 
-            if (trackForAck) {
-                pending.packages.emplace(pkg.packageId, info);
-                packageToMessage_[pkg.packageId] = msg.id;
+        // Unacknowledged large messages are paced here, one window per tick
+        if (failure.empty() && pending.extended && !pending.message.requireAck) {
+            try {
+                advanceMessageLocked(pending, now, nullptr);
+            } catch (const exception& ex) {
+                failure = string("fragment send failed: ") + ex.what();
             }
         }
 
-        if (trackForAck && !pending.packages.empty()) {
-            pendingMessages_[msg.id] = move(pending);
-        } else if (msg.onDelivered) {
-            callbacks.push_back(msg.onDelivered);
+        if (!failure.empty()) {
+            // A message with a lost fragment can never be reassembled, so the
+            // remaining fragments are dropped and onFailed runs instead of onDelivered.
+            if (pending.message.requireAck) {
+                reopened.push_back(pending.message.connId);
+            }
+            msgIt = failPendingMessageLocked(msgIt, failure);
+            continue;
+        }
+
+        if (isMessageCompleteLocked(pending)) {
+            if (pending.message.onDelivered) {
+                callbacks.push_back(pending.message.onDelivered);
+            }
+            finishSequenceLocked(pending);
+            msgIt = pendingMessages_.erase(msgIt);
+        } else {
+            ++msgIt;
         }
     }
+
+    // A timeout is one congestion signal per connection, however many packages expired
+    for (ConnectionWindow* window : congested) {
+        window->congestion->onCongestion(now);
+    }
+    if (!congested.empty()) {
+        updatePacingRateLocked();
+    }
+    for (ConnectionId connId : reopened) {
+        releaseFragmentsLocked(connId, now);
+    }
 }
 
-void SessionManager::retransmitPendingLocked(const steady_clock::time_point& now) {
-    for (auto msgIt = pendingMessages_.begin(); msgIt != pendingMessages_.end();) {
-        auto& pending = msgIt->second;
-        bool anyDropped = false;
-
-        for (auto pkgIt = pending.packages.begin(); pkgIt != pending.packages.end();) {
-            auto& info = pkgIt->second;
-
-            if (now - info.lastSent >= retransmitInterval_) {
-                if (info.attempts >= maxRetransmitAttempts_) {
-                    log(LogLevel::WARN, string("Package ") + to_string(info.pkg.packageId) +
-                            " failed after " + to_string(maxRetransmitAttempts_) +
-                            " retransmit attempts (connId=" + to_string(info.pkg.connId) +
-                            ", msgId=" + to_string(info.pkg.messageId) + ")");
-                    packageToMessage_.erase(info.pkg.packageId);
-                    anyDropped = true;
-                    pkgIt = pending.packages.erase(pkgIt);
-                    continue;
-                }
-                try {
-                    sendPackageLocked(info, now);
-                    log(LogLevel::DEBUG, string("Retransmit #") + to_string(info.attempts) +
-                        " for package " + to_string(info.pkg.packageId));
-                } catch (const exception& ex) {
-                    log(LogLevel::WARN, string("Failed to retransmit package: ") + ex.what());
-                    packageToMessage_.erase(info.pkg.packageId);
-                    anyDropped = true;
-                    pkgIt = pending.packages.erase(pkgIt);
-                    continue;
+void SessionManager::countExpiredMessageLocked(Message& msg, vector<function<void()>>& callbacks) {
+    ++windows_[msg.connId].expiredMessages;
+    if (msg.onExpired) {
+        callbacks.push_back(move(msg.onExpired));
+    }
+}
+
+// Incomplete messages whose sender has given up on them by now
+void SessionManager::expireReassembliesLocked(const steady_clock::time_point& now) {
+    for (auto it = receivedPackages_.begin(); it != receivedPackages_.end();) {
+        const ReassemblyBuffer& buffer = it->second;
+        const char* reason = nullptr;
+        if (buffer.deadline != steady_clock::time_point{}) {
+            if (now >= buffer.deadline) {
+                reason = "deadline passed";
+            }
+        } else if (now - buffer.lastActivity >= reassemblyIdleTimeout_) {
+            reason = "idle";
+        }
+        if (!reason) {
+            ++it;
+            continue;
+        }
+        countExpiredReassemblyLocked(it->first, buffer, reason);
+        // The sender drops the message at the same deadline, or has given up on it
+        if (buffer.ordered) {
+            abandonSequenceLocked(static_cast<ConnectionId>(it->first >> 32), buffer.orderedStream, buffer.sequence);
+        }
+        it = eraseReassemblyLocked(it);
+    }
+}
+
+void SessionManager::countExpiredReassemblyLocked(uint64_t key, const ReassemblyBuffer& buffer, const char* reason) {
+    ++windows_[static_cast<ConnectionId>(key >> 32)].expiredReassemblies;
+    log(LogLevel::INFO, string("Discarding msgId=") + to_string(static_cast<uint32_t>(key)) +
+        ": " + reason + " with " + to_string(buffer.fragments.size()) + "/" +
+        to_string(buffer.fragmentsCount) + " fragments");
+}
+
+unordered_map<uint64_t, SessionManager::ReassemblyBuffer>::iterator SessionManager::eraseReassemblyLocked(
+    unordered_map<uint64_t, ReassemblyBuffer>::iterator it) {
+    reassemblyBytes_ -= it->second.bytes;
+    return receivedPackages_.erase(it);
+}
+
+// Drops the previous message of msg's key unless part of it is already out: a
+// partly sent multi-fragment message finishes, or the peer would be left
+// with a reassembly it can never complete
+void SessionManager::conflateLocked(const Message& msg) {
+    ConnectionWindow& window = windows_[msg.connId];
+    auto [latestIt, inserted] = window.latestByKey.try_emplace(msg.conflationKey, msg.id);
+    if (inserted) {
+        return;
+    }
+    MessageId previous = latestIt->second;
+    latestIt->second = msg.id;
+
+    auto it = pendingMessages_.find(previous);
+    if (it == pendingMessages_.end() || it->second.message.connId != msg.connId ||
+        it->second.message.conflationKey != msg.conflationKey) {
+        return;
+    }
+    const PendingMessageInfo& pending = it->second;
+    if (isMessageCompleteLocked(pending) || (pending.nextFragment > 0 && pending.fragmentsCount > 1)) {
+        return;
+    }
+    ++window.conflatedMessages;
+    failPendingMessageLocked(it, string("superseded by message ") + to_string(msg.id), LogLevel::DEBUG);
+}
+
+bool SessionManager::hasDeadline(const Message& msg) {
+    return msg.deadline != steady_clock::time_point{};
+}
+
+size_t SessionManager::headerExtensionFor(const Message& msg) {
+    return (hasDeadline(msg) ? ValidationConfig::DEADLINE_FIELD_BYTES : 0) +
+        (msg.ordered ? ValidationConfig::ORDERING_FIELDS_BYTES : 0);
+}
+
+// ============================================================
+// Ordered delivery
+// ============================================================
+
+// Tracked sequences belong to messages that may still be (re)sent; the oldest
+// of them is the floor the receiver has to wait for
+uint64_t SessionManager::assignSequenceLocked(const Message& msg, bool tracked) {
+    OrderedStream& stream = windows_[msg.connId].orderedStreams[msg.orderedStream];
+    uint64_t sequence = stream.nextSequence++;
+    if (tracked) {
+        stream.unfinished.insert(sequence);
+    }
+    return sequence;
+}
+
+void SessionManager::finishSequenceLocked(const PendingMessageInfo& pending) {
+    if (!pending.message.ordered) {
+        return;
+    }
+    auto winIt = windows_.find(pending.message.connId);
+    if (winIt == windows_.end()) {
+        return;
+    }
+    auto streamIt = winIt->second.orderedStreams.find(pending.message.orderedStream);
+    if (streamIt != winIt->second.orderedStreams.end()) {
+        streamIt->second.unfinished.erase(pending.sequence);
+    }
+}
+
+uint16_t SessionManager::sequenceGapLocked(ConnectionId connId, uint8_t stream, uint64_t sequence) {
+    auto winIt = windows_.find(connId);
+    if (winIt == windows_.end()) {
+        return 0;
+    }
+    auto streamIt = winIt->second.orderedStreams.find(stream);
+    if (streamIt == winIt->second.orderedStreams.end() || streamIt->second.unfinished.empty()) {
+        return 0;
+    }
+    uint64_t oldest = *streamIt->second.unfinished.begin();
+    // releaseFragmentsLocked() keeps acknowledged messages within the limit
+    return oldest < sequence ? static_cast<uint16_t>(min<uint64_t>(sequence - oldest, MAX_SEQUENCE_GAP)) : 0;
+}
+
+// Serial number order of 16-bit sequences (RFC 1982)
+bool SessionManager::sequenceBefore(uint16_t a, uint16_t b) {
+    return static_cast<int16_t>(static_cast<uint16_t>(a - b)) < 0;
+}
+
+void SessionManager::orderMessageLocked(const Package& pkg, Message&& msg) {
+    ConnectionWindow& window = windows_[pkg.connId];
+    OrderedStream& stream = window.orderedStreams[pkg.orderedStream];
+    // The sender no longer (re)sends anything below the floor, so what is
+    // still missing there will not come
+    uint16_t floor = static_cast<uint16_t>(pkg.sequence - pkg.sequenceGap);
+    while (sequenceBefore(stream.expected, floor)) {
+        auto heldIt = stream.held.find(stream.expected);
+        if (heldIt != stream.held.end()) {
+            readyOrdered_.push_back(move(heldIt->second));
+            stream.held.erase(heldIt);
+            --heldOrderedMessages_;
+        } else {
+            ++window.skippedMessages;
+        }
+        stream.abandoned.erase(stream.expected);
+        ++stream.expected;
+    }
+
+    if (sequenceBefore(pkg.sequence, stream.expected)) {
+        log(LogLevel::DEBUG, string("Dropping ordered msgId=") + to_string(pkg.messageId) +
+            ": its sequence was already skipped");
+        return;
+    }
+    if (pkg.sequence != stream.expected) {
+        ++window.reorderedMessages;
+        if (stream.held.emplace(pkg.sequence, move(msg)).second) {
+            ++heldOrderedMessages_;
+        }
+        return;
+    }
+    readyOrdered_.push_back(move(msg));
+    ++stream.expected;
+    releaseOrderedLocked(window, stream);
+}
+
+// An incomplete message expired here; its sender has dropped it as well
+void SessionManager::abandonSequenceLocked(ConnectionId connId, uint8_t streamId, uint16_t sequence) {
+    ConnectionWindow& window = windows_[connId];
+    OrderedStream& stream = window.orderedStreams[streamId];
+    if (sequenceBefore(sequence, stream.expected)) {
+        return;
+    }
+    stream.abandoned.insert(sequence);
+    releaseOrderedLocked(window, stream);
+}
+
+// Hands up held messages from `expected` on, stepping over abandoned sequences
+void SessionManager::releaseOrderedLocked(ConnectionWindow& window, OrderedStream& stream) {
+    while (true) {
+        auto heldIt = stream.held.find(stream.expected);
+        if (heldIt != stream.held.end()) {
+            readyOrdered_.push_back(move(heldIt->second));
+            stream.held.erase(heldIt);
+            --heldOrderedMessages_;
+        } else if (stream.abandoned.erase(stream.expected) > 0) {
+            ++window.skippedMessages;
+        } else {
+            return;
+        }
+        ++stream.expected;
+    }
+}
+
+// One thread at a time hands up released messages, with no lock held, so a
+// callback may send or receive again. Whoever finds another thread at it
+// returns: that thread also takes what was released meanwhile, in order.
+void SessionManager::deliverOrderedMessages() {
+    deque<Message> batch;
+    {
+        lock_guard<mutex> lock(queueMutex_);
+        if (deliveringOrdered_ || readyOrdered_.empty()) {
+            return;
+        }
+        deliveringOrdered_ = true;
+    }
+    try {
+        while (true) {
+            {
+                lock_guard<mutex> lock(queueMutex_);
+                if (readyOrdered_.empty()) {
+                    deliveringOrdered_ = false;
+                    return;
                 }
+                batch.swap(readyOrdered_);
+            }
+            for (const Message& msg : batch) {
+                sdk_.onMessageReceived(msg);
+            }
+            batch.clear();
+        }
+    } catch (...) {
+        lock_guard<mutex> lock(queueMutex_);
+        deliveringOrdered_ = false;
+        throw;
+    }
+}
+
+// ============================================================
+// Large-message mode
+// ============================================================
+
+void SessionManager::queueLargeMessageLocked(Message&& msg, const steady_clock::time_point& now) {
+    PendingMessageInfo pending;
+    pending.extended = true;
+    size_t headerExtension = ValidationConfig::EXTENDED_FRAGMENT_FIELDS_BYTES + headerExtensionFor(msg);
+    size_t packetSize = maxPacketSize_;
+    pending.fragmentSize = packetSize > headerExtension ? packetSize - headerExtension : packetSize;
+    uint64_t total = (msg.payload.size() + pending.fragmentSize - 1) / pending.fragmentSize;
+    if (total > static_cast<uint64_t>(numeric_limits<int>::max())) {
+        log(LogLevel::ERROR, string("Dropping message id=") + to_string(msg.id) +
+            ": too many fragments even for large-message mode");
+        failMessageLocked(msg, "message too large for large-message mode");
+        return;
+    }
+    pending.fragmentsCount = static_cast<int>(total);
+    pending.message = move(msg);
+
+    log(LogLevel::INFO, string("Large message id=") + to_string(pending.message.id) + " size=" +
+        to_string(pending.message.payload.size()) + " fragments=" + to_string(pending.fragmentsCount));
+    queuePendingMessageLocked(move(pending), now);
+}
+
+// ============================================================
+// Flow control
+// ============================================================
+
+// Acknowledged messages wait for their connection's window; unacknowledged
+// (large) ones send their first window right away.
+void SessionManager::queuePendingMessageLocked(PendingMessageInfo&& pending, const steady_clock::time_point& now) {
+    MessageId id = pending.message.id;
+    ConnectionId connId = pending.message.connId;
+    bool acknowledged = pending.message.requireAck;
+    if (pending.message.ordered) {
+        pending.sequence = assignSequenceLocked(pending.message, true);
+    }
+
+    auto it = pendingMessages_.insert_or_assign(id, move(pending)).first;
+    if (acknowledged) {
+        ConnectionWindow& window = windows_[connId];
+        if (!window.congestion && congestionFactory_) {
+            window.congestion = congestionFactory_();
+        }
+        window.waiting.push_back(id);
+        releaseFragmentsLocked(connId, now);
+        return;
+    }
+    try {
+        advanceMessageLocked(it->second, now, nullptr);
+    } catch (const exception& ex) {
+        failPendingMessageLocked(it, string("fragment send failed: ") + ex.what());
+    }
+}
+
+// Hands out the connection's free window to waiting messages in queue order
+void SessionManager::releaseFragmentsLocked(ConnectionId connId, const steady_clock::time_point& now) {
+    auto winIt = windows_.find(connId);
+    if (winIt == windows_.end()) {
+        return;
+    }
+    ConnectionWindow& window = winIt->second;
+    while (!window.waiting.empty()) {
+        auto msgIt = pendingMessages_.find(window.waiting.front());
+        if (msgIt == pendingMessages_.end() || msgIt->second.nextFragment >= msgIt->second.fragmentsCount) {
+            window.waiting.pop_front();
+            continue;
+        }
+        // An ordered message too far ahead of the oldest unfinished one of
+        // its stream waits, as the gap field could not reach back to that one
+        const PendingMessageInfo& pending = msgIt->second;
+        if (pending.message.ordered && pending.nextFragment == 0 &&
+            sequenceGapLocked(connId, pending.message.orderedStream, pending.sequence) >= MAX_SEQUENCE_GAP) {
+            break;
+        }
+        try {
+            advanceMessageLocked(msgIt->second, now, &window);
+        } catch (const exception& ex) {
+            failPendingMessageLocked(msgIt, string("fragment send failed: ") + ex.what());
+            window.waiting.pop_front();
+            continue;
+        }
+        if (msgIt->second.nextFragment < msgIt->second.fragmentsCount) {
+            break;
+        }
+        window.waiting.pop_front();
+    }
+}
+
+size_t SessionManager::windowLimitLocked(const ConnectionWindow& window) const {
+    size_t limit = min(flowWindow_, window.peerWindow);
+    if (window.congestion) {
+        limit = min(limit, window.congestion->congestionWindow());
+    }
+    return max<size_t>(limit, 1);
+}
+
+microseconds SessionManager::retransmitTimeoutLocked(ConnectionId connId) const {
+    auto it = windows_.find(connId);
+    if (it == windows_.end() || !it->second.hasRttSample) {
+        return retransmitInterval_;
+    }
+    return it->second.rto;
+}
+
+// RFC 6298: SRTT/RTTVAR smoothing with gains 1/8 and 1/4,
+// RTO = SRTT + max(G, 4 * RTTVAR) where G is the worker tick
+void SessionManager::addRttSampleLocked(ConnectionWindow& window, microseconds sample) {
+    if (!window.hasRttSample) {
+        window.srtt = sample;
+        window.rttvar = sample / 2;
+        window.hasRttSample = true;
+    } else {
+        microseconds error = window.srtt > sample ? window.srtt - sample : sample - window.srtt;
+        window.rttvar = (3 * window.rttvar + error) / 4;
+        window.srtt = (7 * window.srtt + sample) / 8;
+    }
+    microseconds rto = window.srtt + max<microseconds>(workerSleepInterval_, 4 * window.rttvar);
+    window.rto = clamp<microseconds>(rto, minRetransmitTimeout_, maxRetransmitTimeout_);
+}
+
+// Cuts the next fragments of a message. Acknowledged messages stop when the
+// connection window is full (large ones also at largeMessageWindow_ of their
+// own fragments); unacknowledged ones send one largeMessageWindow_ per call.
+void SessionManager::advanceMessageLocked(PendingMessageInfo& pending, const steady_clock::time_point& now,
+                                          ConnectionWindow* window) {
+    size_t sentNow = 0;
+    while (pending.nextFragment < pending.fragmentsCount) {
+        if (window != nullptr) {
+            if (window->inFlight >= windowLimitLocked(*window) ||
+                (pending.extended && pending.packages.size() >= largeMessageWindow_) ||
+                packageToMessage_.size() >= maxPackageIdValue_) {
+                break;
             }
-            ++pkgIt;
+        } else if (sentNow >= largeMessageWindow_) {
+            break;
         }
 
-        if (anyDropped && pending.packages.empty()) {
-            // All packages for this message failed — notify SDK
-            log(LogLevel::ERROR, string("Message ") + to_string(msgIt->first) +
-                " delivery failed: all retransmission attempts exhausted");
+        int frag = pending.nextFragment;
+        PendingPackageInfo info;
+        info.pkg = Package{
+            allocatePackageId(),
+            pending.message.id,
+            pending.message.connId,
+            frag,
+            pending.fragmentsCount,
+            pending.message.payload.substr(static_cast<size_t>(frag) * pending.fragmentSize - pending.payloadOffset,
+                                           pending.fragmentSize),
+            pending.message.format,
+            pending.message.priority,
+            pending.message.requireAck,
+            PackageStatus::QUEUED,
+            pending.extended
+        };
+        info.pkg.compressed = pending.message.compressed;
+        info.pkg.delta = pending.message.delta;
+        info.pkg.ordered = pending.message.ordered;
+        info.pkg.orderedStream = pending.message.orderedStream;
+        info.pkg.peer = pending.message.peer;
+        info.deadline = pending.message.deadline;
+        info.sequence = pending.sequence;
+        sendPackageLocked(info, now);
+        ++pending.nextFragment;
+        ++sentNow;
+
+        if (window != nullptr) {
+            if (window->packagesSent++ == 0) {
+                window->firstSent = now;
+            }
+            ++window->inFlight;
+            packageToMessage_[info.pkg.packageId] = pending.message.id;
+            pending.packages.emplace(info.pkg.packageId, move(info));
         }
+    }
 
-        if (pending.packages.empty()) {
-            msgIt = pendingMessages_.erase(msgIt);
+    if (pending.nextFragment == pending.fragmentsCount) {
+        // Everything is cut; only the window copies are needed from now on
+        string().swap(pending.message.payload);
+        return;
+    }
+    // Sent bytes are let go once they make up half the buffer, so the sender
+    // holds little more than the unsent rest and copies each byte about once more
+    size_t cut = static_cast<size_t>(pending.nextFragment) * pending.fragmentSize - pending.payloadOffset;
+    if (cut > 0 && cut >= pending.message.payload.size() - cut) {
+        pending.message.payload = pending.message.payload.substr(cut);
+        pending.payloadOffset += cut;
+    }
+}
+
+bool SessionManager::isMessageCompleteLocked(const PendingMessageInfo& pending) const {
+    return pending.packages.empty() && pending.nextFragment >= pending.fragmentsCount;
+}
+
+unordered_map<MessageId, SessionManager::PendingMessageInfo>::iterator SessionManager::dropPendingMessageLocked(
+    unordered_map<MessageId, PendingMessageInfo>::iterator it, const string& reason, LogLevel level) {
+    for (const auto& [packageId, info] : it->second.packages) {
+        packageToMessage_.erase(packageId);
+    }
+    auto winIt = windows_.find(it->second.message.connId);
+    if (winIt != windows_.end() && it->second.message.requireAck) {
+        winIt->second.inFlight -= min(winIt->second.inFlight, it->second.packages.size());
+    }
+    finishSequenceLocked(it->second);
+    log(level, string("Message ") + to_string(it->first) + " delivery failed: " + reason);
+    return pendingMessages_.erase(it);
+}
+
+unordered_map<MessageId, SessionManager::PendingMessageInfo>::iterator SessionManager::failPendingMessageLocked(
+    unordered_map<MessageId, PendingMessageInfo>::iterator it, const string& reason, LogLevel level) {
+    failMessageLocked(it->second.message, reason);
+    return dropPendingMessageLocked(it, reason, level);
+}
+
+// Callers may hold no callback list (ACK handler, setters), so the callback
+// waits in failedCallbacks_ for the next tick
+void SessionManager::failMessageLocked(Message& msg, const string& reason) {
+    if (msg.onFailed) {
+        failedCallbacks_.push_back([onFailed = move(msg.onFailed), reason]() { onFailed(reason); });
+    }
+}
+
+void SessionManager::takeFailedCallbacksLocked(vector<function<void()>>& callbacks) {
+    move(failedCallbacks_.begin(), failedCallbacks_.end(), back_inserter(callbacks));
+    failedCallbacks_.clear();
+}
+
+void SessionManager::purgeConnection(ConnectionId connId) {
+    lock_guard<mutex> lock(queueMutex_);
+    size_t failed = sdkQueue_.removeIf([&](Message& msg) {
+        if (msg.connId != connId || !msg.requireAck) {
+            return false;
+        }
+        failMessageLocked(msg, "connection closed");
+        return true;
+    });
+    for (auto it = pendingMessages_.begin(); it != pendingMessages_.end();) {
+        if (it->second.message.connId == connId) {
+            it = failPendingMessageLocked(it, "connection closed", LogLevel::DEBUG);
+            ++failed;
         } else {
-            ++msgIt;
+            ++it;
+        }
+    }
+
+    size_t reassemblies = 0;
+    for (auto it = receivedPackages_.begin(); it != receivedPackages_.end();) {
+        if (static_cast<ConnectionId>(it->first >> 32) == connId) {
+            it = eraseReassemblyLocked(it);
+            ++reassemblies;
+        } else {
+            ++it;
+        }
+    }
+    auto fromConnection = [connId](uint64_t key) { return static_cast<ConnectionId>(key >> 32) == connId; };
+    deliveredOrder_.erase(remove_if(deliveredOrder_.begin(), deliveredOrder_.end(), fromConnection),
+                          deliveredOrder_.end());
+    for (auto it = delivered_.begin(); it != delivered_.end();) {
+        it = fromConnection(*it) ? delivered_.erase(it) : next(it);
+    }
+
+    auto windowIt = windows_.find(connId);
+    if (windowIt != windows_.end()) {
+        for (auto& [streamId, stream] : windowIt->second.orderedStreams) {
+            heldOrderedMessages_ -= stream.held.size();
+        }
+        windows_.erase(windowIt);
+        updatePacingRateLocked();
+    }
+    log(LogLevel::INFO, string("Purged connection ") + to_string(connId) + ": " + to_string(failed) +
+        " messages failed, " + to_string(reassemblies) + " reassemblies dropped");
+}
+
+void SessionManager::setLargeMessageWindow(size_t packages) {
+    if (packages == 0) {
+        throw invalid_argument("SessionManager requires a positive large-message window");
+    }
+    lock_guard<mutex> lock(queueMutex_);
+    largeMessageWindow_ = packages;
+}
+
+void SessionManager::setFlowWindow(size_t packages) {
+    if (packages == 0) {
+        throw invalid_argument("SessionManager requires a positive flow window");
+    }
+    lock_guard<mutex> lock(queueMutex_);
+    flowWindow_ = packages;
+    auto now = steady_clock::now();
+    for (auto& [connId, window] : windows_) {
+        releaseFragmentsLocked(connId, now);
+    }
+}
+
+// ============================================================
+// Congestion control
+// ============================================================
+
+void SessionManager::setCongestionControl(CongestionControllerFactory factory) {
+    lock_guard<mutex> lock(queueMutex_);
+    congestionFactory_ = move(factory);
+    for (auto& [connId, window] : windows_) {
+        window.congestion = congestionFactory_ ? congestionFactory_() : nullptr;
+    }
+    updatePacingRateLocked();
+    auto now = steady_clock::now();
+    for (auto& [connId, window] : windows_) {
+        releaseFragmentsLocked(connId, now);
+    }
+}
+
+void SessionManager::setOnPacingRateChanged(function<void(double)> handler) {
+    lock_guard<mutex> lock(queueMutex_);
+    onPacingRateChanged_ = move(handler);
+    if (onPacingRateChanged_) {
+        onPacingRateChanged_(pacingRate_);
+    }
+}
+
+void SessionManager::onLinkBackpressure() {
+    lock_guard<mutex> lock(queueMutex_);
+    auto now = steady_clock::now();
+    for (auto& [connId, window] : windows_) {
+        if (window.congestion) {
+            window.congestion->onCongestion(now);
+        }
+    }
+    updatePacingRateLocked();
+}
+
+// All connections share the link, so their rates add up. Small changes are
+// not forwarded; the pacer does not need that precision.
+void SessionManager::updatePacingRateLocked() {
+    double rate = 0.0;
+    for (const auto& [connId, window] : windows_) {
+        if (window.congestion) {
+            rate += window.congestion->pacingRate(maxPacketSize_);
         }
     }
+    if (rate == pacingRate_ || (rate > 0.0 && pacingRate_ > 0.0 && abs(rate - pacingRate_) < pacingRate_ * 0.01)) {
+        return;
+    }
+    pacingRate_ = rate;
+    if (onPacingRateChanged_) {
+        onPacingRateChanged_(rate);
+    }
+}
+
+optional<SessionManager::LinkStats> SessionManager::getLinkStats(ConnectionId connId) {
+    lock_guard<mutex> lock(queueMutex_);
+    auto it = windows_.find(connId);
+    if (it == windows_.end()) {
+        return nullopt;
+    }
+    const ConnectionWindow& window = it->second;
+    LinkStats stats;
+    stats.smoothedRtt = window.srtt;
+    stats.rttVariance = window.rttvar;
+    stats.retransmitTimeout = retransmitTimeoutLocked(connId);
+    stats.inFlight = window.inFlight;
+    for (const auto& [id, pending] : pendingMessages_) {
+        if (pending.message.connId == connId && pending.message.requireAck) {
+            ++stats.queuedMessages;
+        }
+    }
+    stats.packagesSent = window.packagesSent;
+    stats.retransmits = window.retransmits;
+    stats.fastRetransmits = window.fastRetransmits;
+    stats.acknowledgedBytes = window.acknowledgedBytes;
+    stats.firstSent = window.firstSent;
+    stats.expiredMessages = window.expiredMessages;
+    stats.expiredReassemblies = window.expiredReassemblies;
+    stats.conflatedMessages = window.conflatedMessages;
+    stats.reorderedMessages = window.reorderedMessages;
+    stats.skippedMessages = window.skippedMessages;
+    if (window.congestion) {
+        stats.congestionWindow = window.congestion->congestionWindow();
+        stats.pacingRate = window.congestion->pacingRate(maxPacketSize_);
+    }
+    return stats;
+}
+
+void SessionManager::setReceiveWindow(size_t packages) {
+    if (packages == 0) {
+        throw invalid_argument("SessionManager requires a positive receive window");
+    }
+    lock_guard<mutex> lock(queueMutex_);
+    receiveWindow_ = packages;
 }
 
 void SessionManager::sendPackageLocked(PendingPackageInfo& info, const steady_clock::time_point& now) {
+    if (info.deadline != steady_clock::time_point{}) {
+        // Relative, as the peers' clocks are unrelated. Beyond the field's
+        // range no deadline is sent; a later retransmit carries it.
+        int64_t left = duration_cast<milliseconds>(info.deadline - now).count();
+        info.pkg.ttlMs = left > numeric_limits<uint16_t>::max() ? 0 : static_cast<uint16_t>(max<int64_t>(left, 1));
+    }
+    if (info.pkg.ordered) {
+        // Retransmits carry the current gap, so the receiver learns of messages given up since
+        info.pkg.sequence = static_cast<uint16_t>(info.sequence);
+        info.pkg.sequenceGap = sequenceGapLocked(info.pkg.connId, info.pkg.orderedStream, info.sequence);
+    }
     try {
         validationConfig_.validatePackage(info.pkg);
     } catch (const exception& ex) {
@@ -232,8 +947,8 @@ void SessionManager::sendPackageLocked(PendingPackageInfo& info, const steady_cl
     ++info.attempts;
 }
 
-optional<PackageId> SessionManager::parseAckPayload(const string& payload) const {
-    const string token = "\"ackPackageId\"";
+// Non-negative integer value of a top-level field of the ACK JSON
+static optional<uint64_t> parseAckField(const string& payload, const string& token) {
     size_t keyPos = payload.find(token);
     if (keyPos == string::npos) {
         return nullopt;
@@ -263,14 +978,61 @@ optional<PackageId> SessionManager::parseAckPayload(const string& payload) const
     }
 
     try {
-        PackageId value = static_cast<PackageId>(stoll(payload.substr(valueStart, valueEnd - valueStart)));
-        if (value <= 0) {
+        return static_cast<uint64_t>(stoull(payload.substr(valueStart, valueEnd - valueStart)));
+    } catch (...) {
+        return nullopt;
+    }
+}
+
+optional<SessionManager::AckInfo> SessionManager::parseAckPayload(const string& payload) const {
+    auto packageId = parseAckField(payload, "\"ackPackageId\"");
+    if (!packageId.has_value() || *packageId == 0 ||
+        *packageId > static_cast<uint64_t>(numeric_limits<PackageId>::max())) {
+        return nullopt;
+    }
+    AckInfo ack;
+    ack.packageId = static_cast<PackageId>(*packageId);
+    // Older peers do not advertise a window
+    if (auto window = parseAckField(payload, "\"wnd\""); window.has_value() && *window > 0) {
+        ack.window = static_cast<size_t>(min<uint64_t>(*window, numeric_limits<size_t>::max()));
+    }
+    return ack;
+}
+
+optional<SessionManager::NackInfo> SessionManager::parseNackPayload(const string& payload) const {
+    auto messageId = parseAckField(payload, "\"nackMessageId\"");
+    if (!messageId.has_value() || *messageId > static_cast<uint64_t>(numeric_limits<MessageId>::max())) {
+        return nullopt;
+    }
+    size_t listStart = payload.find("\"missing\":[");
+    if (listStart == string::npos) {
+        return nullopt;
+    }
+    NackInfo nack;
+    nack.messageId = static_cast<MessageId>(*messageId);
+    size_t pos = listStart + 11;
+    while (pos < payload.size() && payload[pos] != ']') {
+        size_t end = pos;
+        while (end < payload.size() && isdigit(static_cast<unsigned char>(payload[end]))) {
+            ++end;
+        }
+        if (end == pos || end - pos > 10 || nack.fragments.size() >= MAX_NACK_FRAGMENTS) {
             return nullopt;
         }
-        return value;
-    } catch (...) {
+        uint64_t fragmentId = stoull(payload.substr(pos, end - pos));
+        if (fragmentId > static_cast<uint64_t>(numeric_limits<int>::max())) {
+            return nullopt;
+        }
+        nack.fragments.push_back(static_cast<int>(fragmentId));
+        pos = end < payload.size() && payload[end] == ',' ? end + 1 : end;
+    }
+    if (pos >= payload.size() || nack.fragments.empty()) {
         return nullopt;
     }
+    if (auto window = parseAckField(payload, "\"wnd\""); window.has_value() && *window > 0) {
+        nack.window = static_cast<size_t>(min<uint64_t>(*window, numeric_limits<size_t>::max()));
+    }
+    return nack;
 }
 
 void SessionManager::handleAckPackage(const Package& pkg) {
@@ -281,18 +1043,29 @@ void SessionManager::handleAckPackage(const Package& pkg) {
         return;
     }
 
-    auto ackIdOpt = parseAckPayload(pkg.payload);
-    if (!ackIdOpt.has_value()) {
+    if (auto nack = parseNackPayload(pkg.payload)) {
+        handleNack(pkg, *nack);
+        return;
+    }
+
+    auto ack = parseAckPayload(pkg.payload);
+    if (!ack.has_value()) {
         log(LogLevel::WARN, string("Failed to parse ACK payload: '") + pkg.payload + "'");
         return;
     }
 
     function<void()> callback;
+    auto now = steady_clock::now();
 
     {
         lock_guard<mutex> lock(queueMutex_);
 
-        PackageId ackId = *ackIdOpt;
+        auto winIt = windows_.find(pkg.connId);
+        if (winIt != windows_.end() && ack->window.has_value()) {
+            winIt->second.peerWindow = *ack->window;
+        }
+
+        PackageId ackId = ack->packageId;
         auto pkgMsgIt = packageToMessage_.find(ackId);
         if (pkgMsgIt == packageToMessage_.end()) {
             log(LogLevel::WARN, string("ACK for unknown packageId=") + to_string(ackId));
@@ -307,15 +1080,38 @@ void SessionManager::handleAckPackage(const Package& pkg) {
             return;
         }
 
-        auto packageIt = msgIt->second.packages.find(ackId);
-        if (packageIt != msgIt->second.packages.end()) {
-            msgIt->second.packages.erase(packageIt);
+        auto& pending = msgIt->second;
+        ConnectionId connId = pending.message.connId;
+        auto pkgIt = pending.packages.find(ackId);
+        if (pkgIt != pending.packages.end()) {
+            auto window = windows_.find(connId);
+            if (window != windows_.end()) {
+                // Karn's algorithm: an ACK of a retransmitted package cannot
+                // be matched to one transmission, so it is not an RTT sample
+                optional<microseconds> rtt;
+                if (pkgIt->second.attempts == 1) {
+                    rtt = duration_cast<microseconds>(now - pkgIt->second.lastSent);
+                    addRttSampleLocked(window->second, *rtt);
+                }
+                size_t bytes = pkgIt->second.pkg.payload.size();
+                window->second.acknowledgedBytes += bytes;
+                if (window->second.congestion) {
+                    window->second.congestion->onAck(bytes, rtt, now);
+                    updatePacingRateLocked();
+                }
+                if (window->second.inFlight > 0) {
+                    --window->second.inFlight;
+                }
+            }
+            pending.packages.erase(pkgIt);
         }
 
-        if (msgIt->second.packages.empty()) {
-            callback = msgIt->second.message.onDelivered;
+        if (isMessageCompleteLocked(pending)) {
+            callback = pending.message.onDelivered;
+            finishSequenceLocked(pending);
             pendingMessages_.erase(msgIt);
         }
+        releaseFragmentsLocked(connId, now);
     }
 
     if (callback) {
@@ -323,7 +1119,98 @@ void SessionManager::handleAckPackage(const Package& pkg) {
     }
 }
 
+// Fast retransmit: resends the fragments the peer reported missing without
+// waiting for their timeout. A loss reported this way is a congestion signal.
+void SessionManager::handleNack(const Package& pkg, const NackInfo& nack) {
+    lock_guard<mutex> lock(queueMutex_);
+    auto winIt = windows_.find(pkg.connId);
+    ConnectionWindow* window = winIt != windows_.end() ? &winIt->second : nullptr;
+    if (window != nullptr && nack.window.has_value()) {
+        window->peerWindow = *nack.window;
+    }
+
+    auto msgIt = pendingMessages_.find(nack.messageId);
+    if (msgIt == pendingMessages_.end() || msgIt->second.message.connId != pkg.connId) {
+        return;
+    }
+    auto now = steady_clock::now();
+    size_t resent = 0;
+    for (auto& [packageId, info] : msgIt->second.packages) {
+        if (find(nack.fragments.begin(), nack.fragments.end(), info.pkg.fragmentId) == nack.fragments.end() ||
+            info.attempts >= maxRetransmitAttempts_) {
+            continue;
+        }
+        // Resent within half an RTT: the NACK predates that transmission
+        if (window != nullptr && window->hasRttSample && now - info.lastSent < window->srtt / 2) {
+            continue;
+        }
+        try {
+            sendPackageLocked(info, now);
+        } catch (const exception& ex) {
+            log(LogLevel::WARN, string("Fast retransmit failed: ") + ex.what());
+            continue;
+        }
+        ++resent;
+        if (window != nullptr) {
+            ++window->retransmits;
+            ++window->fastRetransmits;
+        }
+    }
+    log(LogLevel::DEBUG, string("NACK for msgId=") + to_string(nack.messageId) + ": resent " +
+        to_string(resent) + " of " + to_string(nack.fragments.size()) + " fragments");
+    if (resent > 0 && window != nullptr && window->congestion) {
+        window->congestion->onCongestion(now);
+        updatePacingRateLocked();
+    }
+}
+
 void SessionManager::sendAckForPackageLocked(const Package& pkg) {
+    queueConfirmationLocked(pkg, string("{\"ackPackageId\":") + to_string(pkg.packageId) +
+                                 ",\"wnd\":" + to_string(advertisedWindowLocked()) + "}");
+}
+
+// receiveWindow_ less the messages this side still holds: incomplete ones
+// and complete ones not handed up yet (ordered ones waiting for an earlier
+// one or for delivery). Never 0: the sender ignores a zero window, and
+// with nothing in flight it would have no ACK to learn of a reopened one.
+size_t SessionManager::advertisedWindowLocked() const {
+    size_t held = receivedPackages_.size() + heldOrderedMessages_ + readyOrdered_.size();
+    return held < receiveWindow_ ? receiveWindow_ - held : 1;
+}
+
+// Lists fragments of pkg's message that are missing below the highest one
+// received, skipping those NACKed before
+void SessionManager::sendNackForGapsLocked(const Package& pkg, ReassemblyBuffer& buffer,
+                                           const steady_clock::time_point& now) {
+    buffer.highest = max(buffer.highest, pkg.fragmentId);
+    while (buffer.fragments.count(buffer.contiguous) > 0) {
+        ++buffer.contiguous;
+    }
+    if (nackInterval_.count() == 0 || buffer.contiguous >= buffer.highest ||
+        now - buffer.lastNack < nackInterval_) {
+        return;
+    }
+
+    string missing;
+    vector<int> listed;
+    for (int fragmentId = buffer.contiguous; fragmentId < buffer.highest && listed.size() < MAX_NACK_FRAGMENTS;
+         ++fragmentId) {
+        if (buffer.fragments.count(fragmentId) == 0 && buffer.nacked.count(fragmentId) == 0) {
+            missing += (listed.empty() ? "" : ",") + to_string(fragmentId);
+            listed.push_back(fragmentId);
+        }
+    }
+    if (listed.empty()) {
+        return;
+    }
+    buffer.nacked.insert(listed.begin(), listed.end());
+    buffer.lastNack = now;
+    log(LogLevel::DEBUG, string("NACK msgId=") + to_string(pkg.messageId) + " fragments [" + missing + "]");
+    queueConfirmationLocked(pkg, string("{\"nackMessageId\":") + to_string(pkg.messageId) +
+                                 ",\"missing\":[" + missing + "],\"wnd\":" + to_string(advertisedWindowLocked()) + "}");
+}
+
+void SessionManager::queueConfirmationLocked(const Package& pkg, string&& payload) {
     try {
         Priority ackPriority = static_cast<Priority>(min<uint64_t>(static_cast<uint64_t>(pkg.priority) + 1ULL, maxPriorityValue_));
         validationConfig_.validatePriority(ackPriority);
@@ -334,14 +1221,13 @@ void SessionManager::sendAckForPackageLocked(const Package& pkg) {
             pkg.connId,
             0,
             1,
-            string{},
+            move(payload),
             MessageFormat::CONFIRMATION,
             ackPriority,
             false,
             PackageStatus::QUEUED
         };
-
-        ack.payload = string("{\"ackPackageId\":") + to_string(pkg.packageId) + "}";
+        ack.peer = pkg.peer;
         validationConfig_.validatePackage(ack);
         outgoingPackages_.push(ack);
     } catch (const exception& ex) {
@@ -361,66 +1247,155 @@ void SessionManager::receivePackage(const Package& pkg) {
 
     Message messageToDeliver{};
     bool shouldDeliver = false;
+    bool orderedReleased = false;
 
     {
         lock_guard<mutex> lock(queueMutex_);
 
+        auto now = steady_clock::now();
+        uint64_t key = reassemblyKey(pkg.connId, pkg.messageId);
+        if (delivered_.count(key) > 0) {
+            if (pkg.requireAck) {
+                sendAckForPackageLocked(pkg);
+            }
+            log(LogLevel::DEBUG, string("Dropping duplicate of delivered msgId=") + to_string(pkg.messageId));
+            return;
+        }
+        // Checked before a buffer exists, so a stray fragment leaves none behind
+        auto it = receivedPackages_.find(key);
+        bool known = it != receivedPackages_.end();
+        int fragmentsCount = known ? it->second.fragmentsCount : pkg.fragmentsCount;
+        if (pkg.fragmentsCount != fragmentsCount || pkg.fragmentId < 0 || pkg.fragmentId >= fragmentsCount) {
+            if (pkg.requireAck) {
+                sendAckForPackageLocked(pkg);
+            }
+            log(LogLevel::WARN, string("Dropping fragment ") + to_string(pkg.fragmentId) + "/" +
+                    to_string(pkg.fragmentsCount) + " for msgId=" + to_string(pkg.messageId) +
+                    ": inconsistent with " + to_string(fragmentsCount) + " fragments");
+            return;
+        }
+        // A fragment arriving after the deadline cannot make the message
+        // useful again; expireReassembliesLocked() discards it on the next tick
+        if (known && it->second.deadline != steady_clock::time_point{} && now >= it->second.deadline) {
+            if (pkg.requireAck) {
+                sendAckForPackageLocked(pkg);
+            }
+            return;
+        }
+        bool isNew = !known || it->second.fragments.count(pkg.fragmentId) == 0;
+        // Left unacknowledged: the sender retransmits it once other messages
+        // have completed and freed their share
+        if (isNew && reassemblyBytes_ + pkg.payload.size() > maxReassemblyBytes_) {
+            log(LogLevel::WARN, string("Dropping fragment ") + to_string(pkg.fragmentId) + " for msgId=" +
+                    to_string(pkg.messageId) + ": incomplete messages hold " + to_string(reassemblyBytes_) +
+                    " bytes already");
+            return;
+        }
         if (pkg.requireAck) {
             sendAckForPackageLocked(pkg);
         }
 
-        receivedPackages_[pkg.messageId].push_back(pkg);
-        auto& vec = receivedPackages_[pkg.messageId];
+        if (!known) {
+            it = receivedPackages_.emplace(key, ReassemblyBuffer{}).first;
+            it->second.fragmentsCount = pkg.fragmentsCount;
+            it->second.ordered = pkg.ordered;
+            it->second.orderedStream = pkg.orderedStream;
+            it->second.sequence = pkg.sequence;
+        }
+        auto& buffer = it->second;
+        if (pkg.ttlMs > 0) {
+            auto deadline = now + milliseconds{pkg.ttlMs};
+            if (buffer.deadline == steady_clock::time_point{} || deadline < buffer.deadline) {
+                buffer.deadline = deadline;
+            }
+        }
+        // Retransmitted duplicates (lost ACKs) are acknowledged again but stored once
+        if (isNew) {
+            buffer.fragments.emplace(pkg.fragmentId, pkg.payload);
+            buffer.bytes += pkg.payload.size();
+            reassemblyBytes_ += pkg.payload.size();
+            buffer.lastActivity = now;
+        }
         log(LogLevel::DEBUG, string("Fragments received for msgId=") + to_string(pkg.messageId) +
-                ": " + to_string(vec.size()) + "/" + to_string(pkg.fragmentsCount));
+                ": " + to_string(buffer.fragments.size()) + "/" + to_string(pkg.fragmentsCount));
 
-        if (static_cast<int>(vec.size()) < pkg.fragmentsCount) {
+        if (static_cast<int>(buffer.fragments.size()) < buffer.fragmentsCount) {
+            // Only acknowledged messages are retransmitted
+            if (pkg.requireAck) {
+                sendNackForGapsLocked(pkg, buffer, now);
+            }
             return;
         }
 
-        sort(vec.begin(), vec.end(), [](const Package& a, const Package& b) { return a.fragmentId < b.fragmentId; });
         string fullPayload;
-        fullPayload.reserve(vec.size() * maxPacketSize_);
+        fullPayload.reserve(buffer.bytes);
+        for (auto& [fragmentId, fragment] : buffer.fragments) {
+            fullPayload += fragment;
+        }
 
-        for (int i = 0; i < pkg.fragmentsCount; ++i) {
-            if (vec[i].fragmentId != i) {
-                log(LogLevel::WARN, string("Fragment index mismatch at i=") + to_string(i) +
-                        ", got " + to_string(vec[i].fragmentId));
-                return;
+        eraseReassemblyLocked(it);
+        // A restarted peer reuses handshake ids, so those are never treated as duplicates
+        if (pkg.requireAck && pkg.format != MessageFormat::HANDSHAKE) {
+            delivered_.insert(key);
+            deliveredOrder_.push_back(key);
+            if (deliveredOrder_.size() > DELIVERED_HISTORY) {
+                delivered_.erase(deliveredOrder_.front());
+                deliveredOrder_.pop_front();
             }
-            fullPayload += vec[i].payload;
         }
 
-        receivedPackages_.erase(pkg.messageId);
-
+        log(LogLevel::DEBUG, string("All fragments received. Passing message up (") +
+                to_string(fullPayload.size()) + " bytes)");
         messageToDeliver = Message{
             pkg.messageId,
             pkg.connId,
-            fullPayload,
+            move(fullPayload),
             pkg.format,
             pkg.priority,
             pkg.requireAck,
             nullptr
         };
-        shouldDeliver = true;
-        log(LogLevel::DEBUG, string("All fragments received. Passing message up: '") + fullPayload + "'");
+        messageToDeliver.compressed = pkg.compressed;
+        messageToDeliver.delta = pkg.delta;
+        messageToDeliver.peer = pkg.peer;
+        if (pkg.ordered) {
+            orderMessageLocked(pkg, move(messageToDeliver));
+            orderedReleased = !readyOrdered_.empty();
+        } else {
+            shouldDeliver = true;
+        }
     }
 
     if (shouldDeliver) {
         sdk_.onMessageReceived(messageToDeliver);
     }
+    if (orderedReleased) {
+        deliverOrderedMessages();
+    }
 }
 
 bool SessionManager::getNextPackage(Package& out) {
     return outgoingPackages_.tryPop(out);
 }
 
+uint64_t SessionManager::reassemblyKey(ConnectionId connId, MessageId messageId) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(connId)) << 32) | static_cast<uint32_t>(messageId);
+}
+
+// Ids wrap; those still awaiting an ACK are skipped so a late ACK cannot
+// acknowledge a newer package. Acknowledged sends stop before every id is
+// taken (advanceMessageLocked); unacknowledged packages are never ACKed, so
+// they may share an id with one in flight.
 PackageId SessionManager::allocatePackageId() {
-    if (static_cast<uint64_t>(nextPackageId_) > maxPackageIdValue_) {
-        throw runtime_error("Package id overflow: exceeds configured bit width");
-    }
-    PackageId id = nextPackageId_;
-    ++nextPackageId_;
+    bool idsLeft = packageToMessage_.size() < maxPackageIdValue_;
+    PackageId id;
+    do {
+        if (static_cast<uint64_t>(nextPackageId_) > maxPackageIdValue_) {
+            nextPackageId_ = 1;
+        }
+        id = nextPackageId_;
+        ++nextPackageId_;
+    } while (idsLeft && packageToMessage_.count(id));
     validationConfig_.validatePackageId(id);
     return id;
 }
@@ -461,6 +1436,29 @@ bool SessionManager::ensureFragmentsFit(int total) const {
     return true;
 }
 
+// Fragments follow the link MTU, but a message that would need more fragments
+// than the header can number gets larger fragments instead of being dropped.
+// Optional header fields of the message shrink its fragments to keep frames within the MTU.
+size_t SessionManager::fragmentSizeFor(size_t payloadSize, size_t headerExtensionBytes) const {
+    uint64_t maxFragments = min(maxFragmentsCountValue_, maxFragmentIdValue_ + 1);
+    size_t minimumSize = static_cast<size_t>((payloadSize + maxFragments - 1) / maxFragments);
+    size_t packetSize = maxPacketSize_;
+    size_t mtuSize = packetSize > headerExtensionBytes ? packetSize - headerExtensionBytes : packetSize;
+    return min(max(mtuSize, minimumSize), validationConfig_.maxPayloadLengthBytes());
+}
+
+void SessionManager::setMaxPacketSize(size_t maxPacketSize) {
+    if (maxPacketSize == 0) {
+        throw invalid_argument("SessionManager requires positive maxPacketSize");
+    }
+    lock_guard<mutex> lock(queueMutex_);
+    if (maxPacketSize == maxPacketSize_) {
+        return;
+    }
+    maxPacketSize_ = maxPacketSize;
+    log(LogLevel::INFO, string("Fragment size set to ") + to_string(maxPacketSize) + " bytes");
+}
+
 void SessionManager::setRetransmissionConfig(int maxAttempts, chrono::milliseconds interval) {
     lock_guard<mutex> lock(queueMutex_);
     maxRetransmitAttempts_ = maxAttempts;
@@ -469,3 +1467,34 @@ void SessionManager::setRetransmissionConfig(int maxAttempts, chrono::millisecon
         to_string(maxAttempts) + " interval=" + to_string(interval.count()) + "ms");
 }
 
+void SessionManager::setRetransmitTimeoutBounds(chrono::milliseconds minTimeout, chrono::milliseconds maxTimeout) {
+    if (minTimeout.count() <= 0 || maxTimeout < minTimeout) {
+        throw invalid_argument("SessionManager requires 0 < minTimeout <= maxTimeout");
+    }
+    lock_guard<mutex> lock(queueMutex_);
+    minRetransmitTimeout_ = minTimeout;
+    maxRetransmitTimeout_ = maxTimeout;
+    // Existing estimates are re-clamped; later samples use the new bounds
+    for (auto& [connId, window] : windows_) {
+        if (window.hasRttSample) {
+            window.rto = clamp<microseconds>(window.rto, minRetransmitTimeout_, maxRetransmitTimeout_);
+        }
+    }
+}
+
+void SessionManager::setNackInterval(chrono::milliseconds interval) {
+    if (interval.count() < 0) {
+        throw invalid_argument("SessionManager requires a non-negative NACK interval");
+    }
+    lock_guard<mutex> lock(queueMutex_);
+    nackInterval_ = interval;
+}
+
+void SessionManager::setReassemblyLimits(size_t maxBytes, chrono::milliseconds idleTimeout) {
+    if (maxBytes == 0 || idleTimeout.count() <= 0) {
+        throw invalid_argument("SessionManager requires a positive reassembly byte limit and idle timeout");
+    }
+    lock_guard<mutex> lock(queueMutex_);
+    maxReassemblyBytes_ = maxBytes;
+    reassemblyIdleTimeout_ = idleTimeout;
+}
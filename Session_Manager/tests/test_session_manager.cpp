@@ -1,11 +1,19 @@
 #include "EminentSdk.hpp"
 #include "PhysicalLayerInMemory.hpp"
+#include "CodingModule.hpp"
 #include "ValidationConfig.hpp"
 #include <gtest/gtest.h>
 #include <atomic>
+#include <algorithm>
 #include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <set>
 #include <string>
 #include <thread>
+#include <vector>
 
 using namespace std;
 using namespace chrono;
@@ -160,3 +168,932 @@ TEST(SessionManager, AckDeliveryCallbacks) {
     }
     EXPECT_EQ(deliveredCount.load(), MSG_COUNT);
 }
+
+TEST(SessionManager, LargeMessageUsesExtendedFragments) {
+    auto medium = make_shared<InMemoryMedium>();
+    auto plA = make_unique<PhysicalLayerInMemory>(1001, medium);
+    auto plB = make_unique<PhysicalLayerInMemory>(2002, medium);
+    // 4-bit fragment fields: standard messages top out at 15 fragments
+    ValidationConfig vc(16, 16, 24, 24, 4, 4, 4, 16);
+    EminentSdk sdkA(std::move(plA), vc);
+    EminentSdk sdkB(std::move(plB), vc);
+    sdkA.setLargeMessageWindow(4);
+
+    sdkA.initialize(1001, [](){}, [](const string&){},
+        [](DeviceId, const string&) { return true; });
+
+    atomic<ConnectionId> connB{-1};
+    sdkB.initialize(2002, [](){}, [](const string&){},
+        [](DeviceId, const string&) { return true; },
+        [&](ConnectionId cid, DeviceId) { connB = cid; });
+
+    atomic<ConnectionId> connA{-1};
+    sdkA.connect(2002, 5, nullptr, nullptr, nullptr, nullptr,
+        [&](ConnectionId cid) { connA = cid; }, nullptr);
+
+    auto deadline = steady_clock::now() + 5s;
+    while ((connA.load() == -1 || connB.load() == -1) && steady_clock::now() < deadline) {
+        this_thread::sleep_for(50ms);
+    }
+    ASSERT_NE(connA.load(), -1);
+    ASSERT_NE(connB.load(), -1);
+
+    vector<uint8_t> image(vc.maxStandardMessageBytes() * 2 + 123);
+    for (size_t i = 0; i < image.size(); ++i) {
+        image[i] = static_cast<uint8_t>(i * 31 + (i >> 12));
+    }
+
+    atomic<bool> received{false};
+    string receivedPayload;
+    sdkB.setOnMessageHandler(connB.load(), [&](const Message& msg) {
+        receivedPayload = msg.payload;
+        received = true;
+    });
+
+    atomic<bool> delivered{false};
+    sdkA.sendBinary(connA.load(), image, [&]() { delivered = true; });
+
+    deadline = steady_clock::now() + 20s;
+    while ((!received.load() || !delivered.load()) && steady_clock::now() < deadline) {
+        this_thread::sleep_for(50ms);
+    }
+    EXPECT_TRUE(received.load());
+    EXPECT_TRUE(delivered.load());
+    EXPECT_EQ(receivedPayload, string(image.begin(), image.end()));
+}
+
+// In-memory link with a small MTU, so one message spans many fragments
+class SmallMtuInMemoryLayer : public PhysicalLayerInMemory {
+public:
+    using PhysicalLayerInMemory::PhysicalLayerInMemory;
+    size_t maxFrameBytesOnLink() const override { return 300; }
+};
+
+// Blocks B's receive path, sends a many-fragment message from A and returns
+// the largest number of A's frames waiting on the medium at once.
+static size_t peakInFlightWhileReceiverStalls(size_t senderWindow, size_t receiverWindow) {
+    auto medium = make_shared<InMemoryMedium>();
+    auto plA = make_unique<SmallMtuInMemoryLayer>(1001, medium);
+    auto plB = make_unique<PhysicalLayerInMemory>(2002, medium);
+    ValidationConfig vc;
+    EminentSdk sdkA(std::move(plA), vc);
+    EminentSdk sdkB(std::move(plB), vc);
+    sdkA.setFlowWindow(senderWindow);
+    sdkB.setReceiveWindow(receiverWindow);
+    // No retransmissions while B is stalled, whatever the warm-up RTT
+    sdkA.setRetransmissionConfig(5, 5000ms);
+    sdkA.setRetransmitTimeoutBounds(5000ms, 10000ms);
+
+    sdkA.initialize(1001, [](){}, [](const string&){},
+        [](DeviceId, const string&) { return true; });
+
+    atomic<ConnectionId> connB{-1};
+    sdkB.initialize(2002, [](){}, [](const string&){},
+        [](DeviceId, const string&) { return true; },
+        [&](ConnectionId cid, DeviceId) { connB = cid; });
+
+    atomic<ConnectionId> connA{-1};
+    sdkA.connect(2002, 5, nullptr, nullptr, nullptr, nullptr,
+        [&](ConnectionId cid) { connA = cid; }, nullptr, 60s);
+
+    auto deadline = steady_clock::now() + 5s;
+    while ((connA.load() == -1 || connB.load() == -1) && steady_clock::now() < deadline) {
+        this_thread::sleep_for(50ms);
+    }
+    if (connA.load() == -1 || connB.load() == -1) {
+        ADD_FAILURE() << "Handshake did not complete";
+        return 0;
+    }
+
+    atomic<bool> stall{false};
+    atomic<bool> stalled{false};
+    atomic<bool> received{false};
+    string receivedPayload;
+    sdkB.setOnMessageHandler(connB.load(), [&](const Message& msg) {
+        if (msg.payload == "stall") {
+            stalled = true;
+            while (stall) {
+                this_thread::sleep_for(5ms);
+            }
+            return;
+        }
+        if (msg.payload != "warmup") {
+            receivedPayload = msg.payload;
+            received = true;
+        }
+    });
+
+    // The warm-up ACK carries B's receive window to A
+    atomic<bool> warmedUp{false};
+    sdkA.send(connA.load(), "warmup", [&]() { warmedUp = true; });
+    deadline = steady_clock::now() + 5s;
+    while (!warmedUp && steady_clock::now() < deadline) {
+        this_thread::sleep_for(10ms);
+    }
+    EXPECT_TRUE(warmedUp.load());
+
+    stall = true;
+    sdkA.send(connA.load(), "stall");
+    deadline = steady_clock::now() + 5s;
+    while (!stalled && steady_clock::now() < deadline) {
+        this_thread::sleep_for(5ms);
+    }
+    EXPECT_TRUE(stalled.load());
+
+    // ~110 fragments; random so that compression does not shrink it
+    mt19937 rng(9);
+    string payload(30000, '\0');
+    for (auto& c : payload) {
+        c = static_cast<char>(rng());
+    }
+    atomic<bool> delivered{false};
+    sdkA.send(connA.load(), payload, [&]() { delivered = true; });
+
+    size_t peak = 0;
+    for (int i = 0; i < 60; ++i) {
+        {
+            lock_guard<mutex> lock(medium->mutex);
+            size_t fromA = static_cast<size_t>(count_if(medium->entries.begin(), medium->entries.end(),
+                [](const InMemoryMediumEntry& entry) { return entry.senderId == 1001; }));
+            peak = max(peak, fromA);
+        }
+        this_thread::sleep_for(5ms);
+    }
+    stall = false;
+
+    deadline = steady_clock::now() + 10s;
+    while ((!received.load() || !delivered.load()) && steady_clock::now() < deadline) {
+        this_thread::sleep_for(20ms);
+    }
+    EXPECT_TRUE(received.load());
+    EXPECT_TRUE(delivered.load());
+    EXPECT_EQ(receivedPayload, payload);
+    return peak;
+}
+
+TEST(SessionManager, FlowWindowLimitsUnacknowledgedFragments) {
+    size_t peak = peakInFlightWhileReceiverStalls(8, SessionManager::DEFAULT_RECEIVE_WINDOW);
+    EXPECT_GT(peak, 0u);
+    EXPECT_LE(peak, 8u);
+}
+
+TEST(SessionManager, ReceiveWindowThrottlesSender) {
+    size_t peak = peakInFlightWhileReceiverStalls(SessionManager::DEFAULT_FLOW_WINDOW, 3);
+    EXPECT_GT(peak, 0u);
+    EXPECT_LE(peak, 3u);
+}
+
+TEST(SessionManager, RetransmitTimeoutFollowsMeasuredRtt) {
+    auto medium = make_shared<InMemoryMedium>();
+    auto plA = make_unique<PhysicalLayerInMemory>(1001, medium);
+    auto plB = make_unique<PhysicalLayerInMemory>(2002, medium);
+    ValidationConfig vc;
+    EminentSdk sdkA(std::move(plA), vc);
+    EminentSdk sdkB(std::move(plB), vc);
+
+    sdkA.initialize(1001, [](){}, [](const string&){},
+        [](DeviceId, const string&) { return true; });
+
+    atomic<ConnectionId> connB{-1};
+    sdkB.initialize(2002, [](){}, [](const string&){},
+        [](DeviceId, const string&) { return true; },
+        [&](ConnectionId cid, DeviceId) {
+            connB = cid;
+            sdkB.setOnMessageHandler(cid, [](const Message&){});
+        });
+
+    atomic<ConnectionId> connA{-1};
+    sdkA.connect(2002, 5, nullptr, nullptr, nullptr, nullptr,
+        [&](ConnectionId cid) { connA = cid; }, nullptr);
+
+    auto deadline = steady_clock::now() + 5s;
+    while ((connA.load() == -1 || connB.load() == -1) && steady_clock::now() < deadline) {
+        this_thread::sleep_for(50ms);
+    }
+    ASSERT_NE(connA.load(), -1);
+
+    // Before any ACK the configured interval is the timeout
+    vector<ConnectionStats> stats;
+    sdkA.getStats([&](const vector<ConnectionStats>& s) { stats = s; }, connA.load());
+    ASSERT_EQ(stats.size(), 1u);
+    EXPECT_DOUBLE_EQ(stats[0].retransmitTimeoutMs, 500.0);
+    EXPECT_DOUBLE_EQ(stats[0].avgLatencyMs, 0.0);
+
+    constexpr int MSG_COUNT = 20;
+    atomic<int> deliveredCount{0};
+    for (int i = 0; i < MSG_COUNT; ++i) {
+        sdkA.send(connA.load(), "rtt_" + to_string(i), [&]() { deliveredCount++; });
+        this_thread::sleep_for(10ms);
+    }
+    deadline = steady_clock::now() + 10s;
+    while (deliveredCount.load() < MSG_COUNT && steady_clock::now() < deadline) {
+        this_thread::sleep_for(20ms);
+    }
+    ASSERT_EQ(deliveredCount.load(), MSG_COUNT);
+
+    sdkA.getStats([&](const vector<ConnectionStats>& s) { stats = s; }, connA.load());
+    ASSERT_EQ(stats.size(), 1u);
+    EXPECT_GT(stats[0].avgLatencyMs, 0.0);
+    // An in-memory link answers far faster than the 500 ms default
+    EXPECT_GE(stats[0].retransmitTimeoutMs, 50.0);
+    EXPECT_LT(stats[0].retransmitTimeoutMs, 500.0);
+    EXPECT_GE(stats[0].retransmitTimeoutMs, stats[0].avgLatencyMs);
+    EXPECT_EQ(stats[0].queuedMessages, 0);
+    EXPECT_GT(stats[0].throughputMbps, 0.0);
+    EXPECT_GE(stats[0].congestionWindow, static_cast<int>(AimdController::INITIAL_WINDOW));
+}
+
+// Point-to-point link with a small MTU whose sender can drop chosen frames
+struct DroppingMedium {
+    mutex guard;
+    deque<Frame> toA;
+    deque<Frame> toB;
+    // Called with every frame A sends; true drops it
+    function<bool(const Frame&)> dropFromA;
+};
+
+class DroppingLayer : public AbstractPhysicalLayer {
+public:
+    DroppingLayer(shared_ptr<DroppingMedium> medium, bool sideA)
+        : AbstractPhysicalLayer("DroppingLayer"), medium_(std::move(medium)), sideA_(sideA) {}
+    ~DroppingLayer() override {
+        stop_ = true;
+        if (worker_.joinable()) {
+            worker_.join();
+        }
+    }
+
+    void configure(ThreadSafeQueue<Frame>& outgoingFrames, CodingModule& codingModule,
+                   const ValidationConfig& validationConfig) override {
+        setEnvironment(outgoingFrames, codingModule, validationConfig);
+    }
+    void start() override {
+        worker_ = thread([this]() {
+            while (!stop_) {
+                tick();
+                this_thread::sleep_for(1ms);
+            }
+        });
+    }
+    void tick() override {
+        Frame frame;
+        vector<Frame> received;
+        {
+            lock_guard<mutex> lock(medium_->guard);
+            while (outgoingFramesFromCodingModule_->tryPop(frame)) {
+                if (sideA_ && medium_->dropFromA && medium_->dropFromA(frame)) {
+                    continue;
+                }
+                (sideA_ ? medium_->toB : medium_->toA).push_back(std::move(frame));
+            }
+            auto& inbox = sideA_ ? medium_->toA : medium_->toB;
+            received.assign(inbox.begin(), inbox.end());
+            inbox.clear();
+        }
+        for (const auto& rx : received) {
+            try {
+                codingModule_->receiveFrameWithCrc(rx);
+            } catch (const exception&) {
+                // Dropped like an invalid datagram on a real link
+            }
+        }
+    }
+    bool tryReceive(Frame&) override { return false; }
+    size_t maxFrameBytesOnLink() const override { return 300; }
+
+private:
+    shared_ptr<DroppingMedium> medium_;
+    bool sideA_;
+    atomic<bool> stop_{false};
+    thread worker_;
+};
+
+// Two SDKs joined by a DroppingMedium; connect() completes the handshake
+struct DroppingPair {
+    shared_ptr<DroppingMedium> medium = make_shared<DroppingMedium>();
+    EminentSdk sdkA;
+    EminentSdk sdkB;
+    atomic<ConnectionId> connA{-1};
+    atomic<ConnectionId> connB{-1};
+
+    explicit DroppingPair(const ValidationConfig& vc = ValidationConfig())
+        : sdkA(make_unique<DroppingLayer>(medium, true), vc),
+          sdkB(make_unique<DroppingLayer>(medium, false), vc) {}
+
+    ~DroppingPair() {
+        {
+            lock_guard<mutex> lock(medium->guard);
+            medium->dropFromA = nullptr;
+        }
+        sdkA.shutdown();
+        sdkB.shutdown();
+    }
+
+    // Returns false if the handshake did not complete in time
+    bool connect() {
+        sdkA.initialize(1001, [](){}, [](const string&){},
+            [](DeviceId, const string&) { return true; });
+        sdkB.initialize(2002, [](){}, [](const string&){},
+            [](DeviceId, const string&) { return true; },
+            [this](ConnectionId cid, DeviceId) { connB = cid; });
+        sdkA.connect(2002, 5, nullptr, nullptr, nullptr, nullptr,
+            [this](ConnectionId cid) { connA = cid; }, nullptr);
+        auto deadline = steady_clock::now() + 5s;
+        while ((connA.load() == -1 || connB.load() == -1) && steady_clock::now() < deadline) {
+            this_thread::sleep_for(20ms);
+        }
+        return connA.load() != -1 && connB.load() != -1;
+    }
+};
+
+TEST(SessionManager, NackRecoversFragmentBeforeTimeout) {
+    DroppingPair p;
+    // Recovery by timeout alone would take at least two seconds
+    p.sdkA.setRetransmissionConfig(5, 2000ms);
+    p.sdkA.setRetransmitTimeoutBounds(2000ms, 10000ms);
+
+    ASSERT_TRUE(p.connect());
+
+    mutex receivedGuard;
+    string receivedPayload;
+    atomic<bool> received{false};
+    p.sdkB.setOnMessageHandler(p.connB.load(), [&](const Message& msg) {
+        lock_guard<mutex> lock(receivedGuard);
+        receivedPayload = msg.payload;
+        received = true;
+    });
+
+    // Drop the tenth full-size fragment of a ~110-fragment message
+    int fragmentFrames = 0;
+    {
+        lock_guard<mutex> lock(p.medium->guard);
+        p.medium->dropFromA = [&](const Frame& frame) {
+            return frame.data.size() > 200 && ++fragmentFrames == 10;
+        };
+    }
+    mt19937 rng(5);
+    string payload(30000, '\0');
+    for (auto& c : payload) {
+        c = static_cast<char>(rng());
+    }
+    auto start = steady_clock::now();
+    atomic<bool> delivered{false};
+    p.sdkA.send(p.connA.load(), payload, [&]() { delivered = true; });
+
+    auto deadline = start + 5s;
+    while ((!received.load() || !delivered.load()) && steady_clock::now() < deadline) {
+        this_thread::sleep_for(5ms);
+    }
+    auto elapsed = steady_clock::now() - start;
+    ASSERT_TRUE(received.load());
+    ASSERT_TRUE(delivered.load());
+    EXPECT_LT(duration_cast<milliseconds>(elapsed).count(), 1000);
+    {
+        lock_guard<mutex> lock(receivedGuard);
+        EXPECT_EQ(receivedPayload, payload);
+    }
+    {
+        lock_guard<mutex> lock(p.medium->guard);
+        p.medium->dropFromA = nullptr;
+    }
+}
+
+TEST(SessionManager, DeadlineStopsRetransmitsAndDiscardsReassembly) {
+    DroppingPair p;
+    p.sdkA.setRetransmissionConfig(50, 50ms);
+
+    ASSERT_TRUE(p.connect());
+
+    atomic<int> received{0};
+    p.sdkB.setOnMessageHandler(p.connB.load(), [&](const Message&) { ++received; });
+
+    // Every copy of fragment 3 and later is lost, so the message cannot complete
+    int fragmentFrames = 0;
+    {
+        lock_guard<mutex> lock(p.medium->guard);
+        p.medium->dropFromA = [&](const Frame& frame) {
+            return frame.data.size() > 200 && ++fragmentFrames >= 3;
+        };
+    }
+    // Incompressible, so it really spans several fragments
+    mt19937 rng(7);
+    string payload(2000, '\0');
+    for (auto& c : payload) {
+        c = static_cast<char>(rng());
+    }
+    atomic<bool> delivered{false};
+    atomic<bool> expired{false};
+    auto start = steady_clock::now();
+    p.sdkA.send(p.connA.load(), payload, MessageFormat::JSON, 5, true, 300ms,
+              [&]() { delivered = true; }, [&]() { expired = true; });
+
+    auto deadline = start + 3s;
+    while (!expired.load() && steady_clock::now() < deadline) {
+        this_thread::sleep_for(5ms);
+    }
+    ASSERT_TRUE(expired.load());
+    EXPECT_LT(duration_cast<milliseconds>(steady_clock::now() - start).count(), 600);
+    // No further retransmits once expired
+    int framesAtExpiry;
+    {
+        lock_guard<mutex> lock(p.medium->guard);
+        framesAtExpiry = fragmentFrames;
+    }
+    this_thread::sleep_for(300ms);
+    {
+        lock_guard<mutex> lock(p.medium->guard);
+        EXPECT_EQ(fragmentFrames, framesAtExpiry);
+        p.medium->dropFromA = nullptr;
+    }
+    EXPECT_FALSE(delivered.load());
+    EXPECT_EQ(received.load(), 0);
+
+    auto statsOf = [](EminentSdk& sdk) {
+        vector<ConnectionStats> result;
+        sdk.getStats([&](const vector<ConnectionStats>& stats) { result = stats; });
+        return result;
+    };
+    auto statsA = statsOf(p.sdkA);
+    auto statsB = statsOf(p.sdkB);
+    ASSERT_EQ(statsA.size(), 1u);
+    ASSERT_EQ(statsB.size(), 1u);
+    EXPECT_EQ(statsA[0].expiredMessages, 1u);
+    EXPECT_EQ(statsB[0].expiredReassemblies, 1u);
+
+    // The connection carries on once the link recovers
+    p.sdkA.send(p.connA.load(), "fresh", MessageFormat::JSON, 5, true, 1000ms, [&]() { delivered = true; });
+    deadline = steady_clock::now() + 2s;
+    while (!delivered.load() && steady_clock::now() < deadline) {
+        this_thread::sleep_for(5ms);
+    }
+    EXPECT_TRUE(delivered.load());
+    EXPECT_EQ(received.load(), 1);
+}
+
+TEST(SessionManager, ReassemblyLimitsBoundIncompleteMessages) {
+    DroppingPair p;
+    p.sdkA.setRetransmissionConfig(3, 50ms);
+    p.sdkB.setReassemblyLimits(1 << 20, 300ms);
+
+    ASSERT_TRUE(p.connect());
+
+    atomic<int> received{0};
+    p.sdkB.setOnMessageHandler(p.connB.load(), [&](const Message&) { ++received; });
+    auto expiredAtB = [&]() {
+        uint64_t expired = 0;
+        p.sdkB.getStats([&](const vector<ConnectionStats>& stats) { expired = stats.at(0).expiredReassemblies; });
+        return expired;
+    };
+    mt19937 rng(13);
+    string payload(2000, '\0');
+    for (auto& c : payload) {
+        c = static_cast<char>(rng());
+    }
+    atomic<int> failed{0};
+    atomic<bool> delivered{false};
+
+    // Fragment 3 and later never arrive and the message has no deadline:
+    // the receiver drops its part once the sender has stopped retransmitting
+    int fragmentFrames = 0;
+    {
+        lock_guard<mutex> lock(p.medium->guard);
+        p.medium->dropFromA = [&](const Frame& frame) {
+            return frame.data.size() > 200 && ++fragmentFrames >= 3;
+        };
+    }
+    p.sdkA.send(p.connA.load(), payload, MessageFormat::JSON, 5, true,
+              [&]() { delivered = true; }, [&](const string&) { ++failed; });
+    auto deadline = steady_clock::now() + 3s;
+    while ((failed.load() < 1 || expiredAtB() < 1) && steady_clock::now() < deadline) {
+        this_thread::sleep_for(10ms);
+    }
+    EXPECT_EQ(failed.load(), 1);
+    EXPECT_EQ(expiredAtB(), 1u);
+    {
+        lock_guard<mutex> lock(p.medium->guard);
+        p.medium->dropFromA = nullptr;
+    }
+
+    // A message larger than the byte limit never completes; its fragments
+    // beyond the limit stay unacknowledged until the sender gives up
+    p.sdkB.setReassemblyLimits(1000, 300ms);
+    p.sdkA.send(p.connA.load(), payload, MessageFormat::JSON, 5, true,
+              [&]() { delivered = true; }, [&](const string&) { ++failed; });
+    deadline = steady_clock::now() + 3s;
+    while (failed.load() < 2 && steady_clock::now() < deadline) {
+        this_thread::sleep_for(10ms);
+    }
+    EXPECT_EQ(failed.load(), 2);
+    EXPECT_FALSE(delivered.load());
+    EXPECT_EQ(received.load(), 0);
+
+    // The partial message is let go, so small ones still get through
+    p.sdkA.send(p.connA.load(), "fresh", MessageFormat::JSON, 5, true, [&]() { delivered = true; });
+    deadline = steady_clock::now() + 2s;
+    while (!delivered.load() && steady_clock::now() < deadline) {
+        this_thread::sleep_for(5ms);
+    }
+    EXPECT_TRUE(delivered.load());
+    EXPECT_EQ(received.load(), 1);
+}
+
+TEST(SessionManager, ConflatedSendsKeepOnlyLatestValue) {
+    DroppingPair p;
+    p.sdkA.setRetransmissionConfig(50, 50ms);
+
+    ASSERT_TRUE(p.connect());
+
+    mutex receivedGuard;
+    vector<string> received;
+    p.sdkB.setOnMessageHandler(p.connB.load(), [&](const Message& msg) {
+        lock_guard<mutex> lock(receivedGuard);
+        received.push_back(msg.payload);
+    });
+
+    // While the link is down the producer keeps writing; each value replaces
+    // the queued or unacknowledged one before it
+    {
+        lock_guard<mutex> lock(p.medium->guard);
+        p.medium->dropFromA = [](const Frame&) { return true; };
+    }
+    atomic<int> delivered{0};
+    mutex reasonGuard;
+    vector<string> reasons;
+    auto onFailed = [&](const string& reason) {
+        lock_guard<mutex> lock(reasonGuard);
+        reasons.push_back(reason);
+    };
+    for (int i = 0; i < 50; ++i) {
+        p.sdkA.sendLatest(p.connA.load(), "pose", "pose:" + to_string(i), MessageFormat::JSON, 5, true,
+                          [&]() { ++delivered; }, onFailed);
+        this_thread::sleep_for(i % 10 == 0 ? 25ms : 1ms);
+    }
+    p.sdkA.sendLatest(p.connA.load(), "battery", "battery:87", [&]() { ++delivered; });
+    this_thread::sleep_for(50ms);
+    {
+        lock_guard<mutex> lock(p.medium->guard);
+        p.medium->dropFromA = nullptr;
+    }
+
+    auto deadline = steady_clock::now() + 3s;
+    while (delivered.load() < 2 && steady_clock::now() < deadline) {
+        this_thread::sleep_for(5ms);
+    }
+    this_thread::sleep_for(100ms);
+    EXPECT_EQ(delivered.load(), 2);
+    {
+        lock_guard<mutex> lock(receivedGuard);
+        sort(received.begin(), received.end());
+        EXPECT_EQ(received, (vector<string>{"battery:87", "pose:49"}));
+    }
+    vector<ConnectionStats> stats;
+    p.sdkA.getStats([&](const vector<ConnectionStats>& s) { stats = s; });
+    ASSERT_EQ(stats.size(), 1u);
+    EXPECT_EQ(stats[0].conflatedMessages, 49u);
+    // Every replaced value is reported, naming a later message
+    lock_guard<mutex> lock(reasonGuard);
+    EXPECT_EQ(reasons.size(), 49u);
+    for (const auto& reason : reasons) {
+        EXPECT_EQ(reason.rfind("superseded by message ", 0), 0u) << reason;
+    }
+}
+
+TEST(SessionManager, FailedDeliveryReportedAndPurgedOnDisconnect) {
+    DroppingPair p;
+    p.sdkA.setRetransmissionConfig(3, 50ms);
+
+    ASSERT_TRUE(p.connect());
+
+    // Small frames are lost while dropSmall is set; fragment frames from the third on always
+    atomic<bool> dropSmall{true};
+    int fragmentFrames = 0;
+    {
+        lock_guard<mutex> lock(p.medium->guard);
+        p.medium->dropFromA = [&](const Frame& frame) {
+            return frame.data.size() > 200 ? ++fragmentFrames >= 3 : dropSmall.load();
+        };
+    }
+
+    mutex reasonGuard;
+    vector<string> reasons;
+    auto onFailed = [&](const string& reason) {
+        lock_guard<mutex> lock(reasonGuard);
+        reasons.push_back(reason);
+    };
+    auto failures = [&]() {
+        lock_guard<mutex> lock(reasonGuard);
+        return reasons.size();
+    };
+    atomic<bool> delivered{false};
+
+    // Retransmits run out
+    p.sdkA.send(p.connA.load(), "lost", MessageFormat::JSON, 5, true, [&]() { delivered = true; }, onFailed);
+    auto deadline = steady_clock::now() + 3s;
+    while (failures() < 1 && steady_clock::now() < deadline) {
+        this_thread::sleep_for(5ms);
+    }
+    ASSERT_EQ(failures(), 1u);
+    EXPECT_EQ(reasons[0], "retransmission attempts exhausted");
+    dropSmall = false;
+
+    // Disconnect fails the incomplete message at once and stops its retransmits
+    p.sdkA.setRetransmissionConfig(50, 50ms);
+    mt19937 rng(11);
+    string payload(2000, '\0');
+    for (auto& c : payload) {
+        c = static_cast<char>(rng());
+    }
+    p.sdkA.sendBinary(p.connA.load(), vector<uint8_t>(payload.begin(), payload.end()), 5, true,
+                    [&]() { delivered = true; }, onFailed);
+    this_thread::sleep_for(200ms);
+    auto disconnectedAt = steady_clock::now();
+    p.sdkA.disconnect(p.connA.load());
+    deadline = disconnectedAt + 2s;
+    while (failures() < 2 && steady_clock::now() < deadline) {
+        this_thread::sleep_for(5ms);
+    }
+    ASSERT_EQ(failures(), 2u);
+    EXPECT_LT(duration_cast<milliseconds>(steady_clock::now() - disconnectedAt).count(), 200);
+    EXPECT_EQ(reasons[1], "connection closed");
+    int framesAtPurge;
+    {
+        lock_guard<mutex> lock(p.medium->guard);
+        framesAtPurge = fragmentFrames;
+    }
+    this_thread::sleep_for(300ms);
+    {
+        lock_guard<mutex> lock(p.medium->guard);
+        EXPECT_EQ(fragmentFrames, framesAtPurge);
+        p.medium->dropFromA = nullptr;
+    }
+    EXPECT_FALSE(delivered.load());
+}
+
+TEST(SessionManager, OrderedStreamsKeepSendOrder) {
+    DroppingPair p;
+    p.sdkA.setRetransmissionConfig(50, 50ms);
+
+    ASSERT_TRUE(p.connect());
+
+    mutex receivedGuard;
+    vector<string> received;
+    p.sdkB.setOnMessageHandler(p.connB.load(), [&](const Message& msg) {
+        lock_guard<mutex> lock(receivedGuard);
+        received.push_back(msg.payload);
+    });
+    auto waitFor = [&](size_t count) {
+        auto until = steady_clock::now() + 3s;
+        while (steady_clock::now() < until) {
+            {
+                lock_guard<mutex> lock(receivedGuard);
+                if (received.size() >= count) {
+                    return vector<string>(received);
+                }
+            }
+            this_thread::sleep_for(5ms);
+        }
+        lock_guard<mutex> lock(receivedGuard);
+        return vector<string>(received);
+    };
+
+    // First copies of the listed payloads are lost, the rest of each always
+    set<string> dropOnce;
+    set<string> dropAlways;
+    {
+        lock_guard<mutex> lock(p.medium->guard);
+        p.medium->dropFromA = [&](const Frame& frame) {
+            auto carries = [&](const string& text) {
+                return search(frame.data.begin(), frame.data.end(), text.begin(), text.end()) != frame.data.end();
+            };
+            for (auto it = dropOnce.begin(); it != dropOnce.end(); ++it) {
+                if (carries(*it)) {
+                    dropOnce.erase(it);
+                    return true;
+                }
+            }
+            return any_of(dropAlways.begin(), dropAlways.end(), carries);
+        };
+    }
+    auto drop = [&](set<string>& which, const string& payload) {
+        lock_guard<mutex> lock(p.medium->guard);
+        which.insert(payload);
+    };
+
+    // A lost message holds back the ones sent after it
+    p.sdkA.setDeliveryMode(p.connA.load(), DeliveryMode::ORDERED);
+    drop(dropOnce, "m3");
+    vector<string> expected;
+    for (int i = 0; i < 8; ++i) {
+        expected.push_back("m" + to_string(i));
+        p.sdkA.send(p.connA.load(), expected.back(), MessageFormat::JSON, 5, true, nullptr);
+    }
+    EXPECT_EQ(waitFor(expected.size()), expected);
+
+    // Streams are independent: control traffic passes a stalled bulk stream
+    drop(dropOnce, "bulk-0");
+    p.sdkA.sendOrdered(p.connA.load(), 1, "bulk-0", MessageFormat::JSON, 5);
+    p.sdkA.sendOrdered(p.connA.load(), 1, "bulk-1", MessageFormat::JSON, 5);
+    this_thread::sleep_for(5ms);
+    p.sdkA.sendOrdered(p.connA.load(), 0, "control", MessageFormat::JSON, 5);
+    for (const char* payload : {"control", "bulk-0", "bulk-1"}) {
+        expected.push_back(payload);
+    }
+    EXPECT_EQ(waitFor(expected.size()), expected);
+
+    // A message the sender gives up on is skipped once the next one says so
+    drop(dropAlways, "stale");
+    p.sdkA.send(p.connA.load(), "stale", MessageFormat::JSON, 5, true, 100ms, nullptr);
+    p.sdkA.send(p.connA.load(), "held", MessageFormat::JSON, 5, true, nullptr);
+    this_thread::sleep_for(300ms);
+    {
+        lock_guard<mutex> lock(receivedGuard);
+        EXPECT_EQ(received.size(), expected.size());
+    }
+    p.sdkA.send(p.connA.load(), "next", MessageFormat::JSON, 5, true, nullptr);
+    expected.push_back("held");
+    expected.push_back("next");
+    EXPECT_EQ(waitFor(expected.size()), expected);
+
+    vector<ConnectionStats> stats;
+    p.sdkB.getStats([&](const vector<ConnectionStats>& s) { stats = s; });
+    ASSERT_EQ(stats.size(), 1u);
+    EXPECT_GE(stats[0].reorderedMessages, 5u);
+    EXPECT_EQ(stats[0].skippedMessages, 1u);
+    {
+        lock_guard<mutex> lock(p.medium->guard);
+        p.medium->dropFromA = nullptr;
+    }
+}
+
+TEST(SessionManager, PackageIdWrapSkipsUnacknowledgedIds) {
+    // 8-bit package ids: 254 usable values, so the bulk below wraps them
+    DroppingPair p(ValidationConfig(16, 16, 24, 8));
+    p.sdkA.setRetransmissionConfig(100, 100ms);
+    p.sdkA.setRetransmitTimeoutBounds(100ms, 200ms);
+    ASSERT_TRUE(p.connect());
+
+    // A first full header gives the peer its header-compression context
+    atomic<int> delivered{0};
+    p.sdkA.send(p.connA.load(), "warm-up", [&]() { ++delivered; });
+    auto deadline = steady_clock::now() + 2s;
+    while (delivered.load() < 1 && steady_clock::now() < deadline) {
+        this_thread::sleep_for(5ms);
+    }
+    ASSERT_EQ(delivered.load(), 1);
+    delivered = 0;
+
+    atomic<bool> dropStuck{true};
+    {
+        lock_guard<mutex> lock(p.medium->guard);
+        p.medium->dropFromA = [&](const Frame& frame) {
+            const string marker = "stuck";
+            return dropStuck.load() &&
+                search(frame.data.begin(), frame.data.end(), marker.begin(), marker.end()) != frame.data.end();
+        };
+    }
+    atomic<bool> stuckDelivered{false};
+    atomic<bool> stuckFailed{false};
+    p.sdkA.send(p.connA.load(), "stuck", MessageFormat::JSON, 5, true,
+                [&]() { stuckDelivered = true; }, [&](const string&) { stuckFailed = true; });
+
+    // The stuck package keeps its id while the allocator wraps past it
+    const int bulk = 300;
+    for (int i = 0; i < bulk; ++i) {
+        p.sdkA.send(p.connA.load(), "bulk-" + to_string(i), [&]() { ++delivered; });
+    }
+    deadline = steady_clock::now() + 5s;
+    while (delivered.load() < bulk && steady_clock::now() < deadline) {
+        this_thread::sleep_for(5ms);
+    }
+    ASSERT_EQ(delivered.load(), bulk);
+    EXPECT_FALSE(stuckDelivered.load());
+
+    // Its ACK is still credited to it once the link lets it through
+    dropStuck = false;
+    deadline = steady_clock::now() + 3s;
+    while (!stuckDelivered.load() && !stuckFailed.load() && steady_clock::now() < deadline) {
+        this_thread::sleep_for(5ms);
+    }
+    EXPECT_TRUE(stuckDelivered.load());
+    EXPECT_FALSE(stuckFailed.load());
+}
+
+TEST(SessionManager, DeltaReceiverMissingBaseRequestsSnapshot) {
+    DroppingPair p;
+    // The lost message stays lost well past the end of the test
+    p.sdkA.setRetransmissionConfig(5, 2000ms);
+    p.sdkA.setRetransmitTimeoutBounds(2000ms, 10000ms);
+    ASSERT_TRUE(p.connect());
+
+    mutex receivedGuard;
+    vector<string> received;
+    p.sdkB.setOnMessageHandler(p.connB.load(), [&](const Message& msg) {
+        lock_guard<mutex> lock(receivedGuard);
+        received.push_back(msg.payload);
+    });
+    p.sdkA.setDeltaEncoding(p.connA.load(), true);
+
+    bool blockerDropped = false;
+    {
+        lock_guard<mutex> lock(p.medium->guard);
+        p.medium->dropFromA = [&](const Frame& frame) {
+            const string marker = "blocker";
+            if (blockerDropped ||
+                search(frame.data.begin(), frame.data.end(), marker.begin(), marker.end()) == frame.data.end()) {
+                return false;
+            }
+            blockerDropped = true;
+            return true;
+        };
+    }
+    auto state = [](int rpm) {
+        return "{\"device\":\"esp32-gyro\",\"gyro\":{\"x\":0.01,\"y\":-0.02,\"z\":1.5}"
+               ",\"motor\":{\"rpm\":" + to_string(rpm) + ",\"temp\":41.5,\"mode\":\"auto\"}"
+               ",\"battery\":{\"voltage\":3.71,\"percent\":82},\"wifi\":{\"rssi\":-61,\"ch\":6}}";
+    };
+
+    // The base is acknowledged on arrival but held behind the lost message
+    p.sdkA.sendOrdered(p.connA.load(), 1, "blocker", MessageFormat::JSON, 5);
+    this_thread::sleep_for(20ms);
+    atomic<bool> baseAcked{false};
+    p.sdkA.sendOrdered(p.connA.load(), 1, state(1200), MessageFormat::JSON, 5, [&]() { baseAcked = true; });
+    auto deadline = steady_clock::now() + 1s;
+    while (!baseAcked.load() && steady_clock::now() < deadline) {
+        this_thread::sleep_for(5ms);
+    }
+    ASSERT_TRUE(baseAcked.load());
+
+    // A diff against it cannot be decoded; the receiver asks for a snapshot
+    // and gets the latest value long before the held stream moves on
+    p.sdkA.send(p.connA.load(), state(1250), MessageFormat::JSON, 5, true, nullptr);
+    deadline = steady_clock::now() + 1s;
+    while (steady_clock::now() < deadline) {
+        {
+            lock_guard<mutex> lock(receivedGuard);
+            if (!received.empty()) {
+                break;
+            }
+        }
+        this_thread::sleep_for(5ms);
+    }
+    {
+        lock_guard<mutex> lock(receivedGuard);
+        EXPECT_EQ(received, vector<string>{state(1250)});
+    }
+    {
+        lock_guard<mutex> lock(p.medium->guard);
+        EXPECT_TRUE(blockerDropped);
+        p.medium->dropFromA = nullptr;
+    }
+}
+
+// ============================================================
+// Congestion controllers
+// ============================================================
+
+TEST(CongestionControl, AimdHalvesOncePerRoundTrip) {
+    AimdController aimd;
+    auto now = steady_clock::now();
+    for (int i = 0; i < 10; ++i) {
+        aimd.onAck(1000, 100ms, now);
+    }
+    EXPECT_EQ(aimd.congestionWindow(), 20u);  // slow start: +1 per ACK
+    EXPECT_TRUE(aimd.inSlowStart());
+
+    aimd.onCongestion(now);
+    EXPECT_EQ(aimd.congestionWindow(), 10u);
+    aimd.onCongestion(now + 50ms);            // same loss episode
+    EXPECT_EQ(aimd.congestionWindow(), 10u);
+    aimd.onCongestion(now + 150ms);
+    EXPECT_EQ(aimd.congestionWindow(), 5u);
+    EXPECT_FALSE(aimd.inSlowStart());
+
+    for (int i = 0; i < 5; ++i) {
+        aimd.onAck(1000, nullopt, now + 200ms);
+    }
+    EXPECT_EQ(aimd.congestionWindow(), 5u);   // about +1 per window
+    aimd.onAck(1000, nullopt, now + 200ms);
+    EXPECT_EQ(aimd.congestionWindow(), 6u);
+    EXPECT_NEAR(aimd.pacingRate(1000), 1.25 * 6.0 * 1000 / 0.1, 2500.0);
+}
+
+TEST(CongestionControl, DelayBasedConvergesOnBottleneck) {
+    // 1000-byte packages delivered at 1 MB/s over a 10 ms path
+    DelayBasedController bbr;
+    EXPECT_EQ(bbr.congestionWindow(), DelayBasedController::INITIAL_WINDOW);
+    EXPECT_EQ(bbr.pacingRate(1000), 0.0);
+
+    auto now = steady_clock::now();
+    for (int i = 0; i < 2000; ++i) {
+        now += 1ms;
+        bbr.onAck(1000, 10ms, now);
+    }
+    EXPECT_EQ(bbr.state(), DelayBasedController::State::PROBE_BW);
+    EXPECT_EQ(bbr.minRtt(), 10ms);
+    EXPECT_NEAR(bbr.bottleneckBandwidth(), 1e6, 1e5);
+    // Twice the 10-package bandwidth-delay product
+    EXPECT_GE(bbr.congestionWindow(), 18u);
+    EXPECT_LE(bbr.congestionWindow(), 24u);
+    EXPECT_GE(bbr.pacingRate(1000), 0.7e6);
+    EXPECT_LE(bbr.pacingRate(1000), 1.4e6);
+}
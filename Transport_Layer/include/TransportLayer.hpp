@@ -2,10 +2,13 @@
 
 #include <atomic>
 #include <cstdint>
+#include <mutex>
 #include <queue>
 #include <stdexcept>
 #include <string>
 #include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <logging.hpp>
 #include <commonTypes.hpp>
@@ -18,15 +21,64 @@ class SessionManager;
 
 class TransportLayer : public LoggerBase {
 public:
+    // Bits of the flags byte (formerly a plain requireAck byte holding 0/1).
+    // FLAG_EXTENDED_FRAGMENTS means fragmentId/fragmentsCount are carried as
+    // 32-bit fields right after the flags byte; the regular fields are zero.
+    // FLAG_DEADLINE means a 16-bit remaining TTL (ms) follows them.
+    // FLAG_ORDERED means [orderedStream:1][sequence:2][sequenceGap:2] follow.
+    static constexpr uint8_t FLAG_REQUIRE_ACK = 0x01;
+    static constexpr uint8_t FLAG_EXTENDED_FRAGMENTS = 0x02;
+    static constexpr uint8_t FLAG_COMPRESSED = 0x04;
+    static constexpr uint8_t FLAG_DELTA = 0x08;
+    static constexpr uint8_t FLAG_DEADLINE = 0x10;
+    static constexpr uint8_t FLAG_ORDERED = 0x20;
+
+    // Header compression. Per (connId, format) both sides remember the ids of
+    // the last full header; a compact frame then carries only their low bytes:
+    //   [0xFF][connId][format | COMPACT_* bits][priority][packageIdLsb:2][messageIdLsb:2]
+    //   [fragmentId][fragmentsCount]   (omitted for single-fragment packages)
+    //   [payloadLength:2][payload]
+    // A full header is sent again every COMPACT_REFRESH_INTERVAL frames, when
+    // the ids drift too far, for retransmissions (older packageId) and for
+    // packages with a deadline or ordering fields, which the compact header
+    // cannot carry.
+    static constexpr uint8_t COMPACT_FORMAT_MASK = 0x0F;
+    static constexpr uint8_t COMPACT_SINGLE_FRAGMENT = 0x10;
+    static constexpr uint8_t COMPACT_REQUIRE_ACK = 0x20;
+    static constexpr uint8_t COMPACT_COMPRESSED = 0x40;
+    static constexpr uint8_t COMPACT_DELTA = 0x80;
+    static constexpr int COMPACT_REFRESH_INTERVAL = 32;
+    static constexpr uint64_t COMPACT_MAX_ID_DRIFT = 0x4000;
+
     TransportLayer(ThreadSafeQueue<Package>& outgoingPackages, SessionManager& sessionManager, const ValidationConfig& validationConfig);
     ~TransportLayer();
     
     ThreadSafeQueue<Frame>& getOutgoingFrames();
     void receiveFrame(const Frame& frame);
 
+    // Enabled per connection once both peers negotiated it. Disabling also
+    // forgets both directions' contexts for the connection.
+    void setHeaderCompression(ConnectionId connId, bool enabled);
+
 private:
+    // packageId/messageId are the reference ids of the last full header;
+    // lastPackageId (sender only) keeps retransmissions out of compact frames.
+    struct CompressionContext {
+        uint64_t packageId = 0;
+        uint64_t messageId = 0;
+        uint64_t lastPackageId = 0;
+        int framesSinceRefresh = 0;
+    };
+
     Frame serialize(const Package& pkg);
     Package deserialize(const Frame& frame);
+
+    static uint64_t contextKey(ConnectionId connId, MessageFormat format);
+    static bool fitsCompactHeader(const Package& pkg);
+    static uint64_t expandLsb(uint64_t reference, uint64_t lsb, uint64_t maxValue);
+    bool serializeCompactLocked(const Package& pkg, Frame& frame);
+    Package deserializeCompact(const Frame& frame);
+    void readPayload(const vector<uint8_t>& bytes, size_t& offset, Package& pkg);
     void appendBytes(vector<uint8_t>& bytes, uint64_t value, int byteCount);
     uint64_t readBytes(const vector<uint8_t>& bytes, size_t& offset, int byteCount);
     uint32_t crc32(const vector<uint8_t>& dataBytes);
@@ -53,6 +105,10 @@ private:
     void initializeFieldWidths();
     void validateSerializedPackage(const Package& pkg) const;
     void validateDeserializedPackage(const Package& pkg) const;
+    mutex compressionMutex_;
+    unordered_set<ConnectionId> compressedConnections_;
+    unordered_map<uint64_t, CompressionContext> txContexts_;
+    unordered_map<uint64_t, CompressionContext> rxContexts_;
     thread worker_;
     atomic<bool> stopWorker_{false};
 };
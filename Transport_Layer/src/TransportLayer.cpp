@@ -30,6 +30,11 @@ void TransportLayer::workerLoop() {
         Package pkg;
         while (outgoingPackages_.tryPop(pkg)) {
             Frame frame = serialize(pkg);
+            frame.connId = pkg.connId;
+            frame.peer = pkg.peer;
+            frame.paced = pkg.requireAck &&
+                (pkg.format == MessageFormat::JSON || pkg.format == MessageFormat::VIDEO ||
+                 pkg.format == MessageFormat::STREAM || pkg.format == MessageFormat::TELEMETRY);
             outgoingFrames_.push(frame);
 
             ostringstream oss;
@@ -55,14 +60,46 @@ Frame TransportLayer::serialize(const Package& pkg) {
     validateSerializedPackage(pkg);
 
     Frame frame;
+    if (fitsCompactHeader(pkg)) {
+        lock_guard<mutex> lock(compressionMutex_);
+        if (compressedConnections_.count(pkg.connId) > 0) {
+            if (serializeCompactLocked(pkg, frame)) {
+                return frame;
+            }
+            auto& context = txContexts_[contextKey(pkg.connId, pkg.format)];
+            context.packageId = static_cast<uint64_t>(pkg.packageId);
+            context.messageId = static_cast<uint64_t>(pkg.messageId);
+            context.lastPackageId = context.packageId;
+            context.framesSinceRefresh = 0;
+        }
+    }
+
     appendBytes(frame.data, static_cast<uint64_t>(pkg.packageId), packageIdBytes_);
     appendBytes(frame.data, static_cast<uint64_t>(pkg.messageId), messageIdBytes_);
     appendBytes(frame.data, static_cast<uint64_t>(pkg.connId), connectionIdBytes_);
-    appendBytes(frame.data, static_cast<uint64_t>(pkg.fragmentId), fragmentIdBytes_);
-    appendBytes(frame.data, static_cast<uint64_t>(pkg.fragmentsCount), fragmentsCountBytes_);
+    appendBytes(frame.data, pkg.extendedFragments ? 0 : static_cast<uint64_t>(pkg.fragmentId), fragmentIdBytes_);
+    appendBytes(frame.data, pkg.extendedFragments ? 0 : static_cast<uint64_t>(pkg.fragmentsCount), fragmentsCountBytes_);
     appendBytes(frame.data, static_cast<uint8_t>(pkg.format), formatBytes_);
     appendBytes(frame.data, static_cast<uint64_t>(pkg.priority), priorityBytes_);
-    appendBytes(frame.data, static_cast<uint8_t>(pkg.requireAck ? 1 : 0), requireAckBytes_);
+    uint8_t flags = (pkg.requireAck ? FLAG_REQUIRE_ACK : 0) |
+                    (pkg.extendedFragments ? FLAG_EXTENDED_FRAGMENTS : 0) |
+                    (pkg.compressed ? FLAG_COMPRESSED : 0) |
+                    (pkg.delta ? FLAG_DELTA : 0) |
+                    (pkg.ttlMs > 0 ? FLAG_DEADLINE : 0) |
+                    (pkg.ordered ? FLAG_ORDERED : 0);
+    appendBytes(frame.data, flags, requireAckBytes_);
+    if (pkg.extendedFragments) {
+        appendBytes(frame.data, static_cast<uint64_t>(pkg.fragmentId), 4);
+        appendBytes(frame.data, static_cast<uint64_t>(pkg.fragmentsCount), 4);
+    }
+    if (pkg.ttlMs > 0) {
+        appendBytes(frame.data, pkg.ttlMs, static_cast<int>(ValidationConfig::DEADLINE_FIELD_BYTES));
+    }
+    if (pkg.ordered) {
+        appendBytes(frame.data, pkg.orderedStream, 1);
+        appendBytes(frame.data, pkg.sequence, 2);
+        appendBytes(frame.data, pkg.sequenceGap, 2);
+    }
     appendBytes(frame.data, static_cast<uint64_t>(pkg.payload.size()), payloadLengthBytes_);
     for (char c : pkg.payload) {
         frame.data.push_back(static_cast<uint8_t>(c));
@@ -70,6 +107,59 @@ Frame TransportLayer::serialize(const Package& pkg) {
     return frame;
 }
 
+bool TransportLayer::serializeCompactLocked(const Package& pkg, Frame& frame) {
+    auto it = txContexts_.find(contextKey(pkg.connId, pkg.format));
+    if (it == txContexts_.end()) {
+        return false;
+    }
+    auto& context = it->second;
+    uint64_t packageId = static_cast<uint64_t>(pkg.packageId);
+    uint64_t messageId = static_cast<uint64_t>(pkg.messageId);
+    uint64_t messageDrift = messageId > context.messageId
+        ? messageId - context.messageId
+        : context.messageId - messageId;
+    if (context.framesSinceRefresh >= COMPACT_REFRESH_INTERVAL ||
+        packageId <= context.lastPackageId ||
+        packageId - context.packageId >= COMPACT_MAX_ID_DRIFT ||
+        messageDrift >= COMPACT_MAX_ID_DRIFT) {
+        return false;
+    }
+
+    bool singleFragment = pkg.fragmentId == 0 && pkg.fragmentsCount == 1;
+    uint8_t formatBits = static_cast<uint8_t>(static_cast<uint8_t>(pkg.format) & COMPACT_FORMAT_MASK);
+    if (singleFragment) {
+        formatBits |= COMPACT_SINGLE_FRAGMENT;
+    }
+    if (pkg.requireAck) {
+        formatBits |= COMPACT_REQUIRE_ACK;
+    }
+    if (pkg.compressed) {
+        formatBits |= COMPACT_COMPRESSED;
+    }
+    if (pkg.delta) {
+        formatBits |= COMPACT_DELTA;
+    }
+
+    const int lsbBytes = static_cast<int>(ValidationConfig::COMPACT_ID_LSB_BYTES);
+    frame.data.reserve(validationConfig_.compactTransportHeaderBytes() + pkg.payload.size());
+    frame.data.push_back(ValidationConfig::COMPACT_HEADER_MARKER);
+    appendBytes(frame.data, static_cast<uint64_t>(pkg.connId), connectionIdBytes_);
+    appendBytes(frame.data, formatBits, formatBytes_);
+    appendBytes(frame.data, static_cast<uint64_t>(pkg.priority), priorityBytes_);
+    appendBytes(frame.data, packageId, lsbBytes);
+    appendBytes(frame.data, messageId, lsbBytes);
+    if (!singleFragment) {
+        appendBytes(frame.data, static_cast<uint64_t>(pkg.fragmentId), fragmentIdBytes_);
+        appendBytes(frame.data, static_cast<uint64_t>(pkg.fragmentsCount), fragmentsCountBytes_);
+    }
+    appendBytes(frame.data, static_cast<uint64_t>(pkg.payload.size()), payloadLengthBytes_);
+    frame.data.insert(frame.data.end(), pkg.payload.begin(), pkg.payload.end());
+
+    context.lastPackageId = packageId;
+    ++context.framesSinceRefresh;
+    return true;
+}
+
 void TransportLayer::appendBytes(vector<uint8_t>& bytes, uint64_t value, int byteCount) {
     if (byteCount <= 0) {
         throw runtime_error("appendBytes called with non-positive byteCount");
@@ -99,6 +189,7 @@ uint32_t TransportLayer::crc32(const vector<uint8_t>&) {
 
 void TransportLayer::receiveFrame(const Frame& frame) {
     Package pkg = deserialize(frame);
+    pkg.peer = frame.peer;
     ostringstream oss;
     oss << "Received frame -> package id=" << pkg.packageId
         << " msgId=" << pkg.messageId
@@ -109,6 +200,9 @@ void TransportLayer::receiveFrame(const Frame& frame) {
 }
 
 Package TransportLayer::deserialize(const Frame& frame) {
+    if (!frame.data.empty() && frame.data[0] == ValidationConfig::COMPACT_HEADER_MARKER) {
+        return deserializeCompact(frame);
+    }
     size_t offset = 0;
     const auto& data = frame.data;
     Package pkg;
@@ -119,23 +213,134 @@ Package TransportLayer::deserialize(const Frame& frame) {
     pkg.fragmentsCount = static_cast<int>(readBytes(data, offset, fragmentsCountBytes_));
     pkg.format = static_cast<MessageFormat>(readBytes(data, offset, formatBytes_));
     pkg.priority = static_cast<int>(readBytes(data, offset, priorityBytes_));
-    pkg.requireAck = readBytes(data, offset, requireAckBytes_) != 0;
-    uint64_t payloadSize64 = readBytes(data, offset, payloadLengthBytes_);
+    uint64_t flags = readBytes(data, offset, requireAckBytes_);
+    pkg.requireAck = (flags & FLAG_REQUIRE_ACK) != 0;
+    pkg.extendedFragments = (flags & FLAG_EXTENDED_FRAGMENTS) != 0;
+    pkg.compressed = (flags & FLAG_COMPRESSED) != 0;
+    pkg.delta = (flags & FLAG_DELTA) != 0;
+    if (pkg.extendedFragments) {
+        uint64_t fragmentId = readBytes(data, offset, 4);
+        uint64_t fragmentsCount = readBytes(data, offset, 4);
+        if (fragmentsCount > static_cast<uint64_t>(numeric_limits<int>::max())) {
+            throw runtime_error("Extended fragments count exceeds platform limits");
+        }
+        pkg.fragmentId = static_cast<int>(fragmentId);
+        pkg.fragmentsCount = static_cast<int>(fragmentsCount);
+    }
+    if ((flags & FLAG_DEADLINE) != 0) {
+        pkg.ttlMs = static_cast<uint16_t>(readBytes(data, offset, static_cast<int>(ValidationConfig::DEADLINE_FIELD_BYTES)));
+        if (pkg.ttlMs == 0) {
+            throw runtime_error("Deadline flag with zero time-to-live");
+        }
+    }
+    if ((flags & FLAG_ORDERED) != 0) {
+        pkg.ordered = true;
+        pkg.orderedStream = static_cast<uint8_t>(readBytes(data, offset, 1));
+        pkg.sequence = static_cast<uint16_t>(readBytes(data, offset, 2));
+        pkg.sequenceGap = static_cast<uint16_t>(readBytes(data, offset, 2));
+    }
+    readPayload(data, offset, pkg);
+    pkg.status = PackageStatus::QUEUED;
+    validateDeserializedPackage(pkg);
+
+    if (fitsCompactHeader(pkg)) {
+        lock_guard<mutex> lock(compressionMutex_);
+        if (compressedConnections_.count(pkg.connId) > 0) {
+            auto& context = rxContexts_[contextKey(pkg.connId, pkg.format)];
+            context.packageId = static_cast<uint64_t>(pkg.packageId);
+            context.messageId = static_cast<uint64_t>(pkg.messageId);
+        }
+    }
+    return pkg;
+}
+
+Package TransportLayer::deserializeCompact(const Frame& frame) {
+    size_t offset = 1;
+    const auto& data = frame.data;
+    const int lsbBytes = static_cast<int>(ValidationConfig::COMPACT_ID_LSB_BYTES);
+    Package pkg;
+    pkg.connId = static_cast<int>(readBytes(data, offset, connectionIdBytes_));
+    uint8_t formatBits = static_cast<uint8_t>(readBytes(data, offset, formatBytes_));
+    pkg.format = static_cast<MessageFormat>(formatBits & COMPACT_FORMAT_MASK);
+    pkg.requireAck = (formatBits & COMPACT_REQUIRE_ACK) != 0;
+    pkg.compressed = (formatBits & COMPACT_COMPRESSED) != 0;
+    pkg.delta = (formatBits & COMPACT_DELTA) != 0;
+    pkg.priority = static_cast<int>(readBytes(data, offset, priorityBytes_));
+    uint64_t packageIdLsb = readBytes(data, offset, lsbBytes);
+    uint64_t messageIdLsb = readBytes(data, offset, lsbBytes);
+    if ((formatBits & COMPACT_SINGLE_FRAGMENT) != 0) {
+        pkg.fragmentId = 0;
+        pkg.fragmentsCount = 1;
+    } else {
+        pkg.fragmentId = static_cast<int>(readBytes(data, offset, fragmentIdBytes_));
+        pkg.fragmentsCount = static_cast<int>(readBytes(data, offset, fragmentsCountBytes_));
+    }
+
+    {
+        lock_guard<mutex> lock(compressionMutex_);
+        auto it = rxContexts_.find(contextKey(pkg.connId, pkg.format));
+        if (it == rxContexts_.end()) {
+            throw runtime_error("Compact header without compression context");
+        }
+        pkg.packageId = static_cast<int>(expandLsb(it->second.packageId, packageIdLsb, packageIdMax_));
+        pkg.messageId = static_cast<int>(expandLsb(it->second.messageId, messageIdLsb, messageIdMax_));
+    }
+
+    readPayload(data, offset, pkg);
+    pkg.status = PackageStatus::QUEUED;
+    validateDeserializedPackage(pkg);
+    return pkg;
+}
+
+void TransportLayer::readPayload(const vector<uint8_t>& bytes, size_t& offset, Package& pkg) {
+    uint64_t payloadSize64 = readBytes(bytes, offset, payloadLengthBytes_);
     if (payloadSize64 > numeric_limits<size_t>::max()) {
         throw runtime_error("Payload length exceeds platform limits");
     }
     size_t payloadSize = static_cast<size_t>(payloadSize64);
-    if (offset + payloadSize > data.size()) {
+    if (offset + payloadSize > bytes.size()) {
         throw runtime_error("Frame truncated while reading payload");
     }
-    pkg.payload.clear();
-    pkg.payload.reserve(payloadSize);
-    for (size_t i = 0; i < payloadSize; ++i) {
-        pkg.payload.push_back(static_cast<char>(data[offset++]));
+    pkg.payload.assign(reinterpret_cast<const char*>(bytes.data() + offset), payloadSize);
+    offset += payloadSize;
+}
+
+uint64_t TransportLayer::contextKey(ConnectionId connId, MessageFormat format) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(connId)) << 8) | static_cast<uint8_t>(format);
+}
+
+// The compact header has no room for the optional fields
+bool TransportLayer::fitsCompactHeader(const Package& pkg) {
+    return !pkg.extendedFragments && pkg.ttlMs == 0 && !pkg.ordered;
+}
+
+// Picks the id closest to `reference` whose low bytes equal `lsb`
+uint64_t TransportLayer::expandLsb(uint64_t reference, uint64_t lsb, uint64_t maxValue) {
+    const uint64_t span = 1ULL << (8 * ValidationConfig::COMPACT_ID_LSB_BYTES);
+    uint64_t candidate = (reference & ~(span - 1)) | lsb;
+    if (candidate + span / 2 < reference) {
+        candidate += span;
+    } else if (candidate > reference + span / 2 && candidate >= span) {
+        candidate -= span;
+    }
+    if (candidate > maxValue) {
+        throw runtime_error("Compact header id outside configured bit width");
+    }
+    return candidate;
+}
+
+void TransportLayer::setHeaderCompression(ConnectionId connId, bool enabled) {
+    lock_guard<mutex> lock(compressionMutex_);
+    if (enabled) {
+        compressedConnections_.insert(connId);
+        return;
+    }
+    compressedConnections_.erase(connId);
+    for (uint8_t format = 0; format <= COMPACT_FORMAT_MASK; ++format) {
+        uint64_t key = contextKey(connId, static_cast<MessageFormat>(format));
+        txContexts_.erase(key);
+        rxContexts_.erase(key);
     }
-    pkg.status = PackageStatus::QUEUED;
-    validateDeserializedPackage(pkg);
-    return pkg;
 }
 
 void TransportLayer::initializeFieldWidths() {
@@ -174,11 +379,14 @@ void TransportLayer::validateSerializedPackage(const Package& pkg) const {
         return value > maxAllowed;
     };
 
+    bool fragmentsExceed = !pkg.extendedFragments &&
+        (exceeds(static_cast<uint64_t>(pkg.fragmentId), fragmentIdMax_) ||
+         exceeds(static_cast<uint64_t>(pkg.fragmentsCount), fragmentsCountMax_));
+
     if (exceeds(static_cast<uint64_t>(pkg.packageId), packageIdMax_) ||
         exceeds(static_cast<uint64_t>(pkg.messageId), messageIdMax_) ||
         exceeds(static_cast<uint64_t>(pkg.connId), connectionIdMax_) ||
-        exceeds(static_cast<uint64_t>(pkg.fragmentId), fragmentIdMax_) ||
-        exceeds(static_cast<uint64_t>(pkg.fragmentsCount), fragmentsCountMax_) ||
+        fragmentsExceed ||
         exceeds(static_cast<uint64_t>(pkg.priority), priorityMax_)) {
         throw runtime_error("Package fields exceed allowed encoding width");
     }
@@ -56,6 +56,33 @@ TEST(ValidationConfig, MaxPayloadLength) {
     EXPECT_EQ(vc.maxPayloadLengthBytes(), 65535u);
 }
 
+TEST(ValidationConfig, MaxStandardMessageBytes) {
+    ValidationConfig vc;
+    // fragmentsCount is 8 bits = max 255 fragments of 65535 bytes
+    EXPECT_EQ(vc.maxStandardMessageBytes(), 255u * 65535u);
+}
+
+TEST(ValidationConfig, ExtendedFragmentsBypassBitWidth) {
+    ValidationConfig vc;
+    Package pkg{1, 1, 1, 100000, 200000, "hello", MessageFormat::VIDEO, 5, true, PackageStatus::QUEUED, true};
+    EXPECT_NO_THROW(vc.validatePackage(pkg));
+    pkg.fragmentId = 200000;
+    EXPECT_THROW(vc.validatePackage(pkg), invalid_argument);
+}
+
+TEST(ValidationConfig, CompactHeaderBytes) {
+    ValidationConfig vc;
+    // marker(1) + connId(2) + format(1) + priority(1) + idLsb(2+2) + payloadLen(2)
+    EXPECT_EQ(vc.compactTransportHeaderBytes(), 11u);
+    EXPECT_EQ(vc.minTransportHeaderBytes(), 11u);
+}
+
+TEST(ValidationConfig, PackageIdsAvoidCompactMarker) {
+    ValidationConfig vc;
+    // 24-bit packageId: top byte 0xFF is reserved for compact frames
+    EXPECT_EQ(vc.maxAllocatablePackageId(), 0xFEFFFFu);
+}
+
 // ============================================================
 // TransportLayer serialization tests
 // ============================================================
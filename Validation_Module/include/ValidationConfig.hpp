@@ -12,6 +12,16 @@ public:
     static constexpr size_t REQUIRE_ACK_FIELD_BYTES = 1;
     static constexpr size_t PAYLOAD_LENGTH_FIELD_BYTES = 2;
     static constexpr size_t CRC_FIELD_BYTES = 4;
+    // 32-bit fragmentId + fragmentsCount appended to the header in large-message mode
+    static constexpr size_t EXTENDED_FRAGMENT_FIELDS_BYTES = 8;
+    // Remaining time-to-live in ms, appended after them for messages with a deadline
+    static constexpr size_t DEADLINE_FIELD_BYTES = 2;
+    // Ordered stream, sequence and sequence gap of ordered messages, after the deadline
+    static constexpr size_t ORDERING_FIELDS_BYTES = 5;
+    // A compact (header-compressed) frame starts with this byte. Full headers
+    // start with packageId, so ids whose top byte is 0xFF are never allocated.
+    static constexpr uint8_t COMPACT_HEADER_MARKER = 0xFF;
+    static constexpr size_t COMPACT_ID_LSB_BYTES = 2;
 
     static constexpr uint8_t DEFAULT_DEVICE_ID_BITS = 16;
     static constexpr uint8_t DEFAULT_CONNECTION_ID_BITS = 16;
@@ -54,6 +64,14 @@ public:
     size_t transportHeaderBytes() const;
     size_t maxPayloadLengthBytes() const;
     size_t maxFrameLengthBytes() const;
+    // Shortest header: compact single-fragment form
+    // [marker:1][connId][format:1][priority][packageIdLsb:2][messageIdLsb:2][payloadLength:2]
+    size_t compactTransportHeaderBytes() const;
+    size_t minTransportHeaderBytes() const;
+    // Highest packageId whose first serialized byte is not COMPACT_HEADER_MARKER
+    uint64_t maxAllocatablePackageId() const;
+    // Largest message the standard fragment fields can carry
+    size_t maxStandardMessageBytes() const;
 
 private:
     bool fitsInBits(int value, uint8_t bits) const;
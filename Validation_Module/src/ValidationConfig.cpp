@@ -1,4 +1,5 @@
 #include "ValidationConfig.hpp"
+#include <algorithm>
 #include <limits>
 #include <stdexcept>
 #include <string>
@@ -56,11 +57,17 @@ bool ValidationConfig::validatePackage(const Package& package) const {
     if (package.connId < 0 || !fitsInBits(package.connId, connectionIdBits_)) {
         throw invalid_argument("Package connection id exceeds allowed bit width");
     }
-    if (package.fragmentId < 0 || !fitsInBits(package.fragmentId, fragmentIdBits_)) {
-        throw invalid_argument("Package fragment id exceeds allowed bit width");
-    }
-    if (package.fragmentsCount < 0 || !fitsInBits(package.fragmentsCount, fragmentsCountBits_)) {
-        throw invalid_argument("Package fragments count exceeds allowed bit width");
+    if (package.extendedFragments) {
+        if (package.fragmentId < 0 || package.fragmentsCount <= package.fragmentId) {
+            throw invalid_argument("Package extended fragment fields are out of range");
+        }
+    } else {
+        if (package.fragmentId < 0 || !fitsInBits(package.fragmentId, fragmentIdBits_)) {
+            throw invalid_argument("Package fragment id exceeds allowed bit width");
+        }
+        if (package.fragmentsCount < 0 || !fitsInBits(package.fragmentsCount, fragmentsCountBits_)) {
+            throw invalid_argument("Package fragments count exceeds allowed bit width");
+        }
     }
     if (package.priority < 0 || !fitsInBits(package.priority, priorityBits_)) {
         throw invalid_argument("Package priority exceeds allowed bit width");
@@ -150,5 +157,33 @@ size_t ValidationConfig::maxPayloadLengthBytes() const {
 }
 
 size_t ValidationConfig::maxFrameLengthBytes() const {
-    return transportHeaderBytes() + maxPayloadLengthBytes() + CRC_FIELD_BYTES;
+    return transportHeaderBytes() + EXTENDED_FRAGMENT_FIELDS_BYTES + DEADLINE_FIELD_BYTES + ORDERING_FIELDS_BYTES +
+        maxPayloadLengthBytes() + CRC_FIELD_BYTES;
+}
+
+size_t ValidationConfig::compactTransportHeaderBytes() const {
+    return 1
+        + bitsToBytes(connectionIdBits_)
+        + FORMAT_FIELD_BYTES
+        + bitsToBytes(priorityBits_)
+        + 2 * COMPACT_ID_LSB_BYTES
+        + PAYLOAD_LENGTH_FIELD_BYTES;
+}
+
+size_t ValidationConfig::minTransportHeaderBytes() const {
+    return min(compactTransportHeaderBytes(), transportHeaderBytes());
+}
+
+uint64_t ValidationConfig::maxAllocatablePackageId() const {
+    uint64_t maxValue = packageIdBits_ >= 32 ? numeric_limits<uint32_t>::max() : ((1ULL << packageIdBits_) - 1ULL);
+    uint64_t reservedFloor = static_cast<uint64_t>(COMPACT_HEADER_MARKER) << (8 * (bitsToBytes(packageIdBits_) - 1));
+    return min(maxValue, reservedFloor - 1);
+}
+
+size_t ValidationConfig::maxStandardMessageBytes() const {
+    uint64_t fragmentIds = (fragmentIdBits_ >= 32 ? numeric_limits<uint32_t>::max() : ((1ULL << fragmentIdBits_) - 1ULL)) + 1ULL;
+    uint64_t fragmentsCount = fragmentsCountBits_ >= 32 ? numeric_limits<uint32_t>::max() : ((1ULL << fragmentsCountBits_) - 1ULL);
+    uint64_t fragments = min<uint64_t>({fragmentIds, fragmentsCount, static_cast<uint64_t>(numeric_limits<int>::max())});
+    uint64_t bytes = fragments * static_cast<uint64_t>(maxPayloadLengthBytes());
+    return static_cast<size_t>(min<uint64_t>(bytes, numeric_limits<size_t>::max()));
 }
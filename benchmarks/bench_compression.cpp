@@ -0,0 +1,143 @@
+// Compression ratio and CPU cost of Lz4Codec and TimeSeriesCodec on
+// representative payloads.
+// Build with -DBUILD_BENCHMARKS=ON -DCMAKE_BUILD_TYPE=Release,
+// run ./bench_compression [iterations]
+#include "Lz4Codec.hpp"
+#include "TimeSeriesCodec.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace chrono;
+
+static string telemetryJson(int samples) {
+    string json = "[";
+    mt19937 rng(7);
+    normal_distribution<double> noise(0.0, 0.02);
+    for (int i = 0; i < samples; ++i) {
+        char buffer[192];
+        snprintf(buffer, sizeof(buffer),
+                 "{\"sensor\":\"imu\",\"ts\":%d,\"ax\":%.3f,\"ay\":%.3f,\"az\":%.3f,\"temp\":%.1f,\"status\":\"ok\"},",
+                 1700000000 + i * 100, 0.01 + noise(rng), -0.02 + noise(rng), 9.81 + noise(rng),
+                 36.5 + i * 0.01);
+        json += buffer;
+    }
+    json.back() = ']';
+    return json;
+}
+
+static string sensorBinary(size_t samples) {
+    // int16 waveform, as produced by an ADC at a steady sample rate
+    string out;
+    out.reserve(samples * 2);
+    for (size_t i = 0; i < samples; ++i) {
+        auto value = static_cast<int16_t>(1000.0 * sin(static_cast<double>(i) * 0.05));
+        out.push_back(static_cast<char>(value & 0xFF));
+        out.push_back(static_cast<char>((value >> 8) & 0xFF));
+    }
+    return out;
+}
+
+static string randomBytes(size_t size) {
+    mt19937 rng(42);
+    string out(size, '\0');
+    for (auto& c : out) {
+        c = static_cast<char>(rng());
+    }
+    return out;
+}
+
+static void run(const char* name, const string& payload, int iterations) {
+    Lz4Codec codec;
+    string compressed = codec.compress(payload.data(), payload.size());
+
+    auto start = steady_clock::now();
+    size_t sink = 0;
+    for (int i = 0; i < iterations; ++i) {
+        sink += codec.compress(payload.data(), payload.size()).size();
+    }
+    double compressNs = duration<double, nano>(steady_clock::now() - start).count() / iterations;
+
+    start = steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        sink += codec.decompress(compressed, payload.size()).size();
+    }
+    double decompressNs = duration<double, nano>(steady_clock::now() - start).count() / iterations;
+
+    double mb = static_cast<double>(payload.size()) / 1e6;
+    printf("%-16s %8zu B -> %8zu B  ratio %5.2fx  compress %8.0f ns (%7.1f MB/s)  decompress %8.0f ns (%7.1f MB/s)%s\n",
+           name, payload.size(), compressed.size(),
+           static_cast<double>(payload.size()) / static_cast<double>(compressed.size()),
+           compressNs, mb / (compressNs * 1e-9), decompressNs, mb / (decompressNs * 1e-9),
+           sink == 0 ? " !" : "");
+}
+
+// Gyro-like channel: 100 Hz timestamps in ms with occasional jitter,
+// readings quantized the way the MPU6050 driver produces them (int16 / 131
+// as float)
+static void sensorSeries(size_t samples, vector<int64_t>& timestamps, vector<double>& values) {
+    mt19937 rng(11);
+    normal_distribution<double> noise(0.0, 0.3);
+    timestamps.resize(samples);
+    values.resize(samples);
+    int64_t ts = 1700000000000;
+    for (size_t i = 0; i < samples; ++i) {
+        ts += (i % 50 == 49) ? 11 : 10;
+        timestamps[i] = ts;
+        double raw = 120.0 * sin(static_cast<double>(i) * 0.01) + noise(rng);
+        values[i] = static_cast<float>(round(raw * 131.0)) / 131.0f;
+    }
+}
+
+static void runTimeSeries(const char* name, size_t samples, int iterations) {
+    vector<int64_t> timestamps;
+    vector<double> values;
+    sensorSeries(samples, timestamps, values);
+    string encoded = TimeSeriesCodec::encode(timestamps, values);
+
+    auto start = steady_clock::now();
+    size_t sink = 0;
+    for (int i = 0; i < iterations; ++i) {
+        sink += TimeSeriesCodec::encode(timestamps, values).size();
+    }
+    double encodeNs = duration<double, nano>(steady_clock::now() - start).count() / iterations;
+
+    vector<int64_t> decodedTimestamps;
+    vector<double> decodedValues;
+    start = steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        TimeSeriesCodec::decode(encoded.data(), encoded.size(), samples, decodedTimestamps, decodedValues);
+        sink += decodedValues.size();
+    }
+    double decodeNs = duration<double, nano>(steady_clock::now() - start).count() / iterations;
+
+    double n = static_cast<double>(samples);
+    printf("%-16s %8zu samples -> %8zu B  %5.1f bits/sample  encode %6.1f ns/sample  decode %6.1f ns/sample%s\n",
+           name, samples, encoded.size(), static_cast<double>(encoded.size()) * 8.0 / n,
+           encodeNs / n, decodeNs / n, sink == 0 ? " !" : "");
+}
+
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? atoi(argv[1]) : 2000;
+    if (iterations <= 0) {
+        iterations = 2000;
+    }
+
+    run("json-1-sample", telemetryJson(1), iterations);
+    run("json-10-samples", telemetryJson(10), iterations);
+    run("json-100-samples", telemetryJson(100), iterations);
+    run("sensor-int16-4k", sensorBinary(2048), iterations);
+    run("sensor-int16-64k", sensorBinary(32768), iterations / 10 + 1);
+    run("random-4k", randomBytes(4096), iterations);
+    run("random-64k", randomBytes(65536), iterations / 10 + 1);
+
+    runTimeSeries("series-10", 10, iterations);
+    runTimeSeries("series-1024", 1024, iterations / 10 + 1);
+    return 0;
+}
@@ -0,0 +1,222 @@
+// GF(2^8) kernel throughput and message latency over a lossy link with
+// forward error correction off, XOR and Reed-Solomon.
+// Build with -DBUILD_BENCHMARKS=ON -DCMAKE_BUILD_TYPE=Release,
+// run ./bench_fec [messages] [loss percent]
+#include "AbstractPhysicalLayer.hpp"
+#include "CodingModule.hpp"
+#include "EminentSdk.hpp"
+#include "GaloisField.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace chrono;
+
+// ============================================================
+// Lossy link: drops frames at random, delays the rest
+// ============================================================
+struct LossyNetwork {
+    struct Direction {
+        mutex guard;
+        deque<pair<steady_clock::time_point, Frame>> frames;
+    };
+    Direction toA;
+    Direction toB;
+    atomic<double> lossRate{0.0};
+    microseconds oneWayDelay{5000};
+};
+
+class LossyLink : public AbstractPhysicalLayer {
+public:
+    // WiFi-sized datagrams, so messages fragment as they do over UDP
+    static constexpr size_t LINK_MTU = 1400;
+
+    LossyLink(shared_ptr<LossyNetwork> network, bool sideA)
+        : AbstractPhysicalLayer("LossyLink"), network_(move(network)), sideA_(sideA), rng_(sideA ? 1 : 2) {}
+
+    ~LossyLink() override {
+        stop_ = true;
+        if (worker_.joinable()) {
+            worker_.join();
+        }
+    }
+
+    void configure(ThreadSafeQueue<Frame>& outgoingFrames, CodingModule& codingModule,
+                   const ValidationConfig& validationConfig) override {
+        setEnvironment(outgoingFrames, codingModule, validationConfig);
+    }
+
+    void start() override {
+        worker_ = thread([this]() {
+            while (!stop_) {
+                tick();
+                this_thread::sleep_for(microseconds{500});
+            }
+        });
+    }
+
+    void tick() override {
+        auto now = steady_clock::now();
+        auto& tx = sideA_ ? network_->toB : network_->toA;
+        auto& rx = sideA_ ? network_->toA : network_->toB;
+
+        Frame frame;
+        while (outgoingFramesFromCodingModule_->tryPop(frame)) {
+            if (uniform_real_distribution<double>(0.0, 1.0)(rng_) < network_->lossRate) {
+                continue;
+            }
+            lock_guard<mutex> lock(tx.guard);
+            tx.frames.emplace_back(now + network_->oneWayDelay, move(frame));
+        }
+
+        vector<Frame> due;
+        {
+            lock_guard<mutex> lock(rx.guard);
+            while (!rx.frames.empty() && rx.frames.front().first <= now) {
+                due.push_back(move(rx.frames.front().second));
+                rx.frames.pop_front();
+            }
+        }
+        for (const auto& received : due) {
+            try {
+                codingModule_->receiveFrameWithCrc(received);
+            } catch (const exception&) {
+            }
+        }
+    }
+
+    bool tryReceive(Frame&) override { return false; }
+    size_t maxFrameBytesOnLink() const override { return LINK_MTU; }
+
+private:
+    shared_ptr<LossyNetwork> network_;
+    bool sideA_;
+    mt19937 rng_;
+    atomic<bool> stop_{false};
+    thread worker_;
+};
+
+// ============================================================
+// GF(2^8) kernels
+// ============================================================
+static void benchKernels() {
+    const size_t bytes = 64 * 1024;
+    const int iterations = 2000;
+    vector<uint8_t> src(bytes, 0x5A);
+    vector<uint8_t> dst(bytes, 0xA5);
+
+    auto measure = [&](auto kernel) {
+        auto start = steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            kernel(dst.data(), src.data(), static_cast<uint8_t>(3 + i % 250), bytes);
+        }
+        double seconds = duration<double>(steady_clock::now() - start).count();
+        return static_cast<double>(bytes) * iterations / seconds / 1e6;
+    };
+    double scalar = measure(GaloisField::mulAddRegionScalar);
+    double dispatched = measure(GaloisField::mulAddRegion);
+    printf("GF(2^8) multiply-add: scalar %8.0f MB/s, %-6s %8.0f MB/s%s\n",
+           scalar, GaloisField::kernelName(), dispatched, dst[0] == 0 && dst[1] == 0 ? " !" : "");
+}
+
+// ============================================================
+// Latency under loss
+// ============================================================
+static double percentile(vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t index = min(sorted.size() - 1, static_cast<size_t>(p * static_cast<double>(sorted.size())));
+    return sorted[index];
+}
+
+static void benchLatency(const char* name, const FecConfig& fec, int messages, double lossRate) {
+    auto network = make_shared<LossyNetwork>();
+    ValidationConfig vc;
+    EminentSdk sdkA(make_unique<LossyLink>(network, true), vc, LogLevel::NONE);
+    EminentSdk sdkB(make_unique<LossyLink>(network, false), vc, LogLevel::NONE);
+
+    atomic<ConnectionId> cidB{-1};
+    sdkA.initialize(1, []() {}, [](const string&) {}, [](DeviceId, const string&) { return true; });
+    sdkB.initialize(2, []() {}, [](const string&) {}, [](DeviceId, const string&) { return true; },
+                    [&](ConnectionId id, DeviceId) { cidB = id; });
+
+    atomic<ConnectionId> cidA{-1};
+    sdkA.connect(2, 1, [&](ConnectionId id) { cidA = id; }, [](const string&) {}, [](const string&) {}, []() {},
+                 [&](ConnectionId id) { cidA = id; }, [](const Message&) {});
+    auto deadline = steady_clock::now() + seconds{5};
+    while ((cidA <= 0 || cidB <= 0) && steady_clock::now() < deadline) {
+        this_thread::sleep_for(milliseconds{10});
+    }
+    if (cidA <= 0 || cidB <= 0) {
+        printf("%-22s handshake failed\n", name);
+        return;
+    }
+
+    vector<steady_clock::time_point> sentAt(messages);
+    vector<steady_clock::time_point> receivedAt(messages);
+    mutex guard;
+    sdkB.setOnMessageHandler(cidB, [&](const Message& msg) {
+        int seq = atoi(msg.payload.c_str());
+        lock_guard<mutex> lock(guard);
+        if (seq >= 0 && seq < messages && receivedAt[seq] == steady_clock::time_point{}) {
+            receivedAt[seq] = steady_clock::now();
+        }
+    });
+    if (fec.scheme != FecScheme::NONE) {
+        sdkA.setForwardErrorCorrection(cidA, fec);
+    }
+    network->lossRate = lossRate;
+
+    // 200-byte telemetry records at 100 Hz
+    string padding(190, 'x');
+    for (int seq = 0; seq < messages; ++seq) {
+        {
+            lock_guard<mutex> lock(guard);
+            sentAt[seq] = steady_clock::now();
+        }
+        sdkA.send(cidA, to_string(seq) + ":" + padding, MessageFormat::JSON, 1, true, nullptr);
+        this_thread::sleep_for(milliseconds{10});
+    }
+    this_thread::sleep_for(seconds{2});
+
+    vector<double> latencies;
+    {
+        lock_guard<mutex> lock(guard);
+        for (int seq = 0; seq < messages; ++seq) {
+            if (receivedAt[seq] != steady_clock::time_point{}) {
+                latencies.push_back(duration<double, milli>(receivedAt[seq] - sentAt[seq]).count());
+            }
+        }
+    }
+    sort(latencies.begin(), latencies.end());
+    printf("%-22s delivered %5zu/%-5d p50 %6.1f ms  p90 %6.1f ms  p99 %6.1f ms  p99.9 %6.1f ms  max %6.1f ms\n",
+           name, latencies.size(), messages, percentile(latencies, 0.50), percentile(latencies, 0.90),
+           percentile(latencies, 0.99), percentile(latencies, 0.999), latencies.empty() ? 0.0 : latencies.back());
+
+    sdkA.shutdown();
+    sdkB.shutdown();
+}
+
+int main(int argc, char** argv) {
+    int messages = argc > 1 ? atoi(argv[1]) : 1500;
+    double lossPercent = argc > 2 ? atof(argv[2]) : 2.0;
+
+    benchKernels();
+    printf("\n%d messages, %.1f%% frame loss, 5 ms one-way delay\n", messages, lossPercent);
+    benchLatency("FEC off", FecConfig{}, messages, lossPercent / 100.0);
+    benchLatency("XOR K=8", FecConfig{FecScheme::XOR, 8, 1}, messages, lossPercent / 100.0);
+    benchLatency("Reed-Solomon K=8 M=2", FecConfig{FecScheme::REED_SOLOMON, 8, 2}, messages, lossPercent / 100.0);
+    return 0;
+}
@@ -0,0 +1,319 @@
+// Loopback UDP packet rate and kernel calls per datagram: one datagram per
+// sendto/recvfrom, sendmmsg/recvmmsg batches, and the io_uring backend;
+// then bulk messages fragmented at a 1500-byte MTU with and without
+// segmentation offload (GSO/GRO); then a multi-peer hub receiving from many
+// devices on one socket or on SO_REUSEPORT receive shards; then the shared
+// memory rings that replace loopback UDP between co-located processes.
+// Build with -DBUILD_BENCHMARKS=ON -DCMAKE_BUILD_TYPE=Release,
+// run ./bench_udp [messages]
+#include "EminentSdk.hpp"
+#include "PhysicalLayerIoUring.hpp"
+#include "PhysicalLayerSharedMemory.hpp"
+#include "PhysicalLayerUdp.hpp"
+#include "ValidationConfig.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace chrono;
+
+// Datagrams in flight; each message counts with its fragments
+static constexpr int MAX_IN_FLIGHT = 128;
+static constexpr size_t BULK_MESSAGE_BYTES = 16384;
+static constexpr size_t BULK_PATH_MTU = 1500;
+static constexpr int HUB_DEVICES = 8;
+
+using LayerFactory = function<unique_ptr<PhysicalLayerUdp>(int localPort, int remotePort)>;
+
+// Without congestion control the pacer lets each flow window out as one
+// burst, which is what batching and segmentation offload act on
+static void benchLayer(const char* name, const LayerFactory& makeLayer, int messages, size_t payloadBytes,
+                       bool congestionControl, int basePort) {
+    ValidationConfig vc;
+    auto layerA = makeLayer(basePort, basePort + 1);
+    auto layerB = makeLayer(basePort + 1, basePort);
+    PhysicalLayerUdp* udpA = layerA.get();
+    PhysicalLayerUdp* udpB = layerB.get();
+    EminentSdk sdkA(move(layerA), vc, LogLevel::NONE);
+    EminentSdk sdkB(move(layerB), vc, LogLevel::NONE);
+    if (!congestionControl) {
+        sdkA.setCongestionControl(nullptr);
+        sdkB.setCongestionControl(nullptr);
+    }
+
+    atomic<ConnectionId> cidB{-1};
+    atomic<int> received{0};
+    sdkA.initialize(1, []() {}, [](const string&) {}, [](DeviceId, const string&) { return true; });
+    sdkB.initialize(2, []() {}, [](const string&) {}, [](DeviceId, const string&) { return true; },
+                    [&](ConnectionId id, DeviceId) {
+                        sdkB.setOnMessageHandler(id, [&](const Message&) { received++; });
+                        cidB = id;
+                    });
+
+    atomic<ConnectionId> cidA{-1};
+    sdkA.connect(2, 1, [&](ConnectionId id) { cidA = id; }, [](const string&) {}, [](const string&) {}, []() {},
+                 [&](ConnectionId id) { cidA = id; }, [](const Message&) {});
+    auto deadline = steady_clock::now() + seconds{5};
+    while ((cidA <= 0 || cidB <= 0) && steady_clock::now() < deadline) {
+        this_thread::sleep_for(milliseconds{10});
+    }
+    if (cidA <= 0 || cidB <= 0) {
+        printf("%-22s handshake failed\n", name);
+        return;
+    }
+
+    PhysicalLayerUdp::IoStats beforeA = udpA->ioStats();
+    PhysicalLayerUdp::IoStats beforeB = udpB->ioStats();
+    // Incompressible, so a bulk message stays a burst of full fragments
+    string payload(payloadBytes, 'x');
+    uint32_t seed = 1;
+    for (char& c : payload) {
+        seed = seed * 1103515245u + 12345u;
+        c = static_cast<char>('a' + (seed >> 16) % 26);
+    }
+    int fragments = static_cast<int>(payloadBytes / (udpA->maxFrameBytesOnLink() - 64) + 1);
+    int maxInFlight = max(1, MAX_IN_FLIGHT / fragments);
+    auto start = steady_clock::now();
+    // Unacknowledged sends have no flow control; keeping a bounded number in
+    // flight stops the receive socket buffer from overflowing
+    for (int i = 0; i < messages; ++i) {
+        while (i - received >= maxInFlight && steady_clock::now() - start < seconds{20}) {
+            this_thread::sleep_for(microseconds{100});
+        }
+        sdkA.send(cidA, payload, MessageFormat::JSON, 1, /*requireAck=*/false, nullptr);
+    }
+    deadline = start + seconds{20};
+    int last = -1;
+    auto lastChange = steady_clock::now();
+    while (received < messages && steady_clock::now() < deadline) {
+        this_thread::sleep_for(milliseconds{5});
+        if (received != last) {
+            last = received;
+            lastChange = steady_clock::now();
+        } else if (steady_clock::now() - lastChange > milliseconds{500}) {
+            break;
+        }
+    }
+    double seconds = duration<double>(lastChange - start).count();
+    PhysicalLayerUdp::IoStats afterA = udpA->ioStats();
+    PhysicalLayerUdp::IoStats afterB = udpB->ioStats();
+
+    auto perDatagram = [](uint64_t calls, uint64_t datagrams) {
+        return datagrams == 0 ? 0.0 : static_cast<double>(calls) / static_cast<double>(datagrams);
+    };
+    double rate = seconds > 0.0 ? received / seconds : 0.0;
+    printf("%-22s delivered %7d/%-7d %9.0f messages/s %7.1f MB/s  send calls/datagram %.3f  "
+           "recv calls/datagram %.3f  GSO sends %llu  GRO receives %llu\n",
+           name, received.load(), messages, rate, rate * static_cast<double>(payloadBytes) / 1e6,
+           perDatagram(afterA.sendCalls - beforeA.sendCalls, afterA.datagramsSent - beforeA.datagramsSent),
+           perDatagram(afterB.receiveCalls - beforeB.receiveCalls,
+                       afterB.datagramsReceived - beforeB.datagramsReceived),
+           static_cast<unsigned long long>(afterA.segmentedSends - beforeA.segmentedSends),
+           static_cast<unsigned long long>(afterB.coalescedReceives - beforeB.coalescedReceives));
+
+    sdkA.shutdown();
+    sdkB.shutdown();
+}
+
+// Devices send round-robin to one hub; the rate is the hub's aggregate
+static void benchHub(size_t shards, int messages, int basePort) {
+    ValidationConfig vc;
+    auto hubLayer = make_unique<PhysicalLayerUdp>(basePort);
+    PhysicalLayerUdp* hubUdp = hubLayer.get();
+    hubUdp->setReceiveShards(shards);
+    EminentSdk hub(move(hubLayer), vc, LogLevel::NONE);
+    atomic<int> received{0};
+    hub.initialize(1, []() {}, [](const string&) {}, [](DeviceId, const string&) { return true; },
+                   [&](ConnectionId id, DeviceId) { hub.setOnMessageHandler(id, [&](const Message&) { received++; }); });
+
+    vector<unique_ptr<EminentSdk>> devices;
+    vector<atomic<ConnectionId>> cids(HUB_DEVICES);
+    for (int d = 0; d < HUB_DEVICES; ++d) {
+        cids[d] = -1;
+        devices.push_back(make_unique<EminentSdk>(make_unique<PhysicalLayerUdp>(basePort + 1 + d, "127.0.0.1", basePort),
+                                                  vc, LogLevel::NONE));
+        devices[d]->initialize(100 + d, []() {}, [](const string&) {}, [](DeviceId, const string&) { return true; });
+        devices[d]->connect(1, 1, nullptr, nullptr, nullptr, nullptr, [&cids, d](ConnectionId id) { cids[d] = id; },
+                            [](const Message&) {});
+    }
+    auto deadline = steady_clock::now() + seconds{5};
+    auto allConnected = [&]() {
+        return all_of(cids.begin(), cids.end(), [](const atomic<ConnectionId>& cid) { return cid > 0; });
+    };
+    while (!allConnected() && steady_clock::now() < deadline) {
+        this_thread::sleep_for(milliseconds{10});
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "hub, %zu shard%s", shards, shards == 1 ? "" : "s");
+    if (!allConnected()) {
+        printf("%-22s handshake failed\n", name);
+        return;
+    }
+
+    string payload(64, 'x');
+    auto start = steady_clock::now();
+    for (int i = 0; i < messages; ++i) {
+        while (i - received >= MAX_IN_FLIGHT && steady_clock::now() - start < seconds{20}) {
+            this_thread::sleep_for(microseconds{100});
+        }
+        int d = i % HUB_DEVICES;
+        devices[d]->send(cids[d], payload, MessageFormat::JSON, 1, /*requireAck=*/false, nullptr);
+    }
+    deadline = start + seconds{20};
+    int last = -1;
+    auto lastChange = steady_clock::now();
+    while (received < messages && steady_clock::now() < deadline) {
+        this_thread::sleep_for(milliseconds{5});
+        if (received != last) {
+            last = received;
+            lastChange = steady_clock::now();
+        } else if (steady_clock::now() - lastChange > milliseconds{500}) {
+            break;
+        }
+    }
+    double seconds = duration<double>(lastChange - start).count();
+    string perShard;
+    for (uint64_t count : hubUdp->shardDatagramsReceived()) {
+        perShard += (perShard.empty() ? "" : "/") + to_string(count);
+    }
+    printf("%-22s delivered %7d/%-7d %9.0f messages/s  datagrams per shard %s\n", name, received.load(), messages,
+           seconds > 0.0 ? received / seconds : 0.0, perShard.c_str());
+
+    for (auto& device : devices) {
+        device->shutdown();
+    }
+    hub.shutdown();
+}
+
+#ifdef SHM_HAVE_RING
+// Same traffic as the 64-byte socket runs; futex calls per frame stand in
+// for socket calls per datagram
+static void benchSharedMemory(int messages) {
+    ValidationConfig vc;
+    auto layerA = make_unique<PhysicalLayerSharedMemory>(1, 2);
+    auto layerB = make_unique<PhysicalLayerSharedMemory>(2, 1);
+    PhysicalLayerSharedMemory* shmA = layerA.get();
+    PhysicalLayerSharedMemory* shmB = layerB.get();
+    EminentSdk sdkA(move(layerA), vc, LogLevel::NONE);
+    EminentSdk sdkB(move(layerB), vc, LogLevel::NONE);
+
+    atomic<ConnectionId> cidB{-1};
+    atomic<int> received{0};
+    sdkA.initialize(1, []() {}, [](const string&) {}, [](DeviceId, const string&) { return true; });
+    sdkB.initialize(2, []() {}, [](const string&) {}, [](DeviceId, const string&) { return true; },
+                    [&](ConnectionId id, DeviceId) {
+                        sdkB.setOnMessageHandler(id, [&](const Message&) { received++; });
+                        cidB = id;
+                    });
+    atomic<ConnectionId> cidA{-1};
+    sdkA.connect(2, 1, nullptr, nullptr, nullptr, nullptr, [&](ConnectionId id) { cidA = id; }, [](const Message&) {});
+    auto deadline = steady_clock::now() + seconds{5};
+    while ((cidA <= 0 || cidB <= 0) && steady_clock::now() < deadline) {
+        this_thread::sleep_for(milliseconds{10});
+    }
+    if (cidA <= 0 || cidB <= 0) {
+        printf("%-22s handshake failed\n", "shared memory");
+        return;
+    }
+
+    PhysicalLayerSharedMemory::Stats beforeA = shmA->stats();
+    PhysicalLayerSharedMemory::Stats beforeB = shmB->stats();
+    string payload(64, 'x');
+    auto start = steady_clock::now();
+    for (int i = 0; i < messages; ++i) {
+        while (i - received >= MAX_IN_FLIGHT && steady_clock::now() - start < seconds{20}) {
+            this_thread::sleep_for(microseconds{100});
+        }
+        sdkA.send(cidA, payload, MessageFormat::JSON, 1, /*requireAck=*/false, nullptr);
+    }
+    deadline = start + seconds{20};
+    int last = -1;
+    auto lastChange = steady_clock::now();
+    while (received < messages && steady_clock::now() < deadline) {
+        this_thread::sleep_for(milliseconds{5});
+        if (received != last) {
+            last = received;
+            lastChange = steady_clock::now();
+        } else if (steady_clock::now() - lastChange > milliseconds{500}) {
+            break;
+        }
+    }
+    double seconds = duration<double>(lastChange - start).count();
+    PhysicalLayerSharedMemory::Stats afterA = shmA->stats();
+    PhysicalLayerSharedMemory::Stats afterB = shmB->stats();
+    uint64_t frames = afterA.framesSent - beforeA.framesSent;
+    uint64_t futexCalls = afterA.wakeCalls - beforeA.wakeCalls + afterA.sleeps - beforeA.sleeps +
+                          afterB.wakeCalls - beforeB.wakeCalls + afterB.sleeps - beforeB.sleeps;
+    printf("%-22s delivered %7d/%-7d %9.0f messages/s  futex calls/frame %.3f\n", "shared memory",
+           received.load(), messages, seconds > 0.0 ? received / seconds : 0.0,
+           frames == 0 ? 0.0 : static_cast<double>(futexCalls) / static_cast<double>(frames));
+
+    sdkA.shutdown();
+    sdkB.shutdown();
+}
+#endif
+
+int main(int argc, char** argv) {
+    int messages = argc > 1 ? atoi(argv[1]) : 200000;
+
+    auto sockets = [](size_t batchSize) {
+        return [batchSize](int localPort, int remotePort) {
+            auto layer = make_unique<PhysicalLayerUdp>(localPort, "127.0.0.1", remotePort);
+            layer->setIoBatchSize(batchSize);
+            return layer;
+        };
+    };
+
+    printf("%d unacknowledged 64-byte messages over loopback\n", messages);
+    benchLayer("sockets, batch 1", sockets(1), messages, 64, true, 47401);
+    benchLayer("sockets, batch 32", sockets(PhysicalLayerUdp::DEFAULT_IO_BATCH_SIZE), messages, 64, true, 47411);
+#ifdef UDP_HAVE_IO_URING
+    // Calls counted for io_uring are io_uring_enter submissions and waits
+    auto ioUring = [](const IoUringConfig& config) {
+        return [config](int localPort, int remotePort) -> unique_ptr<PhysicalLayerUdp> {
+            return make_unique<PhysicalLayerIoUring>(localPort, "127.0.0.1", remotePort, config);
+        };
+    };
+    IoUringConfig sqPoll;
+    sqPoll.sqPoll = true;
+    try {
+        benchLayer("io_uring", ioUring(IoUringConfig{}), messages, 64, true, 47421);
+        benchLayer("io_uring, SQPOLL", ioUring(sqPoll), messages, 64, true, 47431);
+    } catch (const exception& ex) {
+        printf("io_uring unavailable: %s\n", ex.what());
+    }
+#endif
+
+    auto bulk = [](bool offload) {
+        return [offload](int localPort, int remotePort) {
+            auto layer = make_unique<PhysicalLayerUdp>(localPort, "127.0.0.1", remotePort);
+            layer->setPathMtu(BULK_PATH_MTU);
+            layer->setSegmentationOffload(offload);
+            return layer;
+        };
+    };
+    int bulkMessages = max(1, messages / 50);
+    printf("%d unacknowledged %zu-byte messages, path MTU %zu\n", bulkMessages, BULK_MESSAGE_BYTES, BULK_PATH_MTU);
+    benchLayer("sockets, no offload", bulk(false), bulkMessages, BULK_MESSAGE_BYTES, false, 47441);
+    benchLayer("sockets, GSO/GRO", bulk(true), bulkMessages, BULK_MESSAGE_BYTES, false, 47451);
+
+    // Receive shards only spread load across cores the machine has
+    printf("%d unacknowledged 64-byte messages from %d devices to one hub, %u cores\n", messages, HUB_DEVICES,
+           thread::hardware_concurrency());
+    benchHub(1, messages, 47461);
+    benchHub(4, messages, 47481);
+
+#ifdef SHM_HAVE_RING
+    printf("%d unacknowledged 64-byte messages between co-located processes\n", messages);
+    benchSharedMemory(messages);
+#endif
+    return 0;
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <condition_variable>
+#include <functional>
 #include <mutex>
 #include <queue>
 #include <utility>
@@ -17,11 +18,22 @@ public:
     void push(const T& item) {
         std::lock_guard<std::mutex> lock(mutex_);
         queue_.push(item);
+        notifyPushLocked();
     }
 
     void push(T&& item) {
         std::lock_guard<std::mutex> lock(mutex_);
         queue_.push(std::move(item));
+        notifyPushLocked();
+    }
+
+    // Called under the queue lock when a push makes the queue non-empty, so a
+    // consumer can block until there is work instead of polling. The consumer
+    // drains the queue or wakes by itself while items are left. Keep it short
+    // (e.g. an eventfd write); nullptr removes it.
+    void setOnPush(std::function<void()> onPush) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        onPush_ = std::move(onPush);
     }
 
     bool tryPop(T& out) {
@@ -44,6 +56,25 @@ public:
         return queue_.size();
     }
 
+    // Removes the items `pred` accepts, keeping the order of the rest.
+    // `pred` may move from the items it accepts.
+    template <typename Predicate>
+    size_t removeIf(Predicate pred) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::queue<T> kept;
+        size_t removed = 0;
+        while (!queue_.empty()) {
+            if (pred(queue_.front())) {
+                ++removed;
+            } else {
+                kept.push(std::move(queue_.front()));
+            }
+            queue_.pop();
+        }
+        std::swap(queue_, kept);
+        return removed;
+    }
+
     void clear() {
         std::lock_guard<std::mutex> lock(mutex_);
         std::queue<T> empty;
@@ -51,6 +82,13 @@ public:
     }
 
 private:
+    void notifyPushLocked() {
+        if (onPush_ && queue_.size() == 1) {
+            onPush_();
+        }
+    }
+
     mutable std::mutex mutex_;
     std::queue<T> queue_;
+    std::function<void()> onPush_;
 };
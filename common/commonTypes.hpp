@@ -1,5 +1,7 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
 #include <functional>
 #include <queue>
 #include <string>
@@ -13,6 +15,11 @@ using ConnectionId = int;
 using MessageId = int;
 using PackageId = int;
 using Priority = int;
+using StreamId = int;
+using ChannelId = int;
+// Address of a peer as a multi-peer physical layer encodes it (UDP: IPv4
+// address and port); 0 = unknown
+using LinkAddress = uint64_t;
 
 enum class MessageFormat {
     JSON,
@@ -21,7 +28,11 @@ enum class MessageFormat {
     CONFIRMATION,
     DISCONNECT,
     HEARTBEAT,
-    HEARTBEAT_ACK
+    HEARTBEAT_ACK,
+    STREAM,
+    TELEMETRY,
+    // Multicast group feed record (GroupFeed.hpp): data, NACK or announce
+    GROUP
 };
 
 enum class PackageStatus {
@@ -33,6 +44,15 @@ enum class PackageStatus {
 
 struct Frame {
     vector<uint8_t> data;
+    // Connection the frame was serialized for; not part of the wire format
+    ConnectionId connId = -1;
+    // Multi-peer links: where a received frame came from, and where an
+    // outgoing one goes when set (else to its connection's device)
+    LinkAddress peer = 0;
+    // Acknowledged data, which the congestion controllers' pacing rate is
+    // meant for. ACKs, control messages and unacknowledged traffic are sent
+    // as soon as they come and pass frames waiting for the pacer.
+    bool paced = false;
 };
 
 struct Package {
@@ -46,24 +66,117 @@ struct Package {
     Priority priority;
     bool requireAck;
     PackageStatus status = PackageStatus::QUEUED;
+    // Fragment index/count use the 32-bit extension fields of the header
+    // instead of the configured bit widths (large-message mode).
+    bool extendedFragments = false;
+    // Payload of the whole message is compressed (CAPABILITY_COMPRESSION).
+    bool compressed = false;
+    // Payload is a delta-mode record (CAPABILITY_DELTA).
+    bool delta = false;
+    // Milliseconds left until the message's deadline when this copy was sent
+    // (FLAG_DEADLINE); 0 = no deadline or more than the field can hold.
+    uint16_t ttlMs = 0;
+    // Ordered delivery (FLAG_ORDERED): the message's sequence number on its
+    // ordered stream, and how far below it the oldest message the sender
+    // still (re)sends on that stream is. The receiver skips missing messages
+    // further back instead of waiting for them.
+    bool ordered = false;
+    uint8_t orderedStream = 0;
+    uint16_t sequence = 0;
+    uint16_t sequenceGap = 0;
+    // Frame::peer of the package; ACKs go back to the source of what they
+    // acknowledge
+    LinkAddress peer = 0;
 };
 
 struct ConnectionStats {
     ConnectionId id;
+    // Smoothed round-trip time of acknowledged packages
     double avgLatencyMs;
+    // Share of transmissions that were retransmits
     double packetLossPercent;
+    // Acknowledged payload since the first acknowledged send
     double throughputMbps;
     int queuedMessages;
+    double rttVarianceMs = 0.0;
+    // Current retransmission timeout (before per-package backoff)
+    double retransmitTimeoutMs = 0.0;
+    // Packages the congestion controller allows in flight; 0 when it is off
+    int congestionWindow = 0;
+    double pacingRateMbps = 0.0;
+    // Outgoing messages dropped at their deadline
+    uint64_t expiredMessages = 0;
+    // Incomplete inbound messages discarded at the sender's deadline
+    uint64_t expiredReassemblies = 0;
+    // Outgoing messages replaced by a newer one with the same conflation key
+    uint64_t conflatedMessages = 0;
+    // Inbound ordered messages held back for an earlier one, and earlier
+    // ones skipped because their sender gave up on them
+    uint64_t reorderedMessages = 0;
+    uint64_t skippedMessages = 0;
 };
 
+// How a connection hands inbound messages up. UNORDERED delivers each one as
+// soon as it is complete; ORDERED keeps the send order per ordered stream.
+enum class DeliveryMode {
+    UNORDERED,
+    ORDERED
+};
+
+// Built from the fields every message has; the optional ones below are
+// assigned by name afterwards.
 struct Message {
-    MessageId id;
-    ConnectionId connId;
+    Message() = default;
+    Message(MessageId id, ConnectionId connId, string payload, MessageFormat format, Priority priority,
+            bool requireAck, function<void()> onDelivered = nullptr)
+        : id(id), connId(connId), payload(move(payload)), format(format), priority(priority),
+          requireAck(requireAck), onDelivered(move(onDelivered)) {}
+
+    MessageId id = 0;
+    ConnectionId connId = 0;
     string payload;
-    MessageFormat format;
-    Priority priority;
-    bool requireAck;
+    MessageFormat format = MessageFormat::JSON;
+    Priority priority = 0;
+    bool requireAck = false;
     function<void()> onDelivered;
+    // Set by the SDK when the connection negotiated CAPABILITY_LARGE_MESSAGES.
+    bool allowExtendedFragments = false;
+    // Payload was compressed by the sender before encryption.
+    bool compressed = false;
+    // Payload is a DeltaChannel record (snapshot or diff).
+    bool delta = false;
+    // Past this point the message is dropped instead of (re)sent and
+    // onExpired runs in place of onDelivered; default = no deadline.
+    chrono::steady_clock::time_point deadline{};
+    function<void()> onExpired;
+    // Latest value wins: a newer message of the connection with the same
+    // non-empty key replaces this one while it has not gone out
+    string conflationKey;
+    // Runs in place of onDelivered when the message is given up: retransmits
+    // exhausted, a send failed, its connection was closed or a newer message
+    // of its conflation key replaced it. Not called for expired messages.
+    function<void(const string& reason)> onFailed;
+    // Delivered in send order relative to the other messages of its ordered
+    // stream (0-255) on the connection; streams do not wait for each other
+    bool ordered = false;
+    uint8_t orderedStream = 0;
+    // Link address the message came from, or is sent to when set (replies
+    // to a peer the link has no route for yet)
+    LinkAddress peer = 0;
+};
+
+// Protocol capabilities advertised during the handshake. A feature is used on
+// a connection only when both peers advertised it.
+enum ProtocolCapability : uint32_t {
+    CAPABILITY_BINARY_CONTROL = 1u << 0,
+    CAPABILITY_LARGE_MESSAGES = 1u << 1,
+    CAPABILITY_STREAMS = 1u << 2,
+    CAPABILITY_HEADER_COMPRESSION = 1u << 3,
+    CAPABILITY_COMPRESSION = 1u << 4,
+    CAPABILITY_DELTA = 1u << 5,
+    CAPABILITY_TELEMETRY = 1u << 6,
+    CAPABILITY_FEC = 1u << 7,
+    CAPABILITY_ORDERED = 1u << 8
 };
 
 enum class ConnectionStatus {
@@ -81,7 +194,13 @@ struct Connection {
     function<void(const string&)> onTrouble;
     function<void()> onDisconnected;
     function<void(ConnectionId)> onConnected;
+    // In-order data of inbound streams; `finished` is set on the last chunk
+    function<void(StreamId, const string& data, bool finished)> onStreamChunk;
+    // Decoded sample batches of one telemetry channel
+    function<void(ChannelId, const vector<int64_t>& timestamps, const vector<double>& values)> onSamples;
     ConnectionStatus status = ConnectionStatus::PENDING;
     int specialCode = 0;
+    uint32_t capabilities = 0;
+    DeliveryMode deliveryMode = DeliveryMode::UNORDERED;
 };
 
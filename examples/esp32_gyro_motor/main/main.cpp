@@ -12,7 +12,8 @@
  * This firmware:
  *   1. Connects to WiFi
  *   2. Establishes encrypted connection with Mac app via EminentSdk
- *   3. Sends gyroscope readings as JSON every 100ms
+ *   3. Samples the gyroscope every 100ms and sends 1 s batches of
+ *      numeric telemetry (one channel per axis, see sendSamples)
  *   4. Receives motor speed commands from Mac
  *
  * Build with ESP-IDF:
@@ -35,6 +36,7 @@
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "nvs_flash.h"
 #include "driver/i2c.h"
 #include "driver/ledc.h"
@@ -57,6 +59,13 @@ static const char* TAG = "GyroMotor";
 #define DEVICE_ID       1                 // This device's ID
 #define MAC_DEVICE_ID   2                 // Mac device's ID
 
+// Telemetry channels (must match mac_console)
+enum TelemetryChannel : ChannelId {
+    CH_GX, CH_GY, CH_GZ, CH_AX, CH_AY, CH_AZ, CH_MOTOR, CH_COUNT
+};
+#define SAMPLE_PERIOD_MS   100
+#define SAMPLES_PER_BATCH  10                // one batch per second
+
 // I2C config for MPU6050
 #define I2C_MASTER_NUM     I2C_NUM_0
 #define I2C_MASTER_SDA     GPIO_NUM_21
@@ -287,30 +296,46 @@ extern "C" void app_main() {
         std::chrono::milliseconds{10000}
     );
 
-    // 6. Main loop: read gyroscope, send telemetry
-    ESP_LOGI(TAG, "Entering main loop — sending gyro data every 100ms");
+    // 6. Main loop: sample gyroscope, send telemetry batches
+    ESP_LOGI(TAG, "Entering main loop — sampling every %d ms", SAMPLE_PERIOD_MS);
+
+    std::vector<int64_t> timestamps;
+    std::vector<double> samples[CH_COUNT];
+    timestamps.reserve(SAMPLES_PER_BATCH);
+    for (auto& channel : samples) {
+        channel.reserve(SAMPLES_PER_BATCH);
+    }
 
     while (true) {
         if (g_connected && g_connectionId > 0) {
             GyroData gyro = read_mpu6050();
 
-            // Format as JSON telemetry
-            char json[256];
-            snprintf(json, sizeof(json),
-                "{\"gx\":%.2f,\"gy\":%.2f,\"gz\":%.2f,"
-                "\"ax\":%.2f,\"ay\":%.2f,\"az\":%.2f,"
-                "\"motor\":%d}",
-                gyro.gx, gyro.gy, gyro.gz,
-                gyro.ax, gyro.ay, gyro.az,
-                g_motorSpeed.load());
-
-            try {
-                sdk->send(g_connectionId, std::string(json), nullptr);
-            } catch (const std::exception& ex) {
-                ESP_LOGW(TAG, "Send failed: %s", ex.what());
+            timestamps.push_back(esp_timer_get_time() / 1000);  // ms since boot
+            samples[CH_GX].push_back(gyro.gx);
+            samples[CH_GY].push_back(gyro.gy);
+            samples[CH_GZ].push_back(gyro.gz);
+            samples[CH_AX].push_back(gyro.ax);
+            samples[CH_AY].push_back(gyro.ay);
+            samples[CH_AZ].push_back(gyro.az);
+            samples[CH_MOTOR].push_back(g_motorSpeed.load());
+
+            // Delta-of-delta timestamps and XOR-coded floats: a few bytes per
+            // sample instead of a ~60-byte JSON object
+            if (timestamps.size() == SAMPLES_PER_BATCH) {
+                try {
+                    for (int ch = 0; ch < CH_COUNT; ++ch) {
+                        sdk->sendSamples(g_connectionId, ch, timestamps, samples[ch]);
+                    }
+                } catch (const std::exception& ex) {
+                    ESP_LOGW(TAG, "Send failed: %s", ex.what());
+                }
+                timestamps.clear();
+                for (auto& channel : samples) {
+                    channel.clear();
+                }
             }
         }
 
-        vTaskDelay(pdMS_TO_TICKS(100)); // 10 Hz telemetry rate
+        vTaskDelay(pdMS_TO_TICKS(SAMPLE_PERIOD_MS)); // 10 Hz sampling rate
     }
 }
@@ -5,7 +5,7 @@
  *
  * This application:
  *   1. Connects to ESP32 via WiFi (UDP)
- *   2. Displays gyroscope telemetry in the terminal
+ *   2. Displays gyroscope telemetry (numeric sample batches) in the terminal
  *   3. Allows typing motor speed commands (0-255)
  *
  * Build:
@@ -67,6 +67,29 @@ static ConnectionId g_connectionId = -1;
 // ============================================================
 // Telemetry display
 // ============================================================
+// Channels sent by the ESP32 (see sendSamples in esp32_gyro_motor)
+static const char* CHANNEL_NAMES[] = {"gx", "gy", "gz", "ax", "ay", "az", "motor"};
+static const int CHANNEL_COUNT = 7;
+static double g_latest[CHANNEL_COUNT] = {};
+
+static void on_samples_received(ChannelId channel, const vector<int64_t>& timestamps, const vector<double>& values) {
+    if (channel < 0 || channel >= CHANNEL_COUNT || values.empty()) {
+        return;
+    }
+    g_latest[channel] = values.back();
+    // The last channel of a batch completes a row
+    if (channel != CHANNEL_COUNT - 1) {
+        return;
+    }
+    printf("\r\033[K");  // Clear current line
+    printf("📡 t=%lld ms", static_cast<long long>(timestamps.back()));
+    for (int ch = 0; ch < CHANNEL_COUNT; ++ch) {
+        printf(" %s=%.2f", CHANNEL_NAMES[ch], g_latest[ch]);
+    }
+    printf(" (%zu samples)\n> ", values.size());
+    fflush(stdout);
+}
+
 static void on_message_received(const Message& msg) {
     // Clear line and print telemetry
     printf("\r\033[K");  // Clear current line
@@ -172,6 +195,8 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    sdk.setOnSamples(g_connectionId, on_samples_received);
+
     // 6. Interactive loop
     printf("\n");
     printf("━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n");
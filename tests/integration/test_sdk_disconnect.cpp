@@ -166,6 +166,9 @@ TEST_F(DisconnectIntegration, ShutdownCleansAllConnections) {
     // B may or may not get the notification depending on timing
     // The key assertion is that shutdown doesn't crash
     SUCCEED() << "Shutdown completed without crash";
+    // B's handler captures bDisconnected; if the notification was lost it would
+    // run from TearDown's shutdown after this scope ended
+    sdkB->shutdown();
 }
 
 // ============================================================
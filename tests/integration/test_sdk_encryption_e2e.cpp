@@ -197,6 +197,36 @@ TEST_F(EncryptionE2E, WrongKeyProducesGarbage) {
     // If not received at all, that's also acceptable (decryption failure can drop message)
 }
 
+// ============================================================
+// TEST: Compression runs before encryption and is undone on receive
+// ============================================================
+TEST_F(EncryptionE2E, CompressedJsonDecryptedAndInflated) {
+    initBoth();
+    auto [cidA, cidB] = connectAtoB();
+    ASSERT_GT(cidA, 0);
+    ASSERT_GT(cidB, 0);
+
+    atomic<bool> received{false};
+    string receivedPayload;
+
+    sdkB->setOnMessageHandler(cidB, [&](const Message& msg) {
+        receivedPayload = msg.payload;
+        received = true;
+    });
+
+    string original = "[";
+    for (int i = 0; i < 40; ++i) {
+        original += R"({"sensor":"imu","ts":)" + to_string(1000 + i * 100) + R"(,"az":9.81,"status":"ok"},)";
+    }
+    original.back() = ']';
+    ASSERT_GE(original.size(), EminentSdk::DEFAULT_COMPRESSION_THRESHOLD_BYTES);
+
+    sdkA->send(cidA, original, MessageFormat::JSON, 5, false, nullptr);
+
+    ASSERT_TRUE(waitFor(received, 5000ms));
+    EXPECT_EQ(receivedPayload, original);
+}
+
 // ============================================================
 // TEST: Encryption disabled → plaintext arrives as-is
 // ============================================================
@@ -127,6 +127,10 @@ TEST_F(HeartbeatIntegration, HeartbeatMissDetected) {
 
     EXPECT_TRUE(heartbeatMissed || disconnected)
         << "A should detect peer loss (heartbeat miss or disconnect)";
+
+    // Shutting down disconnects what is still open, which calls onDisconnected:
+    // do it while the flags it captures are alive, not in TearDown
+    sdkA->shutdown();
 }
 
 // ============================================================
@@ -101,6 +101,8 @@ TEST_F(RetransmissionIntegration, AckedMessageDelivered) {
 
     ASSERT_TRUE(waitFor(received, 5000ms)) << "B should receive the message";
     EXPECT_EQ(receivedPayload, "Reliable message");
+    // onDelivered writes to this frame's locals, so it must fire before we return
+    EXPECT_TRUE(waitFor(delivered, 5000ms)) << "A should get the delivery confirmation";
 }
 
 // ============================================================